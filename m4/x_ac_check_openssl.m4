@@ -24,6 +24,8 @@ AC_DEFUN([X_AC_CHECK_OPENSSL], [
     EVP_CIPHER_CTX_free \
     EVP_CIPHER_CTX_init \
     EVP_CIPHER_CTX_new \
+    EVP_CIPHER_fetch \
+    EVP_CIPHER_get0_name \
     EVP_CipherFinal \
     EVP_CipherFinal_ex \
     EVP_CipherInit \
@@ -51,6 +53,8 @@ AC_DEFUN([X_AC_CHECK_OPENSSL], [
     EVP_Q_mac \
     EVP_aes_128_cbc \
     EVP_aes_256_cbc \
+    EVP_blake2b512 \
+    EVP_blake2s256 \
     EVP_sha256 \
     EVP_sha512 \
     HMAC \
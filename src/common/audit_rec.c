@@ -0,0 +1,175 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <string.h>
+#include "audit_rec.h"
+
+
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static unsigned char * _audit_put32 (unsigned char *p, uint32_t u);
+static const unsigned char * _audit_get32 (const unsigned char *p,
+        uint32_t *up);
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+/*  Packs the audit log header into the buffer [dst] of AUDIT_HDR_LEN bytes.
+ */
+void
+audit_hdr_pack (unsigned char *dst)
+{
+    unsigned char *p = dst;
+
+    assert (dst != NULL);
+
+    memcpy (p, AUDIT_MAGIC, AUDIT_MAGIC_LEN);
+    p += AUDIT_MAGIC_LEN;
+    p = _audit_put32 (p, AUDIT_VERSION);
+    p = _audit_put32 (p, AUDIT_REC_LEN);
+    assert (p - dst == AUDIT_HDR_LEN);
+    return;
+}
+
+
+/*  Checks the audit log header in the buffer [src] of AUDIT_HDR_LEN bytes.
+ *  Returns 0 if it matches the format understood here, or -1 if not.
+ */
+int
+audit_hdr_unpack (const unsigned char *src)
+{
+    const unsigned char *p = src;
+    uint32_t             version;
+    uint32_t             rec_len;
+
+    assert (src != NULL);
+
+    if (memcmp (p, AUDIT_MAGIC, AUDIT_MAGIC_LEN) != 0) {
+        return (-1);
+    }
+    p += AUDIT_MAGIC_LEN;
+    p = _audit_get32 (p, &version);
+    p = _audit_get32 (p, &rec_len);
+    if ((version != AUDIT_VERSION) || (rec_len != AUDIT_REC_LEN)) {
+        return (-1);
+    }
+    return (0);
+}
+
+
+/*  Packs the audit record [r] into the buffer [dst] of AUDIT_REC_LEN bytes.
+ */
+void
+audit_rec_pack (unsigned char *dst, const struct audit_rec *r)
+{
+    unsigned char *p = dst;
+
+    assert (dst != NULL);
+    assert (r != NULL);
+    assert (r->mac_len <= AUDIT_MAC_PREFIX_LEN);
+
+    p = _audit_put32 (p, r->time_dec);
+    p = _audit_put32 (p, r->time_enc);
+    p = _audit_put32 (p, r->client_uid);
+    p = _audit_put32 (p, r->client_gid);
+    p = _audit_put32 (p, r->cred_uid);
+    p = _audit_put32 (p, r->cred_gid);
+    memcpy (p, r->addr, sizeof (r->addr));
+    p += sizeof (r->addr);
+    *p++ = r->mac_type;
+    *p++ = r->mac_len;
+    *p++ = 0;                           /* reserved */
+    *p++ = 0;                           /* reserved */
+    memcpy (p, r->mac, AUDIT_MAC_PREFIX_LEN);
+    p += AUDIT_MAC_PREFIX_LEN;
+    assert (p - dst == AUDIT_REC_LEN);
+    return;
+}
+
+
+/*  Unpacks the audit record in the buffer [src] of AUDIT_REC_LEN bytes
+ *    into [r].
+ */
+void
+audit_rec_unpack (struct audit_rec *r, const unsigned char *src)
+{
+    const unsigned char *p = src;
+
+    assert (r != NULL);
+    assert (src != NULL);
+
+    p = _audit_get32 (p, &r->time_dec);
+    p = _audit_get32 (p, &r->time_enc);
+    p = _audit_get32 (p, &r->client_uid);
+    p = _audit_get32 (p, &r->client_gid);
+    p = _audit_get32 (p, &r->cred_uid);
+    p = _audit_get32 (p, &r->cred_gid);
+    memcpy (r->addr, p, sizeof (r->addr));
+    p += sizeof (r->addr);
+    r->mac_type = *p++;
+    r->mac_len = *p++;
+    p += 2;                             /* reserved */
+    memcpy (r->mac, p, AUDIT_MAC_PREFIX_LEN);
+    if (r->mac_len > AUDIT_MAC_PREFIX_LEN) {
+        r->mac_len = AUDIT_MAC_PREFIX_LEN;
+    }
+    return;
+}
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static unsigned char *
+_audit_put32 (unsigned char *p, uint32_t u)
+{
+    u = htonl (u);
+    memcpy (p, &u, sizeof (u));
+    return (p + sizeof (u));
+}
+
+
+static const unsigned char *
+_audit_get32 (const unsigned char *p, uint32_t *up)
+{
+    uint32_t u;
+
+    memcpy (&u, p, sizeof (u));
+    *up = ntohl (u);
+    return (p + sizeof (u));
+}
@@ -0,0 +1,82 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#ifndef MUNGE_AUDIT_REC_H
+#define MUNGE_AUDIT_REC_H
+
+#include <inttypes.h>
+
+
+/*****************************************************************************
+ *  Constants
+ *****************************************************************************/
+
+/*  The audit log starts with a header of AUDIT_HDR_LEN bytes:
+ *    the AUDIT_MAGIC string (without NUL), the format version, and the
+ *    record length.  It is followed by records of AUDIT_REC_LEN bytes each.
+ *  All integers are stored in network byte order.
+ */
+#define AUDIT_MAGIC             "MUNGEAUD"
+#define AUDIT_MAGIC_LEN         8
+#define AUDIT_VERSION           1
+#define AUDIT_HDR_LEN           16
+#define AUDIT_REC_LEN           40
+#define AUDIT_MAC_PREFIX_LEN    8
+
+
+/*****************************************************************************
+ *  Data Types
+ *****************************************************************************/
+
+struct audit_rec {
+    uint32_t        time_dec;           /* time at which cred was decoded    */
+    uint32_t        time_enc;           /* time at which cred was encoded    */
+    uint32_t        client_uid;         /* UID of client that decoded cred   */
+    uint32_t        client_gid;         /* GID of client that decoded cred   */
+    uint32_t        cred_uid;           /* UID of client that encoded cred   */
+    uint32_t        cred_gid;           /* GID of client that encoded cred   */
+    uint8_t         addr[4];            /* IPv4 addr where cred was encoded  */
+    uint8_t         mac_type;           /* munge_mac_t enum                  */
+    uint8_t         mac_len;            /* num bytes of MAC prefix           */
+    uint8_t         mac[AUDIT_MAC_PREFIX_LEN];  /* prefix of cred MAC        */
+};
+
+
+/*****************************************************************************
+ *  Prototypes
+ *****************************************************************************/
+
+void audit_hdr_pack (unsigned char *dst);
+
+int audit_hdr_unpack (const unsigned char *src);
+
+void audit_rec_pack (unsigned char *dst, const struct audit_rec *r);
+
+void audit_rec_unpack (struct audit_rec *r, const unsigned char *src);
+
+
+#endif /* !MUNGE_AUDIT_REC_H */
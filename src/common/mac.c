@@ -535,9 +535,13 @@ _mac_map_enum (munge_mac_t md, void *dst)
           OSSL_PARAM_END },             /* MUNGE_MAC_SHA256 */
         { OSSL_PARAM_utf8_string (OSSL_ALG_PARAM_DIGEST, "SHA2-512", 8),
           OSSL_PARAM_END },             /* MUNGE_MAC_SHA512 */
+        { OSSL_PARAM_utf8_string (OSSL_ALG_PARAM_DIGEST, "BLAKE2S-256", 11),
+          OSSL_PARAM_END },             /* MUNGE_MAC_BLAKE2S256 */
+        { OSSL_PARAM_utf8_string (OSSL_ALG_PARAM_DIGEST, "BLAKE2B-512", 11),
+          OSSL_PARAM_END },             /* MUNGE_MAC_BLAKE2B512 */
     };
 
-    if ((md < MUNGE_MAC_MD5) || (md > MUNGE_MAC_SHA512)) {
+    if ((md < MUNGE_MAC_MD5) || (md > MUNGE_MAC_BLAKE2B512)) {
         return (-1);
     }
     if (dst != NULL) {
@@ -123,6 +123,19 @@ main (int argc, char *argv[])
         0xef, 0x39, 0x87, 0xac, 0xb3, 0xb9, 0x7e, 0x73, 0x10, 0x9b, 0xae, 0xde,
         0xce, 0x1b, 0xd4, 0x79
     };
+    const unsigned char out_blake2s256[32] = {
+        0x39, 0x4c, 0xa7, 0x81, 0xef, 0xdf, 0x32, 0xce, 0x5c, 0x6e, 0xd5, 0xa8,
+        0x9c, 0x09, 0x26, 0x42, 0x2e, 0x5e, 0xcc, 0xf1, 0x6a, 0xa2, 0x01, 0x88,
+        0x6f, 0x16, 0xc7, 0x69, 0x34, 0x7d, 0x26, 0x6a
+    };
+    const unsigned char out_blake2b512[64] = {
+        0x4d, 0x2e, 0x79, 0x85, 0x4a, 0x36, 0xcf, 0x10, 0x3a, 0x52, 0x96, 0xc3,
+        0x22, 0x95, 0xc7, 0x1a, 0x64, 0xf9, 0x18, 0xf7, 0x2d, 0xdc, 0x8c, 0xf4,
+        0x81, 0x1f, 0x34, 0x37, 0xeb, 0xd1, 0xb4, 0x40, 0xb6, 0xd0, 0xf1, 0xa3,
+        0x67, 0xac, 0xbf, 0xb4, 0x87, 0x30, 0x0d, 0xf9, 0x42, 0xf3, 0xe2, 0x88,
+        0xcf, 0x28, 0xaf, 0x31, 0xa0, 0xc7, 0x1d, 0xe2, 0xc9, 0xff, 0x64, 0x52,
+        0x8d, 0xd1, 0x89, 0xcf
+    };
 
     crypto_init ();
     md_init_subsystem ();
@@ -144,6 +157,12 @@ main (int argc, char *argv[])
     check_mac (MUNGE_MAC_SHA512, "MUNGE_MAC_SHA512", key, strlen (key),
             in, strlen (in), out_sha512, sizeof (out_sha512));
 
+    check_mac (MUNGE_MAC_BLAKE2S256, "MUNGE_MAC_BLAKE2S256", key, strlen (key),
+            in, strlen (in), out_blake2s256, sizeof (out_blake2s256));
+
+    check_mac (MUNGE_MAC_BLAKE2B512, "MUNGE_MAC_BLAKE2B512", key, strlen (key),
+            in, strlen (in), out_blake2b512, sizeof (out_blake2b512));
+
     done_testing ();
 
     crypto_fini ();
@@ -229,6 +229,8 @@ _md_init_subsystem (void)
     _md_map [MUNGE_MAC_RIPEMD160] = GCRY_MD_RMD160;
     _md_map [MUNGE_MAC_SHA256] = GCRY_MD_SHA256;
     _md_map [MUNGE_MAC_SHA512] = GCRY_MD_SHA512;
+    _md_map [MUNGE_MAC_BLAKE2S256] = GCRY_MD_BLAKE2S_256;
+    _md_map [MUNGE_MAC_BLAKE2B512] = GCRY_MD_BLAKE2B_512;
     return;
 }
 
@@ -363,6 +365,14 @@ _md_init_subsystem (void)
     _md_map [MUNGE_MAC_SHA512] = EVP_sha512 ();
 #endif /* HAVE_EVP_SHA512 */
 
+#if HAVE_EVP_BLAKE2S256
+    _md_map [MUNGE_MAC_BLAKE2S256] = EVP_blake2s256 ();
+#endif /* HAVE_EVP_BLAKE2S256 */
+
+#if HAVE_EVP_BLAKE2B512
+    _md_map [MUNGE_MAC_BLAKE2B512] = EVP_blake2b512 ();
+#endif /* HAVE_EVP_BLAKE2B512 */
+
     return;
 }
 
@@ -0,0 +1,178 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <string.h>
+#include "trace_rec.h"
+
+
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static unsigned char * _trace_put32 (unsigned char *p, uint32_t u);
+static const unsigned char * _trace_get32 (const unsigned char *p,
+        uint32_t *up);
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+/*  Packs the request trace header for a trace started at [time_start]
+ *    into the buffer [dst] of TRACE_HDR_LEN bytes.
+ */
+void
+trace_hdr_pack (unsigned char *dst, uint32_t time_start)
+{
+    unsigned char *p = dst;
+
+    assert (dst != NULL);
+
+    memcpy (p, TRACE_MAGIC, TRACE_MAGIC_LEN);
+    p += TRACE_MAGIC_LEN;
+    p = _trace_put32 (p, TRACE_VERSION);
+    p = _trace_put32 (p, TRACE_REC_LEN);
+    p = _trace_put32 (p, time_start);
+    assert (p - dst == TRACE_HDR_LEN);
+    return;
+}
+
+
+/*  Checks the request trace header in the buffer [src] of TRACE_HDR_LEN
+ *    bytes, setting [time_start] (if non-NULL) to the time at which the
+ *    trace was started.
+ *  Returns 0 if it matches the format understood here, or -1 if not.
+ */
+int
+trace_hdr_unpack (const unsigned char *src, uint32_t *time_start)
+{
+    const unsigned char *p = src;
+    uint32_t             version;
+    uint32_t             rec_len;
+    uint32_t             t;
+
+    assert (src != NULL);
+
+    if (memcmp (p, TRACE_MAGIC, TRACE_MAGIC_LEN) != 0) {
+        return (-1);
+    }
+    p += TRACE_MAGIC_LEN;
+    p = _trace_get32 (p, &version);
+    p = _trace_get32 (p, &rec_len);
+    p = _trace_get32 (p, &t);
+    if ((version != TRACE_VERSION) || (rec_len != TRACE_REC_LEN)) {
+        return (-1);
+    }
+    if (time_start != NULL) {
+        *time_start = t;
+    }
+    return (0);
+}
+
+
+/*  Packs the trace record [r] into the buffer [dst] of TRACE_REC_LEN bytes.
+ */
+void
+trace_rec_pack (unsigned char *dst, const struct trace_rec *r)
+{
+    unsigned char *p = dst;
+
+    assert (dst != NULL);
+    assert (r != NULL);
+
+    p = _trace_put32 (p, r->arrive_secs);
+    p = _trace_put32 (p, r->arrive_usecs);
+    p = _trace_put32 (p, r->service_usecs);
+    p = _trace_put32 (p, r->data_len);
+    p = _trace_put32 (p, r->ttl);
+    *p++ = r->type;
+    *p++ = r->cipher;
+    *p++ = r->mac;
+    *p++ = r->zip;
+    *p++ = r->flags;
+    *p++ = r->error_num;
+    *p++ = 0;                           /* reserved */
+    *p++ = 0;                           /* reserved */
+    assert (p - dst == TRACE_REC_LEN);
+    return;
+}
+
+
+/*  Unpacks the trace record in the buffer [src] of TRACE_REC_LEN bytes
+ *    into [r].
+ */
+void
+trace_rec_unpack (struct trace_rec *r, const unsigned char *src)
+{
+    const unsigned char *p = src;
+
+    assert (r != NULL);
+    assert (src != NULL);
+
+    p = _trace_get32 (p, &r->arrive_secs);
+    p = _trace_get32 (p, &r->arrive_usecs);
+    p = _trace_get32 (p, &r->service_usecs);
+    p = _trace_get32 (p, &r->data_len);
+    p = _trace_get32 (p, &r->ttl);
+    r->type = *p++;
+    r->cipher = *p++;
+    r->mac = *p++;
+    r->zip = *p++;
+    r->flags = *p++;
+    r->error_num = *p++;
+    return;
+}
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static unsigned char *
+_trace_put32 (unsigned char *p, uint32_t u)
+{
+    u = htonl (u);
+    memcpy (p, &u, sizeof (u));
+    return (p + sizeof (u));
+}
+
+
+static const unsigned char *
+_trace_get32 (const unsigned char *p, uint32_t *up)
+{
+    uint32_t u;
+
+    memcpy (&u, p, sizeof (u));
+    *up = ntohl (u);
+    return (p + sizeof (u));
+}
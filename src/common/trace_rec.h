@@ -0,0 +1,91 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#ifndef MUNGE_TRACE_REC_H
+#define MUNGE_TRACE_REC_H
+
+#include <inttypes.h>
+
+
+/*****************************************************************************
+ *  Constants
+ *****************************************************************************/
+
+/*  The request trace starts with a header of TRACE_HDR_LEN bytes:
+ *    the TRACE_MAGIC string (without NUL), the format version, the record
+ *    length, and the time at which the trace was started.  It is followed by
+ *    records of TRACE_REC_LEN bytes each.
+ *  All integers are stored in network byte order.
+ */
+#define TRACE_MAGIC             "MUNGETRC"
+#define TRACE_MAGIC_LEN         8
+#define TRACE_VERSION           1
+#define TRACE_HDR_LEN           20
+#define TRACE_REC_LEN           28
+
+/*  Flags for the credential restrictions of a request.
+ */
+#define TRACE_FLAG_AUTH_UID     0x01
+#define TRACE_FLAG_AUTH_GID     0x02
+
+
+/*****************************************************************************
+ *  Data Types
+ *****************************************************************************/
+
+/*  A trace record describes the shape of a request without identifying the
+ *    client, the credential, or its payload.
+ */
+struct trace_rec {
+    uint32_t        arrive_secs;        /* secs since trace start at arrival */
+    uint32_t        arrive_usecs;       /* usecs past [arrive_secs]          */
+    uint32_t        service_usecs;      /* usecs from arrival to response    */
+    uint32_t        data_len;           /* length of payload data            */
+    uint32_t        ttl;                /* time-to-live                      */
+    uint8_t         type;               /* m_msg_type of request             */
+    uint8_t         cipher;             /* munge_cipher_t enum               */
+    uint8_t         mac;                /* munge_mac_t enum                  */
+    uint8_t         zip;                /* munge_zip_t enum                  */
+    uint8_t         flags;              /* TRACE_FLAG_* restrictions         */
+    uint8_t         error_num;          /* munge_err_t of response           */
+};
+
+
+/*****************************************************************************
+ *  Prototypes
+ *****************************************************************************/
+
+void trace_hdr_pack (unsigned char *dst, uint32_t time_start);
+
+int trace_hdr_unpack (const unsigned char *src, uint32_t *time_start);
+
+void trace_rec_pack (unsigned char *dst, const struct trace_rec *r);
+
+void trace_rec_unpack (struct trace_rec *r, const unsigned char *src);
+
+
+#endif /* !MUNGE_TRACE_REC_H */
@@ -33,6 +33,7 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -51,6 +52,8 @@
 
 #define LOG_BUFFER_MAXLEN       1024
 #define LOG_IDENTITY_MAXLEN     128
+#define LOG_LIMIT_BURST         5
+#define LOG_LIMIT_SECS          60
 #define LOG_PREFIX_MAXLEN       9
 #define LOG_TRUNC_SUFFIX        "+"
 
@@ -76,6 +79,13 @@ struct log_ctx {
 
 static struct log_ctx log_ctx = { NULL, 0, 0, 0, 0, 0, { '\0' } };
 
+/*  The mutex protects the rate-limiting state of all log_limit sites, which
+ *    are linked onto log_limit_list the first time they are used.  It is
+ *    never held while a message is written since that can block on I/O.
+ */
+static pthread_mutex_t log_limit_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct log_limit *log_limit_list = NULL;
+
 
 /*****************************************************************************
  *  Static Prototypes
@@ -84,6 +94,9 @@ static struct log_ctx log_ctx = { NULL, 0, 0, 0, 0, 0, { '\0' } };
 static void _log_aux (int errnum, int priority, char *msgbuf, int msgbuflen,
         const char *format, va_list vargs);
 static void _log_die (int status, int priority, const char *msg);
+static void _log_limit_reset (struct log_limit *lp, time_t now,
+        struct log_limit *sp);
+static void _log_limit_summary (const struct log_limit *sp);
 static char * _log_prefix (int priority);
 
 
@@ -195,6 +208,18 @@ log_close_all (void)
 }
 
 
+/*  Changes the [priority] level at and above which messages are logged,
+ *    both to the file stream and to syslog.
+ */
+void
+log_set_priority (int priority)
+{
+    log_ctx.priority = (priority > 0) ? priority : 0;
+    (void) setlogmask (LOG_UPTO (log_ctx.priority));
+    return;
+}
+
+
 /*  Logs a fatal message at the specified [priority] level according to
  *    the printf-style [format] string, after which it exits the program
  *    with the specified [status] value.
@@ -276,10 +301,162 @@ log_err_or_warn (int got_force, const char *format, ...)
 }
 
 
+/*  Logs a non-fatal message at the specified [priority] level according to
+ *    the printf-style [format] string, subject to the rate limit of the call
+ *    site [lp].  This is normally invoked via the log_msg_limit() macro.
+ *  If the site's previous interval has elapsed, a summary of any messages
+ *    suppressed during it is logged first.
+ */
+void
+log_limit_msg (struct log_limit *lp, int priority, const char *format, ...)
+{
+    va_list          vargs;
+    char             msg [LOG_BUFFER_MAXLEN];
+    time_t           now;
+    char            *p;
+    int              is_logged;
+    struct log_limit sum;
+
+    assert (lp != NULL);
+
+    now = time (NULL);
+    sum.n_suppressed = 0;
+
+    if ((errno = pthread_mutex_lock (&log_limit_mutex)) != 0) {
+        log_errno (EXIT_FAILURE, LOG_ERR, "Failed to lock log limit mutex");
+    }
+    if (!lp->is_registered) {
+        lp->next = log_limit_list;
+        log_limit_list = lp;
+        lp->is_registered = 1;
+    }
+    if ((now >= lp->t_start + LOG_LIMIT_SECS) || (now < lp->t_start)) {
+        _log_limit_reset (lp, now, &sum);
+    }
+    is_logged = (lp->n_logged < LOG_LIMIT_BURST);
+    if (is_logged) {
+        lp->n_logged++;
+    }
+    else {
+        lp->n_suppressed++;
+        lp->priority = priority;
+    }
+    if ((errno = pthread_mutex_unlock (&log_limit_mutex)) != 0) {
+        log_errno (EXIT_FAILURE, LOG_ERR, "Failed to unlock log limit mutex");
+    }
+    _log_limit_summary (&sum);
+
+    if (!is_logged) {
+        return;
+    }
+    va_start (vargs, format);
+    _log_aux (0, priority, msg, sizeof (msg), format, vargs);
+    va_end (vargs);
+
+    if ((p = strchr (msg, '\n')) != NULL) {
+        *p = '\0';
+    }
+    if ((errno = pthread_mutex_lock (&log_limit_mutex)) != 0) {
+        log_errno (EXIT_FAILURE, LOG_ERR, "Failed to lock log limit mutex");
+    }
+    if (memccpy (lp->msg, msg, '\0', sizeof (lp->msg)) == NULL) {
+        lp->msg[sizeof (lp->msg) - 1] = '\0';
+    }
+    if ((errno = pthread_mutex_unlock (&log_limit_mutex)) != 0) {
+        log_errno (EXIT_FAILURE, LOG_ERR, "Failed to unlock log limit mutex");
+    }
+    return;
+}
+
+
+/*  Logs a summary of the messages suppressed at each rate-limited call site
+ *    whose interval has elapsed.  This should be called periodically so
+ *    summaries are not held back until a site logs again.
+ *  If [got_all] is true, summaries are logged for all sites regardless of
+ *    their interval (e.g., at shutdown).
+ */
+void
+log_limit_flush (int got_all)
+{
+    struct log_limit *lp;
+    struct log_limit  sum;
+    time_t            now;
+
+    now = time (NULL);
+
+    /*  Sites are only ever prepended to the list, so a site's next pointer
+     *    does not change once it is registered.  This allows the mutex to be
+     *    released while each site's summary is logged.
+     */
+    if ((errno = pthread_mutex_lock (&log_limit_mutex)) != 0) {
+        log_errno (EXIT_FAILURE, LOG_ERR, "Failed to lock log limit mutex");
+    }
+    lp = log_limit_list;
+
+    while (lp != NULL) {
+        sum.n_suppressed = 0;
+        if ((got_all) || (now >= lp->t_start + LOG_LIMIT_SECS)
+                || (now < lp->t_start)) {
+            _log_limit_reset (lp, now, &sum);
+        }
+        lp = lp->next;
+
+        if ((errno = pthread_mutex_unlock (&log_limit_mutex)) != 0) {
+            log_errno (EXIT_FAILURE, LOG_ERR,
+                "Failed to unlock log limit mutex");
+        }
+        _log_limit_summary (&sum);
+
+        if ((errno = pthread_mutex_lock (&log_limit_mutex)) != 0) {
+            log_errno (EXIT_FAILURE, LOG_ERR,
+                "Failed to lock log limit mutex");
+        }
+    }
+    if ((errno = pthread_mutex_unlock (&log_limit_mutex)) != 0) {
+        log_errno (EXIT_FAILURE, LOG_ERR, "Failed to unlock log limit mutex");
+    }
+    return;
+}
+
+
 /*****************************************************************************
  *  Static Functions
  *****************************************************************************/
 
+static void
+_log_limit_reset (struct log_limit *lp, time_t now, struct log_limit *sp)
+{
+/*  Copies the summary of the messages suppressed at the call site [lp] into
+ *    [sp], and starts a new interval at time [now].
+ *  The log_limit_mutex must be locked when calling this routine.
+ */
+    sp->n_suppressed = lp->n_suppressed;
+    if (lp->n_suppressed > 0) {
+        sp->priority = lp->priority;
+        (void) memcpy (sp->msg, lp->msg, sizeof (sp->msg));
+    }
+    lp->t_start = now;
+    lp->n_logged = 0;
+    lp->n_suppressed = 0;
+    return;
+}
+
+
+static void
+_log_limit_summary (const struct log_limit *sp)
+{
+/*  Logs the summary [sp] of suppressed messages copied by _log_limit_reset().
+ *  The log_limit_mutex must not be locked when calling this routine.
+ */
+    if (sp->n_suppressed > 0) {
+        log_msg (sp->priority, "Suppressed %lu similar message%s: %s",
+            sp->n_suppressed, ((sp->n_suppressed == 1) ? "" : "s"),
+            sp->msg);
+    }
+    return;
+}
+
+
 static void
 _log_aux (int errnum, int priority, char *msgbuf, int msgbuflen,
         const char *format, va_list vargs)
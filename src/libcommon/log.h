@@ -35,6 +35,7 @@
 
 #include <stdio.h>
 #include <syslog.h>
+#include <time.h>
 
 
 #define LOG_OPT_NONE            0x00
@@ -42,6 +43,35 @@
 #define LOG_OPT_PRIORITY        0x02    /* add priority string to message    */
 #define LOG_OPT_TIMESTAMP       0x04    /* add timestamp to message          */
 
+#define LOG_LIMIT_MSG_MAXLEN    96      /* max len of msg saved for summary  */
+
+
+/*  Rate-limiting state for a single log call site.
+ *  Each site may log up to LOG_LIMIT_BURST messages per LOG_LIMIT_SECS
+ *    interval.  Further messages are suppressed and counted, and a summary
+ *    of the suppressed messages is logged once the interval has elapsed.
+ */
+struct log_limit {
+    struct log_limit   *next;           /* next site registered for flushing */
+    time_t              t_start;        /* start of the current interval     */
+    unsigned int        n_logged;       /* msgs logged in current interval   */
+    unsigned long       n_suppressed;   /* msgs suppressed in curr interval  */
+    int                 priority;       /* priority of last suppressed msg   */
+    unsigned            is_registered:1;/* true if on list for flushing      */
+    char                msg [LOG_LIMIT_MSG_MAXLEN]; /* last msg logged       */
+};
+
+#define LOG_LIMIT_INITIALIZER   { NULL, 0, 0, 0, 0, 0, { '\0' } }
+
+/*  Logs a non-fatal message like log_msg(), but rate-limited by call site.
+ *  This should be used for messages that can be triggered by each request.
+ */
+#define log_msg_limit(priority, ...)                                          \
+    do {                                                                      \
+        static struct log_limit _log_limit_site = LOG_LIMIT_INITIALIZER;      \
+        log_limit_msg (&_log_limit_site, (priority), __VA_ARGS__);            \
+    } while (0)
+
 
 int log_open_file (FILE *fp, const char *identity, int priority, int options);
 
@@ -53,6 +83,8 @@ void log_close_syslog (void);
 
 void log_close_all (void);
 
+void log_set_priority (int priority);
+
 void log_err (int status, int priority, const char *format, ...);
 
 void log_errno (int status, int priority, const char *format, ...);
@@ -61,5 +93,10 @@ void log_msg (int priority, const char *format, ...);
 
 void log_err_or_warn (int got_force, const char *format, ...);
 
+void log_limit_msg (struct log_limit *lp, int priority,
+        const char *format, ...);
+
+void log_limit_flush (int got_all);
+
 
 #endif /* !LOG_H */
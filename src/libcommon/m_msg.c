@@ -38,6 +38,7 @@
 #include <string.h>
 #include <sys/time.h>                   /* gettimeofday */
 #include <sys/uio.h>
+#include <time.h>                       /* clock_gettime */
 #include <unistd.h>
 #include "fd.h"
 #include "m_msg.h"
@@ -57,7 +58,13 @@ typedef void ** vpp;
  *****************************************************************************/
 
 static void _get_timeval (struct timeval *tv, int msecs);
+static void _get_xfer_timeval (m_msg_t m, struct timeval *tv);
 static int _msg_length (m_msg_t m, m_msg_type_t type);
+static int _msg_has_req_id (m_msg_t m, m_msg_type_t type);
+static int _msg_has_req_flags (m_msg_t m, m_msg_type_t type);
+
+static int _msg_has_rsp_ttl (m_msg_t m, m_msg_type_t type);
+static uint32_t _msg_data_len (m_msg_t m, m_msg_type_t type);
 static munge_err_t _msg_pack (m_msg_t m, m_msg_type_t type,
         void *dst, int dstlen);
 static munge_err_t _msg_unpack (m_msg_t m, m_msg_type_t type,
@@ -89,6 +96,7 @@ m_msg_create (m_msg_t *pm)
     }
     m->sd = -1;
     m->type = MUNGE_MSG_UNDEF;
+    m->version = MUNGE_MSG_VERSION_MIN;
 
     *pm = m;
     return (EMUNGE_SUCCESS);
@@ -129,6 +137,10 @@ m_msg_destroy (m_msg_t m)
         assert (m->auth_c_len > 0);
         free (m->auth_c_str);
     }
+    if (m->req_id_str && !m->req_id_is_copy) {
+        assert (m->req_id_len > 0);
+        free (m->req_id_str);
+    }
     free (m);
     return;
 }
@@ -272,7 +284,7 @@ m_msg_send (m_msg_t m, m_msg_type_t type, int maxlen)
 
     /*  Compute maximum time to wait for transmission of message.
      */
-    _get_timeval (&tv, MUNGE_SOCKET_TIMEOUT_MSECS);
+    _get_xfer_timeval (m, &tv);
 
     /*  Send the message.
      */
@@ -322,12 +334,16 @@ m_msg_recv (m_msg_t m, m_msg_type_t type, int maxlen)
 
     /*  Compute maximum time to wait for receipt of message.
      */
-    _get_timeval (&tv, MUNGE_SOCKET_TIMEOUT_MSECS);
+    _get_xfer_timeval (m, &tv);
 
     /*  Read and validate the message header.
+     *  If timed, note when the header arrives to separate the time spent
+     *    waiting on the sender from the time spent receiving the body;
+     *    if the clock cannot be read, the message is no longer timed.
      */
     nrecv = sizeof (hdr);
     if ((errno = 0, n = fd_timed_read_n (m->sd, &hdr, nrecv, &tv, 1)) < 0) {
+        m->is_unanswered = 1;
         m_msg_set_err (m, EMUNGE_SOCKET,
             strdupf ("Failed to receive message header: %s",
                 strerror (errno)));
@@ -339,12 +355,17 @@ m_msg_recv (m_msg_t m, m_msg_type_t type, int maxlen)
         return (EMUNGE_SOCKET);
     }
     else if (n != nrecv) {
+        m->is_unanswered = (n == 0);
         m_msg_set_err (m, EMUNGE_SOCKET,
             strdupf ("Received incomplete message header: %d of %d bytes",
             n, nrecv));
         return (EMUNGE_SOCKET);
     }
-    else if (_msg_unpack (m, MUNGE_MSG_HDR, hdr, sizeof (hdr))
+    if ((m->is_timed)
+            && (clock_gettime (CLOCK_MONOTONIC, &m->hdr_time) < 0)) {
+        m->is_timed = 0;
+    }
+    if (_msg_unpack (m, MUNGE_MSG_HDR, hdr, sizeof (hdr))
             != EMUNGE_SUCCESS) {
         m_msg_set_err (m, EMUNGE_SOCKET,
             strdup ("Failed to unpack message header"));
@@ -429,6 +450,72 @@ m_msg_set_err (m_msg_t m, munge_err_t e, char *s)
 }
 
 
+int
+m_msg_req_id_is_valid (const char *s)
+{
+/*  Checks whether [s] is a valid request ID: a non-empty string of up to
+ *    MUNGE_REQUEST_ID_MAX_LEN printable non-space ASCII characters.
+ *  Since request IDs are copied verbatim into munged log messages, this is
+ *    checked by both the client and the server.
+ *  Returns non-zero if valid; o/w, returns 0.
+ */
+    int n;
+
+    if ((s == NULL) || (*s == '\0')) {
+        return (0);
+    }
+    for (n = 0; s[n] != '\0'; n++) {
+        if ((n >= MUNGE_REQUEST_ID_MAX_LEN) || (s[n] < '!') || (s[n] > '~')) {
+            return (0);
+        }
+    }
+    return (1);
+}
+
+
+void
+m_msg_set_deadline (m_msg_t m, int msecs)
+{
+/*  Sets a hard deadline [msecs] milliseconds from now by which all
+ *    subsequent sends & receives of the message [m] must complete,
+ *    regardless of the per-transfer socket timeout.
+ *  If [msecs] <= 0, the deadline is cleared.
+ */
+    assert (m != NULL);
+
+    if (msecs > 0) {
+        _get_timeval (&m->deadline, msecs);
+    }
+    else {
+        m->deadline.tv_sec = m->deadline.tv_usec = 0;
+    }
+    return;
+}
+
+
+void
+m_msg_set_version (m_msg_t m, m_msg_version_t version)
+{
+/*  Sets the format [version] in which the message [m] is sent, discarding
+ *    any message body already packed in another version.
+ */
+    assert (m != NULL);
+    assert (version >= MUNGE_MSG_VERSION_MIN);
+    assert (version <= MUNGE_MSG_VERSION);
+
+    if ((m->version != version) && (m->pkt != NULL)) {
+        if (!m->pkt_is_copy) {
+            free (m->pkt);
+        }
+        m->pkt = NULL;
+        m->pkt_len = 0;
+        m->pkt_is_copy = 0;
+    }
+    m->version = version;
+    return;
+}
+
+
 /*****************************************************************************
  *  Private Functions
  *****************************************************************************/
@@ -455,6 +542,32 @@ _get_timeval (struct timeval *tv, int msecs)
 }
 
 
+static void
+_get_xfer_timeval (m_msg_t m, struct timeval *tv)
+{
+/*  Sets [tv] to the time by which a send or receive of the message [m] must
+ *    complete: the per-transfer socket timeout, or the message deadline if
+ *    that is sooner.
+ *  If the deadline has passed, [tv] is set to the deadline so the transfer
+ *    times out without blocking.
+ */
+    assert (m != NULL);
+    assert (tv != NULL);
+
+    _get_timeval (tv, MUNGE_SOCKET_TIMEOUT_MSECS);
+
+    if ((m->deadline.tv_sec == 0) && (m->deadline.tv_usec == 0)) {
+        return;
+    }
+    if ((m->deadline.tv_sec < tv->tv_sec)
+            || ((m->deadline.tv_sec == tv->tv_sec)
+                && (m->deadline.tv_usec < tv->tv_usec))) {
+        *tv = m->deadline;
+    }
+    return;
+}
+
+
 static int
 _msg_length (m_msg_t m, m_msg_type_t type)
 {
@@ -514,7 +627,7 @@ _msg_length (m_msg_t m, m_msg_type_t type)
             n += sizeof (m->auth_uid);
             n += sizeof (m->auth_gid);
             n += sizeof (m->data_len);
-            n += m->data_len;
+            n += _msg_data_len (m, type);
             break;
         case MUNGE_MSG_AUTH_FD_REQ:
             n += sizeof (m->auth_s_len);
@@ -526,10 +639,88 @@ _msg_length (m_msg_t m, m_msg_type_t type)
             return (-1);
             break;
     }
+    if (_msg_has_req_id (m, type)) {
+        n += sizeof (m->req_id_len);
+        n += m->req_id_len;
+    }
+    if (_msg_has_req_flags (m, type)) {
+        n += sizeof (m->req_flags);
+    }
+    if (_msg_has_rsp_ttl (m, type)) {
+        n += sizeof (m->ttl);
+    }
     return (n);
 }
 
 
+static int
+_msg_has_req_id (m_msg_t m, m_msg_type_t type)
+{
+/*  Returns non-zero if the message [m] of type [type] carries a request ID
+ *    (which may be empty).
+ *  The request ID trails the encode/decode request & response bodies of
+ *    versions newer than the oldest.
+ */
+    assert (m != NULL);
+
+    if (m->version <= MUNGE_MSG_VERSION_MIN) {
+        return (0);
+    }
+    switch (type) {
+        case MUNGE_MSG_ENC_REQ:
+        case MUNGE_MSG_ENC_RSP:
+        case MUNGE_MSG_DEC_REQ:
+        case MUNGE_MSG_DEC_RSP:
+            return (1);
+        default:
+            return (0);
+    }
+}
+
+
+static int
+_msg_has_req_flags (m_msg_t m, m_msg_type_t type)
+{
+/*  Returns non-zero if the message [m] of type [type] carries request flags.
+ *  The request flags follow the request ID in the decode request & response.
+ */
+    assert (m != NULL);
+
+    return (((type == MUNGE_MSG_DEC_REQ) || (type == MUNGE_MSG_DEC_RSP))
+            && _msg_has_req_id (m, type));
+}
+
+
+static int
+_msg_has_rsp_ttl (m_msg_t m, m_msg_type_t type)
+{
+/*  Returns non-zero if the message [m] of type [type] carries the ttl
+ *    applied by munged.
+ *  The applied ttl follows the request ID in the encode response.
+ */
+    assert (m != NULL);
+
+    return ((type == MUNGE_MSG_ENC_RSP) && _msg_has_req_id (m, type));
+}
+
+
+static uint32_t
+_msg_data_len (m_msg_t m, m_msg_type_t type)
+{
+/*  Returns the length of the data to be sent in the message [m] of type
+ *    [type].  The decoded payload is omitted from the decode response if
+ *    the client requested only the credential metadata.
+ */
+    assert (m != NULL);
+
+    if ((type == MUNGE_MSG_DEC_RSP)
+            && (m->req_flags & MUNGE_MSG_REQ_FLAG_NO_DATA)) {
+        return (0);
+    }
+    return (m->data_len);
+}
+
+
 static munge_err_t
 _msg_pack (m_msg_t m, m_msg_type_t type, void *dst, int dstlen)
 {
@@ -537,7 +728,8 @@ _msg_pack (m_msg_t m, m_msg_type_t type, void *dst, int dstlen)
  *    of length [dstlen] for transport across the munge socket.
  */
     m_msg_magic_t    magic = MUNGE_MSG_MAGIC;
-    m_msg_version_t  version = MUNGE_MSG_VERSION;
+    m_msg_version_t  version = m->version;
+    uint32_t         data_len = _msg_data_len (m, type);
     void            *p = dst;
     void            *q = (unsigned char *) dst + dstlen;
 
@@ -596,8 +788,8 @@ _msg_pack (m_msg_t m, m_msg_type_t type, void *dst, int dstlen)
             else if (!_pack (&p, &(m->cred_gid), sizeof (m->cred_gid), q)) ;
             else if (!_pack (&p, &(m->auth_uid), sizeof (m->auth_uid), q)) ;
             else if (!_pack (&p, &(m->auth_gid), sizeof (m->auth_gid), q)) ;
-            else if (!_pack (&p, &(m->data_len), sizeof (m->data_len), q)) ;
-            else if ( _copy (p, m->data, m->data_len, p, q, &p) < 0) ;
+            else if (!_pack (&p, &data_len, sizeof (data_len), q)) ;
+            else if ( _copy (p, m->data, data_len, p, q, &p) < 0) ;
             else break;
             goto err;
         case MUNGE_MSG_AUTH_FD_REQ:
@@ -610,6 +802,16 @@ _msg_pack (m_msg_t m, m_msg_type_t type, void *dst, int dstlen)
         default:
             goto err;
     }
+    if (_msg_has_req_id (m, type)) {
+        if      (!_pack (&p, &(m->req_id_len), sizeof (m->req_id_len), q)) ;
+        else if ( _copy (p, m->req_id_str, m->req_id_len, p, q, &p) < 0) ;
+        else if (_msg_has_req_flags (m, type)
+                && !_pack (&p, &(m->req_flags), sizeof (m->req_flags), q)) ;
+        else if (_msg_has_rsp_ttl (m, type)
+                && !_pack (&p, &(m->ttl), sizeof (m->ttl), q)) ;
+        else return (EMUNGE_SUCCESS);
+        goto err;
+    }
     return (EMUNGE_SUCCESS);
 
 err:
@@ -625,8 +827,8 @@ _msg_unpack (m_msg_t m, m_msg_type_t type, const void *src, int srclen)
 /*  Unpacks the message [m] from transport across the munge socket.
  *  Checks to ensure the message is of the expected type [type].
  */
-    m_msg_magic_t    magic;
-    m_msg_version_t  version;
+    m_msg_magic_t    magic = 0;
+    m_msg_version_t  version = 0;
     void            *p = (void *) src;
     void            *q = (unsigned char *) src + srclen;
 
@@ -709,7 +911,37 @@ _msg_unpack (m_msg_t m, m_msg_type_t type, const void *src, int srclen)
         default:
             goto err;
     }
-    assert (p == (unsigned char *) src + srclen);
+    /*  Unpack the request ID trailing the encode/decode bodies.
+     */
+    if (_msg_has_req_id (m, type)) {
+        if      (!_unpack (&(m->req_id_len), &p, sizeof (m->req_id_len), q));
+        else if (m->req_id_len == 0) goto flags;
+        else if (!_alloc ((vpp) &(m->req_id_str), m->req_id_len)) goto nomem;
+        else if ( _copy (m->req_id_str, p, m->req_id_len, p, q, &p) < 0) ;
+        else if (strlen (m->req_id_str) + 1 != m->req_id_len) ;
+        else if (!m_msg_req_id_is_valid (m->req_id_str)) ;
+        else goto flags;
+        goto err;
+    }
+flags:
+    /*  Unpack the request flags following the decode request ID, ignoring
+     *    any not understood.  Unpack the applied ttl following the encode
+     *    response ID.
+     */
+    if (_msg_has_req_flags (m, type)) {
+        if (!_unpack (&(m->req_flags), &p, sizeof (m->req_flags), q)) {
+            goto err;
+        }
+        m->req_flags &= MUNGE_MSG_REQ_FLAGS;
+    }
+    if (_msg_has_rsp_ttl (m, type)) {
+        if (!_unpack (&(m->ttl), &p, sizeof (m->ttl), q)) {
+            goto err;
+        }
+    }
+    if (p != q) {
+        goto err;
+    }
 
     if (type == MUNGE_MSG_HDR) {
         if (magic != MUNGE_MSG_MAGIC) {
@@ -717,11 +949,13 @@ _msg_unpack (m_msg_t m, m_msg_type_t type, const void *src, int srclen)
                 strdupf ("Received invalid message magic %d", magic));
             return (EMUNGE_SOCKET);
         }
-        else if (version != MUNGE_MSG_VERSION) {
+        else if ((version < MUNGE_MSG_VERSION_MIN)
+                || (version > MUNGE_MSG_VERSION)) {
             m_msg_set_err (m, EMUNGE_SOCKET,
                 strdupf ("Received invalid message version %d", version));
             return (EMUNGE_SOCKET);
         }
+        m->version = version;
     }
     return (EMUNGE_SUCCESS);
 
@@ -36,6 +36,8 @@
 #include <inttypes.h>
 #include <munge.h>
 #include <netinet/in.h>                 /* for struct in_addr                */
+#include <sys/time.h>                   /* for struct timeval                */
+#include <time.h>                       /* for struct timespec               */
 
 
 /*****************************************************************************
@@ -56,13 +58,35 @@
  *  This must be incremented whenever the client/server msg format changes;
  *    otherwise, the message may be parsed incorrectly when decoded.
  */
-#define MUNGE_MSG_VERSION               4
+#define MUNGE_MSG_VERSION               5
+
+/*  Oldest version of the munge client-server message format.
+ *  Version 5 appends the request ID to the version 4 encode/decode request
+ *    and response bodies, followed by the request flags for decode and by the
+ *    ttl applied by munged for the encode response.
+ *  munged accepts any version from the oldest to the current, and responds
+ *    in the version of the request.  libmunge sends the oldest version unless
+ *    a newer field is needed, falling back to the oldest version if munged
+ *    closes the connection without responding (as an older munged does upon
+ *    receiving a newer version).
+ */
+#define MUNGE_MSG_VERSION_MIN           4
+
+/*  Request flags for the decode request.  The decode response echoes those
+ *    honored by munged.
+ *  NO_DATA requests only the credential metadata, omitting the decoded
+ *    payload from the decode response.
+ */
+#define MUNGE_MSG_REQ_FLAG_NO_DATA      0x01
+#define MUNGE_MSG_REQ_FLAGS             (MUNGE_MSG_REQ_FLAG_NO_DATA)
 
 
 /*****************************************************************************
  *  Data Types
  *****************************************************************************/
 
+struct listener;                        /* munged listening socket           */
+
 enum m_msg_type {                       /* message type                      */
     MUNGE_MSG_UNDEF,                    /*  undefined (new) message          */
     MUNGE_MSG_HDR,                      /*  message header                   */
@@ -75,6 +99,7 @@ enum m_msg_type {                       /* message type                      */
 
 struct m_msg {
     int                sd;              /* munge socket descriptor           */
+    uint8_t            version;         /* msg format version for xfer       */
     uint8_t            type;            /* enum m_msg_type                   */
     uint8_t            retry;           /* retry count for this transaction  */
     uint32_t           pkt_len;         /* length of msg pkt mem allocation  */
@@ -104,12 +129,23 @@ struct m_msg {
     uint8_t            error_num;       /* munge_err_t for encode/decode op  */
     uint8_t            error_len;       /* length of err msg str with NUL    */
     char              *error_str;       /* descriptive err msg str with NUL  */
+    uint8_t            req_id_len;      /* length of request ID with NUL     */
+    char              *req_id_str;      /* client request ID with NUL        */
+    uint8_t            req_flags;       /* MUNGE_MSG_REQ_FLAG bitwise-flags  */
+    const struct listener *listener;    /* munged socket if not primary      */
+    struct timeval     deadline;        /* hard deadline for xfers if non-0  */
+    struct timespec    hdr_time;        /* monotonic time hdr rcvd if timed  */
     unsigned           pkt_is_copy:1;   /* true if mem for pkt is a copy     */
     unsigned           realm_is_copy:1; /* true if mem for realm is a copy   */
     unsigned           data_is_copy:1;  /* true if mem for data is a copy    */
     unsigned           error_is_copy:1; /* true if mem for err str is a copy */
     unsigned           auth_s_is_copy:1;/* true if mem for auth srvr is copy */
     unsigned           auth_c_is_copy:1;/* true if mem for auth clnt is copy */
+    unsigned           req_id_is_copy:1;/* true if mem for req ID is a copy  */
+    unsigned           is_probe:1;      /* true if internal munged probe msg */
+    unsigned           client_is_known:1;/* true if client UID/GID is known  */
+    unsigned           is_timed:1;      /* true if recv records hdr_time     */
+    unsigned           is_unanswered:1; /* true if peer closed w/o sending   */
 };
 
 typedef struct m_msg *  m_msg_t;
@@ -117,6 +153,13 @@ typedef enum m_msg_type m_msg_type_t;
 typedef uint32_t        m_msg_magic_t;
 typedef uint8_t         m_msg_version_t;
 
+/*  Expands to the args for a log msg format ending in "%s%s" that append
+ *    the request ID (if any) of the message [M].
+ */
+#define M_MSG_REQ_ID_ARGS(M)                                                  \
+    (((M)->req_id_len > 0) ? " req=" : ""),                                   \
+    (((M)->req_id_len > 0) ? (M)->req_id_str : "")
+
 
 /*****************************************************************************
  *  Prototypes
@@ -136,5 +179,11 @@ munge_err_t m_msg_recv (m_msg_t m, m_msg_type_t type, int maxlen);
 
 int m_msg_set_err (m_msg_t m, munge_err_t e, char *s);
 
+int m_msg_req_id_is_valid (const char *s);
+
+void m_msg_set_deadline (m_msg_t m, int msecs);
+
+void m_msg_set_version (m_msg_t m, m_msg_version_t version);
+
 
 #endif /* !M_MSG_H */
@@ -104,6 +104,12 @@
  */
 #define MUNGE_MAXIMUM_REQ_LEN           1048576
 
+/*  Integer for the maximum length (in bytes, excluding the NUL) of the
+ *    request ID a client can attach to its requests for correlating them
+ *    with munged log messages (see MUNGE_OPT_REQUEST_ID).
+ */
+#define MUNGE_REQUEST_ID_MAX_LEN        64
+
 /*  Flag to denote whether group information comes from "/etc/group".
  *  If set, group information will not be updated unless this file
  *    modification time changes.  If not set, the file modification time
@@ -128,6 +134,11 @@
  */
 #define MUNGE_SIGNAL_WAIT_MSECS         5000
 
+/*  Maximum number of milliseconds to wait for each step of handing off the
+ *    socket and state of a running daemon to a new daemon during an upgrade.
+ */
+#define MUNGE_UPGRADE_WAIT_MSECS        15000
+
 /*  Number of milliseconds between checks to see whether a process has
  *    terminated (i.e., kicked the bucket, shuffled off this mortal coil,
  *    run down the curtain, and joined the bleedin' choir invisible).
@@ -179,10 +190,106 @@
  */
 #define MUNGE_SOCKET_TIMEOUT_MSECS      2000
 
+/*  Number of milliseconds from when munged starts on a request until its
+ *    receipt, processing, and response must be completed.
+ *  This matches the worst case of a receive followed by a send (each bounded
+ *    by MUNGE_SOCKET_TIMEOUT_MSECS).
+ */
+#define MUNGE_REQUEST_TIMEOUT_MSECS     4000
+
+/*  Maximum number of pre-encoded credentials a client can keep in the
+ *    credential pool of a single munge context (see MUNGE_OPT_POOL_SIZE).
+ */
+#define MUNGE_POOL_MAX_SIZE             256
+
+/*  Number of milliseconds a client's credential pool refill thread sleeps
+ *    after a failed encode before trying again.
+ */
+#define MUNGE_POOL_RETRY_MSECS          1000
+
+/*  Maximum number of seconds a pooled credential is kept if munged does not
+ *    report the ttl it applied (ie, a munged predating msg version 5).
+ *    munged may have clamped the requested ttl to its own maximum.
+ */
+#define MUNGE_POOL_FALLBACK_MAX_AGE     30
+
 /*  Number of threads to create for processing credential requests.
  */
 #define MUNGE_THREADS                   2
 
+/*  Number of I/O threads to create for receiving requests and sending
+ *    responses when using the staged request pipeline.
+ *  If set to 0, the staged pipeline is disabled and each request is processed
+ *    from start to finish by a single thread.
+ */
+#define MUNGE_IO_THREADS                0
+
+/*  Maximum number of requests that can be queued between stages of the
+ *    staged request pipeline before the upstream stage blocks.
+ */
+#define MUNGE_STAGE_QUEUE_LEN           1024
+
+/*  Maximum number of requests processed together as a batch by a stage of
+ *    the staged request pipeline.
+ */
+#define MUNGE_STAGE_BATCH_LEN           16
+
+/*  Number of helper threads to create for compressing and decompressing large
+ *    payloads in parallel chunks.
+ *  If set to 0, payloads are compressed in a single pass by the thread
+ *    processing the request.
+ */
+#define MUNGE_ZIP_THREADS               0
+
+/*  Length (in bytes) of the uncompressed chunks into which a payload is split
+ *    when compressed in parallel.  Only payloads larger than this are split.
+ */
+#define MUNGE_ZIP_CHUNK_LEN             131072
+
+/*  Number of compressed payloads to cache for reuse when the same payload is
+ *    encoded into multiple credentials.
+ *  If set to 0, the cache is disabled.
+ */
+#define MUNGE_ZIP_CACHE_LEN             0
+
+/*  Integer for the number of seconds between internal encode/decode round
+ *    trips used to probe the request processing latency.
+ *  If set to 0, the latency probe is disabled.
+ */
+#define MUNGE_PROBE_INTERVAL_SECS       60
+
+/*  Integer for the number of milliseconds of probe round-trip latency above
+ *    which the daemon is reported as being slow.
+ */
+#define MUNGE_PROBE_THRESHOLD_MSECS     1000
+
+/*  Integer for the number of seconds between reports of per-client CPU usage.
+ *  If set to 0, CPU usage will only be reported on SIGHUP and at shutdown.
+ *  If set to -1, CPU usage tracking will be disabled altogether.
+ */
+#define MUNGE_USAGE_REPORT_SECS         3600
+
+/*  Size (in bytes) at which the audit log of decoded credentials is rotated.
+ *  If set to 0, the audit log will not be rotated.
+ */
+#define MUNGE_AUDIT_MAX_BYTES           67108864
+
+/*  Maximum number of msecs that audit log records may linger in the page
+ *    cache before being synced to disk.
+ *  If set to 0, the audit log will be synced after every batch of writes.
+ *  If set to -1, syncing will be left to the kernel.
+ */
+#define MUNGE_AUDIT_SYNC_MSECS          1000
+
+/*  Maximum number of client UIDs for which CPU usage is tracked individually.
+ *  Requests from additional UIDs are attributed to "other clients".
+ */
+#define MUNGE_USAGE_MAX_UIDS            1024
+
+/*  Number of client UIDs with the highest CPU usage to include in a report.
+ */
+#define MUNGE_USAGE_REPORT_NUM          10
+
 /*  Flag to allow root to decode any credential regardless of its
  *    UID/GID restrictions.
  */
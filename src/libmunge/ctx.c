@@ -37,6 +37,7 @@
 #include <string.h>
 #include <munge.h>
 #include "ctx.h"
+#include "m_msg.h"
 #include "munge_defs.h"
 
 
@@ -57,15 +58,19 @@ munge_ctx_create (void)
     ctx->zip = MUNGE_ZIP_DEFAULT;
     ctx->realm_str = NULL;
     ctx->ttl = MUNGE_TTL_DEFAULT;
+    ctx->enc_ttl = -1;
     ctx->addr.s_addr = 0;
     ctx->time0 = 0;
     ctx->time1 = 0;
     ctx->auth_uid = MUNGE_UID_ANY;
     ctx->auth_gid = MUNGE_GID_ANY;
     ctx->socket_str = strdup (MUNGE_SOCKET_NAME);
+    ctx->req_id_str = NULL;
     ctx->error_num = EMUNGE_SUCCESS;
     ctx->error_str = NULL;
     ctx->flags = 0;
+    ctx->pool = NULL;
+    memset (&ctx->timing, 0, sizeof (ctx->timing));
 
     if (!ctx->socket_str) {
         munge_ctx_destroy (ctx);
@@ -96,11 +101,17 @@ munge_ctx_copy (munge_ctx_t src)
      */
     dst->realm_str = NULL;
     dst->socket_str = NULL;
+    dst->req_id_str = NULL;
     dst->error_str = NULL;
+    /*
+     *  The credential pool belongs to the src ctx and is not copied.
+     */
+    dst->pool = NULL;
     /*
      *  Reset the error condition.
      */
     dst->error_num = EMUNGE_SUCCESS;
+    memset (&dst->timing, 0, sizeof (dst->timing));
     /*
      *  Copy the src strings.
      */
@@ -110,6 +121,9 @@ munge_ctx_copy (munge_ctx_t src)
     if (!(dst->socket_str = strdup (src->socket_str))) {
         goto err;
     }
+    if ((src->req_id_str) && !(dst->req_id_str = strdup (src->req_id_str))) {
+        goto err;
+    }
     return (dst);
 
 err:
@@ -124,12 +138,18 @@ munge_ctx_destroy (munge_ctx_t ctx)
     if (!ctx) {
         return;
     }
+    if (ctx->pool) {
+        _munge_pool_destroy (ctx->pool);
+    }
     if (ctx->realm_str) {
         free (ctx->realm_str);
     }
     if (ctx->socket_str) {
         free (ctx->socket_str);
     }
+    if (ctx->req_id_str) {
+        free (ctx->req_id_str);
+    }
     if (ctx->error_str) {
         free (ctx->error_str);
     }
@@ -159,6 +179,7 @@ munge_ctx_get (munge_ctx_t ctx, int opt, ...)
 {
     int             *p2int;
     char           **p2str;
+    struct munge_timing *p2timing;
     struct in_addr  *p2addr;
     time_t          *p2time;
     uid_t           *p2uid;
@@ -227,6 +248,26 @@ munge_ctx_get (munge_ctx_t ctx, int opt, ...)
             p2int = va_arg (vargs, int *);
             *p2int = !!(ctx->flags & MUNGE_CTX_FLAG_IGNORE_REPLAY);
             break;
+        case MUNGE_OPT_POOL_SIZE:
+            p2int = va_arg (vargs, int *);
+            *p2int = _munge_pool_size (ctx->pool);
+            break;
+        case MUNGE_OPT_TIMING:
+            p2int = va_arg (vargs, int *);
+            *p2int = !!(ctx->flags & MUNGE_CTX_FLAG_TIMING);
+            break;
+        case MUNGE_OPT_TIMING_INFO:
+            p2timing = va_arg (vargs, struct munge_timing *);
+            *p2timing = ctx->timing;
+            break;
+        case MUNGE_OPT_REQUEST_ID:
+            p2str = va_arg (vargs, char **);
+            *p2str = ctx->req_id_str;
+            break;
+        case MUNGE_OPT_METADATA_ONLY:
+            p2int = va_arg (vargs, int *);
+            *p2int = !!(ctx->flags & MUNGE_CTX_FLAG_METADATA_ONLY);
+            break;
         default:
             ctx->error_num = EMUNGE_BAD_ARG;
             break;
@@ -317,17 +358,77 @@ munge_ctx_set (munge_ctx_t ctx, int opt, ...)
             else
                 ctx->flags &= ~MUNGE_CTX_FLAG_IGNORE_REPLAY;
             break;
+        case MUNGE_OPT_POOL_SIZE:
+            i = va_arg (vargs, int);
+            if ((i < 0) || (i > MUNGE_POOL_MAX_SIZE)) {
+                ctx->error_num = EMUNGE_BAD_ARG;
+                break;
+            }
+            if (ctx->pool) {
+                _munge_pool_destroy (ctx->pool);
+                ctx->pool = NULL;
+            }
+            if (i > 0) {
+                ctx->error_num = _munge_pool_create (&ctx->pool, ctx, i);
+            }
+            break;
+        case MUNGE_OPT_TIMING:
+            if (va_arg (vargs, int))
+                ctx->flags |= MUNGE_CTX_FLAG_TIMING;
+            else
+                ctx->flags &= ~MUNGE_CTX_FLAG_TIMING;
+            break;
+        case MUNGE_OPT_REQUEST_ID:
+            str = va_arg (vargs, char *);
+            if (!str) {
+                p = NULL;
+            }
+            else if (strlen (str) > MUNGE_REQUEST_ID_MAX_LEN) {
+                ctx->error_num = EMUNGE_BAD_LENGTH;
+                break;
+            }
+            else if (!m_msg_req_id_is_valid (str)) {
+                ctx->error_num = EMUNGE_BAD_ARG;
+                break;
+            }
+            else if (!(p = strdup (str))) {
+                ctx->error_num = EMUNGE_NO_MEMORY;
+                break;
+            }
+            if (ctx->req_id_str) {
+                free (ctx->req_id_str);
+            }
+            ctx->req_id_str = p;
+            break;
+        case MUNGE_OPT_METADATA_ONLY:
+            if (va_arg (vargs, int))
+                ctx->flags |= MUNGE_CTX_FLAG_METADATA_ONLY;
+            else
+                ctx->flags &= ~MUNGE_CTX_FLAG_METADATA_ONLY;
+            break;
         case MUNGE_OPT_ADDR4:
             /* this option cannot be set; fall through to error case */
         case MUNGE_OPT_ENCODE_TIME:
             /* this option cannot be set; fall through to error case */
         case MUNGE_OPT_DECODE_TIME:
             /* this option cannot be set; fall through to error case */
+        case MUNGE_OPT_TIMING_INFO:
+            /* this option cannot be set; fall through to error case */
         default:
             ctx->error_num = EMUNGE_BAD_ARG;
             break;
     }
     va_end (vargs);
+    /*
+     *  Rebind the credential pool to the updated ctx options.
+     */
+    if ((ctx->pool) && (opt != MUNGE_OPT_POOL_SIZE)
+            && (opt != MUNGE_OPT_TIMING)
+            && (opt != MUNGE_OPT_REQUEST_ID)
+            && (opt != MUNGE_OPT_METADATA_ONLY)
+            && (ctx->error_num == EMUNGE_SUCCESS)) {
+        ctx->error_num = _munge_pool_reset (ctx->pool, ctx);
+    }
     return (ctx->error_num);
 }
 
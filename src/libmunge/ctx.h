@@ -33,6 +33,7 @@
 #include <sys/types.h>                  /* for uid_t, gid_t                  */
 #include <time.h>                       /* for time_t                        */
 #include <munge.h>                      /* for munge_ctx_t, munge_err_t      */
+#include "pool.h"                       /* for munge_pool_t                  */
 
 
 /*****************************************************************************
@@ -45,21 +46,28 @@ struct munge_ctx {
     int                 zip;            /* compression type                  */
     char               *realm_str;      /* security realm string with NUL    */
     int                 ttl;            /* time-to-live                      */
+    int                 enc_ttl;        /* ttl applied to last encode or -1  */
     struct in_addr      addr;           /* IP addr where cred was encoded    */
     time_t              time0;          /* time at which cred was encoded    */
     time_t              time1;          /* time at which cred was decoded    */
     uid_t               auth_uid;       /* UID of client allowed to decode   */
     gid_t               auth_gid;       /* GID of client allowed to decode   */
     char               *socket_str;     /* munge domain sock filename w/ NUL */
+    char               *req_id_str;     /* request correlation ID with NUL   */
     munge_err_t         error_num;      /* munge error status                */
     char               *error_str;      /* munge error string with NUL       */
     unsigned            flags;          /* bitwise-flags                     */
+    munge_pool_t        pool;           /* pool of pre-encoded creds or NULL */
+    struct munge_timing timing;         /* timings of last encode/decode     */
 };
 
 typedef enum munge_ctx_flag {
     MUNGE_CTX_FLAG_NONE                 = 0x00,
     MUNGE_CTX_FLAG_IGNORE_TTL           = 0x01,
-    MUNGE_CTX_FLAG_IGNORE_REPLAY        = 0x02
+    MUNGE_CTX_FLAG_IGNORE_REPLAY        = 0x02,
+    MUNGE_CTX_FLAG_TIMING               = 0x04,
+    MUNGE_CTX_FLAG_METADATA_ONLY        = 0x08,
+    MUNGE_CTX_FLAG_ENC_TTL              = 0x10  /* internal: get enc_ttl     */
 } munge_ctx_flag_t;
 
 
@@ -93,7 +93,8 @@ munge_decode (const char *cred, munge_ctx_t ctx,
     /*  Clean up and return.
      */
     if (ctx) {
-        if ((e != EMUNGE_SUCCESS) && ctx->flags) {
+        if ((e != EMUNGE_SUCCESS) && (ctx->flags &
+                (MUNGE_CTX_FLAG_IGNORE_TTL | MUNGE_CTX_FLAG_IGNORE_REPLAY))) {
             e = _decode_ignore (m, ctx);
         }
         _munge_ctx_set_err (ctx, e, m->error_str);
@@ -127,6 +128,7 @@ _decode_init (munge_ctx_t ctx, void **buf, int *len, uid_t *uid, gid_t *gid)
         ctx->time1 = -1;
         ctx->auth_uid = UID_SENTINEL;
         ctx->auth_gid = GID_SENTINEL;
+        memset (&ctx->timing, 0, sizeof (ctx->timing));
         ctx->error_num = EMUNGE_SUCCESS;
         if (ctx->error_str) {
             free (ctx->error_str);
@@ -154,12 +156,23 @@ _decode_req (m_msg_t m, munge_ctx_t ctx, const char *cred)
 {
 /*  Creates a Decode Request message to be sent to the local munge daemon.
  *  The inputs to this message are as follows:
- *    data_len, data.
+ *    data_len, data, and the optional req_id_len, req_id_str & req_flags.
  */
     assert (m != NULL);
     assert (cred != NULL);
     assert (strlen (cred) > 0);
 
+    if ((ctx) && (ctx->req_id_str)) {
+        m->req_id_len = strlen (ctx->req_id_str) + 1;
+        m->req_id_str = ctx->req_id_str;
+        m->req_id_is_copy = 1;
+        m_msg_set_version (m, MUNGE_MSG_VERSION);
+    }
+    if ((ctx) && (ctx->flags & MUNGE_CTX_FLAG_METADATA_ONLY)) {
+        m->req_flags |= MUNGE_MSG_REQ_FLAG_NO_DATA;
+        m_msg_set_version (m, MUNGE_MSG_VERSION);
+    }
+
     /*  Pass the NUL-terminated credential to be decoded.
      */
     m->data_len = strlen (cred) + 1;
@@ -205,6 +218,17 @@ _decode_rsp (m_msg_t m, munge_ctx_t ctx,
         ctx->auth_uid = m->auth_uid;
         ctx->auth_gid = m->auth_gid;
     }
+    /*  Discard the payload if the metadata-only request was not honored
+     *    (eg, by an older munged responding in the oldest msg version).
+     */
+    if ((ctx) && (ctx->flags & MUNGE_CTX_FLAG_METADATA_ONLY)
+            && !(m->req_flags & MUNGE_MSG_REQ_FLAG_NO_DATA)
+            && (m->data_len > 0)) {
+        memburn (m->data, 0, m->data_len);
+        free (m->data);
+        m->data = NULL;
+        m->data_len = 0;
+    }
     if (buf && len && (m->data_len > 0)) {
         assert (* ((unsigned char *) m->data + m->data_len) == '\0');
         *buf = m->data;
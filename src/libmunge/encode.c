@@ -38,6 +38,8 @@
 #include "ctx.h"
 #include "m_msg.h"
 #include "m_msg_client.h"
+#include "munge_defs.h"
+#include "pool.h"
 #include "str.h"
 
 
@@ -50,7 +52,7 @@ static void _encode_init (char **cred, munge_ctx_t ctx);
 static munge_err_t _encode_req (m_msg_t m, munge_ctx_t ctx,
     const void *buf, int len);
 
-static munge_err_t _encode_rsp (m_msg_t m, char **cred);
+static munge_err_t _encode_rsp (m_msg_t m, munge_ctx_t ctx, char **cred);
 
 
 /*****************************************************************************
@@ -73,6 +75,13 @@ munge_encode (char **cred, munge_ctx_t ctx, const void *buf, int len)
         return (_munge_ctx_set_err (ctx, EMUNGE_BAD_ARG,
             strdup ("No address specified for returning the credential")));
     }
+    /*  Take a payload-free credential from the ctx's pool if one is ready.
+     */
+    if ((ctx) && (ctx->pool) && (!buf || (len <= 0))) {
+        if (_munge_pool_take (ctx->pool, cred)) {
+            return (EMUNGE_SUCCESS);
+        }
+    }
     /*  Ask the daemon to encode a credential.
      */
     if ((e = m_msg_create (&m)) != EMUNGE_SUCCESS)
@@ -82,7 +91,7 @@ munge_encode (char **cred, munge_ctx_t ctx, const void *buf, int len)
     else if ((e = m_msg_client_xfer (&m, MUNGE_MSG_ENC_REQ, ctx))
             != EMUNGE_SUCCESS)
         ;
-    else if ((e = _encode_rsp (m, cred)) != EMUNGE_SUCCESS)
+    else if ((e = _encode_rsp (m, ctx, cred)) != EMUNGE_SUCCESS)
         ;
     /*  Clean up and return.
      */
@@ -108,6 +117,8 @@ _encode_init (char **cred, munge_ctx_t ctx)
         *cred = NULL;
     }
     if (ctx) {
+        memset (&ctx->timing, 0, sizeof (ctx->timing));
+        ctx->enc_ttl = -1;
         ctx->error_num = EMUNGE_SUCCESS;
         if (ctx->error_str) {
             free (ctx->error_str);
@@ -124,7 +135,7 @@ _encode_req (m_msg_t m, munge_ctx_t ctx, const void *buf, int len)
 /*  Creates an Encode Request message to be sent to the local munge daemon.
  *  The inputs to this message are as follows:
  *    cipher, mac, zip, realm_len, realm_str, ttl, auth_uid, auth_gid,
- *    data_len, data.
+ *    data_len, data, and the optional req_id_len & req_id_str.
  */
     assert (m != NULL);
 
@@ -146,6 +157,15 @@ _encode_req (m_msg_t m, munge_ctx_t ctx, const void *buf, int len)
         m->ttl = ctx->ttl;
         m->auth_uid = ctx->auth_uid;
         m->auth_gid = ctx->auth_gid;
+        if (ctx->req_id_str) {
+            m->req_id_len = strlen (ctx->req_id_str) + 1;
+            m->req_id_str = ctx->req_id_str;
+            m->req_id_is_copy = 1;
+            m_msg_set_version (m, MUNGE_MSG_VERSION);
+        }
+        if (ctx->flags & MUNGE_CTX_FLAG_ENC_TTL) {
+            m_msg_set_version (m, MUNGE_MSG_VERSION);
+        }
     }
     else {
         m->cipher = MUNGE_CIPHER_DEFAULT;
@@ -167,11 +187,12 @@ _encode_req (m_msg_t m, munge_ctx_t ctx, const void *buf, int len)
 
 
 static munge_err_t
-_encode_rsp (m_msg_t m, char **cred)
+_encode_rsp (m_msg_t m, munge_ctx_t ctx, char **cred)
 {
 /*  Extracts an Encode Response message received from the local munge daemon.
  *  The outputs from this message are as follows:
- *    error_num, error_len, error_str, data_len, data.
+ *    error_num, error_len, error_str, data_len, data, and the applied ttl
+ *    if the response is newer than the oldest msg version.
  *  Note that error_num and error_str are set by _munge_ctx_set_err()
  *    called from munge_encode() (ie, the parent of this stack frame).
  *  Note that the [cred] is NUL-terminated.
@@ -196,5 +217,10 @@ _encode_rsp (m_msg_t m, char **cred)
     assert (* ((unsigned char *) m->data + m->data_len) == '\0');
     *cred = m->data;
     m->data_is_copy = 1;
+
+    if ((ctx) && (m->version > MUNGE_MSG_VERSION_MIN)) {
+        ctx->enc_ttl = (m->ttl < MUNGE_MAXIMUM_TTL)
+            ? m->ttl : MUNGE_MAXIMUM_TTL;
+    }
     return (m->error_num);
 }
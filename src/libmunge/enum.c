@@ -65,6 +65,18 @@
 #  define MUNGE_MAC_SHA512_FLAG         0
 #endif
 
+#if HAVE_LIBGCRYPT || HAVE_EVP_BLAKE2S256
+#  define MUNGE_MAC_BLAKE2S256_FLAG     1
+#else
+#  define MUNGE_MAC_BLAKE2S256_FLAG     0
+#endif
+
+#if HAVE_LIBGCRYPT || HAVE_EVP_BLAKE2B512
+#  define MUNGE_MAC_BLAKE2B512_FLAG     1
+#else
+#  define MUNGE_MAC_BLAKE2B512_FLAG     0
+#endif
+
 #if HAVE_PKG_BZLIB
 #  define MUNGE_ZIP_BZLIB_FLAG          1
 #else
@@ -113,6 +125,8 @@ static struct munge_enum_table _munge_mac_table[] = {
     { MUNGE_MAC_RIPEMD160,      "ripemd160",    1                        },
     { MUNGE_MAC_SHA256,         "sha256",       MUNGE_MAC_SHA256_FLAG    },
     { MUNGE_MAC_SHA512,         "sha512",       MUNGE_MAC_SHA512_FLAG    },
+    { MUNGE_MAC_BLAKE2S256,     "blake2s256",   MUNGE_MAC_BLAKE2S256_FLAG },
+    { MUNGE_MAC_BLAKE2B512,     "blake2b512",   MUNGE_MAC_BLAKE2B512_FLAG },
     { -1,                        NULL,         -1                        }
 };
 
@@ -52,9 +52,22 @@
  *  Prototypes
  *****************************************************************************/
 
-static munge_err_t _m_msg_client_connect (m_msg_t m, char *path);
+static munge_err_t _m_msg_client_connect (m_msg_t m, char *path,
+        struct munge_timing *tp);
+static munge_err_t _m_msg_client_connect_socket (m_msg_t m, char *path,
+        struct munge_timing *tp);
+static munge_err_t _m_msg_client_send (m_msg_t m, m_msg_type_t type,
+        struct munge_timing *tp);
+static munge_err_t _m_msg_client_recv (m_msg_t m, m_msg_type_t type,
+        struct munge_timing *tp);
+static munge_err_t _m_msg_client_check_req_id (m_msg_t mreq, m_msg_t mrsp);
+static int _m_msg_client_downgrade (m_msg_t mreq, m_msg_t mrsp);
 static munge_err_t _m_msg_client_disconnect (m_msg_t m);
-static munge_err_t _m_msg_client_millisleep (m_msg_t m, unsigned long msecs);
+static munge_err_t _m_msg_client_millisleep (m_msg_t m, unsigned long msecs,
+        struct munge_timing *tp);
+static void _m_msg_client_clock (struct timespec *tsp);
+static unsigned long _m_msg_client_usecs (const struct timespec *t0,
+        const struct timespec *t1);
 
 
 /*****************************************************************************
@@ -66,9 +79,12 @@ m_msg_client_xfer (m_msg_t *pm, m_msg_type_t mreq_type, munge_ctx_t ctx)
 {
     char         *socket;
     int           i;
+    int           is_downgraded;
     munge_err_t   e;
     m_msg_t       mreq, mrsp;
     m_msg_type_t  mrsp_type;
+    struct munge_timing *tp;
+    struct timespec      t0, t1;
 
     if (!pm || !*pm) {
         return (EMUNGE_SNAFU);
@@ -76,6 +92,14 @@ m_msg_client_xfer (m_msg_t *pm, m_msg_type_t mreq_type, munge_ctx_t ctx)
     if (!ctx || !(socket = ctx->socket_str)) {
         socket = MUNGE_SOCKET_NAME;
     }
+    /*  Only read the clock if the ctx has asked for a timing breakdown.
+     */
+    tp = NULL;
+    if ((ctx != NULL) && (ctx->flags & MUNGE_CTX_FLAG_TIMING)) {
+        tp = &ctx->timing;
+        memset (tp, 0, sizeof (*tp));
+        _m_msg_client_clock (&t0);
+    }
     mreq = *pm;
     mrsp = NULL;
     if (mreq_type == MUNGE_MSG_ENC_REQ) {
@@ -90,25 +114,27 @@ m_msg_client_xfer (m_msg_t *pm, m_msg_type_t mreq_type, munge_ctx_t ctx)
 
     i = 1;
     while (1) {
-        if ((e = _m_msg_client_connect (mreq, socket)) != EMUNGE_SUCCESS) {
+        if ((e = _m_msg_client_connect (mreq, socket, tp)) != EMUNGE_SUCCESS) {
             break;
         }
-        else if ((e = m_msg_send (mreq, mreq_type, MUNGE_MAXIMUM_REQ_LEN))
+        else if ((e = _m_msg_client_send (mreq, mreq_type, tp))
                 != EMUNGE_SUCCESS) {
             ; /* empty */
         }
-        else if (auth_send (mreq) < 0) {
-            e = EMUNGE_SOCKET;
-        }
         else if ((e = m_msg_create (&mrsp)) != EMUNGE_SUCCESS) {
             break;
         }
         else if ((e = m_msg_bind (mrsp, mreq->sd)) != EMUNGE_SUCCESS) {
             break;
         }
-        else if ((e = m_msg_recv (mrsp, mrsp_type, 0)) != EMUNGE_SUCCESS) {
+        else if ((e = _m_msg_client_recv (mrsp, mrsp_type, tp))
+                != EMUNGE_SUCCESS) {
             ; /* empty */
         }
+        else if ((e = _m_msg_client_check_req_id (mreq, mrsp))
+                != EMUNGE_SUCCESS) {
+            break;
+        }
         else if ((e = _m_msg_client_disconnect (mrsp)) != EMUNGE_SUCCESS) {
             break;
         }
@@ -116,7 +142,8 @@ m_msg_client_xfer (m_msg_t *pm, m_msg_type_t mreq_type, munge_ctx_t ctx)
             break;
         }
 
-        if (i >= MUNGE_SOCKET_RETRY_ATTEMPTS) {
+        is_downgraded = _m_msg_client_downgrade (mreq, mrsp);
+        if ((i >= MUNGE_SOCKET_RETRY_ATTEMPTS) && !is_downgraded) {
             break;
         }
         if (e == EMUNGE_BAD_LENGTH) {
@@ -131,13 +158,24 @@ m_msg_client_xfer (m_msg_t *pm, m_msg_type_t mreq_type, munge_ctx_t ctx)
             (void) close (mreq->sd);
             mreq->sd = -1;
         }
+        /*  Resend the request in the oldest version without counting it
+         *    as a retry since it was rejected rather than lost.
+         */
+        if (is_downgraded) {
+            continue;
+        }
         mreq->retry = i;
-        e = _m_msg_client_millisleep (mreq, i * MUNGE_SOCKET_RETRY_MSECS);
+        e = _m_msg_client_millisleep (mreq, i * MUNGE_SOCKET_RETRY_MSECS, tp);
         if (e != EMUNGE_SUCCESS) {
             break;
         }
         i++;
     }
+    if (tp != NULL) {
+        _m_msg_client_clock (&t1);
+        tp->total_usecs = _m_msg_client_usecs (&t0, &t1);
+        tp->xfer_retries = i - 1;
+    }
     if (mrsp) {
         *pm = mrsp;
         mreq->sd = -1;                  /* prevent socket close by destroy() */
@@ -152,7 +190,35 @@ m_msg_client_xfer (m_msg_t *pm, m_msg_type_t mreq_type, munge_ctx_t ctx)
  *****************************************************************************/
 
 static munge_err_t
-_m_msg_client_connect (m_msg_t m, char *path)
+_m_msg_client_connect (m_msg_t m, char *path, struct munge_timing *tp)
+{
+/*  Connects the msg [m] to the munged socket [path].
+ *  If timing [tp], the time spent connecting (less the backoff between
+ *    connection attempts) is added to the connect time.
+ */
+    struct timespec t0, t1;
+    unsigned long   backoff_usecs;
+    unsigned long   usecs;
+    munge_err_t     e;
+
+    if (tp == NULL) {
+        return (_m_msg_client_connect_socket (m, path, NULL));
+    }
+    backoff_usecs = tp->backoff_usecs;
+    _m_msg_client_clock (&t0);
+    e = _m_msg_client_connect_socket (m, path, tp);
+    _m_msg_client_clock (&t1);
+    usecs = _m_msg_client_usecs (&t0, &t1);
+    backoff_usecs = tp->backoff_usecs - backoff_usecs;
+    if (usecs > backoff_usecs) {
+        tp->connect_usecs += usecs - backoff_usecs;
+    }
+    return (e);
+}
+
+
+static munge_err_t
+_m_msg_client_connect_socket (m_msg_t m, char *path, struct munge_timing *tp)
 {
     size_t              path_len;
     struct stat         st;
@@ -236,7 +302,10 @@ _m_msg_client_connect (m_msg_t m, char *path)
             break;
         }
         delay_msecs = i * MUNGE_SOCKET_CONNECT_RETRY_MSECS;
-        if (_m_msg_client_millisleep (m, delay_msecs) != EMUNGE_SUCCESS) {
+        if (tp != NULL) {
+            tp->connect_retries++;
+        }
+        if (_m_msg_client_millisleep (m, delay_msecs, tp) != EMUNGE_SUCCESS) {
             break;
         }
         i++;
@@ -253,6 +322,123 @@ _m_msg_client_connect (m_msg_t m, char *path)
 }
 
 
+static munge_err_t
+_m_msg_client_send (m_msg_t m, m_msg_type_t type, struct munge_timing *tp)
+{
+/*  Sends the request msg [m] of the specified [type] to munged, and then
+ *    authenticates the client.
+ *  If timing [tp], the time spent in each is added to the send & auth times.
+ */
+    struct timespec t0, t1, t2;
+    munge_err_t     e;
+
+    if (tp != NULL) {
+        _m_msg_client_clock (&t0);
+    }
+    e = m_msg_send (m, type, MUNGE_MAXIMUM_REQ_LEN);
+    if (tp != NULL) {
+        _m_msg_client_clock (&t1);
+        tp->send_usecs += _m_msg_client_usecs (&t0, &t1);
+    }
+    if (e != EMUNGE_SUCCESS) {
+        return (e);
+    }
+    if (auth_send (m) < 0) {
+        e = EMUNGE_SOCKET;
+    }
+    if (tp != NULL) {
+        _m_msg_client_clock (&t2);
+        tp->auth_usecs += _m_msg_client_usecs (&t1, &t2);
+    }
+    return (e);
+}
+
+
+static munge_err_t
+_m_msg_client_recv (m_msg_t m, m_msg_type_t type, struct munge_timing *tp)
+{
+/*  Receives the response msg [m] of the specified [type] from munged.
+ *  If timing [tp], the time until the msg header arrives is added to the
+ *    wait time, and the remainder is added to the recv time.
+ */
+    struct timespec t0, t1;
+    munge_err_t     e;
+
+    if (tp == NULL) {
+        return (m_msg_recv (m, type, 0));
+    }
+    m->is_timed = 1;
+    m->hdr_time.tv_sec = 0;
+    m->hdr_time.tv_nsec = 0;
+    _m_msg_client_clock (&t0);
+    e = m_msg_recv (m, type, 0);
+    _m_msg_client_clock (&t1);
+
+    if ((m->is_timed)
+            && ((m->hdr_time.tv_sec != 0) || (m->hdr_time.tv_nsec != 0))) {
+        tp->wait_usecs += _m_msg_client_usecs (&t0, &m->hdr_time);
+        tp->recv_usecs += _m_msg_client_usecs (&m->hdr_time, &t1);
+    }
+    else {
+        tp->wait_usecs += _m_msg_client_usecs (&t0, &t1);
+    }
+    return (e);
+}
+
+
+static munge_err_t
+_m_msg_client_check_req_id (m_msg_t mreq, m_msg_t mrsp)
+{
+/*  Checks that the response msg [mrsp] echoes the request ID (if any) of the
+ *    request msg [mreq].
+ *  A request sent in the oldest version (eg, after falling back for an older
+ *    munged) carries no request ID, so its response is not checked.
+ */
+    assert (mreq != NULL);
+    assert (mrsp != NULL);
+
+    if (mrsp->version <= MUNGE_MSG_VERSION_MIN) {
+        return (EMUNGE_SUCCESS);
+    }
+    if (mrsp->version != mreq->version) {
+        m_msg_set_err (mrsp, EMUNGE_SOCKET,
+            strdupf ("Received response version %d for request version %d",
+                mrsp->version, mreq->version));
+        return (EMUNGE_SOCKET);
+    }
+    if ((mreq->req_id_len == mrsp->req_id_len)
+            && ((mreq->req_id_len == 0)
+                || (strcmp (mreq->req_id_str, mrsp->req_id_str) == 0))) {
+        return (EMUNGE_SUCCESS);
+    }
+    m_msg_set_err (mrsp, EMUNGE_SOCKET,
+        strdupf ("Received response for request ID \"%s\" instead of \"%s\"",
+            (mrsp->req_id_str ? mrsp->req_id_str : ""),
+            (mreq->req_id_str ? mreq->req_id_str : "")));
+    return (EMUNGE_SOCKET);
+}
+
+
+static int
+_m_msg_client_downgrade (m_msg_t mreq, m_msg_t mrsp)
+{
+/*  Falls back to sending the request msg [mreq] in the oldest version if the
+ *    daemon closed the connection without responding to a newer version
+ *    (as a munged predating that version does after rejecting its header).
+ *  Fields added by newer versions are then not sent.
+ *  Returns non-zero if the request was downgraded.
+ */
+    assert (mreq != NULL);
+
+    if ((mrsp == NULL) || !mrsp->is_unanswered
+            || (mreq->version <= MUNGE_MSG_VERSION_MIN)) {
+        return (0);
+    }
+    m_msg_set_version (mreq, MUNGE_MSG_VERSION_MIN);
+    return (1);
+}
+
+
 static munge_err_t
 _m_msg_client_disconnect (m_msg_t m) {
     munge_err_t e;
@@ -274,18 +460,24 @@ _m_msg_client_disconnect (m_msg_t m) {
 
 
 static munge_err_t
-_m_msg_client_millisleep (m_msg_t m, unsigned long msecs)
+_m_msg_client_millisleep (m_msg_t m, unsigned long msecs,
+        struct munge_timing *tp)
 {
 /*  Sleeps for 'msecs' milliseconds.
+ *  If timing 'tp', the time actually slept is added to the backoff time.
  *  Returns EMUNGE_SUCCESS on success,
  *    or EMUNGE_SNAFU on error (with additional info if 'm' is not NULL).
  */
     struct timespec ts;
+    struct timespec t0, t1;
     int rv;
 
     ts.tv_sec = msecs / 1000;
     ts.tv_nsec = (msecs % 1000) * 1000 * 1000;
 
+    if (tp != NULL) {
+        _m_msg_client_clock (&t0);
+    }
     while (1) {
         rv = nanosleep (&ts, &ts);
         if (rv == 0) {
@@ -300,5 +492,41 @@ _m_msg_client_millisleep (m_msg_t m, unsigned long msecs)
         }
         return (EMUNGE_SNAFU);
     }
+    if (tp != NULL) {
+        _m_msg_client_clock (&t1);
+        tp->backoff_usecs += _m_msg_client_usecs (&t0, &t1);
+    }
     return (EMUNGE_SUCCESS);
 }
+
+
+static void
+_m_msg_client_clock (struct timespec *tsp)
+{
+/*  Sets 'tsp' to the current time of the monotonic clock.
+ *  Since timings are merely informational, a clock error yields a zero time
+ *    (which _m_msg_client_usecs() treats as an unknown time).
+ */
+    if (clock_gettime (CLOCK_MONOTONIC, tsp) < 0) {
+        tsp->tv_sec = 0;
+        tsp->tv_nsec = 0;
+    }
+    return;
+}
+
+
+static unsigned long
+_m_msg_client_usecs (const struct timespec *t0, const struct timespec *t1)
+{
+/*  Returns the number of microseconds elapsed from 't0' to 't1',
+ *    or 0 if either time is unknown or 't1' does not follow 't0'.
+ */
+    long long usecs;
+
+    if ((t0->tv_sec == 0) || (t1->tv_sec == 0)) {
+        return (0);
+    }
+    usecs = ((long long) (t1->tv_sec - t0->tv_sec) * 1000000)
+        + ((t1->tv_nsec - t0->tv_nsec) / 1000);
+    return ((usecs > 0) ? (unsigned long) usecs : 0);
+}
@@ -69,9 +69,30 @@ typedef enum munge_opt {
     MUNGE_OPT_UID_RESTRICTION   =  9,   /* UID able to decode cred (uid_t)   */
     MUNGE_OPT_GID_RESTRICTION   = 10,   /* GID able to decode cred (gid_t)   */
     MUNGE_OPT_IGNORE_TTL        = 11,   /* ignore ttl/replay errors (int)    */
-    MUNGE_OPT_IGNORE_REPLAY     = 12    /* ignore replay errors (int)        */
+    MUNGE_OPT_IGNORE_REPLAY     = 12,   /* ignore replay errors (int)        */
+    MUNGE_OPT_POOL_SIZE         = 13,   /* num of pre-encoded creds (int)    */
+    MUNGE_OPT_TIMING            = 14,   /* record xfer timings (int)         */
+    MUNGE_OPT_TIMING_INFO       = 15,   /* last xfer timings (munge_timing)  */
+    MUNGE_OPT_REQUEST_ID        = 16,   /* request correlation ID (str)      */
+    MUNGE_OPT_METADATA_ONLY     = 17    /* decode w/o returning payload (int)*/
 } munge_opt_t;
 
+/*  MUNGE client-side timing breakdown of the most recent encode/decode call
+ *    (collected only when MUNGE_OPT_TIMING is enabled).  Times are in usecs
+ *    and accumulate over all attempts.  Connect times exclude backoff sleeps.
+ */
+struct munge_timing {
+    unsigned long       connect_usecs;  /* connecting to the daemon socket   */
+    unsigned long       send_usecs;     /* sending the request message       */
+    unsigned long       auth_usecs;     /* client authentication exchange    */
+    unsigned long       wait_usecs;     /* waiting for the response header   */
+    unsigned long       recv_usecs;     /* receiving the response body       */
+    unsigned long       backoff_usecs;  /* sleeping between retries          */
+    unsigned long       total_usecs;    /* entire client/server transaction  */
+    unsigned int        connect_retries;/* retried connect() attempts        */
+    unsigned int        xfer_retries;   /* retried request/response xfers    */
+};
+
 /*  MUNGE symmetric cipher types
  */
 typedef enum munge_cipher {
@@ -94,6 +115,8 @@ typedef enum munge_mac {
     MUNGE_MAC_RIPEMD160         =  4,   /* RIPEMD-160 w/ 160b-digest         */
     MUNGE_MAC_SHA256            =  5,   /* SHA-256 w/ 256b-digest            */
     MUNGE_MAC_SHA512            =  6,   /* SHA-512 w/ 512b-digest            */
+    MUNGE_MAC_BLAKE2S256        =  7,   /* BLAKE2s w/ 256b-digest            */
+    MUNGE_MAC_BLAKE2B512        =  8,   /* BLAKE2b w/ 512b-digest            */
     MUNGE_MAC_LAST_ITEM
 } munge_mac_t;
 
@@ -0,0 +1,508 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+#include <munge.h>
+#include "common.h"
+#include "ctx.h"
+#include "munge_defs.h"
+#include "pool.h"
+
+
+/*****************************************************************************
+ *  Notes
+ *****************************************************************************/
+/*
+ *  A credential pool keeps up to [size] payload-free credentials that have
+ *    already been encoded by munged with the options of a given munge
+ *    context.  munge_encode() takes a credential from the pool when one is
+ *    available instead of waiting on a round trip to the daemon.
+ *
+ *  The pool is refilled asynchronously by a background thread that encodes
+ *    credentials using a private copy of the context.  Changing any option
+ *    of the owning context resets the pool: its credentials are discarded,
+ *    and those encoded with the previous options while the reset was in
+ *    progress are dropped when they arrive (via the generation count).
+ *
+ *  Credentials are discarded once they reach half of their time-to-live so
+ *    that a pooled credential always has a reasonable lifetime remaining by
+ *    the time it is decoded.  The ttl is the one applied by munged (which
+ *    may differ from the one requested), as reported in its encode response.
+ *    A munged predating msg version 5 does not report it.  In that case,
+ *    credentials are not pooled without an explicit ttl, and are otherwise
+ *    kept for at most MUNGE_POOL_FALLBACK_MAX_AGE seconds.
+ *
+ *  The refill thread does not survive a fork().  A child process will
+ *    bypass the pool and encode credentials directly.
+ *
+ *  Each credential is tagged with the effective UID & GID of the process
+ *    when it was encoded.  If the process changes either one (eg, a daemon
+ *    dropping privileges), the pool is flushed instead of handing out a
+ *    credential encoded under its previous identity.
+ *
+ *  LOCKING PROTOCOL:
+ *    The mutex must be locked when accessing any field of the pool other
+ *      than [tid] and [pid] (which are constant while the thread is running).
+ */
+
+
+/*****************************************************************************
+ *  Data Types
+ *****************************************************************************/
+
+struct munge_pool_cred {
+    char               *cred;           /* credential string with NUL        */
+    time_t              t_expire;       /* time when cred is discarded       */
+    uid_t               euid;           /* effective UID at encode time      */
+    gid_t               egid;           /* effective GID at encode time      */
+};
+
+struct munge_pool {
+    pthread_t           tid;            /* refill thread ID                  */
+    pid_t               pid;            /* PID of process owning the thread  */
+    pthread_mutex_t     mutex;          /* mutex for accessing the pool      */
+    pthread_cond_t      cond;           /* cond for waking the refill thread */
+    munge_ctx_t         ctx;            /* private ctx copy for refills      */
+    unsigned            generation;     /* incremented whenever ctx changes  */
+    int                 is_unpoolable;  /* true if creds cannot be pooled    */
+    int                 size;           /* max number of pooled credentials  */
+    int                 count;          /* current number of pooled creds    */
+    int                 head;           /* index of oldest pooled cred       */
+    int                 do_exit;        /* true if refill thread should exit */
+    struct munge_pool_cred *creds;      /* circular array of [size] creds    */
+};
+
+
+/*****************************************************************************
+ *  Static Prototypes
+ *****************************************************************************/
+
+static munge_err_t _pool_set_ctx (munge_pool_t p, munge_ctx_t ctx);
+
+static void _pool_flush (munge_pool_t p);
+
+static void _pool_expire (munge_pool_t p, time_t now);
+
+static void * _pool_thread (munge_pool_t p);
+
+static int _pool_max_age (munge_ctx_t ctx);
+
+static void _pool_timedwait (munge_pool_t p, time_t t_abs, int msecs);
+
+static void _pool_free_cred (char *cred);
+
+
+/*****************************************************************************
+ *  Internal (but still "Extern") Functions
+ *****************************************************************************/
+
+munge_err_t
+_munge_pool_create (munge_pool_t *pp, munge_ctx_t ctx, int size)
+{
+/*  Creates a credential pool of [size] credentials encoded with the options
+ *    of the munge context [ctx], and starts its refill thread.
+ *  Returns EMUNGE_SUCCESS with the new pool in [pp], or a munge error.
+ */
+    munge_pool_t  p;
+    munge_err_t   e;
+    sigset_t      sigset;
+    sigset_t      sigset_save;
+    int           rv;
+
+    assert (pp != NULL);
+    assert (ctx != NULL);
+    assert (size > 0);
+
+    *pp = NULL;
+    if (!(p = calloc (1, sizeof (*p)))) {
+        return (EMUNGE_NO_MEMORY);
+    }
+    if (!(p->creds = calloc (size, sizeof (*p->creds)))) {
+        free (p);
+        return (EMUNGE_NO_MEMORY);
+    }
+    p->size = size;
+    p->pid = getpid ();
+
+    if ((e = _pool_set_ctx (p, ctx)) != EMUNGE_SUCCESS) {
+        free (p->creds);
+        free (p);
+        return (e);
+    }
+    if ((errno = pthread_mutex_init (&p->mutex, NULL)) != 0) {
+        goto err;
+    }
+    if ((errno = pthread_cond_init (&p->cond, NULL)) != 0) {
+        pthread_mutex_destroy (&p->mutex);
+        goto err;
+    }
+    /*  Block signals in the refill thread so they continue to be delivered
+     *    to the application's threads.
+     */
+    sigfillset (&sigset);
+    pthread_sigmask (SIG_SETMASK, &sigset, &sigset_save);
+    rv = pthread_create (&p->tid, NULL, (void * (*) (void *)) _pool_thread, p);
+    pthread_sigmask (SIG_SETMASK, &sigset_save, NULL);
+    if (rv != 0) {
+        pthread_cond_destroy (&p->cond);
+        pthread_mutex_destroy (&p->mutex);
+        goto err;
+    }
+    *pp = p;
+    return (EMUNGE_SUCCESS);
+
+err:
+    munge_ctx_destroy (p->ctx);
+    free (p->creds);
+    free (p);
+    return (EMUNGE_SNAFU);
+}
+
+
+void
+_munge_pool_destroy (munge_pool_t p)
+{
+/*  Stops the refill thread of the credential pool [p], and destroys the pool
+ *    along with any credentials remaining in it.
+ *  If called from a child process after a fork(), the refill thread does not
+ *    exist and the mutex may have been held at the time of the fork, so the
+ *    pool memory is released without touching either.
+ */
+    int i;
+
+    if (!p) {
+        return;
+    }
+    if (p->pid == getpid ()) {
+        pthread_mutex_lock (&p->mutex);
+        p->do_exit = 1;
+        pthread_cond_signal (&p->cond);
+        pthread_mutex_unlock (&p->mutex);
+        pthread_join (p->tid, NULL);
+        pthread_cond_destroy (&p->cond);
+        pthread_mutex_destroy (&p->mutex);
+        _pool_flush (p);
+    }
+    else {
+        for (i = 0; i < p->size; i++) {
+            _pool_free_cred (p->creds[i].cred);
+        }
+    }
+    munge_ctx_destroy (p->ctx);
+    free (p->creds);
+    free (p);
+    return;
+}
+
+
+int
+_munge_pool_size (munge_pool_t p)
+{
+/*  Returns the maximum number of credentials kept in the pool [p].
+ */
+    return (p ? p->size : 0);
+}
+
+
+munge_err_t
+_munge_pool_reset (munge_pool_t p, munge_ctx_t ctx)
+{
+/*  Discards all credentials in the pool [p], and rebinds the pool to the
+ *    current options of the munge context [ctx].
+ *  Returns EMUNGE_SUCCESS, or a munge error.
+ */
+    munge_err_t e;
+
+    assert (p != NULL);
+    assert (ctx != NULL);
+
+    if (p->pid != getpid ()) {
+        return (EMUNGE_SUCCESS);
+    }
+    pthread_mutex_lock (&p->mutex);
+    _pool_flush (p);
+    e = _pool_set_ctx (p, ctx);
+    pthread_cond_signal (&p->cond);
+    pthread_mutex_unlock (&p->mutex);
+    return (e);
+}
+
+
+int
+_munge_pool_take (munge_pool_t p, char **cred)
+{
+/*  Takes the oldest unexpired credential from the pool [p], and returns it
+ *    in [cred] to be free()d by the caller.
+ *  If the effective UID or GID of the process has changed since the oldest
+ *    credential was encoded, the pool is flushed.
+ *  Returns 1 if a credential was taken, or 0 if the pool is empty.
+ */
+    int taken = 0;
+
+    assert (p != NULL);
+    assert (cred != NULL);
+
+    if (p->pid != getpid ()) {
+        return (0);
+    }
+    pthread_mutex_lock (&p->mutex);
+    _pool_expire (p, time (NULL));
+    if ((p->count > 0) && ((p->creds[p->head].euid != geteuid ())
+                || (p->creds[p->head].egid != getegid ()))) {
+        _pool_flush (p);
+    }
+    if (p->count > 0) {
+        *cred = p->creds[p->head].cred;
+        p->creds[p->head].cred = NULL;
+        p->head = (p->head + 1) % p->size;
+        p->count--;
+        taken = 1;
+    }
+    pthread_cond_signal (&p->cond);
+    pthread_mutex_unlock (&p->mutex);
+    return (taken);
+}
+
+
+/*****************************************************************************
+ *  Static Functions
+ *****************************************************************************/
+
+static munge_err_t
+_pool_set_ctx (munge_pool_t p, munge_ctx_t ctx)
+{
+/*  Replaces the private context of the pool [p] with a copy of [ctx].
+ *  Since munge_ctx_copy() does not copy the pool, the private context
+ *    encodes credentials directly.  It requests the applied ttl from munged
+ *    for computing when its credentials expire.
+ */
+    munge_ctx_t copy;
+
+    if (!(copy = munge_ctx_copy (ctx))) {
+        return (EMUNGE_NO_MEMORY);
+    }
+    copy->flags |= MUNGE_CTX_FLAG_ENC_TTL;
+    munge_ctx_destroy (p->ctx);
+    p->ctx = copy;
+    p->generation++;
+    p->is_unpoolable = 0;
+    return (EMUNGE_SUCCESS);
+}
+
+
+static void
+_pool_flush (munge_pool_t p)
+{
+/*  Discards all credentials in the pool [p].
+ */
+    while (p->count > 0) {
+        _pool_free_cred (p->creds[p->head].cred);
+        p->creds[p->head].cred = NULL;
+        p->head = (p->head + 1) % p->size;
+        p->count--;
+    }
+    p->head = 0;
+    return;
+}
+
+
+static void
+_pool_expire (munge_pool_t p, time_t now)
+{
+/*  Discards credentials in the pool [p] that have reached their maximum age.
+ *  Since credentials are added in encode order, the oldest is at the head.
+ */
+    while ((p->count > 0) && (now >= p->creds[p->head].t_expire)) {
+        _pool_free_cred (p->creds[p->head].cred);
+        p->creds[p->head].cred = NULL;
+        p->head = (p->head + 1) % p->size;
+        p->count--;
+    }
+    return;
+}
+
+
+static void *
+_pool_thread (munge_pool_t p)
+{
+/*  Refills the pool [p] until told to exit.
+ *  The pool's private context is copied whenever its generation changes so
+ *    that it can be used for encoding while the mutex is released.
+ */
+    munge_ctx_t  ctx = NULL;
+    unsigned     generation = 0;
+    char        *cred;
+    time_t       t_encode;
+    uid_t        euid;
+    gid_t        egid;
+    munge_err_t  e;
+    int          max_age;
+    int          i;
+
+    pthread_mutex_lock (&p->mutex);
+    while (!p->do_exit) {
+        _pool_expire (p, time (NULL));
+
+        if (p->is_unpoolable) {
+            /*
+             *  Sleep until the ctx changes.
+             */
+            pthread_cond_wait (&p->cond, &p->mutex);
+            continue;
+        }
+        if (p->count >= p->size) {
+            /*
+             *  Sleep until the oldest credential expires or one is taken.
+             */
+            _pool_timedwait (p, p->creds[p->head].t_expire, 0);
+            continue;
+        }
+        if ((ctx == NULL) || (generation != p->generation)) {
+            munge_ctx_destroy (ctx);
+            if (!(ctx = munge_ctx_copy (p->ctx))) {
+                _pool_timedwait (p, 0, MUNGE_POOL_RETRY_MSECS);
+                continue;
+            }
+            generation = p->generation;
+        }
+        pthread_mutex_unlock (&p->mutex);
+
+        t_encode = time (NULL);
+        euid = geteuid ();
+        egid = getegid ();
+        e = munge_encode (&cred, ctx, NULL, 0);
+        max_age = (e == EMUNGE_SUCCESS) ? _pool_max_age (ctx) : 0;
+
+        pthread_mutex_lock (&p->mutex);
+        if (e != EMUNGE_SUCCESS) {
+            _pool_free_cred (cred);
+            _pool_timedwait (p, 0, MUNGE_POOL_RETRY_MSECS);
+        }
+        else if ((generation != p->generation) || (p->count >= p->size)) {
+            _pool_free_cred (cred);
+        }
+        else if ((euid != geteuid ()) || (egid != getegid ())) {
+            /*
+             *  The identity changed during the encode.
+             */
+            _pool_free_cred (cred);
+        }
+        else if (max_age <= 0) {
+            _pool_free_cred (cred);
+            p->is_unpoolable = 1;
+        }
+        else {
+            i = (p->head + p->count) % p->size;
+            p->creds[i].cred = cred;
+            p->creds[i].t_expire = t_encode + max_age;
+            p->creds[i].euid = euid;
+            p->creds[i].egid = egid;
+            p->count++;
+        }
+    }
+    pthread_mutex_unlock (&p->mutex);
+    munge_ctx_destroy (ctx);
+    return (NULL);
+}
+
+
+static int
+_pool_max_age (munge_ctx_t ctx)
+{
+/*  Returns the number of seconds the credential just encoded with [ctx] can
+ *    be kept in the pool, or 0 if it leaves no useful lifetime for pooling.
+ *  If munged did not report the ttl it applied, the requested ttl is used
+ *    if explicit, capped since munged may have clamped it.
+ */
+    int ttl;
+
+    if (ctx->enc_ttl >= 0) {
+        return (ctx->enc_ttl / 2);
+    }
+    ttl = ctx->ttl;
+    if ((ttl == MUNGE_TTL_DEFAULT) || (ttl == MUNGE_TTL_MAXIMUM)) {
+        return (0);
+    }
+    return (MIN ((ttl / 2), MUNGE_POOL_FALLBACK_MAX_AGE));
+}
+
+
+static void
+_pool_timedwait (munge_pool_t p, time_t t_abs, int msecs)
+{
+/*  Waits on the pool's condition variable until signaled, or until the
+ *    absolute time [t_abs] if non-zero, or for [msecs] milliseconds if
+ *    non-zero.  The mutex must be locked by the caller.
+ */
+    struct timeval  tv;
+    struct timespec ts;
+
+    if (t_abs > 0) {
+        ts.tv_sec = t_abs;
+        ts.tv_nsec = 0;
+    }
+    else {
+        if (gettimeofday (&tv, NULL) < 0) {
+            tv.tv_sec = time (NULL);
+            tv.tv_usec = 0;
+        }
+        ts.tv_sec = tv.tv_sec + (msecs / 1000);
+        ts.tv_nsec = (tv.tv_usec * 1000) + ((msecs % 1000) * 1000 * 1000);
+        if (ts.tv_nsec >= 1000 * 1000 * 1000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000 * 1000 * 1000;
+        }
+    }
+    (void) pthread_cond_timedwait (&p->cond, &p->mutex, &ts);
+    return;
+}
+
+
+static void
+_pool_free_cred (char *cred)
+{
+/*  Scrubs and frees the credential string [cred].
+ */
+    if (cred) {
+        memset (cred, 0, strlen (cred));
+        free (cred);
+    }
+    return;
+}
@@ -0,0 +1,57 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#ifndef MUNGE_POOL_H
+#define MUNGE_POOL_H
+
+
+#include <munge.h>                      /* for munge_ctx_t, munge_err_t      */
+
+
+/*****************************************************************************
+ *  Data Types
+ *****************************************************************************/
+
+typedef struct munge_pool * munge_pool_t;
+
+
+/*****************************************************************************
+ *  Internal (but still "Extern") Prototypes
+ *****************************************************************************/
+
+munge_err_t _munge_pool_create (munge_pool_t *pp, munge_ctx_t ctx, int size);
+
+void _munge_pool_destroy (munge_pool_t p);
+
+int _munge_pool_size (munge_pool_t p);
+
+munge_err_t _munge_pool_reset (munge_pool_t p, munge_ctx_t ctx);
+
+int _munge_pool_take (munge_pool_t p, char **cred);
+
+
+#endif /* !MUNGE_POOL_H */
@@ -53,7 +53,7 @@
  *  Command-Line Options
  *****************************************************************************/
 
-const char * const short_opts = ":hLVns:i:o:c:Cm:Mz:Zu:U:g:G:t:S:";
+const char * const short_opts = ":hLVns:i:o:c:Cm:Mz:Zu:U:g:G:t:S:R:";
 
 #include <getopt.h>
 struct option long_opts[] = {
@@ -76,6 +76,7 @@ struct option long_opts[] = {
     { "gid",          required_argument, NULL, 'G' },
     { "ttl",          required_argument, NULL, 't' },
     { "socket",       required_argument, NULL, 'S' },
+    { "request-id",   required_argument, NULL, 'R' },
     {  NULL,          0,                 NULL,  0  }
 };
 
@@ -390,6 +391,14 @@ parse_cmdline (conf_t conf, int argc, char **argv)
                         munge_ctx_strerror (conf->ctx));
                 }
                 break;
+            case 'R':
+                e = munge_ctx_set (conf->ctx, MUNGE_OPT_REQUEST_ID, optarg);
+                if (e != EMUNGE_SUCCESS) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid request ID \"%s\": %s", optarg,
+                        munge_ctx_strerror (conf->ctx));
+                }
+                break;
             case '?':
                 if (optopt > 0) {
                     log_err (EMUNGE_SNAFU, LOG_ERR,
@@ -516,6 +525,9 @@ display_help (char *prog)
     printf ("  %*s %s\n", w, "-S, --socket=PATH",
             "Specify local socket for munged");
 
+    printf ("  %*s %s\n", w, "-R, --request-id=STR",
+            "Specify request ID for munged log messages");
+
     printf ("\n");
     printf ("By default, payload read from stdin, "
             "credential written to stdout.\n\n");
@@ -0,0 +1,343 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <sys/types.h>                  /* include before in.h for bsd       */
+#include <netinet/in.h>                 /* include before inet.h for bsd     */
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>                 /* for AF_INET                       */
+#include <time.h>
+#include <munge.h>
+#include "audit_rec.h"
+#include "common.h"
+#include "inet_ntop.h"
+#include "license.h"
+#include "log.h"
+#include "version.h"
+#include "xsignal.h"
+
+
+/*****************************************************************************
+ *  Constants
+ *****************************************************************************/
+
+#define MAX_TIME_STR 64
+
+#define NUM_RECS_PER_READ 256
+
+
+/*****************************************************************************
+ *  Command-Line Options
+ *****************************************************************************/
+
+const char * const short_opts = ":hLVN";
+
+#include <getopt.h>
+struct option long_opts[] = {
+    { "help", no_argument, NULL, 'h' },
+    { "license", no_argument, NULL, 'L' },
+    { "version", no_argument, NULL, 'V' },
+    { "numeric", no_argument, NULL, 'N' },
+    { NULL, 0, NULL, 0 }
+};
+
+
+/*****************************************************************************
+ *  Configuration
+ *****************************************************************************/
+
+struct conf {
+    unsigned        got_numeric:1;      /* flag for NUMERIC option           */
+};
+
+typedef struct conf * conf_t;
+
+
+/*****************************************************************************
+ *  Prototypes
+ *****************************************************************************/
+
+void parse_cmdline (conf_t conf, int argc, char **argv);
+void display_help (char *prog);
+void display_file (conf_t conf, const char *name);
+void display_rec (conf_t conf, const struct audit_rec *r);
+void format_time (conf_t conf, uint32_t t, char *buf, size_t buflen);
+
+
+/*****************************************************************************
+ *  Functions
+ *****************************************************************************/
+
+int
+main (int argc, char *argv[])
+{
+    struct conf conf;
+    int         i;
+
+    xsignal_ignore (SIGHUP);
+    log_open_file (stderr, argv[0], LOG_INFO, LOG_OPT_PRIORITY);
+    memset (&conf, 0, sizeof (conf));
+    parse_cmdline (&conf, argc, argv);
+
+    if (optind >= argc) {
+        display_file (&conf, "-");
+    }
+    for (i = optind; i < argc; i++) {
+        display_file (&conf, argv[i]);
+    }
+    if ((fflush (stdout) != 0) && (errno != EPIPE)) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to write to stdout");
+    }
+    log_close_file ();
+    exit (EMUNGE_SUCCESS);
+}
+
+
+void
+parse_cmdline (conf_t conf, int argc, char **argv)
+{
+    char *prog;
+    int   c;
+
+    opterr = 0;                         /* suppress default getopt err msgs */
+
+    prog = (prog = strrchr (argv[0], '/')) ? prog + 1 : argv[0];
+
+    for (;;) {
+
+        c = getopt_long (argc, argv, short_opts, long_opts, NULL);
+
+        if (c == -1) {                  /* reached end of option list */
+            break;
+        }
+        switch (c) {
+            case 'h':
+                display_help (prog);
+                exit (EMUNGE_SUCCESS);
+                break;
+            case 'L':
+                display_license ();
+                exit (EMUNGE_SUCCESS);
+                break;
+            case 'V':
+                display_version ();
+                exit (EMUNGE_SUCCESS);
+                break;
+            case 'N':
+                conf->got_numeric = 1;
+                break;
+            case '?':
+                if (optopt > 0) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                            "Invalid option \"-%c\"", optopt);
+                }
+                else if (optind > 1) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                            "Invalid option \"%s\"", argv[optind - 1]);
+                }
+                else {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                            "Failed to process command-line");
+                }
+                break;
+            default:
+                if ((optind > 1) && (!strncmp (argv[optind - 1], "--", 2))) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                            "Unimplemented option \"%s\"", argv[optind - 1]);
+                }
+                else {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                            "Unimplemented option \"-%c\"", c);
+                }
+                break;
+        }
+    }
+    return;
+}
+
+
+void
+display_help (char *prog)
+{
+    const int w = -25;                  /* pad for width of option string */
+
+    assert (prog != NULL);
+
+    printf ("Usage: %s [OPTIONS] [FILE...]\n", prog);
+    printf ("\n");
+
+    printf ("  %*s %s\n", w, "-h, --help",
+            "Display this help message");
+
+    printf ("  %*s %s\n", w, "-L, --license",
+            "Display license information");
+
+    printf ("  %*s %s\n", w, "-V, --version",
+            "Display version information");
+
+    printf ("\n");
+
+    printf ("  %*s %s\n", w, "-N, --numeric",
+            "Display times and MAC types numerically");
+
+    printf ("\n");
+    printf ("By default, audit log read from stdin, "
+            "one record per line written to stdout.\n\n");
+    return;
+}
+
+
+void
+display_file (conf_t conf, const char *name)
+{
+/*  Displays each record in the munged audit log [name] ("-" for stdin).
+ */
+    FILE             *fp;
+    unsigned char     hdr[AUDIT_HDR_LEN];
+    unsigned char     buf[NUM_RECS_PER_READ * AUDIT_REC_LEN];
+    struct audit_rec  r;
+    size_t            n;
+    size_t            i;
+
+    assert (conf != NULL);
+    assert (name != NULL);
+
+    if (strcmp (name, "-") == 0) {
+        fp = stdin;
+        name = "stdin";
+    }
+    else if (!(fp = fopen (name, "r"))) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to open audit log \"%s\"", name);
+    }
+    if ((fread (hdr, 1, sizeof (hdr), fp) != sizeof (hdr))
+            || (audit_hdr_unpack (hdr) < 0)) {
+        if (ferror (fp)) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to read audit log \"%s\"", name);
+        }
+        log_err (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to read audit log \"%s\": Invalid header", name);
+    }
+    do {
+        n = fread (buf, 1, sizeof (buf), fp);
+        for (i = 0; i + AUDIT_REC_LEN <= n; i += AUDIT_REC_LEN) {
+            audit_rec_unpack (&r, buf + i);
+            display_rec (conf, &r);
+        }
+        if (i < n) {
+            log_msg (LOG_WARNING,
+                    "Ignoring partial record at end of audit log \"%s\"",
+                    name);
+        }
+    } while (n == sizeof (buf));
+
+    if (ferror (fp)) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to read audit log \"%s\"", name);
+    }
+    if (fp != stdin) {
+        (void) fclose (fp);
+    }
+    return;
+}
+
+
+void
+display_rec (conf_t conf, const struct audit_rec *r)
+{
+/*  Displays the audit record [r] on a single line.
+ */
+    char         t_dec[MAX_TIME_STR];
+    char         t_enc[MAX_TIME_STR];
+    char         addr_str[INET_ADDRSTRLEN];
+    char         mac_str[(AUDIT_MAC_PREFIX_LEN * 2) + 1];
+    const char  *mac_type;
+    int          i;
+
+    format_time (conf, r->time_dec, t_dec, sizeof (t_dec));
+    format_time (conf, r->time_enc, t_enc, sizeof (t_enc));
+
+    if (!inet_ntop (AF_INET, r->addr, addr_str, sizeof (addr_str))) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to convert origin address to a string");
+    }
+    for (i = 0; i < r->mac_len; i++) {
+        (void) snprintf (mac_str + (i * 2), 3, "%02x", r->mac[i]);
+    }
+    mac_str[i * 2] = '\0';
+
+    mac_type = conf->got_numeric
+        ? NULL : munge_enum_int_to_str (MUNGE_ENUM_MAC, r->mac_type);
+
+    printf ("%s encoded=%s host=%s client=%u:%u cred=%u:%u ",
+            t_dec, t_enc, addr_str,
+            (unsigned int) r->client_uid, (unsigned int) r->client_gid,
+            (unsigned int) r->cred_uid, (unsigned int) r->cred_gid);
+    if (mac_type != NULL) {
+        printf ("mac=%s:%s\n", mac_type, mac_str);
+    }
+    else {
+        printf ("mac=%d:%s\n", r->mac_type, mac_str);
+    }
+    return;
+}
+
+
+void
+format_time (conf_t conf, uint32_t t, char *buf, size_t buflen)
+{
+/*  Formats the time [t] into [buf] of length [buflen] as a single token.
+ */
+    time_t     tt = (time_t) t;
+    struct tm *tm_ptr;
+    size_t     n = 0;
+
+    if (conf->got_numeric) {
+        n = snprintf (buf, buflen, "%ld", (long) tt);
+    }
+    else if (!(tm_ptr = localtime (&tt))) {
+        log_err (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to convert time to local time");
+    }
+    else {
+        n = strftime (buf, buflen, "%Y-%m-%dT%H:%M:%S%z", tm_ptr);
+    }
+    if ((n == 0) || (n >= buflen)) {
+        log_err (EMUNGE_OVERFLOW, LOG_ERR,
+                "Failed to format time: exceeded buffer");
+    }
+    return;
+}
@@ -30,6 +30,7 @@
 #endif /* HAVE_CONFIG_H */
 
 #include <assert.h>
+#include <dirent.h>
 #include <errno.h>
 #include <limits.h>
 #include <pthread.h>
@@ -38,14 +39,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 #include <munge.h>
 #include "common.h"
 #include "license.h"
 #include "log.h"
+#include "m_msg.h"
 #include "query.h"
+#include "trace_rec.h"
 #include "version.h"
 #include "xsignal.h"
 
@@ -58,14 +63,21 @@
 #define DEF_NUM_THREADS         1
 #define DEF_PAYLOAD_LENGTH      0
 #define DEF_WARNING_TIME        5
+#define DEF_WARMUP_TIME         1
 #define MIN_DURATION            0.5
+#define LAT_NUM_BUCKETS         256
+#define SWEEP_MIN_GAIN          0.05
+#define DEF_REPLAY_SPEED        1.0
+#define REPLAY_LATE_USECS       1000
+#define REPLAY_RECS_PER_READ    256
 
 
 /*****************************************************************************
  *  Command-Line Options
  *****************************************************************************/
 
-const char * const short_opts = ":hLVqc:Cm:Mz:Zedl:u:g:t:S:D:N:T:W:";
+const char * const short_opts =
+    ":hLVqc:Cm:Mz:Zedl:u:g:t:S:P:p:F:BD:N:T:W:s:w:R:X:";
 
 #include <getopt.h>
 struct option long_opts[] = {
@@ -86,10 +98,18 @@ struct option long_opts[] = {
     { "restrict-gid", required_argument, NULL, 'g' },
     { "ttl",          required_argument, NULL, 't' },
     { "socket",       required_argument, NULL, 'S' },
+    { "pool-size",    required_argument, NULL, 'P' },
+    { "pid",          required_argument, NULL, 'p' },
+    { "pid-file",     required_argument, NULL, 'F' },
+    { "breakdown",    no_argument,       NULL, 'B' },
     { "duration",     required_argument, NULL, 'D' },
     { "num-creds",    required_argument, NULL, 'N' },
     { "num-threads",  required_argument, NULL, 'T' },
     { "warn-time",    required_argument, NULL, 'W' },
+    { "sweep",        required_argument, NULL, 's' },
+    { "warmup",       required_argument, NULL, 'w' },
+    { "replay",       required_argument, NULL, 'R' },
+    { "replay-speed", required_argument, NULL, 'X' },
     {  NULL,          0,                 NULL,  0  }
 };
 
@@ -98,9 +118,20 @@ struct option long_opts[] = {
  *  Data Types
  *****************************************************************************/
 
+struct cpu_stats {
+    double          user_secs;          /* CPU time spent in user mode       */
+    double          sys_secs;           /* CPU time spent in kernel mode     */
+    double          run_secs;           /* CPU time from schedstat if avail  */
+    double          wait_secs;          /* time waiting on a runqueue        */
+    unsigned long   vol_ctxsw;          /* voluntary context switches        */
+    unsigned long   invol_ctxsw;        /* involuntary context switches      */
+    unsigned        got_schedstat:1;    /* true if schedstat was available   */
+};
+
 /*  LOCKING PROTOCOL:
  *    The mutex must be locked when accessing the following fields:
- *      num_creds_done, num_encode_errs, num_decode_errs.
+ *      num_creds_done, num_encode_errs, num_decode_errs, lat_hist,
+ *      num_timed, timing.
  *    The remaining fields are either not shared between threads or
  *      are constant while processing credentials.
  */
@@ -109,14 +140,30 @@ struct conf {
     int             do_decode;          /* true to decode/validate all creds */
     char           *payload;            /* payload to be encoded into cred   */
     int             num_payload;        /* number of bytes for cred payload  */
+    int             pool_size;          /* num of pooled creds per thread    */
+    int             do_timing;          /* true to report client timings     */
     int             max_threads;        /* max number of threads available   */
     int             num_threads;        /* number of threads to spawn        */
     int             num_running;        /* number of threads now running     */
     int             num_seconds;        /* number of seconds to run          */
     unsigned long   num_creds;          /* number of credentials to process  */
     int             warn_time;          /* number of seconds to allow for op */
+    int             sweep_min;          /* min threads to sweep; 0=no sweep  */
+    int             sweep_max;          /* max threads to sweep              */
+    int             sweep_step;         /* threads added per step; 0=double  */
+    int             warmup_secs;        /* secs to warm up each sweep step   */
+    struct trace_rec *replay_recs;      /* requests to replay from trace     */
+    unsigned long   replay_num;         /* number of requests to replay      */
+    double          replay_speed;       /* replay speed factor; 0=unpaced    */
+    unsigned long   replay_num_errs;    /* num requests recorded with errors */
+    unsigned long   replay_hist[LAT_NUM_BUCKETS];   /* recorded service hist */
     struct timeval  t_main_start;       /* time when cred processing started */
     struct timeval  t_main_stop;        /* time when cred processing stopped */
+    pid_t           munged_pid;         /* munged pid for efficiency stats   */
+    struct cpu_stats munged_start;      /* munged CPU usage at start         */
+    struct cpu_stats munged_stop;       /* munged CPU usage at stop          */
+    struct cpu_stats client_start;      /* client CPU usage at start         */
+    struct cpu_stats client_stop;       /* client CPU usage at stop          */
     pthread_t      *tids;               /* ptr to array of thread IDs        */
     pthread_mutex_t mutex;              /* mutex for accessing shared data   */
     pthread_cond_t  cond_done;          /* cond for when last thread is done */
@@ -125,6 +172,11 @@ struct conf {
       unsigned long num_creds_done;     /*   number of credentials processed */
       unsigned long num_encode_errs;    /*   number of errors encoding creds */
       unsigned long num_decode_errs;    /*   number of errors decoding creds */
+      unsigned long lat_hist[LAT_NUM_BUCKETS];  /* cred latency histogram */
+      unsigned long num_timed;          /*   number of encode/decode calls   */
+      struct munge_timing timing;       /*   sum of client-side timings      */
+      unsigned long max_lag_usecs;      /*   max lag behind replay schedule  */
+      unsigned long num_late;           /*   num requests replayed late      */
     }               shared;
 };
 typedef struct conf * conf_t;
@@ -133,6 +185,11 @@ struct thread_data {
     conf_t          conf;               /* reference to global configuration */
     munge_ctx_t     ectx;               /* local munge context for encodes   */
     munge_ctx_t     dctx;               /* local munge context for decodes   */
+    unsigned long   lat_hist[LAT_NUM_BUCKETS];  /* local latency histogram   */
+    unsigned long   num_timed;          /* local num of encode/decode calls  */
+    struct munge_timing timing;         /* local sum of client-side timings  */
+    unsigned long   max_lag_usecs;      /* local max lag behind replay sched */
+    unsigned long   num_late;           /* local num requests replayed late  */
 };
 typedef struct thread_data * tdata_t;
 
@@ -163,9 +220,27 @@ int     get_time_multiple (char c);
 void    start_threads (conf_t conf);
 void    process_creds (conf_t conf);
 void    stop_threads (conf_t conf);
+void    display_results (conf_t conf);
+void    display_timing (conf_t conf);
+void    sweep_threads (conf_t conf);
+void    run_phase (conf_t conf, int num_threads, int num_seconds,
+            unsigned long num_creds);
+int     get_lat_bucket (unsigned long usecs);
+double  get_lat_percentile (const unsigned long *hist, double pct);
 void *  remunge (conf_t conf);
+void    add_timing (struct munge_timing *sum, const struct munge_timing *t);
 void    remunge_cleanup (tdata_t tdata);
 void    output_msg (const char *format, ...);
+pid_t   read_pid_file (const char *path);
+void    get_munged_stats (pid_t pid, struct cpu_stats *cs);
+void    get_client_stats (struct cpu_stats *cs);
+void    display_efficiency (conf_t conf, unsigned long n);
+void    load_replay (conf_t conf, const char *name);
+int     replay_cmp (const void *p1, const void *p2);
+void *  replay (conf_t conf);
+int     replay_set_ctx (munge_ctx_t ctx, const struct trace_rec *rp);
+void    replay_wait (conf_t conf, const struct trace_rec *rp, tdata_t tdata);
+void    display_replay (conf_t conf);
 
 
 /*****************************************************************************
@@ -212,10 +287,15 @@ main (int argc, char *argv[])
     conf = create_conf ();
     parse_cmdline (conf, argc, argv);
 
-    start_threads (conf);
-    process_creds (conf);
-    stop_threads (conf);
-
+    if (conf->sweep_min > 0) {
+        sweep_threads (conf);
+    }
+    else {
+        start_threads (conf);
+        process_creds (conf);
+        stop_threads (conf);
+        display_results (conf);
+    }
     destroy_conf (conf);
     log_close_file ();
     exit (EMUNGE_SUCCESS);
@@ -246,6 +326,8 @@ create_conf (void)
     conf->do_decode = DEF_DO_DECODE;
     conf->payload = NULL;
     conf->num_payload = DEF_PAYLOAD_LENGTH;;
+    conf->pool_size = 0;
+    conf->do_timing = 0;
     conf->num_threads = DEF_NUM_THREADS;
     conf->num_running = 0;
     conf->num_seconds = 0;
@@ -253,8 +335,23 @@ create_conf (void)
     conf->shared.num_creds_done = 0;
     conf->shared.num_encode_errs = 0;
     conf->shared.num_decode_errs = 0;
+    memset (conf->shared.lat_hist, 0, sizeof (conf->shared.lat_hist));
+    conf->shared.num_timed = 0;
+    memset (&conf->shared.timing, 0, sizeof (conf->shared.timing));
     conf->warn_time = DEF_WARNING_TIME;
+    conf->sweep_min = 0;
+    conf->sweep_max = 0;
+    conf->sweep_step = 0;
+    conf->warmup_secs = DEF_WARMUP_TIME;
+    conf->replay_recs = NULL;
+    conf->replay_num = 0;
+    conf->replay_speed = DEF_REPLAY_SPEED;
+    conf->replay_num_errs = 0;
+    memset (conf->replay_hist, 0, sizeof (conf->replay_hist));
+    conf->shared.max_lag_usecs = 0;
+    conf->shared.num_late = 0;
     conf->tids = NULL;
+    conf->munged_pid = 0;
     /*
      *  Compute the maximum number of threads available for the process.
      *    Each thread requires an open file descriptor to communicate with
@@ -292,6 +389,7 @@ destroy_conf (conf_t conf)
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to destroy mutex");
     }
     munge_ctx_destroy (conf->ctx);
+    free (conf->replay_recs);
     free (conf->tids);
     free (conf);
     return;
@@ -315,6 +413,11 @@ create_tdata (conf_t conf)
             "Failed to allocate thread data");
     }
     tdata->conf = conf;
+    memset (tdata->lat_hist, 0, sizeof (tdata->lat_hist));
+    tdata->num_timed = 0;
+    memset (&tdata->timing, 0, sizeof (tdata->timing));
+    tdata->max_lag_usecs = 0;
+    tdata->num_late = 0;
     /*
      *  The munge ctx in the global conf is copied since each thread needs
      *    access to its own local ctx for thread-safety.
@@ -327,6 +430,15 @@ create_tdata (conf_t conf)
     if (!(tdata->ectx = munge_ctx_copy (conf->ctx))) {
         log_err (EMUNGE_SNAFU, LOG_ERR, "Failed to copy munge encode context");
     }
+    /*  The credential pool is not copied with the ctx, so each thread's
+     *    encode ctx gets its own pool.
+     */
+    if ((conf->pool_size > 0) && (munge_ctx_set (tdata->ectx,
+            MUNGE_OPT_POOL_SIZE, conf->pool_size) != EMUNGE_SUCCESS)) {
+        log_err (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to set credential pool size: %s",
+            munge_ctx_strerror (tdata->ectx));
+    }
     if ((conf->do_decode) && !(tdata->dctx = munge_ctx_copy (conf->ctx))) {
         log_err (EMUNGE_SNAFU, LOG_ERR, "Failed to copy munge decode context");
     }
@@ -358,11 +470,14 @@ parse_cmdline (conf_t conf, int argc, char **argv)
     char          *prog;
     int            c;
     char          *p;
+    char          *q;
     int            i;
     long int       l;
     unsigned long  u;
     int            multiplier;
     munge_err_t    e;
+    double         d;
+    char          *replay_name = NULL;
 
     opterr = 0;                         /* suppress default getopt err msgs */
 
@@ -529,6 +644,44 @@ parse_cmdline (conf_t conf, int argc, char **argv)
                         munge_ctx_strerror (conf->ctx));
                 }
                 break;
+            case 'P':
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if ((optarg == p) || (*p != '\0') || (l < 0)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid credential pool size '%s'", optarg);
+                }
+                if (((errno == ERANGE) && (l == LONG_MAX))
+                        || (l > MUNGE_POOL_MAX_SIZE)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Exceeded maximum credential pool size of %d",
+                        MUNGE_POOL_MAX_SIZE);
+                }
+                conf->pool_size = (int) l;
+                break;
+            case 'p':
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if ((optarg == p) || (*p != '\0') || (l <= 0)
+                        || ((errno == ERANGE) && (l == LONG_MAX))
+                        || (l > INT_MAX)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid munged pid '%s'", optarg);
+                }
+                conf->munged_pid = (pid_t) l;
+                break;
+            case 'F':
+                conf->munged_pid = read_pid_file (optarg);
+                break;
+            case 'B':
+                e = munge_ctx_set (conf->ctx, MUNGE_OPT_TIMING, 1);
+                if (e != EMUNGE_SUCCESS) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Failed to enable timing breakdown: %s",
+                        munge_ctx_strerror (conf->ctx));
+                }
+                conf->do_timing = 1;
+                break;
             case 'D':
                 errno = 0;
                 l = strtol (optarg, &p, 10);
@@ -604,6 +757,62 @@ parse_cmdline (conf_t conf, int argc, char **argv)
                 }
                 conf->warn_time = (int) l;
                 break;
+            case 's':
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if ((optarg == p) || (*p != '-') || (l <= 0)
+                        || (l > conf->max_threads)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid thread sweep '%s'", optarg);
+                }
+                conf->sweep_min = (int) l;
+                q = p + 1;
+                l = strtol (q, &p, 10);
+                if ((q == p) || ((*p != '\0') && (*p != ':'))
+                        || (l < conf->sweep_min) || (l > conf->max_threads)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid thread sweep '%s'", optarg);
+                }
+                conf->sweep_max = (int) l;
+                conf->sweep_step = 0;
+                if (*p == ':') {
+                    q = p + 1;
+                    l = strtol (q, &p, 10);
+                    if ((q == p) || (*p != '\0') || (l <= 0)
+                            || (l > conf->max_threads)) {
+                        log_err (EMUNGE_SNAFU, LOG_ERR,
+                            "Invalid thread sweep '%s'", optarg);
+                    }
+                    conf->sweep_step = (int) l;
+                }
+                break;
+            case 'w':
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if ((optarg == p) || (*p != '\0') || (l < 0)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid warmup time '%s'", optarg);
+                }
+                if (((errno == ERANGE) && (l == LONG_MAX)) || (l > INT_MAX)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Exceeded maximum warmup time of %d seconds",
+                        INT_MAX);
+                }
+                conf->warmup_secs = (int) l;
+                break;
+            case 'R':
+                replay_name = optarg;
+                break;
+            case 'X':
+                errno = 0;
+                d = strtod (optarg, &p);
+                if ((optarg == p) || (*p != '\0') || (errno == ERANGE)
+                        || !(d >= 0.0)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid replay speed '%s'", optarg);
+                }
+                conf->replay_speed = d;
+                break;
             case '?':
                 if (optopt > 0) {
                     log_err (EMUNGE_SNAFU, LOG_ERR,
@@ -651,6 +860,13 @@ parse_cmdline (conf_t conf, int argc, char **argv)
         log_err (EMUNGE_SNAFU, LOG_ERR,
             "Unrecognized parameter \"%s\"", argv[optind]);
     }
+    if (replay_name != NULL) {
+        if (conf->sweep_min > 0) {
+            log_err (EMUNGE_SNAFU, LOG_ERR,
+                "Replay cannot be combined with a thread sweep");
+        }
+        load_replay (conf, replay_name);
+    }
     /*  Create arbitrary payload of the specified length.
      */
     if (conf->num_payload > 0) {
@@ -737,6 +953,18 @@ display_help (char *prog)
     printf ("  %*s %s\n", w, "-S, --socket=PATH",
             "Specify local socket for munged");
 
+    printf ("  %*s %s\n", w, "-P, --pool-size=INT",
+            "Specify number of pre-encoded creds per thread");
+
+    printf ("  %*s %s\n", w, "-p, --pid=PID",
+            "Report efficiency using CPU usage of munged PID");
+
+    printf ("  %*s %s\n", w, "-F, --pid-file=PATH",
+            "Report efficiency using munged PID from file");
+
+    printf ("  %*s %s\n", w, "-B, --breakdown",
+            "Report client-side timing breakdown per call");
+
     printf ("\n");
 
     printf ("  %*s %s\n", w, "-D, --duration=SECS",
@@ -751,6 +979,22 @@ display_help (char *prog)
     printf ("  %*s %s\n", w, "-W, --warn-time=SECS",
             "Specify max seconds for munge op before warning");
 
+    printf ("\n");
+
+    printf ("  %*s %s\n", w, "-s, --sweep=MIN-MAX[:STEP]",
+            "Sweep thread counts (doubling if no STEP)");
+
+    printf ("  %*s %s\n", w, "-w, --warmup=SECS",
+            "Specify warmup before each sweep step [1]");
+
+    printf ("\n");
+
+    printf ("  %*s %s\n", w, "-R, --replay=PATH",
+            "Replay requests from munged request trace");
+
+    printf ("  %*s %s\n", w, "-X, --replay-speed=FACTOR",
+            "Scale replay speed (0=unpaced) [1]");
+
     printf ("\n");
     return;
 }
@@ -855,6 +1099,7 @@ start_threads (conf_t conf)
  */
     pthread_attr_t tattr;
     size_t         stacksize = 256 * 1024;
+    thread_f       f;
     int            i;
 
     if (!(conf->tids = malloc (sizeof (*conf->tids) * conf->num_threads))) {
@@ -891,11 +1136,14 @@ start_threads (conf_t conf)
 
     output_msg ("Spawning %d thread%s for %s",
         conf->num_threads, ((conf->num_threads == 1) ? "" : "s"),
-        (conf->do_decode ? "encoding/decoding" : "encoding"));
+        ((conf->replay_recs != NULL) ? "replaying" :
+         (conf->do_decode ? "encoding/decoding" : "encoding")));
+
+    f = (conf->replay_recs != NULL) ? (thread_f) replay : (thread_f) remunge;
 
     for (i = 0; i < conf->num_threads; i++) {
         if ((errno = pthread_create
-                    (&conf->tids[i], &tattr, (thread_f) remunge, conf)) != 0) {
+                    (&conf->tids[i], &tattr, f, conf)) != 0) {
             log_errno (EMUNGE_SNAFU, LOG_ERR,
                 "Failed to create thread #%d", i+1);
         }
@@ -919,6 +1167,13 @@ process_creds (conf_t conf)
     unsigned long   n_creds;
     struct timespec to;
 
+    /*  Sample the starting CPU usage of munged and this process for the
+     *    efficiency report.
+     */
+    if (conf->munged_pid > 0) {
+        get_munged_stats (conf->munged_pid, &conf->munged_start);
+        get_client_stats (&conf->client_start);
+    }
     /*  Start the main timer before the timeout is computed below.
      */
     GET_TIMEVAL (conf->t_main_start);
@@ -996,12 +1251,9 @@ process_creds (conf_t conf)
 void
 stop_threads (conf_t conf)
 {
-/*  Stop the threads from processing further credentials.  Output the results.
+/*  Stop the threads from processing further credentials.
  */
-    int           i;
-    unsigned long n;
-    double        delta;
-    double        rate;
+    int i;
 
     /*  The mutex must be unlocked here in order to let the threads clean up
      *    (via remunge_cleanup()) once they are canceled/finished.
@@ -1026,6 +1278,26 @@ stop_threads (conf_t conf)
     /*  Stop the main timer now that all credential processing has stopped.
      */
     GET_TIMEVAL (conf->t_main_stop);
+
+    if (conf->munged_pid > 0) {
+        get_munged_stats (conf->munged_pid, &conf->munged_stop);
+        get_client_stats (&conf->client_stop);
+    }
+    free (conf->tids);
+    conf->tids = NULL;
+    return;
+}
+
+
+void
+display_results (conf_t conf)
+{
+/*  Output the results of processing credentials.
+ */
+    unsigned long n;
+    double        delta;
+    double        rate;
+
     delta = DIFF_TIMEVAL (conf->t_main_stop, conf->t_main_start);
     /*
      *  Output processing stop message and results.
@@ -1058,6 +1330,15 @@ stop_threads (conf_t conf)
     if (g_got_quiet) {
         printf ("%0.0f\n", rate);
     }
+    if (conf->munged_pid > 0) {
+        display_efficiency (conf, n);
+    }
+    if (conf->do_timing) {
+        display_timing (conf);
+    }
+    if (conf->replay_recs != NULL) {
+        display_replay (conf);
+    }
     /*  Check for minimum duration time interval.
      */
     if (delta < MIN_DURATION) {
@@ -1068,6 +1349,206 @@ stop_threads (conf_t conf)
 }
 
 
+void
+display_timing (conf_t conf)
+{
+/*  Output the average client-side timing breakdown of each munge_encode()
+ *    and munge_decode() call, along with the total retries and backoff.
+ */
+    struct munge_timing *tp = &conf->shared.timing;
+    double               n;
+
+    if (conf->shared.num_timed == 0) {
+        return;
+    }
+    n = conf->shared.num_timed;
+    output_msg ("Client usecs per call: connect %0.1f, send %0.1f, "
+        "auth %0.1f, wait %0.1f, recv %0.1f (total %0.1f)",
+        tp->connect_usecs / n, tp->send_usecs / n, tp->auth_usecs / n,
+        tp->wait_usecs / n, tp->recv_usecs / n, tp->total_usecs / n);
+    output_msg ("Client retries: %u connect, %u xfer (%0.3fs backoff)",
+        tp->connect_retries, tp->xfer_retries, tp->backoff_usecs / 1e6);
+    return;
+}
+
+
+void
+sweep_threads (conf_t conf)
+{
+/*  Process credentials over a series of steps in the number of threads,
+ *    running a warmup phase before each measured phase.  Output a table of
+ *    throughput & latency percentiles per step, along with the scaling
+ *    efficiency and the throughput gained per added thread.
+ *  The saturation point is the first step after which adding threads gains
+ *    less than SWEEP_MIN_GAIN throughput.
+ */
+    int            num_seconds;
+    unsigned long  num_creds;
+    int            got_quiet;
+    int            t, t_prev = 0;
+    int            t_first = 0;
+    int            t_sat = 0;
+    double         rate, rate_prev = 0.0;
+    double         rate_first = 0.0;
+    double         rate_sat = 0.0;
+    double         delta;
+    unsigned long  n, errs;
+
+    num_seconds = conf->num_seconds;
+    num_creds = conf->num_creds;
+    if (!num_creds && !num_seconds) {
+        num_seconds = 1;
+    }
+    got_quiet = g_got_quiet;
+    g_got_quiet = 1;
+
+    printf ("%7s %10s %7s %8s %9s %9s %9s %6s\n", "Threads", "Creds/sec",
+        "Eff", "Gain/thr", "p50(ms)", "p90(ms)", "p99(ms)", "Errors");
+
+    t = conf->sweep_min;
+    while (t > 0) {
+        if (conf->warmup_secs > 0) {
+            run_phase (conf, t, conf->warmup_secs, 0);
+        }
+        run_phase (conf, t, num_seconds, num_creds);
+
+        delta = DIFF_TIMEVAL (conf->t_main_stop, conf->t_main_start);
+        errs = conf->shared.num_encode_errs + conf->shared.num_decode_errs;
+        n = conf->shared.num_creds_done - errs;
+        rate = n / delta;
+
+        if (t_first == 0) {
+            t_first = t;
+            rate_first = rate;
+        }
+        printf ("%7d %10.0f %6.0f%% ", t, rate,
+            (rate_first > 0) ? (100.0 * rate * t_first) / (rate_first * t)
+                             : 0.0);
+        if (t_prev > 0) {
+            printf ("%8.0f ", (rate - rate_prev) / (t - t_prev));
+        }
+        else {
+            printf ("%8s ", "-");
+        }
+        printf ("%9.3f %9.3f %9.3f %6lu\n",
+            get_lat_percentile (conf->shared.lat_hist, 0.50),
+            get_lat_percentile (conf->shared.lat_hist, 0.90),
+            get_lat_percentile (conf->shared.lat_hist, 0.99), errs);
+
+        if ((t_sat == 0) && (t_prev > 0)
+                && (rate < rate_prev * (1.0 + SWEEP_MIN_GAIN))) {
+            t_sat = t_prev;
+            rate_sat = rate_prev;
+        }
+        t_prev = t;
+        rate_prev = rate;
+
+        if (t >= conf->sweep_max) {
+            break;
+        }
+        t = (conf->sweep_step > 0) ? t + conf->sweep_step : t * 2;
+        if (t > conf->sweep_max) {
+            t = conf->sweep_max;
+        }
+    }
+    g_got_quiet = got_quiet;
+
+    if (t_sat > 0) {
+        printf ("\nSaturation at %d thread%s (%0.0f creds/sec)\n",
+            t_sat, ((t_sat == 1) ? "" : "s"), rate_sat);
+    }
+    else {
+        printf ("\nSaturation not reached by %d thread%s\n",
+            t_prev, ((t_prev == 1) ? "" : "s"));
+    }
+    return;
+}
+
+
+void
+run_phase (conf_t conf, int num_threads, int num_seconds,
+           unsigned long num_creds)
+{
+/*  Process credentials with [num_threads] threads for [num_seconds] or
+ *    until [num_creds] have been processed, whichever comes first.
+ *  The results are left in [conf] for the caller.
+ */
+    conf->num_threads = num_threads;
+    conf->num_seconds = num_seconds;
+    conf->num_creds = num_creds;
+    conf->shared.num_creds_done = 0;
+    conf->shared.num_encode_errs = 0;
+    conf->shared.num_decode_errs = 0;
+    memset (conf->shared.lat_hist, 0, sizeof (conf->shared.lat_hist));
+    conf->shared.num_timed = 0;
+    memset (&conf->shared.timing, 0, sizeof (conf->shared.timing));
+
+    start_threads (conf);
+    process_creds (conf);
+    stop_threads (conf);
+    return;
+}
+
+
+int
+get_lat_bucket (unsigned long usecs)
+{
+/*  Returns the latency histogram bucket for [usecs].
+ *  Latencies under 16us each get their own bucket; above that, each power
+ *    of 2 is split into 8 buckets for a resolution of 12.5%.
+ */
+    int e;
+    int i;
+
+    if (usecs < 16) {
+        return ((int) usecs);
+    }
+    for (e = 4; (usecs >> (e + 1)) != 0; e++) {
+        ;
+    }
+    i = 16 + ((e - 4) * 8) + (int) ((usecs >> (e - 3)) & 7);
+    return ((i < LAT_NUM_BUCKETS) ? i : LAT_NUM_BUCKETS - 1);
+}
+
+
+double
+get_lat_percentile (const unsigned long *hist, double pct)
+{
+/*  Returns the latency (in milliseconds) at percentile [pct] (0-1) of the
+ *    histogram [hist].  This is the upper bound of the bucket in which the
+ *    percentile falls.
+ */
+    unsigned long total = 0;
+    unsigned long sum = 0;
+    unsigned long usecs;
+    int           i;
+    int           e;
+    int           sub;
+
+    for (i = 0; i < LAT_NUM_BUCKETS; i++) {
+        total += hist[i];
+    }
+    if (total == 0) {
+        return (0.0);
+    }
+    for (i = 0; i < LAT_NUM_BUCKETS - 1; i++) {
+        sum += hist[i];
+        if (sum >= pct * total) {
+            break;
+        }
+    }
+    if (i < 16) {
+        usecs = i;
+    }
+    else {
+        e = ((i - 16) / 8) + 4;
+        sub = (i - 16) % 8;
+        usecs = ((8UL + sub + 1) << (e - 3)) - 1;
+    }
+    return (usecs / 1e3);
+}
+
+
 void *
 remunge (conf_t conf)
 {
@@ -1081,6 +1562,8 @@ remunge (conf_t conf)
     struct timeval  t_start;
     struct timeval  t_stop;
     double          delta;
+    double          latency;
+    struct munge_timing timing;
     munge_err_t     e;
     char           *cred;
     void           *data;
@@ -1117,7 +1600,14 @@ remunge (conf_t conf)
         e = munge_encode(&cred, tdata->ectx, conf->payload, conf->num_payload);
         GET_TIMEVAL (t_stop);
 
+        if ((conf->do_timing) && (munge_ctx_get (tdata->ectx,
+                MUNGE_OPT_TIMING_INFO, &timing) == EMUNGE_SUCCESS)) {
+            add_timing (&tdata->timing, &timing);
+            tdata->num_timed++;
+        }
+
         delta = DIFF_TIMEVAL (t_stop, t_start);
+        latency = delta;
         if (delta > conf->warn_time) {
             output_msg ("Credential #%lu encoding took %0.3f seconds",
                 n, delta);
@@ -1133,7 +1623,14 @@ remunge (conf_t conf)
             e = munge_decode (cred, tdata->dctx, &data, &dlen, &uid, &gid);
             GET_TIMEVAL (t_stop);
 
+            if ((conf->do_timing) && (munge_ctx_get (tdata->dctx,
+                    MUNGE_OPT_TIMING_INFO, &timing) == EMUNGE_SUCCESS)) {
+                add_timing (&tdata->timing, &timing);
+                tdata->num_timed++;
+            }
+
             delta = DIFF_TIMEVAL (t_stop, t_start);
+            latency += delta;
             if (delta > conf->warn_time) {
                 output_msg ("Credential #%lu decoding took %0.3f seconds",
                     n, delta);
@@ -1187,6 +1684,8 @@ remunge (conf_t conf)
         if (cred != NULL) {
             free (cred);
         }
+        tdata->lat_hist[get_lat_bucket (
+            (latency > 0) ? (unsigned long) (latency * 1e6) : 0)]++;
         if ((errno = pthread_setcancelstate
                     (cancel_state, &cancel_state)) != 0) {
             log_errno (EMUNGE_SNAFU, LOG_ERR,
@@ -1203,12 +1702,45 @@ remunge (conf_t conf)
 }
 
 
+void
+add_timing (struct munge_timing *sum, const struct munge_timing *t)
+{
+/*  Add the client-side timing breakdown [t] to the running [sum].
+ */
+    sum->connect_usecs += t->connect_usecs;
+    sum->send_usecs += t->send_usecs;
+    sum->auth_usecs += t->auth_usecs;
+    sum->wait_usecs += t->wait_usecs;
+    sum->recv_usecs += t->recv_usecs;
+    sum->backoff_usecs += t->backoff_usecs;
+    sum->total_usecs += t->total_usecs;
+    sum->connect_retries += t->connect_retries;
+    sum->xfer_retries += t->xfer_retries;
+    return;
+}
+
+
 void
 remunge_cleanup (tdata_t tdata)
 {
 /*  Signal the main thread when the last worker thread is exiting.
+ *  Merge the thread's latency histogram, timings, and replay lag into the
+ *    global ones.
  *  Clean up resources held by the thread.
  */
+    int i;
+
+    for (i = 0; i < LAT_NUM_BUCKETS; i++) {
+        tdata->conf->shared.lat_hist[i] += tdata->lat_hist[i];
+    }
+    if (tdata->conf->do_timing) {
+        add_timing (&tdata->conf->shared.timing, &tdata->timing);
+        tdata->conf->shared.num_timed += tdata->num_timed;
+    }
+    if (tdata->max_lag_usecs > tdata->conf->shared.max_lag_usecs) {
+        tdata->conf->shared.max_lag_usecs = tdata->max_lag_usecs;
+    }
+    tdata->conf->shared.num_late += tdata->num_late;
     if (--tdata->conf->num_running == 0) {
         if ((errno = pthread_cond_signal (&tdata->conf->cond_done)) != 0) {
             log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to signal condition");
@@ -1272,3 +1804,568 @@ output_msg (const char *format, ...)
     printf ("%s\n", buf);
     return;
 }
+
+
+pid_t
+read_pid_file (const char *path)
+{
+/*  Reads the munged pid from the pidfile [path].
+ *  Returns the pid or dies trying.
+ */
+    FILE *fp;
+    long  l;
+
+    if (!(fp = fopen (path, "r"))) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to open munged pidfile \"%s\"", path);
+    }
+    if ((fscanf (fp, "%ld", &l) != 1) || (l <= 0) || (l > INT_MAX)) {
+        log_err (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to read munged pid from \"%s\"", path);
+    }
+    (void) fclose (fp);
+    return ((pid_t) l);
+}
+
+
+void
+get_munged_stats (pid_t pid, struct cpu_stats *cs)
+{
+/*  Samples the CPU usage of munged process [pid] from /proc into [cs].
+ *  User & system times are process-wide and include exited threads.
+ *    Context switches and schedstat times are only kept per-thread, so
+ *    they are summed over the threads now running; munged's threads are
+ *    long-lived, so nothing is lost between samples.
+ *  Dies if the process cannot be sampled.
+ */
+    char           path[PATH_MAX];
+    char           buf[1024];
+    FILE          *fp;
+    char          *p;
+    unsigned long  utime, stime;
+    unsigned long  run_ns, wait_ns;
+    unsigned long  u;
+    long           ticks;
+    DIR           *dp;
+    struct dirent *dep;
+
+    assert (cs != NULL);
+
+    memset (cs, 0, sizeof (*cs));
+
+    if ((ticks = sysconf (_SC_CLK_TCK)) <= 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to determine clock ticks per second");
+    }
+    /*  The command name in field 2 may contain spaces, so skip past its
+     *    closing paren.  The utime & stime fields are 14 & 15.
+     */
+    (void) snprintf (path, sizeof (path), "/proc/%d/stat", (int) pid);
+    if (!(fp = fopen (path, "r"))) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to open \"%s\"", path);
+    }
+    if (!fgets (buf, sizeof (buf), fp)
+            || !(p = strrchr (buf, ')'))
+            || (sscanf (p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u"
+                        " %lu %lu", &utime, &stime) != 2)) {
+        log_err (EMUNGE_SNAFU, LOG_ERR, "Failed to parse \"%s\"", path);
+    }
+    (void) fclose (fp);
+    cs->user_secs = (double) utime / ticks;
+    cs->sys_secs = (double) stime / ticks;
+
+    (void) snprintf (path, sizeof (path), "/proc/%d/task", (int) pid);
+    if (!(dp = opendir (path))) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to open \"%s\"", path);
+    }
+    cs->got_schedstat = 1;
+    while ((dep = readdir (dp)) != NULL) {
+        if (dep->d_name[0] == '.') {
+            continue;
+        }
+        (void) snprintf (path, sizeof (path), "/proc/%d/task/%s/status",
+            (int) pid, dep->d_name);
+        if ((fp = fopen (path, "r")) != NULL) {
+            while (fgets (buf, sizeof (buf), fp)) {
+                if (sscanf (buf, "voluntary_ctxt_switches: %lu", &u) == 1) {
+                    cs->vol_ctxsw += u;
+                }
+                else if (sscanf (buf, "nonvoluntary_ctxt_switches: %lu",
+                            &u) == 1) {
+                    cs->invol_ctxsw += u;
+                }
+            }
+            (void) fclose (fp);
+        }
+        (void) snprintf (path, sizeof (path), "/proc/%d/task/%s/schedstat",
+            (int) pid, dep->d_name);
+        if (((fp = fopen (path, "r")) != NULL)
+                && (fscanf (fp, "%lu %lu", &run_ns, &wait_ns) == 2)) {
+            cs->run_secs += run_ns / 1e9;
+            cs->wait_secs += wait_ns / 1e9;
+        }
+        else {
+            cs->got_schedstat = 0;
+        }
+        if (fp != NULL) {
+            (void) fclose (fp);
+        }
+    }
+    (void) closedir (dp);
+    return;
+}
+
+
+void
+get_client_stats (struct cpu_stats *cs)
+{
+/*  Samples the CPU usage of this process into [cs].
+ */
+    struct rusage ru;
+
+    assert (cs != NULL);
+
+    memset (cs, 0, sizeof (*cs));
+
+    if (getrusage (RUSAGE_SELF, &ru) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to query resource usage");
+    }
+    cs->user_secs = ru.ru_utime.tv_sec + (ru.ru_utime.tv_usec / 1e6);
+    cs->sys_secs = ru.ru_stime.tv_sec + (ru.ru_stime.tv_usec / 1e6);
+    cs->vol_ctxsw = ru.ru_nvcsw;
+    cs->invol_ctxsw = ru.ru_nivcsw;
+    return;
+}
+
+
+void
+display_efficiency (conf_t conf, unsigned long n)
+{
+/*  Outputs the CPU usage of munged and this process over the run in which
+ *    [n] credentials were processed, along with the number of credentials
+ *    per CPU-second.
+ *  The munged CPU time is taken from schedstat when available since its
+ *    nanosecond resolution is far finer than that of the clock ticks.
+ */
+    struct cpu_stats *m0 = &conf->munged_start;
+    struct cpu_stats *m1 = &conf->munged_stop;
+    struct cpu_stats *c0 = &conf->client_start;
+    struct cpu_stats *c1 = &conf->client_stop;
+    double            m_user, m_sys, m_cpu;
+    double            c_user, c_sys, c_cpu;
+    unsigned long     m_vol, m_invol;
+    int               got_schedstat;
+
+    m_user = m1->user_secs - m0->user_secs;
+    m_sys = m1->sys_secs - m0->sys_secs;
+    m_vol = m1->vol_ctxsw - m0->vol_ctxsw;
+    m_invol = m1->invol_ctxsw - m0->invol_ctxsw;
+    got_schedstat = m0->got_schedstat && m1->got_schedstat;
+    m_cpu = got_schedstat ? (m1->run_secs - m0->run_secs) : (m_user + m_sys);
+
+    c_user = c1->user_secs - c0->user_secs;
+    c_sys = c1->sys_secs - c0->sys_secs;
+    c_cpu = c_user + c_sys;
+
+    output_msg ("Munged CPU: %0.3fs (%0.3fs user, %0.3fs sys), "
+        "%lu context switches (%lu involuntary)",
+        m_cpu, m_user, m_sys, m_vol + m_invol, m_invol);
+    if (got_schedstat) {
+        output_msg ("Munged runqueue wait: %0.3fs",
+            m1->wait_secs - m0->wait_secs);
+    }
+    output_msg ("Client CPU: %0.3fs (%0.3fs user, %0.3fs sys), "
+        "%lu context switches (%lu involuntary)",
+        c_cpu, c_user, c_sys,
+        (c1->vol_ctxsw - c0->vol_ctxsw) + (c1->invol_ctxsw - c0->invol_ctxsw),
+        c1->invol_ctxsw - c0->invol_ctxsw);
+    if (m_cpu > 0) {
+        output_msg ("Efficiency: %0.0f creds per munged CPU-second, "
+            "%0.0f creds per total CPU-second",
+            n / m_cpu, n / (m_cpu + c_cpu));
+    }
+    else {
+        output_msg ("Efficiency: munged CPU usage too small to measure");
+    }
+    return;
+}
+
+
+void
+load_replay (conf_t conf, const char *name)
+{
+/*  Loads the encode/decode requests to replay from the request trace [name]
+ *    recorded by "munged --trace-file", sorting them by arrival time.
+ *  The requests are limited by the credential count and duration (if
+ *    specified).  The payload length is set to that of the largest payload
+ *    in the requests, and the credential count to the number of requests.
+ */
+    FILE             *fp;
+    unsigned char     hdr[TRACE_HDR_LEN];
+    unsigned char     buf[REPLAY_RECS_PER_READ * TRACE_REC_LEN];
+    struct trace_rec  r;
+    struct trace_rec *rp;
+    unsigned long     max_recs = 0;
+    unsigned long     u;
+    size_t            n;
+    size_t            i;
+    double            t;
+
+    assert (conf != NULL);
+    assert (name != NULL);
+
+    if (!(fp = fopen (name, "r"))) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to open request trace \"%s\"", name);
+    }
+    if ((fread (hdr, 1, sizeof (hdr), fp) != sizeof (hdr))
+            || (trace_hdr_unpack (hdr, NULL) < 0)) {
+        if (ferror (fp)) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to read request trace \"%s\"", name);
+        }
+        log_err (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to read request trace \"%s\": Invalid header", name);
+    }
+    do {
+        n = fread (buf, 1, sizeof (buf), fp);
+        for (i = 0; i + TRACE_REC_LEN <= n; i += TRACE_REC_LEN) {
+            trace_rec_unpack (&r, buf + i);
+            if ((r.type != MUNGE_MSG_ENC_REQ)
+                    && (r.type != MUNGE_MSG_DEC_REQ)) {
+                continue;
+            }
+            if (conf->replay_num == max_recs) {
+                max_recs = (max_recs > 0) ? max_recs * 2 : 1024;
+                rp = realloc (conf->replay_recs, max_recs * sizeof (*rp));
+                if (rp == NULL) {
+                    log_err (EMUNGE_NO_MEMORY, LOG_ERR,
+                        "Failed to allocate %lu replay requests", max_recs);
+                }
+                conf->replay_recs = rp;
+            }
+            conf->replay_recs[conf->replay_num++] = r;
+        }
+        if (i < n) {
+            log_msg (LOG_WARNING,
+                "Ignoring partial record at end of request trace \"%s\"",
+                name);
+        }
+    } while (n == sizeof (buf));
+
+    if (ferror (fp)) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to read request trace \"%s\"", name);
+    }
+    (void) fclose (fp);
+
+    if (conf->replay_num == 0) {
+        log_err (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to find requests to replay in request trace \"%s\"",
+            name);
+    }
+    /*  Records are written as requests complete, not as they arrive.
+     */
+    qsort (conf->replay_recs, conf->replay_num, sizeof (*conf->replay_recs),
+        replay_cmp);
+
+    if ((conf->num_creds > 0) && (conf->num_creds < conf->replay_num)) {
+        conf->replay_num = conf->num_creds;
+    }
+    if ((conf->num_seconds > 0) && (conf->replay_speed > 0.0)) {
+        while (conf->replay_num > 1) {
+            rp = &conf->replay_recs[conf->replay_num - 1];
+            t = (rp->arrive_secs + (rp->arrive_usecs / 1e6))
+                / conf->replay_speed;
+            if (t < conf->num_seconds) {
+                break;
+            }
+            conf->replay_num--;
+        }
+    }
+    conf->num_payload = 0;
+    for (u = 0; u < conf->replay_num; u++) {
+        rp = &conf->replay_recs[u];
+        if (rp->data_len > MUNGE_MAXIMUM_REQ_LEN) {
+            rp->data_len = MUNGE_MAXIMUM_REQ_LEN;
+        }
+        if ((int) rp->data_len > conf->num_payload) {
+            conf->num_payload = rp->data_len;
+        }
+        if (rp->error_num != EMUNGE_SUCCESS) {
+            conf->replay_num_errs++;
+        }
+        conf->replay_hist[get_lat_bucket (rp->service_usecs)]++;
+    }
+    conf->num_creds = conf->replay_num;
+    /*
+     *  The decode ctx is needed for replaying decode requests.
+     */
+    conf->do_decode = 1;
+
+    output_msg ("Loaded %lu request%s from \"%s\"", conf->replay_num,
+        ((conf->replay_num == 1) ? "" : "s"), name);
+    return;
+}
+
+
+int
+replay_cmp (const void *p1, const void *p2)
+{
+/*  Compares the replay requests [p1] and [p2] by arrival time for qsort().
+ */
+    const struct trace_rec *r1 = p1;
+    const struct trace_rec *r2 = p2;
+
+    if (r1->arrive_secs != r2->arrive_secs) {
+        return ((r1->arrive_secs < r2->arrive_secs) ? -1 : 1);
+    }
+    if (r1->arrive_usecs != r2->arrive_usecs) {
+        return ((r1->arrive_usecs < r2->arrive_usecs) ? -1 : 1);
+    }
+    return (0);
+}
+
+
+void *
+replay (conf_t conf)
+{
+/*  Worker thread responsible for replaying requests from the request trace
+ *    at their recorded arrival times (scaled by the replay speed factor).
+ *  A decode request needs a credential of the recorded shape, so one is
+ *    encoded (untimed) before waiting for the request's arrival time.
+ */
+    tdata_t         tdata;
+    int             cancel_state;
+    unsigned long   n;
+    const struct trace_rec *rp;
+    unsigned long   got_encode_err;
+    unsigned long   got_decode_err;
+    struct timeval  t_start;
+    struct timeval  t_stop;
+    double          latency;
+    struct munge_timing timing;
+    munge_ctx_t     ctx;
+    munge_err_t     e;
+    char           *cred;
+    void           *data;
+    int             dlen;
+    uid_t           uid;
+    gid_t           gid;
+
+    tdata = create_tdata (conf);
+
+    pthread_cleanup_push ((thread_cleanup_f) remunge_cleanup, tdata);
+
+    if ((errno = pthread_mutex_lock (&conf->mutex)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock mutex");
+    }
+    while (conf->num_creds - conf->shared.num_creds_done > 0) {
+
+        pthread_testcancel ();
+
+        if ((errno = pthread_setcancelstate
+                    (PTHREAD_CANCEL_DISABLE, &cancel_state)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to disable thread cancellation");
+        }
+        rp = &conf->replay_recs[conf->shared.num_creds_done];
+        n = ++conf->shared.num_creds_done;
+
+        if ((errno = pthread_mutex_unlock (&conf->mutex)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to unlock mutex");
+        }
+        got_encode_err = 0;
+        got_decode_err = 0;
+        cred = NULL;
+        data = NULL;
+        ctx = NULL;
+        latency = 0.0;
+
+        if (replay_set_ctx (tdata->ectx, rp) < 0) {
+            output_msg ("Request #%lu setup failed: %s",
+                n, munge_ctx_strerror (tdata->ectx));
+            ++got_encode_err;
+        }
+        else if (rp->type == MUNGE_MSG_ENC_REQ) {
+            replay_wait (conf, rp, tdata);
+            GET_TIMEVAL (t_start);
+            e = munge_encode (&cred, tdata->ectx, conf->payload,
+                rp->data_len);
+            GET_TIMEVAL (t_stop);
+            ctx = tdata->ectx;
+            if (e != EMUNGE_SUCCESS) {
+                output_msg ("Request #%lu encoding failed: %s (err=%d)",
+                    n, munge_ctx_strerror (tdata->ectx), e);
+                ++got_encode_err;
+            }
+        }
+        else if ((e = munge_encode (&cred, tdata->ectx, conf->payload,
+                rp->data_len)) != EMUNGE_SUCCESS) {
+            output_msg ("Request #%lu encoding failed: %s (err=%d)",
+                n, munge_ctx_strerror (tdata->ectx), e);
+            ++got_encode_err;
+        }
+        else {
+            replay_wait (conf, rp, tdata);
+            GET_TIMEVAL (t_start);
+            e = munge_decode (cred, tdata->dctx, &data, &dlen, &uid, &gid);
+            GET_TIMEVAL (t_stop);
+            ctx = tdata->dctx;
+            if (e != EMUNGE_SUCCESS) {
+                output_msg ("Request #%lu decoding failed: %s (err=%d)",
+                    n, munge_ctx_strerror (tdata->dctx), e);
+                ++got_decode_err;
+            }
+            /*  The 'data' parm can still be set on certain munge errors.
+             */
+            if (data != NULL) {
+                free (data);
+            }
+        }
+        if (ctx != NULL) {
+            if ((conf->do_timing) && (munge_ctx_get (ctx,
+                    MUNGE_OPT_TIMING_INFO, &timing) == EMUNGE_SUCCESS)) {
+                add_timing (&tdata->timing, &timing);
+                tdata->num_timed++;
+            }
+            latency = DIFF_TIMEVAL (t_stop, t_start);
+            if (latency > conf->warn_time) {
+                output_msg ("Request #%lu took %0.3f seconds", n, latency);
+            }
+            tdata->lat_hist[get_lat_bucket (
+                (latency > 0) ? (unsigned long) (latency * 1e6) : 0)]++;
+        }
+        if (cred != NULL) {
+            free (cred);
+        }
+        if ((errno = pthread_setcancelstate
+                    (cancel_state, &cancel_state)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to enable thread cancellation");
+        }
+        if ((errno = pthread_mutex_lock (&conf->mutex)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock mutex");
+        }
+        conf->shared.num_encode_errs += got_encode_err;
+        conf->shared.num_decode_errs += got_decode_err;
+    }
+    pthread_cleanup_pop (1);
+    return (NULL);
+}
+
+
+int
+replay_set_ctx (munge_ctx_t ctx, const struct trace_rec *rp)
+{
+/*  Sets the encode ctx [ctx] to match the cipher, MAC, compression, ttl,
+ *    and restrictions of the request [rp].
+ *  Since the trace does not record UIDs or GIDs, a restricted credential
+ *    is restricted to the UID/GID of this process so it can be decoded.
+ *  Types not supported by this build fall back to the daemon's defaults.
+ *  Returns 0 on success, or -1 on error.
+ */
+    int cipher;
+    int mac;
+    int zip;
+    int ttl;
+    int uid;
+    int gid;
+
+    cipher = munge_enum_is_valid (MUNGE_ENUM_CIPHER, rp->cipher)
+        ? rp->cipher : MUNGE_CIPHER_DEFAULT;
+    mac = munge_enum_is_valid (MUNGE_ENUM_MAC, rp->mac)
+        ? rp->mac : MUNGE_MAC_DEFAULT;
+    zip = munge_enum_is_valid (MUNGE_ENUM_ZIP, rp->zip)
+        ? rp->zip : MUNGE_ZIP_DEFAULT;
+    ttl = (rp->ttl > INT_MAX) ? MUNGE_TTL_MAXIMUM : (int) rp->ttl;
+    uid = (rp->flags & TRACE_FLAG_AUTH_UID) ? (int) getuid () : MUNGE_UID_ANY;
+    gid = (rp->flags & TRACE_FLAG_AUTH_GID) ? (int) getgid () : MUNGE_GID_ANY;
+
+    if ((munge_ctx_set (ctx, MUNGE_OPT_CIPHER_TYPE, cipher) != EMUNGE_SUCCESS)
+            || (munge_ctx_set (ctx, MUNGE_OPT_MAC_TYPE, mac)
+                != EMUNGE_SUCCESS)
+            || (munge_ctx_set (ctx, MUNGE_OPT_ZIP_TYPE, zip)
+                != EMUNGE_SUCCESS)
+            || (munge_ctx_set (ctx, MUNGE_OPT_TTL, ttl)
+                != EMUNGE_SUCCESS)
+            || (munge_ctx_set (ctx, MUNGE_OPT_UID_RESTRICTION, uid)
+                != EMUNGE_SUCCESS)
+            || (munge_ctx_set (ctx, MUNGE_OPT_GID_RESTRICTION, gid)
+                != EMUNGE_SUCCESS)) {
+        return (-1);
+    }
+    return (0);
+}
+
+
+void
+replay_wait (conf_t conf, const struct trace_rec *rp, tdata_t tdata)
+{
+/*  Waits until the arrival time of the request [rp] (scaled by the replay
+ *    speed factor) relative to the start of the replay.
+ *  Notes in [tdata] how far behind schedule the request is issued.
+ */
+    struct timeval  now;
+    struct timespec ts;
+    double          t;
+    double          delta;
+    unsigned long   lag;
+
+    if (conf->replay_speed <= 0.0) {
+        return;
+    }
+    t = (rp->arrive_secs + (rp->arrive_usecs / 1e6)) / conf->replay_speed;
+    for (;;) {
+        GET_TIMEVAL (now);
+        delta = t - DIFF_TIMEVAL (now, conf->t_main_start);
+        if (delta <= 0.0) {
+            break;
+        }
+        ts.tv_sec = (time_t) delta;
+        ts.tv_nsec = (long) ((delta - ts.tv_sec) * 1e9);
+        (void) nanosleep (&ts, NULL);
+    }
+    lag = (unsigned long) (-delta * 1e6);
+    if (lag > tdata->max_lag_usecs) {
+        tdata->max_lag_usecs = lag;
+    }
+    if (lag > REPLAY_LATE_USECS) {
+        tdata->num_late++;
+    }
+    return;
+}
+
+
+void
+display_replay (conf_t conf)
+{
+/*  Output the service time percentiles recorded by munged for the replayed
+ *    requests alongside the replayed latency percentiles and the difference.
+ */
+    const double pct[] = { 0.50, 0.90, 0.99 };
+    double       rec[3];
+    double       rep[3];
+    int          i;
+
+    for (i = 0; i < 3; i++) {
+        rec[i] = get_lat_percentile (conf->replay_hist, pct[i]);
+        rep[i] = get_lat_percentile (conf->shared.lat_hist, pct[i]);
+    }
+    output_msg ("Recorded %lu error%s in trace", conf->replay_num_errs,
+        ((conf->replay_num_errs == 1) ? "" : "s"));
+    output_msg ("Recorded service p50/p90/p99: %0.3f/%0.3f/%0.3f ms",
+        rec[0], rec[1], rec[2]);
+    output_msg ("Replayed latency p50/p90/p99: %0.3f/%0.3f/%0.3f ms",
+        rep[0], rep[1], rep[2]);
+    output_msg ("Latency difference p50/p90/p99: %+0.3f/%+0.3f/%+0.3f ms",
+        rep[0] - rec[0], rep[1] - rec[1], rep[2] - rec[2]);
+    if (conf->replay_speed > 0.0) {
+        output_msg ("Replay lagged schedule by up to %0.3f ms "
+            "(%lu request%s late by over %0.3f ms)",
+            conf->shared.max_lag_usecs / 1e3, conf->shared.num_late,
+            ((conf->shared.num_late == 1) ? "" : "s"),
+            REPLAY_LATE_USECS / 1e3);
+    }
+    return;
+}
@@ -157,7 +157,7 @@ display_key_t munge_keys[] = {
 #define OPT_IGNORE_TTL          256
 #define OPT_IGNORE_REPLAY       257
 
-const char * const short_opts = ":hLVi:nm:o:k:KNS:";
+const char * const short_opts = ":hLVi:nm:o:k:KNS:R:";
 
 #include <getopt.h>
 struct option long_opts[] = {
@@ -172,6 +172,7 @@ struct option long_opts[] = {
     { "list-keys", no_argument, NULL, 'K' },
     { "numeric", no_argument, NULL, 'N' },
     { "socket", required_argument, NULL, 'S' },
+    { "request-id", required_argument, NULL, 'R' },
     { "ignore-ttl", no_argument, NULL, OPT_IGNORE_TTL },
     { "ignore-replay", no_argument, NULL, OPT_IGNORE_REPLAY },
     { NULL, 0, NULL, 0 }
@@ -411,6 +412,15 @@ parse_cmdline (conf_t conf, int argc, char **argv)
                             (p ? p : "Unspecified error"));
                 }
                 break;
+            case 'R':
+                e = munge_ctx_set (conf->ctx, MUNGE_OPT_REQUEST_ID, optarg);
+                if (e != EMUNGE_SUCCESS) {
+                    p = munge_ctx_strerror (conf->ctx);
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                            "Invalid request ID \"%s\": %s", optarg,
+                            (p ? p : "Unspecified error"));
+                }
+                break;
             case OPT_IGNORE_TTL:
                 conf->is_ttl_ignored = 1;
                 break;
@@ -484,6 +494,18 @@ parse_cmdline (conf_t conf, int argc, char **argv)
                     "Failed to ignore replay errors");
         }
     }
+    /*  Request only the credential metadata if neither the payload nor its
+     *    length will be output.
+     */
+    if (!conf->fn_out
+            && (!conf->fn_meta || !conf->key[MUNGE_KEY_LENGTH])) {
+        munge_err_t e;
+        e = munge_ctx_set (conf->ctx, MUNGE_OPT_METADATA_ONLY, 1);
+        if (e != EMUNGE_SUCCESS) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to request metadata only");
+        }
+    }
     return;
 }
 
@@ -535,6 +557,9 @@ display_help (char *prog)
     printf ("  %*s %s\n", w, "-S, --socket=PATH",
             "Specify local socket for munged");
 
+    printf ("  %*s %s\n", w, "-R, --request-id=STR",
+            "Specify request ID for munged log messages");
+
     printf ("\n");
 
     printf ("  %*s %s\n", w, "--ignore-ttl",
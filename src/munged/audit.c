@@ -0,0 +1,458 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+#include <munge.h>
+#include "audit.h"
+#include "audit_rec.h"
+#include "clock.h"
+#include "conf.h"
+#include "cred.h"
+#include "fd.h"
+#include "log.h"
+#include "m_msg.h"
+#include "path.h"
+#include "reclog.h"
+
+
+/*****************************************************************************
+ *  Notes
+ *****************************************************************************
+ *
+ *  Each successfully decoded credential is recorded in the audit log as a
+ *  fixed-length binary record (see "audit_rec.h").  Workers never touch the
+ *  file: records are buffered by a record log (see "reclog.c") whose writer
+ *  thread calls _audit_flush() with each batch.  If a buffer fills up before
+ *  it can be drained, records are dropped and counted rather than stalling
+ *  the response to the client.
+ *
+ *  The file is synced at most once every [conf->audit_sync_msecs] msecs, and
+ *  is rotated to "<file>.1" before it would exceed [conf->audit_max_bytes].
+ *
+ *  The file and its directory are checked at startup in the same manner as
+ *  the logfile.  Unless overridden by --force, the file is opened with
+ *  O_NOFOLLOW so it cannot be redirected through a symlink when it is
+ *  reopened after rotation.
+ */
+
+
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static int _audit_flush (const unsigned char *buf, size_t len, void *arg);
+static int _audit_write (const unsigned char *buf, size_t len);
+static void _audit_sync (int do_force);
+static void _audit_rotate (void);
+static void _audit_check (int got_force);
+static int _audit_open (char *ebuf, size_t ebuflen);
+
+
+/*****************************************************************************
+ *  Private Variables
+ *****************************************************************************/
+
+static reclog_t             _audit_log = NULL;
+
+/*  The following are only accessed by the writer thread once it is running.
+ */
+static char                *_audit_name = NULL;
+static char                *_audit_name_old = NULL;
+static int                  _audit_fd = -1;
+static int                  _audit_open_flags = 0;
+static off_t                _audit_size = 0;
+static long                 _audit_max_bytes = 0;
+static int                  _audit_sync_msecs = 0;
+static int                  _audit_is_unsynced = 0;
+static struct timespec      _audit_sync_ts;
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+/*  Opens the audit log [conf->audit_name] and starts the writer thread.
+ *  If [conf->audit_name] is NULL, decoded credentials are not recorded.
+ */
+void
+audit_init (conf_t conf)
+{
+    char   ebuf[1024];
+    size_t n;
+
+    assert (conf != NULL);
+
+    if (conf->audit_name == NULL) {
+        return;
+    }
+    if (!(_audit_name = strdup (conf->audit_name))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+                "Failed to copy audit-file name");
+    }
+    n = strlen (_audit_name) + 3;
+    if (!(_audit_name_old = malloc (n))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+                "Failed to allocate audit-file rotation name");
+    }
+    (void) snprintf (_audit_name_old, n, "%s.1", _audit_name);
+
+    _audit_max_bytes = conf->audit_max_bytes;
+    _audit_sync_msecs = conf->audit_sync_msecs;
+
+    _audit_check (conf->got_force);
+
+    if (_audit_open (ebuf, sizeof (ebuf)) < 0) {
+        log_err (EMUNGE_SNAFU, LOG_ERR, "%s", ebuf);
+    }
+    (void) clock_get_timespec (&_audit_sync_ts, _audit_sync_msecs);
+
+    _audit_log = reclog_create ("audit log", AUDIT_REC_LEN, _audit_flush,
+            NULL);
+
+    log_msg (LOG_INFO, "Recording decoded credentials in audit log \"%s\"",
+            _audit_name);
+    return;
+}
+
+
+/*  Flushes pending records to the audit log, stops the writer thread,
+ *    and closes the audit log.
+ */
+void
+audit_fini (void)
+{
+    unsigned long n_written;
+    unsigned long n_dropped;
+
+    if (_audit_log == NULL) {
+        return;
+    }
+    reclog_destroy (_audit_log, &n_written, &n_dropped);
+    _audit_log = NULL;
+
+    _audit_sync (1);
+    if (_audit_fd >= 0) {
+        if (close (_audit_fd) < 0) {
+            log_msg (LOG_WARNING, "Failed to close audit log \"%s\": %s",
+                    _audit_name, strerror (errno));
+        }
+        _audit_fd = -1;
+    }
+    log_msg (LOG_INFO, "Audit log: %lu record%s written, %lu dropped",
+            n_written, (n_written == 1) ? "" : "s", n_dropped);
+
+    free (_audit_name_old);
+    _audit_name_old = NULL;
+    free (_audit_name);
+    _audit_name = NULL;
+    _audit_open_flags = 0;
+    return;
+}
+
+
+/*  Records the successfully decoded credential [c] in the audit log.
+ *  This never blocks on file I/O; if the buffer is full, the record is
+ *    dropped.
+ */
+void
+audit_record (munge_cred_t c)
+{
+    m_msg_t             m;
+    struct audit_rec    r;
+    unsigned char       buf[AUDIT_REC_LEN];
+
+    assert (c != NULL);
+    assert (c->msg != NULL);
+
+    if (_audit_log == NULL) {
+        return;
+    }
+    m = c->msg;
+    memset (&r, 0, sizeof (r));
+    r.time_dec = m->time1;
+    r.time_enc = m->time0;
+    r.client_uid = m->client_uid;
+    r.client_gid = m->client_gid;
+    r.cred_uid = m->cred_uid;
+    r.cred_gid = m->cred_gid;
+    memcpy (r.addr, &m->addr, sizeof (r.addr));
+    r.mac_type = m->mac;
+    r.mac_len = (c->mac_len < AUDIT_MAC_PREFIX_LEN)
+        ? c->mac_len : AUDIT_MAC_PREFIX_LEN;
+    memcpy (r.mac, c->mac, r.mac_len);
+
+    audit_rec_pack (buf, &r);
+    reclog_append (_audit_log, (unsigned int) m->sd, buf);
+    return;
+}
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static int
+_audit_flush (const unsigned char *buf, size_t len, void *arg)
+{
+/*  Writes the batch of [len] bytes of packed records in [buf] to the audit
+ *    log, and syncs it if the sync interval has expired.
+ *  This is called from the record log's writer thread after each flush
+ *    interval.
+ *  Returns 0 on success, or -1 if the records were dropped.
+ */
+    int rv = 0;
+
+    if (len > 0) {
+        rv = _audit_write (buf, len);
+    }
+    _audit_sync (0);
+    return (rv);
+}
+
+
+static int
+_audit_write (const unsigned char *buf, size_t len)
+{
+/*  Appends [len] bytes of packed records in [buf] to the audit log,
+ *    rotating it beforehand if it would exceed the maximum size.
+ *  On error, the records are dropped and the file is truncated back to
+ *    the last complete record.
+ *  Returns 0 on success, or -1 on error.
+ */
+    char ebuf[1024];
+
+    if ((_audit_max_bytes > 0)
+            && (_audit_size > AUDIT_HDR_LEN)
+            && (_audit_size + (off_t) len > _audit_max_bytes)) {
+        _audit_rotate ();
+    }
+    if ((_audit_fd < 0) && (_audit_open (ebuf, sizeof (ebuf)) < 0)) {
+        log_msg_limit (LOG_WARNING, "%s", ebuf);
+        return (-1);
+    }
+    if (fd_write_n (_audit_fd, buf, len) != (ssize_t) len) {
+        log_msg_limit (LOG_WARNING, "Failed to write audit log \"%s\": %s",
+                _audit_name, strerror (errno));
+        (void) ftruncate (_audit_fd, _audit_size);
+        return (-1);
+    }
+    _audit_size += len;
+    _audit_is_unsynced = 1;
+    return (0);
+}
+
+
+static void
+_audit_sync (int do_force)
+{
+/*  Syncs the audit log data to disk if there are unsynced writes and the
+ *    sync interval has expired.  If [do_force] is set, the sync interval
+ *    is ignored (but syncing is still skipped if disabled).
+ */
+    if ((_audit_fd < 0) || !_audit_is_unsynced || (_audit_sync_msecs < 0)) {
+        return;
+    }
+    if (!do_force && (_audit_sync_msecs > 0)
+            && (clock_is_timespec_expired (&_audit_sync_ts) == 0)) {
+        return;
+    }
+    if (fdatasync (_audit_fd) < 0) {
+        log_msg_limit (LOG_WARNING, "Failed to sync audit log \"%s\": %s",
+                _audit_name, strerror (errno));
+    }
+    _audit_is_unsynced = 0;
+    (void) clock_get_timespec (&_audit_sync_ts, _audit_sync_msecs);
+    return;
+}
+
+
+static void
+_audit_rotate (void)
+{
+/*  Renames the current audit log to "<file>.1" (replacing any previous one)
+ *    and closes it.  The new audit log is opened by the next write.
+ */
+    if (_audit_fd < 0) {
+        return;
+    }
+    _audit_sync (1);
+
+    if (rename (_audit_name, _audit_name_old) < 0) {
+        log_msg_limit (LOG_WARNING,
+                "Failed to rotate audit log \"%s\": %s",
+                _audit_name, strerror (errno));
+        return;
+    }
+    if (close (_audit_fd) < 0) {
+        log_msg (LOG_WARNING, "Failed to close audit log \"%s\": %s",
+                _audit_name_old, strerror (errno));
+    }
+    _audit_fd = -1;
+    log_msg (LOG_INFO, "Rotated audit log \"%s\" at %ld bytes",
+            _audit_name, (long) _audit_size);
+    return;
+}
+
+
+static void
+_audit_check (int got_force)
+{
+/*  Checks the audit log and its directory for the same insecurities as the
+ *    logfile.  These are fatal unless [got_force] is set, in which case
+ *    warnings are logged and the audit log may be opened through a symlink.
+ */
+    int          is_symlink;
+    int          rv;
+    struct stat  st;
+    char         auditdir [PATH_MAX];
+    char         ebuf [1024];
+
+    is_symlink = (lstat (_audit_name, &st) == 0) ? S_ISLNK (st.st_mode) : 0;
+    if (is_symlink) {
+        log_err_or_warn (got_force,
+            "Audit log is insecure: \"%s\" should not be a symbolic link",
+            _audit_name);
+    }
+    else {
+        _audit_open_flags |= O_NOFOLLOW;
+    }
+    rv = path_dirname (_audit_name, auditdir, sizeof (auditdir));
+    if (rv < 0) {
+        log_err (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to determine dirname of audit log \"%s\"", _audit_name);
+    }
+    rv = path_is_secure (auditdir, ebuf, sizeof (ebuf),
+        PATH_SECURITY_IGNORE_GROUP_WRITE);
+    if (rv < 0) {
+        log_err (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to check audit log dir \"%s\": %s", auditdir, ebuf);
+    }
+    else if (rv == 0) {
+        log_err_or_warn (got_force, "Audit log is insecure: %s", ebuf);
+    }
+    return;
+}
+
+
+static int
+_audit_open (char *ebuf, size_t ebuflen)
+{
+/*  Opens the audit log for appending, writing the header if the file is new
+ *    or validating it if not.  A partial record at the end of the file (from
+ *    an interrupted write) is truncated.
+ *  Returns 0 on success, or -1 on error (with a message written to [ebuf]).
+ */
+    unsigned char hdr[AUDIT_HDR_LEN];
+    struct stat   st;
+    off_t         extra;
+    int           fd;
+
+    assert (_audit_fd < 0);
+
+    fd = open (_audit_name, O_RDWR | O_CREAT | O_APPEND | _audit_open_flags,
+            S_IRUSR | S_IWUSR);
+    if ((fd < 0) && (errno == ELOOP) && (_audit_open_flags & O_NOFOLLOW)) {
+        (void) snprintf (ebuf, ebuflen,
+                "Failed to open audit log \"%s\": Is a symbolic link",
+                _audit_name);
+        return (-1);
+    }
+    if (fd < 0) {
+        (void) snprintf (ebuf, ebuflen, "Failed to open audit log \"%s\": %s",
+                _audit_name, strerror (errno));
+        return (-1);
+    }
+    if (fd_set_close_on_exec (fd) < 0) {
+        (void) snprintf (ebuf, ebuflen,
+                "Failed to set close-on-exec flag for audit log \"%s\": %s",
+                _audit_name, strerror (errno));
+        goto err;
+    }
+    if (fstat (fd, &st) < 0) {
+        (void) snprintf (ebuf, ebuflen, "Failed to stat audit log \"%s\": %s",
+                _audit_name, strerror (errno));
+        goto err;
+    }
+    if (!S_ISREG (st.st_mode)) {
+        (void) snprintf (ebuf, ebuflen,
+                "Failed to open audit log \"%s\": Not a regular file",
+                _audit_name);
+        goto err;
+    }
+    if (st.st_size == 0) {
+        audit_hdr_pack (hdr);
+        if (fd_write_n (fd, hdr, sizeof (hdr)) != sizeof (hdr)) {
+            (void) snprintf (ebuf, ebuflen,
+                    "Failed to write audit log header \"%s\": %s",
+                    _audit_name, strerror (errno));
+            goto err;
+        }
+        st.st_size = sizeof (hdr);
+    }
+    else if ((st.st_size < (off_t) sizeof (hdr))
+            || (pread (fd, hdr, sizeof (hdr), 0) != sizeof (hdr))
+            || (audit_hdr_unpack (hdr) < 0)) {
+        (void) snprintf (ebuf, ebuflen,
+                "Failed to open audit log \"%s\": Invalid header",
+                _audit_name);
+        goto err;
+    }
+    extra = (st.st_size - AUDIT_HDR_LEN) % AUDIT_REC_LEN;
+    if (extra > 0) {
+        st.st_size -= extra;
+        if (ftruncate (fd, st.st_size) < 0) {
+            (void) snprintf (ebuf, ebuflen,
+                    "Failed to truncate audit log \"%s\": %s",
+                    _audit_name, strerror (errno));
+            goto err;
+        }
+        log_msg (LOG_WARNING,
+                "Truncated partial record at end of audit log \"%s\"",
+                _audit_name);
+    }
+    _audit_fd = fd;
+    _audit_size = st.st_size;
+    return (0);
+
+err:
+    (void) close (fd);
+    return (-1);
+}
@@ -240,7 +240,8 @@ int
 auth_recv (m_msg_t m, uid_t *uid, gid_t *gid)
 {
     if (getpeereid (m->sd, uid, gid) < 0) {
-        log_msg (LOG_ERR, "Failed to get peer identity: %s", strerror (errno));
+        log_msg_limit (LOG_ERR, "Failed to get peer identity: %s",
+                strerror (errno));
         return (-1);
     }
     return (0);
@@ -271,13 +272,16 @@ auth_recv (m_msg_t m, uid_t *uid, gid_t *gid)
     int      rc = -1;
 
     if (getpeerucred (m->sd, &ucred) < 0) {
-        log_msg (LOG_ERR, "Failed to get peer ucred: %s", strerror (errno));
+        log_msg_limit (LOG_ERR, "Failed to get peer ucred: %s",
+                strerror (errno));
     }
     else if ((uid_tmp = ucred_geteuid (ucred)) < 0) {
-        log_msg (LOG_ERR, "Failed to get peer UID: %s", strerror (errno));
+        log_msg_limit (LOG_ERR, "Failed to get peer UID: %s",
+                strerror (errno));
     }
     else if ((gid_tmp = ucred_getegid (ucred)) < 0) {
-        log_msg (LOG_ERR, "Failed to get peer GID: %s", strerror (errno));
+        log_msg_limit (LOG_ERR, "Failed to get peer GID: %s",
+                strerror (errno));
     }
     else {
         *uid = uid_tmp;
@@ -318,7 +322,8 @@ auth_recv (m_msg_t m, uid_t *uid, gid_t *gid)
     socklen_t len = sizeof (cred);
 
     if (getsockopt (m->sd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
-        log_msg (LOG_ERR, "Failed to get peer identity: %s", strerror (errno));
+        log_msg_limit (LOG_ERR, "Failed to get peer identity: %s",
+                strerror (errno));
         return (-1);
     }
     *uid = cred.uid;
@@ -356,12 +361,14 @@ auth_recv (m_msg_t m, uid_t *uid, gid_t *gid)
     socklen_t len = sizeof (cred);
 
     if (getsockopt (m->sd, 0, LOCAL_PEERCRED, &cred, &len) < 0) {
-        log_msg (LOG_ERR, "Failed to get peer identity: %s", strerror (errno));
+        log_msg_limit (LOG_ERR, "Failed to get peer identity: %s",
+                strerror (errno));
         return (-1);
     }
     if (cred.cr_version != XUCRED_VERSION) {
-        log_msg (LOG_ERR, "Failed to get peer identity: invalid xucred v%d",
-            cred.cr_version);
+        log_msg_limit (LOG_ERR,
+                "Failed to get peer identity: invalid xucred v%d",
+                cred.cr_version);
         return (-1);
     }
     *uid = cred.cr_uid;
@@ -401,7 +408,7 @@ auth_recv (m_msg_t m, uid_t *uid, gid_t *gid)
     struct strrecvfd  recvfd;
 
     if (_name_auth_pipe (&pipe_name) < 0) {
-        log_msg (LOG_ERR, "Failed to name auth pipe");
+        log_msg_limit (LOG_ERR, "Failed to name auth pipe");
         goto err;
     }
     assert (pipe_name != NULL);
@@ -411,12 +418,12 @@ auth_recv (m_msg_t m, uid_t *uid, gid_t *gid)
      *    is sent to the client in order to prevent a race condition.
      */
     if (mkfifo (pipe_name, S_IWUSR | S_IRUSR | S_IRGRP | S_IROTH) < 0) {
-        log_msg (LOG_ERR, "Failed to create auth pipe \"%s\": %s",
+        log_msg_limit (LOG_ERR, "Failed to create auth pipe \"%s\": %s",
             pipe_name, strerror (errno));
         goto err;
     }
     if (_send_auth_req (m->sd, pipe_name) < 0) {
-        log_msg (LOG_ERR, "Failed to send auth request");
+        log_msg_limit (LOG_ERR, "Failed to send auth request");
         goto err;
     }
     /*  This open() blocks until the client opens the fifo for writing.
@@ -424,12 +431,12 @@ auth_recv (m_msg_t m, uid_t *uid, gid_t *gid)
      *  FIXME: The open() & ioctl() calls could block and lead to a DoS attack.
      */
     if ((pipe_fd = open (pipe_name, O_RDONLY)) < 0) {
-        log_msg (LOG_ERR, "Failed to open auth pipe \"%s\": %s",
+        log_msg_limit (LOG_ERR, "Failed to open auth pipe \"%s\": %s",
             pipe_name, strerror (errno));
         goto err;
     }
     if (ioctl (pipe_fd, I_RECVFD, &recvfd) < 0) {
-        log_msg (LOG_ERR, "Failed to receive client identity: %s",
+        log_msg_limit (LOG_ERR, "Failed to receive client identity: %s",
             strerror (errno));
         goto err;
     }
@@ -437,15 +444,15 @@ auth_recv (m_msg_t m, uid_t *uid, gid_t *gid)
      *    so the following "errors" are not considered fatal.
      */
     if (close (recvfd.fd) < 0) {
-        log_msg (LOG_WARNING, "Failed to close auth fd from \"%s\": %s",
+        log_msg_limit (LOG_WARNING, "Failed to close auth fd from \"%s\": %s",
             pipe_name, strerror (errno));
     }
     if (close (pipe_fd) < 0) {
-        log_msg (LOG_WARNING, "Failed to close auth pipe \"%s\": %s",
+        log_msg_limit (LOG_WARNING, "Failed to close auth pipe \"%s\": %s",
             pipe_name, strerror (errno));
     }
     if (unlink (pipe_name) < 0) {
-        log_msg (LOG_WARNING, "Failed to remove auth pipe \"%s\": %s",
+        log_msg_limit (LOG_WARNING, "Failed to remove auth pipe \"%s\": %s",
             pipe_name, strerror (errno));
     }
     *uid = recvfd.uid;
@@ -500,7 +507,7 @@ auth_recv (m_msg_t m, uid_t *uid, gid_t *gid)
     struct strrecvfd  recvfd;
 
     if (_name_auth_pipe (&pipe_name) < 0) {
-        log_msg (LOG_ERR, "Failed to name auth pipe");
+        log_msg_limit (LOG_ERR, "Failed to name auth pipe");
         goto err;
     }
     assert (pipe_name != NULL);
@@ -509,17 +516,18 @@ auth_recv (m_msg_t m, uid_t *uid, gid_t *gid)
      *    is sent to the client in order to prevent a race condition.
      */
     if ((_ns_pipe (pipe_name, pipe_fds)) < 0) {
-        log_msg (LOG_ERR, "Failed to create auth pipe \"%s\"", pipe_name);
+        log_msg_limit (LOG_ERR, "Failed to create auth pipe \"%s\"",
+                pipe_name);
         goto err;
     }
     if (_send_auth_req (m->sd, pipe_name) < 0) {
-        log_msg (LOG_ERR, "Failed to send auth request");
+        log_msg_limit (LOG_ERR, "Failed to send auth request");
         goto err;
     }
     /*  FIXME: The ioctl() call could block and lead to a DoS attack.
      */
     if (ioctl (pipe_fds[0], I_RECVFD, &recvfd) < 0) {
-        log_msg (LOG_ERR, "Failed to receive client identity: %s",
+        log_msg_limit (LOG_ERR, "Failed to receive client identity: %s",
             strerror (errno));
         goto err;
     }
@@ -527,21 +535,21 @@ auth_recv (m_msg_t m, uid_t *uid, gid_t *gid)
      *    so the following "errors" are not considered fatal.
      */
     if (close (recvfd.fd) < 0) {
-        log_msg (LOG_WARNING, "Failed to close auth fd from \"%s\": %s",
+        log_msg_limit (LOG_WARNING, "Failed to close auth fd from \"%s\": %s",
             pipe_name, strerror (errno));
     }
     if (close (pipe_fds[0]) < 0) {
-        log_msg (LOG_WARNING,
+        log_msg_limit (LOG_WARNING,
             "Failed to close auth pipe \"%s\" for reading: %s",
             pipe_name, strerror (errno));
     }
     if (close (pipe_fds[1]) < 0) {
-        log_msg (LOG_WARNING,
+        log_msg_limit (LOG_WARNING,
             "Failed to close auth pipe \"%s\" for writing: %s",
             pipe_name, strerror (errno));
     }
     if (unlink (pipe_name) < 0) {
-        log_msg (LOG_WARNING, "Failed to remove auth pipe \"%s\": %s",
+        log_msg_limit (LOG_WARNING, "Failed to remove auth pipe \"%s\": %s",
             pipe_name, strerror (errno));
     }
     *uid = recvfd.uid;
@@ -53,6 +53,9 @@ static int _cipher_update (cipher_ctx *x, void *dst, int *dstlenp,
     const void *src, int srclen);
 static int _cipher_final (cipher_ctx *x, void *dst, int *dstlenp);
 static int _cipher_cleanup (cipher_ctx *x);
+static int _cipher_block (munge_cipher_t cipher, unsigned char *key,
+    unsigned char *iv, int enc, void *dst, int *dstlenp,
+    const void *src, int srclen);
 static int _cipher_block_size (munge_cipher_t cipher);
 static int _cipher_iv_size (munge_cipher_t cipher);
 static int _cipher_key_size (munge_cipher_t cipher);
@@ -168,6 +171,38 @@ cipher_cleanup (cipher_ctx *x)
 }
 
 
+/*  Encrypts or decrypts [srclen] bytes from [src] without the need of a
+ *    context; this requires the [src] to be contiguous.
+ *  Uses the cipher [cipher], symmetric key [key], and initialization vector
+ *    [iv].  The [enc] parm is set to 1 for encryption, and 0 for decryption.
+ *  Writes the result into [dst] of length [dstlenp] which must be at least
+ *    (srclen + cipher_block_size) bytes.
+ *  Returns 0 on success, or -1 on error; in addition, [dstlenp] will be set
+ *    to the number of bytes written to [dst].
+ */
+int
+cipher_block (munge_cipher_t cipher, unsigned char *key, unsigned char *iv,
+              int enc, void *dst, int *dstlenp, const void *src, int srclen)
+{
+    int rc;
+    int n;
+
+    assert (_cipher_is_initialized);
+
+    if (!key || !iv || !((enc == CIPHER_DECRYPT) || (enc == CIPHER_ENCRYPT))
+            || !dst || !dstlenp || !src || (srclen < 0)) {
+        return (-1);
+    }
+    n = _cipher_block_size (cipher);
+    if ((n <= 0) || (*dstlenp < srclen + n)) {
+        *dstlenp = 0;
+        return (-1);
+    }
+    rc = _cipher_block (cipher, key, iv, enc, dst, dstlenp, src, srclen);
+    return (rc);
+}
+
+
 /*  Returns the block size (in bytes) of the cipher [cipher], or -1 on error.
  */
 int
@@ -493,6 +528,100 @@ _cipher_cleanup (cipher_ctx *x)
 }
 
 
+static int
+_cipher_block (munge_cipher_t cipher, unsigned char *key, unsigned char *iv,
+               int enc, void *vdst, int *dstlenp, const void *vsrc, int srclen)
+{
+/*  Since the entire [src] is available, the PKCS #5 padding is computed
+ *    arithmetically instead of staging data through the context's partial
+ *    block buffer.  During encryption, complete blocks are encrypted directly
+ *    from [src] into [dst], and only the final padded block is assembled
+ *    in a local buffer.  During decryption, the ciphertext is decrypted
+ *    directly into [dst] in a single call, and the padding is validated
+ *    and removed in place.
+ */
+    cipher_ctx     x;
+    unsigned char  buf [MUNGE_MAXIMUM_BLK_LEN];
+    unsigned char *dst = vdst;
+    unsigned char *src = (void *) vsrc;
+    int            n_partial;
+    int            n_complete;
+    int            n;
+    int            i;
+    int            pad;
+    int            rc = -1;
+
+    memset (&x, 0, sizeof (x));
+    if (_cipher_init (&x, cipher, key, iv, enc) < 0) {
+        goto end;
+    }
+    if (enc) {
+        n_partial = srclen % x.blklen;
+        n_complete = srclen - n_partial;
+        if (n_complete > 0) {
+            n = *dstlenp;
+            if (_cipher_update_aux (&x, dst, &n, src, n_complete) < 0) {
+                goto end;
+            }
+            assert (n == n_complete);
+        }
+        pad = x.blklen - n_partial;
+        memcpy (buf, src + n_complete, n_partial);
+        memset (buf + n_partial, pad, pad);
+        n = *dstlenp - n_complete;
+        if (_cipher_update_aux (&x, dst + n_complete, &n, buf, x.blklen) < 0) {
+            goto end;
+        }
+        assert (n == x.blklen);
+        *dstlenp = n_complete + x.blklen;
+    }
+    else {
+        /*  Ciphertext should always be a non-zero multiple of the block size
+         *    due to padding.
+         */
+        if ((srclen == 0) || (srclen % x.blklen != 0)) {
+            log_msg (LOG_DEBUG,
+                "Ciphertext length of %d is not a multiple of %d", srclen,
+                x.blklen);
+            goto end;
+        }
+        n = *dstlenp;
+        if (_cipher_update_aux (&x, dst, &n, src, srclen) < 0) {
+            goto end;
+        }
+        assert (n == srclen);
+        /*
+         *  Validate PKCS #5 block padding.
+         */
+        pad = dst[srclen - 1];
+        if ((pad <= 0) || (pad > x.blklen)) {
+            log_msg (LOG_DEBUG,
+                "Final decryption block has invalid pad of %d", pad);
+            goto end;
+        }
+        for (i = srclen - pad; i < srclen; i++) {
+            if (dst[i] != pad) {
+                log_msg (LOG_DEBUG,
+                    "Final decryption block has padding error at byte %d",
+                    i - (srclen - x.blklen));
+                goto end;
+            }
+        }
+        *dstlenp = srclen - pad;
+    }
+    rc = 0;
+
+end:
+    if (rc < 0) {
+        *dstlenp = 0;
+    }
+    memset (buf, 0, sizeof (buf));
+    _cipher_cleanup (&x);
+    memset (&x, 0, sizeof (x));
+    return (rc);
+}
+
+
 static int
 _cipher_block_size (munge_cipher_t cipher)
 {
@@ -593,6 +722,31 @@ _cipher_init_subsystem (void)
     _cipher_map [MUNGE_CIPHER_AES256] = EVP_aes_256_cbc ();
 #endif /* HAVE_EVP_AES_256_CBC && HAVE_EVP_SHA256 */
 
+#if HAVE_EVP_CIPHER_FETCH && HAVE_EVP_CIPHER_GET0_NAME
+    /*  OpenSSL >= 3.0
+     *  The legacy EVP_CIPHER objects above are placeholders that cause
+     *    EVP_CipherInit_ex() to perform an implicit provider fetch on every
+     *    call, which costs more than encrypting a credential.  Replace them
+     *    with explicitly-fetched implementations so each init can use the
+     *    provider directly.  A cipher that cannot be fetched (e.g., Blowfish
+     *    or CAST5 without the legacy provider loaded) keeps its legacy object
+     *    so its behavior is unchanged.  The fetched objects are held for the
+     *    lifetime of the process.
+     */
+    for (i = 0; i < MUNGE_CIPHER_LAST_ITEM; i++) {
+        EVP_CIPHER *algo;
+
+        if (_cipher_map [i] == NULL) {
+            continue;
+        }
+        algo = EVP_CIPHER_fetch (NULL,
+                EVP_CIPHER_get0_name (_cipher_map [i]), NULL);
+        if (algo != NULL) {
+            _cipher_map [i] = algo;
+        }
+    }
+#endif /* HAVE_EVP_CIPHER_FETCH && HAVE_EVP_CIPHER_GET0_NAME */
+
     return;
 }
 
@@ -709,6 +863,47 @@ _cipher_cleanup (cipher_ctx *x)
 }
 
 
+static int
+_cipher_block (munge_cipher_t cipher, unsigned char *key, unsigned char *iv,
+               int enc, void *vdst, int *dstlenp, const void *src, int srclen)
+{
+/*  OpenSSL's EVP_CipherUpdate() already processes complete blocks directly
+ *    from [src] into [dst], so this just drives the context through a single
+ *    update & final.
+ */
+    cipher_ctx     x;
+    unsigned char *dst = vdst;
+    int            n;
+    int            n_written;
+    int            rc = -1;
+
+    memset (&x, 0, sizeof (x));
+    if (_cipher_init (&x, cipher, key, iv, enc) < 0) {
+        goto end;
+    }
+    n = *dstlenp;
+    if (_cipher_update (&x, dst, &n, src, srclen) < 0) {
+        goto end;
+    }
+    n_written = n;
+    n = *dstlenp - n_written;
+    if (_cipher_final (&x, dst + n_written, &n) < 0) {
+        goto end;
+    }
+    *dstlenp = n_written + n;
+    rc = 0;
+
+end:
+    if (rc < 0) {
+        *dstlenp = 0;
+    }
+    if (x.ctx != NULL) {
+        (void) _cipher_cleanup (&x);
+    }
+    return (rc);
+}
+
+
 static int
 _cipher_block_size (munge_cipher_t cipher)
 {
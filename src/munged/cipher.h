@@ -89,6 +89,10 @@ int cipher_final (cipher_ctx *x, void *dst, int *dstlenp);
 
 int cipher_cleanup (cipher_ctx *x);
 
+int cipher_block (munge_cipher_t cipher,
+                  unsigned char *key, unsigned char *iv, int enc,
+                  void *dst, int *dstlenp, const void *src, int srclen);
+
 int cipher_block_size (munge_cipher_t cipher);
 
 int cipher_iv_size (munge_cipher_t cipher);
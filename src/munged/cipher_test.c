@@ -0,0 +1,172 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <munge.h>
+#include "cipher.h"
+#include "crypto.h"
+#include "tap.h"
+
+
+/*****************************************************************************
+ *  Checks that cipher_block() produces the same ciphertext as the
+ *    cipher_init/update/final context interface, that it round-trips,
+ *    and that it rejects ciphertext with corrupted padding.
+ *****************************************************************************/
+
+#define MAX_LEN 64
+
+
+int check_cipher (munge_cipher_t cipher, const char *str);
+int encrypt_context (munge_cipher_t cipher, unsigned char *key,
+        unsigned char *iv, unsigned char *dst, int *dstlenp,
+        const unsigned char *src, int srclen);
+
+
+int
+main (int argc, char *argv[])
+{
+    crypto_init ();
+    cipher_init_subsystem ();
+
+    plan (NO_PLAN);
+
+    check_cipher (MUNGE_CIPHER_BLOWFISH, "MUNGE_CIPHER_BLOWFISH");
+    check_cipher (MUNGE_CIPHER_CAST5, "MUNGE_CIPHER_CAST5");
+    check_cipher (MUNGE_CIPHER_AES128, "MUNGE_CIPHER_AES128");
+    check_cipher (MUNGE_CIPHER_AES256, "MUNGE_CIPHER_AES256");
+
+    done_testing ();
+
+    crypto_fini ();
+
+    exit (EXIT_SUCCESS);
+}
+
+
+int
+check_cipher (munge_cipher_t cipher, const char *str)
+{
+    unsigned char key[MUNGE_MAXIMUM_KEY_LEN];
+    unsigned char iv[MUNGE_MAXIMUM_BLK_LEN];
+    unsigned char src[MAX_LEN];
+    unsigned char ctx_buf[MAX_LEN + MUNGE_MAXIMUM_BLK_LEN];
+    unsigned char enc_buf[MAX_LEN + MUNGE_MAXIMUM_BLK_LEN];
+    unsigned char dec_buf[MAX_LEN + (2 * MUNGE_MAXIMUM_BLK_LEN)];
+    int ctx_len;
+    int enc_len;
+    int dec_len;
+    int n_failed;
+    int i;
+
+    n_failed = 0;
+    skip (cipher_map_enum (cipher, NULL) < 0, 5, "%s not supported", str);
+
+    for (i = 0; i < sizeof (key); i++) {
+        key[i] = i;
+    }
+    for (i = 0; i < sizeof (iv); i++) {
+        iv[i] = 0xff - i;
+    }
+    for (i = 0; i < sizeof (src); i++) {
+        src[i] = (i * 7) & 0xff;
+    }
+    for (i = 0; i <= MAX_LEN; i++) {
+        ctx_len = sizeof (ctx_buf);
+        enc_len = sizeof (enc_buf);
+        dec_len = sizeof (dec_buf);
+        if ((encrypt_context (cipher, key, iv, ctx_buf, &ctx_len, src, i) < 0)
+                || (cipher_block (cipher, key, iv, CIPHER_ENCRYPT,
+                        enc_buf, &enc_len, src, i) < 0)
+                || (enc_len != ctx_len)
+                || (memcmp (enc_buf, ctx_buf, enc_len) != 0)
+                || (cipher_block (cipher, key, iv, CIPHER_DECRYPT,
+                        dec_buf, &dec_len, enc_buf, enc_len) < 0)
+                || (dec_len != i)
+                || (memcmp (dec_buf, src, i) != 0)) {
+            diag ("%s failed for %d-byte plaintext", str, i);
+            n_failed++;
+        }
+    }
+    ok (n_failed == 0, "cipher_block %s matches context for 0-%d bytes",
+            str, MAX_LEN);
+
+    enc_len = sizeof (enc_buf);
+    dec_len = sizeof (dec_buf);
+    ok (!cipher_block (cipher, key, iv, CIPHER_ENCRYPT,
+            enc_buf, &enc_len, src, 0), "cipher_block %s empty encrypt", str);
+    enc_buf[enc_len - 1] ^= 0x01;
+    ok ((cipher_block (cipher, key, iv, CIPHER_DECRYPT,
+            dec_buf, &dec_len, enc_buf, enc_len) < 0) && (dec_len == 0),
+            "cipher_block %s rejects corrupted padding", str);
+
+    dec_len = sizeof (dec_buf);
+    ok ((cipher_block (cipher, key, iv, CIPHER_DECRYPT,
+            dec_buf, &dec_len, enc_buf, enc_len - 1) < 0) && (dec_len == 0),
+            "cipher_block %s rejects partial block", str);
+
+    enc_len = MAX_LEN;
+    ok (cipher_block (cipher, key, iv, CIPHER_ENCRYPT,
+            enc_buf, &enc_len, src, MAX_LEN) < 0,
+            "cipher_block %s rejects short dst", str);
+
+    end_skip;
+
+    return n_failed ? -1 : 0;
+}
+
+
+int
+encrypt_context (munge_cipher_t cipher, unsigned char *key, unsigned char *iv,
+        unsigned char *dst, int *dstlenp, const unsigned char *src, int srclen)
+{
+    cipher_ctx x;
+    int n;
+    int n_written;
+
+    if (cipher_init (&x, cipher, key, iv, CIPHER_ENCRYPT) < 0) {
+        return -1;
+    }
+    n = *dstlenp;
+    if (cipher_update (&x, dst, &n, src, srclen) < 0) {
+        cipher_cleanup (&x);
+        return -1;
+    }
+    n_written = n;
+    n = *dstlenp - n_written;
+    if (cipher_final (&x, dst + n_written, &n) < 0) {
+        cipher_cleanup (&x);
+        return -1;
+    }
+    *dstlenp = n_written + n;
+    return cipher_cleanup (&x);
+}
@@ -30,10 +30,130 @@
 #endif /* HAVE_CONFIG_H */
 
 #include <errno.h>
+#include <pthread.h>
 #include <time.h>
 #include "clock.h"
 
 
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static int _clock_get_real (struct timespec *tsp);
+
+static int _clock_get_virtual (struct timespec *tsp);
+
+
+/*****************************************************************************
+ *  Private Variables
+ *****************************************************************************/
+
+/*  The _clock_source is the function queried for the current time.
+ *    It must not be changed while other threads may be querying the clock.
+ */
+static clock_source_f  _clock_source = _clock_get_real;
+
+/*  The _clock_virtual_ts is the current time of the virtual clock.
+ *    It only advances when explicitly told to do so.
+ */
+static struct timespec _clock_virtual_ts = { 0, 0 };
+static pthread_mutex_t _clock_virtual_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+/*  Set the clock source queried for the current time to [f].
+ *    If [f] is NULL, the realtime system clock is restored.
+ *  This should be called before any threads that query the clock are started.
+ */
+void
+clock_set_source (clock_source_f f)
+{
+    _clock_source = (f != NULL) ? f : _clock_get_real;
+    return;
+}
+
+
+/*  Set the clock source to a virtual clock starting at timespec [tsp].
+ *    The virtual clock only advances via clock_advance_virtual() or another
+ *    call to clock_set_virtual(), allowing time-dependent behavior to be
+ *    tested deterministically.
+ *  Return 0 on success, or -1 on error (with errno set).
+ */
+int
+clock_set_virtual (const struct timespec *tsp)
+{
+    if ((tsp == NULL) || (tsp->tv_nsec < 0)
+            || (tsp->tv_nsec >= 1000 * 1000 * 1000)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((errno = pthread_mutex_lock (&_clock_virtual_mutex)) != 0) {
+        return -1;
+    }
+    _clock_virtual_ts = *tsp;
+    _clock_source = _clock_get_virtual;
+
+    if ((errno = pthread_mutex_unlock (&_clock_virtual_mutex)) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+
+/*  Advance the virtual clock forward by [msecs] milliseconds.
+ *  Return 0 on success, or -1 on error (with errno set).
+ */
+int
+clock_advance_virtual (long msecs)
+{
+    if (msecs < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (_clock_source != _clock_get_virtual) {
+        errno = EPERM;
+        return -1;
+    }
+    if ((errno = pthread_mutex_lock (&_clock_virtual_mutex)) != 0) {
+        return -1;
+    }
+    _clock_virtual_ts.tv_sec += msecs / 1000;
+    _clock_virtual_ts.tv_nsec += (msecs % 1000) * 1000 * 1000;
+    if (_clock_virtual_ts.tv_nsec >= 1000 * 1000 * 1000) {
+        _clock_virtual_ts.tv_sec += 1;
+        _clock_virtual_ts.tv_nsec -= 1000 * 1000 * 1000;
+    }
+    if ((errno = pthread_mutex_unlock (&_clock_virtual_mutex)) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+
+/*  Set [*tp] to the current time in seconds since the Epoch.
+ *    This is the clock-source equivalent of time().
+ *  Return 0 on success, or -1 on error (with errno set).
+ */
+int
+clock_get_time (time_t *tp)
+{
+    struct timespec ts;
+
+    if (tp == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (_clock_source (&ts) < 0) {
+        return -1;
+    }
+    *tp = ts.tv_sec;
+    return 0;
+}
+
+
 /*  Set timespec [tsp] to the current time adjusted forward by
  *    [msecs] milliseconds.
  *  Return 0 on success, or -1 on error (with errno set).
@@ -47,7 +167,7 @@ clock_get_timespec (struct timespec *tsp, long msecs)
         errno = EINVAL;
         return -1;
     }
-    rv = clock_gettime (CLOCK_REALTIME, tsp);
+    rv = _clock_source (tsp);
     if (rv < 0) {
         return -1;
     }
@@ -100,3 +220,33 @@ clock_is_timespec_expired (const struct timespec *tsp)
     rv = clock_is_timespec_le (tsp, &now);
     return rv;
 }
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static int
+_clock_get_real (struct timespec *tsp)
+{
+/*  Query the realtime system clock.
+ */
+    return clock_gettime (CLOCK_REALTIME, tsp);
+}
+
+
+static int
+_clock_get_virtual (struct timespec *tsp)
+{
+/*  Query the virtual clock.
+ */
+    if ((errno = pthread_mutex_lock (&_clock_virtual_mutex)) != 0) {
+        return -1;
+    }
+    *tsp = _clock_virtual_ts;
+
+    if ((errno = pthread_mutex_unlock (&_clock_virtual_mutex)) != 0) {
+        return -1;
+    }
+    return 0;
+}
@@ -36,6 +36,29 @@
 #include <time.h>
 
 
+/*****************************************************************************
+ *  Data Types
+ *****************************************************************************/
+
+typedef int (*clock_source_f) (struct timespec *tsp);
+/*
+ *  Function prototype for a clock source.  It sets timespec [tsp] to the
+ *    current time and returns 0 on success, or -1 on error (with errno set).
+ */
+
+
+/*****************************************************************************
+ *  Prototypes
+ *****************************************************************************/
+
+void clock_set_source (clock_source_f f);
+
+int clock_set_virtual (const struct timespec *tsp);
+
+int clock_advance_virtual (long msecs);
+
+int clock_get_time (time_t *tp);
+
 int clock_get_timespec (struct timespec *tsp, long msecs);
 
 int clock_is_timespec_le (
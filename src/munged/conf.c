@@ -30,12 +30,15 @@
 #endif /* HAVE_CONFIG_H */
 
 #include <assert.h>
+#include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
 #include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/socket.h>                 /* for AF_INET */
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -77,7 +80,25 @@
 #define OPT_TRUSTED_GROUP       269
 #define OPT_ORIGIN              270
 #define OPT_LISTEN_BACKLOG      271
-#define OPT_LAST                272
+#define OPT_IO_THREADS          272
+#define OPT_QUEUE_LIMIT         273
+#define OPT_UPGRADE             274
+#define OPT_UPGRADE_FD          275
+#define OPT_PROBE_INTERVAL      276
+#define OPT_PROBE_THRESHOLD     277
+#define OPT_USAGE_REPORT        278
+#define OPT_ZIP_THREADS         279
+#define OPT_EXTRA_SOCKET        280
+#define OPT_LOCK_STATS          281
+#define OPT_REQUEST_TIMEOUT     282
+#define OPT_AUDIT_FILE          283
+#define OPT_AUDIT_MAX_SIZE      284
+#define OPT_AUDIT_SYNC          285
+#define OPT_CONFIG_FILE         286
+#define OPT_LOG_LEVEL           287
+#define OPT_ZIP_CACHE           288
+#define OPT_TRACE_FILE          289
+#define OPT_LAST                290
 
 const char * const short_opts = ":hLVfFMsS:v";
 
@@ -93,27 +114,75 @@ struct option long_opts[] = {
     { "socket",            required_argument, NULL, 'S'               },
     { "verbose",           no_argument,       NULL, 'v'               },
     { "advice",            no_argument,       NULL, OPT_ADVICE        },
+    { "audit-file",        required_argument, NULL, OPT_AUDIT_FILE    },
+    { "audit-max-size",    required_argument, NULL, OPT_AUDIT_MAX_SIZE},
+    { "audit-sync",        required_argument, NULL, OPT_AUDIT_SYNC    },
 #if defined(AUTH_METHOD_RECVFD_MKFIFO) || defined(AUTH_METHOD_RECVFD_MKNOD)
     { "auth-server-dir",   required_argument, NULL, OPT_AUTH_SERVER   },
     { "auth-client-dir",   required_argument, NULL, OPT_AUTH_CLIENT   },
 #endif /* AUTH_METHOD_RECVFD_MKFIFO || AUTH_METHOD_RECVFD_MKNOD */
     { "benchmark",         no_argument,       NULL, OPT_BENCHMARK     },
+    { "config-file",       required_argument, NULL, OPT_CONFIG_FILE   },
+    { "extra-socket",      required_argument, NULL, OPT_EXTRA_SOCKET  },
     { "group-check-mtime", required_argument, NULL, OPT_GROUP_CHECK   },
     { "group-update-time", required_argument, NULL, OPT_GROUP_UPDATE  },
+    { "io-threads",        required_argument, NULL, OPT_IO_THREADS    },
     { "key-file",          required_argument, NULL, OPT_KEY_FILE      },
     { "listen-backlog",    required_argument, NULL, OPT_LISTEN_BACKLOG},
+    { "lock-stats",        no_argument,       NULL, OPT_LOCK_STATS    },
     { "log-file",          required_argument, NULL, OPT_LOG_FILE      },
+    { "log-level",         required_argument, NULL, OPT_LOG_LEVEL     },
     { "max-ttl",           required_argument, NULL, OPT_MAX_TTL       },
     { "num-threads",       required_argument, NULL, OPT_NUM_THREADS   },
     { "origin",            required_argument, NULL, OPT_ORIGIN        },
     { "pid-file",          required_argument, NULL, OPT_PID_FILE      },
+    { "probe-interval",    required_argument, NULL, OPT_PROBE_INTERVAL},
+    { "probe-threshold",   required_argument, NULL, OPT_PROBE_THRESHOLD},
+    { "queue-limit",       required_argument, NULL, OPT_QUEUE_LIMIT   },
+    { "request-timeout",   required_argument, NULL, OPT_REQUEST_TIMEOUT},
     { "seed-file",         required_argument, NULL, OPT_SEED_FILE     },
     { "syslog",            no_argument,       NULL, OPT_SYSLOG        },
+    { "trace-file",        required_argument, NULL, OPT_TRACE_FILE    },
     { "trusted-group",     required_argument, NULL, OPT_TRUSTED_GROUP },
+    { "upgrade",           no_argument,       NULL, OPT_UPGRADE       },
+    { "usage-report-time", required_argument, NULL, OPT_USAGE_REPORT  },
+    { "upgrade-fd",        required_argument, NULL, OPT_UPGRADE_FD    },
+    { "zip-cache",         required_argument, NULL, OPT_ZIP_CACHE     },
+    { "zip-threads",       required_argument, NULL, OPT_ZIP_THREADS   },
     {  NULL,               0,                 NULL, 0                 }
 };
 
 
+/*****************************************************************************
+ *  Internal Data Types
+ *****************************************************************************/
+
+/*  Settings that can be changed at runtime via the config file.
+ *    These are collected and validated before any are applied to the conf.
+ */
+struct conf_file_opts {
+    int             nthreads;           /* num threads for processing creds  */
+    int             queue_len;          /* max reqs queued between stages    */
+    int             listen_backlog;     /* unix domain socket listen backlog */
+    int             max_ttl;            /* maximum time-to-live in seconds   */
+    int             log_priority;       /* log priority level (or -1)        */
+};
+
+/*  Log levels recognized by the log-level setting.
+ */
+static const struct {
+    const char     *name;
+    int             priority;
+} _conf_log_levels[] = {
+    { "err",        LOG_ERR     },
+    { "warning",    LOG_WARNING },
+    { "notice",     LOG_NOTICE  },
+    { "info",       LOG_INFO    },
+    { "debug",      LOG_DEBUG   },
+    {  NULL,        0           }
+};
+
+
 /*****************************************************************************
  *  Internal Prototypes
  *****************************************************************************/
@@ -127,6 +196,8 @@ static void _conf_set_string (char **str_p, const char *val, const char *cwd,
 
 static void _conf_process_stop (conf_t conf);
 
+static void _conf_process_upgrade (conf_t conf);
+
 static int _conf_send_signal (pid_t pid, int signum, int msecs);
 
 static void _conf_sleep (int msecs);
@@ -135,6 +206,15 @@ static void _conf_set_origin_addr (conf_t conf);
 
 static int _conf_open_keyfile (const char *keyfile, int got_force);
 
+static int _conf_parse_file_opt (struct conf_file_opts *opts,
+        const char *key, const char *val);
+
+static int _conf_parse_int (const char *s, long min, long max, int *ip);
+
+static int _conf_parse_log_level (const char *s);
+
+static char * _conf_strip (char *s);
+
 
 /*****************************************************************************
  *  Global Variables
@@ -160,8 +240,10 @@ create_conf (void)
     conf->got_clock_skew = 1;
     conf->got_force = 0;
     conf->got_foreground = 0;
+    conf->got_lock_stats = 0;
     conf->got_group_stat = !! MUNGE_GROUP_STAT_FLAG;
     conf->got_stop = 0;
+    conf->got_upgrade = 0;
     conf->got_mlockall = 0;
     conf->got_root_auth = !! MUNGE_AUTH_ROOT_ALLOW_FLAG;
     conf->got_socket_retry = !! MUNGE_SOCKET_RETRY_FLAG;
@@ -212,6 +294,21 @@ create_conf (void)
     conf->gids = NULL;
     conf->gids_update_secs = MUNGE_GROUP_UPDATE_SECS;
     conf->nthreads = MUNGE_THREADS;
+    conf->io_threads = MUNGE_IO_THREADS;
+    conf->queue_len = MUNGE_STAGE_QUEUE_LEN;
+    conf->request_timeout_msecs = MUNGE_REQUEST_TIMEOUT_MSECS;
+    conf->zip_threads = MUNGE_ZIP_THREADS;
+    conf->zip_cache_len = MUNGE_ZIP_CACHE_LEN;
+    conf->listeners = NULL;
+    conf->upgrade_fd = -1;
+    conf->probe_interval_secs = MUNGE_PROBE_INTERVAL_SECS;
+    conf->probe_threshold_msecs = MUNGE_PROBE_THRESHOLD_MSECS;
+    conf->usage_report_secs = MUNGE_USAGE_REPORT_SECS;
+    conf->log_priority = -1;
+    conf->audit_name = NULL;
+    conf->audit_max_bytes = MUNGE_AUDIT_MAX_BYTES;
+    conf->audit_sync_msecs = MUNGE_AUDIT_SYNC_MSECS;
+    conf->trace_name = NULL;
     conf->auth_server_dir = NULL;
     conf->auth_client_dir = NULL;
     conf->auth_rnd_bytes = MUNGE_AUTH_RND_BYTES;
@@ -274,6 +371,11 @@ destroy_conf (conf_t conf, int do_unlink)
         free (conf->socket_name);
         conf->socket_name = NULL;
     }
+    while (conf->listeners != NULL) {
+        listener_t l = conf->listeners;
+        conf->listeners = l->next;
+        listener_destroy (l);
+    }
     if (conf->seed_name) {
         free (conf->seed_name);
         conf->seed_name = NULL;
@@ -282,6 +384,14 @@ destroy_conf (conf_t conf, int do_unlink)
         free (conf->key_name);
         conf->key_name = NULL;
     }
+    if (conf->audit_name) {
+        free (conf->audit_name);
+        conf->audit_name = NULL;
+    }
+    if (conf->trace_name) {
+        free (conf->trace_name);
+        conf->trace_name = NULL;
+    }
     if (conf->dek_key) {
         memburn (conf->dek_key, 0, conf->dek_key_len);
         free (conf->dek_key);
@@ -317,10 +427,12 @@ destroy_conf (conf_t conf, int do_unlink)
 void
 parse_cmdline (conf_t conf, int argc, char **argv)
 {
-    char *prog;
-    int   c;
-    long  l;
-    char *p;
+    char        *prog;
+    int          c;
+    long         l;
+    char        *p;
+    listener_t  *lp;
+    char         ebuf [1024];
 
     assert (conf != NULL);
 
@@ -370,6 +482,32 @@ parse_cmdline (conf_t conf, int argc, char **argv)
             case OPT_ADVICE:
                 printf ("Don't Panic!\n");
                 exit (42);
+            case OPT_AUDIT_FILE:
+                _conf_set_string (&conf->audit_name, optarg, conf->cwd,
+                        "audit-file name");
+                break;
+            case OPT_AUDIT_MAX_SIZE:
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if (((errno == ERANGE) && ((l == LONG_MIN) || (l == LONG_MAX)))
+                        || (optarg == p) || (*p != '\0')
+                        || (l < 0)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid value \"%s\" for audit-max-size", optarg);
+                }
+                conf->audit_max_bytes = l;
+                break;
+            case OPT_AUDIT_SYNC:
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if (((errno == ERANGE) && ((l == LONG_MIN) || (l == LONG_MAX)))
+                        || (optarg == p) || (*p != '\0')
+                        || (l < -1) || (l > INT_MAX)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid value \"%s\" for audit-sync", optarg);
+                }
+                conf->audit_sync_msecs = l;
+                break;
 #if defined(AUTH_METHOD_RECVFD_MKFIFO) || defined(AUTH_METHOD_RECVFD_MKNOD)
             case OPT_AUTH_SERVER:
                 _conf_set_string (&conf->auth_server_dir, optarg, conf->cwd,
@@ -383,6 +521,23 @@ parse_cmdline (conf_t conf, int argc, char **argv)
             case OPT_BENCHMARK:
                 conf->got_benchmark = 1;
                 break;
+            case OPT_CONFIG_FILE:
+                _conf_set_string (&conf->config_name, optarg, conf->cwd,
+                        "config-file name");
+                break;
+            case OPT_EXTRA_SOCKET:
+                for (lp = &conf->listeners; *lp != NULL; lp = &(*lp)->next) {
+                    ;
+                }
+                *lp = listener_create (optarg, conf->cwd, conf->def_cipher,
+                        conf->def_mac, conf->def_zip, conf->def_ttl,
+                        ebuf, sizeof (ebuf));
+                if (*lp == NULL) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid value \"%s\" for extra-socket: %s",
+                        optarg, ebuf);
+                }
+                break;
             case OPT_GROUP_CHECK:
                 errno = 0;
                 l = strtol (optarg, &p, 10);
@@ -404,6 +559,17 @@ parse_cmdline (conf_t conf, int argc, char **argv)
                 }
                 conf->gids_update_secs = l;
                 break;
+            case OPT_IO_THREADS:
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if (((errno == ERANGE) && ((l == LONG_MIN) || (l == LONG_MAX)))
+                        || (optarg == p) || (*p != '\0')
+                        || (l < 0) || (l > INT_MAX)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid value \"%s\" for io-threads", optarg);
+                }
+                conf->io_threads = l;
+                break;
             case OPT_KEY_FILE:
                 _conf_set_string (&conf->key_name, optarg, conf->cwd,
                         "key-file name");
@@ -427,10 +593,20 @@ parse_cmdline (conf_t conf, int argc, char **argv)
                     conf->listen_backlog = l;
                 }
                 break;
+            case OPT_LOCK_STATS:
+                conf->got_lock_stats = 1;
+                break;
             case OPT_LOG_FILE:
                 _conf_set_string (&conf->logfile_name, optarg, conf->cwd,
                         "log-file name");
                 break;
+            case OPT_LOG_LEVEL:
+                conf->log_priority = _conf_parse_log_level (optarg);
+                if (conf->log_priority < 0) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid value \"%s\" for log-level", optarg);
+                }
+                break;
             case OPT_MAX_TTL:
                 l = strtol (optarg, &p, 10);
                 if (((errno == ERANGE) && ((l == LONG_MIN) || (l == LONG_MAX)))
@@ -459,6 +635,50 @@ parse_cmdline (conf_t conf, int argc, char **argv)
                 _conf_set_string (&conf->pidfile_name, optarg, conf->cwd,
                         "pid-file name");
                 break;
+            case OPT_PROBE_INTERVAL:
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if (((errno == ERANGE) && ((l == LONG_MIN) || (l == LONG_MAX)))
+                        || (optarg == p) || (*p != '\0')
+                        || (l < 0) || (l > INT_MAX / 1000)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid value \"%s\" for probe-interval", optarg);
+                }
+                conf->probe_interval_secs = l;
+                break;
+            case OPT_PROBE_THRESHOLD:
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if (((errno == ERANGE) && ((l == LONG_MIN) || (l == LONG_MAX)))
+                        || (optarg == p) || (*p != '\0')
+                        || (l <= 0) || (l > INT_MAX)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid value \"%s\" for probe-threshold", optarg);
+                }
+                conf->probe_threshold_msecs = l;
+                break;
+            case OPT_QUEUE_LIMIT:
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if (((errno == ERANGE) && ((l == LONG_MIN) || (l == LONG_MAX)))
+                        || (optarg == p) || (*p != '\0')
+                        || (l <= 0) || (l > INT_MAX)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid value \"%s\" for queue-limit", optarg);
+                }
+                conf->queue_len = l;
+                break;
+            case OPT_REQUEST_TIMEOUT:
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if (((errno == ERANGE) && ((l == LONG_MIN) || (l == LONG_MAX)))
+                        || (optarg == p) || (*p != '\0')
+                        || (l < 0) || (l > INT_MAX)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid value \"%s\" for request-timeout", optarg);
+                }
+                conf->request_timeout_msecs = l;
+                break;
             case OPT_SEED_FILE:
                 _conf_set_string (&conf->seed_name, optarg, conf->cwd,
                         "seed-file name");
@@ -466,12 +686,63 @@ parse_cmdline (conf_t conf, int argc, char **argv)
             case OPT_SYSLOG:
                 conf->got_syslog = 1;
                 break;
+            case OPT_TRACE_FILE:
+                _conf_set_string (&conf->trace_name, optarg, conf->cwd,
+                        "trace-file name");
+                break;
             case OPT_TRUSTED_GROUP:
                 if (path_set_trusted_group (optarg) < 0) {
                     log_err (EMUNGE_SNAFU, LOG_ERR,
                         "Invalid value \"%s\" for trusted-group", optarg);
                 }
                 break;
+            case OPT_UPGRADE:
+                conf->got_upgrade = 1;
+                break;
+            case OPT_USAGE_REPORT:
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if (((errno == ERANGE) && ((l == LONG_MIN) || (l == LONG_MAX)))
+                        || (optarg == p) || (*p != '\0')
+                        || (l < -1) || (l > INT_MAX / 1000)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid value \"%s\" for usage-report-time", optarg);
+                }
+                conf->usage_report_secs = l;
+                break;
+            case OPT_UPGRADE_FD:
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if (((errno == ERANGE) && ((l == LONG_MIN) || (l == LONG_MAX)))
+                        || (optarg == p) || (*p != '\0')
+                        || (l <= STDERR_FILENO) || (l > INT_MAX)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid value \"%s\" for upgrade-fd", optarg);
+                }
+                conf->upgrade_fd = l;
+                break;
+            case OPT_ZIP_THREADS:
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if (((errno == ERANGE) && ((l == LONG_MIN) || (l == LONG_MAX)))
+                        || (optarg == p) || (*p != '\0')
+                        || (l < 0) || (l > INT_MAX)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid value \"%s\" for zip-threads", optarg);
+                }
+                conf->zip_threads = l;
+                break;
+            case OPT_ZIP_CACHE:
+                errno = 0;
+                l = strtol (optarg, &p, 10);
+                if (((errno == ERANGE) && ((l == LONG_MIN) || (l == LONG_MAX)))
+                        || (optarg == p) || (*p != '\0')
+                        || (l < 0) || (l > INT_MAX)) {
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid value \"%s\" for zip-cache", optarg);
+                }
+                conf->zip_cache_len = l;
+                break;
             case '?':
                 if (optopt > 0) {
                     log_err (EMUNGE_SNAFU, LOG_ERR,
@@ -527,16 +798,142 @@ process_conf (conf_t conf)
 {
 /*  Process the configuration.
  */
+    char ebuf[1024];
+
     assert (conf != NULL);
 
     if (conf->got_stop) {
         _conf_process_stop (conf);
     }
+    if (conf->got_upgrade) {
+        _conf_process_upgrade (conf);
+    }
+    if (conf->config_name != NULL) {
+        if (read_conf_file (conf, ebuf, sizeof (ebuf)) < 0) {
+            log_err (EMUNGE_SNAFU, LOG_ERR, "%s", ebuf);
+        }
+    }
     _conf_set_origin_addr (conf);
     return;
 }
 
 
+int
+read_conf_file (conf_t conf, char *ebuf, size_t ebuflen)
+{
+/*  Reads the settings from the config file [conf->config_name] into [conf].
+ *    Each non-blank line is of the form "key = value" where the key is the
+ *    name of a command-line option that can be changed at runtime; text
+ *    following a '#' is ignored.  Settings omitted from the file retain
+ *    their current values.
+ *  The file is read in full and validated before any settings are applied.
+ *  Returns 0 on success, or -1 on error (with a message written to [ebuf]).
+ */
+    struct conf_file_opts  opts;
+    FILE                  *fp;
+    struct stat            st;
+    char                   line[1024];
+    int                    line_num = 0;
+    char                  *key;
+    char                  *val;
+    char                  *p;
+    int                    rc = -1;
+
+    assert (conf != NULL);
+    assert (conf->config_name != NULL);
+    assert (ebuf != NULL);
+
+    opts.nthreads = conf->nthreads;
+    opts.queue_len = conf->queue_len;
+    opts.listen_backlog = conf->listen_backlog;
+    opts.max_ttl = conf->max_ttl;
+    opts.log_priority = conf->log_priority;
+
+    if (!(fp = fopen (conf->config_name, "r"))) {
+        (void) snprintf (ebuf, ebuflen,
+                "Failed to open config file \"%s\": %s",
+                conf->config_name, strerror (errno));
+        return (-1);
+    }
+    /*  Since the config file controls the daemon's capacity, only root or
+     *    the daemon's own user may be able to change it.
+     */
+    if (fstat (fileno (fp), &st) < 0) {
+        (void) snprintf (ebuf, ebuflen,
+                "Failed to stat config file \"%s\": %s",
+                conf->config_name, strerror (errno));
+        goto end;
+    }
+    if (!S_ISREG (st.st_mode)) {
+        (void) snprintf (ebuf, ebuflen,
+                "Config file is insecure: \"%s\" must be a regular file "
+                "(type=%07o)", conf->config_name, (st.st_mode & S_IFMT));
+        goto end;
+    }
+    if ((st.st_uid != 0) && (st.st_uid != geteuid ())) {
+        (void) snprintf (ebuf, ebuflen,
+                "Config file is insecure: \"%s\" should be owned by UID 0 "
+                "or UID %u instead of UID %u", conf->config_name,
+                (unsigned) geteuid (), (unsigned) st.st_uid);
+        goto end;
+    }
+    if (st.st_mode & (S_IWGRP | S_IWOTH)) {
+        (void) snprintf (ebuf, ebuflen,
+                "Config file is insecure: \"%s\" should not be writable "
+                "by group or other (perms=%04o)", conf->config_name,
+                (st.st_mode & ~S_IFMT));
+        goto end;
+    }
+    while (fgets (line, sizeof (line), fp) != NULL) {
+        line_num++;
+        if ((strchr (line, '\n') == NULL) && !feof (fp)) {
+            (void) snprintf (ebuf, ebuflen,
+                    "Line %d of config file \"%s\" is too long",
+                    line_num, conf->config_name);
+            goto end;
+        }
+        if ((p = strchr (line, '#')) != NULL) {
+            *p = '\0';
+        }
+        key = _conf_strip (line);
+        if (*key == '\0') {
+            continue;
+        }
+        if ((p = strchr (key, '=')) == NULL) {
+            (void) snprintf (ebuf, ebuflen,
+                    "Missing \"=\" at line %d of config file \"%s\"",
+                    line_num, conf->config_name);
+            goto end;
+        }
+        *p = '\0';
+        key = _conf_strip (key);
+        val = _conf_strip (p + 1);
+        if (_conf_parse_file_opt (&opts, key, val) < 0) {
+            (void) snprintf (ebuf, ebuflen,
+                    "Invalid setting \"%s = %s\" at line %d "
+                    "of config file \"%s\"",
+                    key, val, line_num, conf->config_name);
+            goto end;
+        }
+    }
+    if (ferror (fp)) {
+        (void) snprintf (ebuf, ebuflen,
+                "Failed to read config file \"%s\"", conf->config_name);
+        goto end;
+    }
+    conf->nthreads = opts.nthreads;
+    conf->queue_len = opts.queue_len;
+    conf->listen_backlog = opts.listen_backlog;
+    conf->max_ttl = opts.max_ttl;
+    conf->log_priority = opts.log_priority;
+    rc = 0;
+
+end:
+    (void) fclose (fp);
+    return (rc);
+}
+
+
 void
 write_origin_addr (conf_t conf)
 {
@@ -749,6 +1146,17 @@ _conf_display_help (char *prog)
 
     printf ("\n");
 
+    printf ("  %*s %s\n", w, "--audit-file=PATH",
+            "Specify binary audit log of decoded credentials");
+
+    printf ("  %*s %s [%d]\n", w, "--audit-max-size=BYTES",
+            "Specify audit log size at which to rotate",
+            MUNGE_AUDIT_MAX_BYTES);
+
+    printf ("  %*s %s [%d]\n", w, "--audit-sync=MSECS",
+            "Specify msecs between audit log syncs",
+            MUNGE_AUDIT_SYNC_MSECS);
+
 #if defined(AUTH_METHOD_RECVFD_MKFIFO) || defined(AUTH_METHOD_RECVFD_MKNOD)
     printf ("  %*s %s [%s]\n", w, "--auth-server-dir=DIR",
             "Specify auth-server directory", MUNGE_AUTH_SERVER_DIR);
@@ -760,6 +1168,12 @@ _conf_display_help (char *prog)
     printf ("  %*s %s\n", w, "--benchmark",
             "Disable timers to reduce noise while benchmarking");
 
+    printf ("  %*s %s\n", w, "--config-file=PATH",
+            "Specify config file reread on SIGHUP");
+
+    printf ("  %*s %s\n", w, "--extra-socket=SPEC",
+            "Specify additional socket with its own defaults");
+
     printf ("  %*s Specify whether to check \"%s\" mtime [%d]\n",
             w, "--group-check-mtime=BOOL", GIDS_GROUP_FILE,
             MUNGE_GROUP_STAT_FLAG);
@@ -768,15 +1182,25 @@ _conf_display_help (char *prog)
             "Specify seconds between group info updates",
             MUNGE_GROUP_UPDATE_SECS);
 
+    printf ("  %*s %s [%d]\n", w, "--io-threads=INT",
+            "Specify number of I/O threads for staged pipeline",
+            MUNGE_IO_THREADS);
+
     printf ("  %*s %s [%s]\n", w, "--key-file=PATH",
             "Specify key file", MUNGE_KEYFILE_PATH);
 
     printf ("  %*s %s [%d]\n", w, "--listen-backlog=INT",
             "Specify listen backlog limit of socket", MUNGE_SOCKET_BACKLOG);
 
+    printf ("  %*s %s\n", w, "--lock-stats",
+            "Report lock contention statistics");
+
     printf ("  %*s %s [%s]\n", w, "--log-file=PATH",
             "Specify log file", MUNGE_LOGFILE_PATH);
 
+    printf ("  %*s %s\n", w, "--log-level=LEVEL",
+            "Specify log level (err/warning/notice/info/debug)");
+
     printf ("  %*s %s [%d]\n", w, "--max-ttl=SECS",
             "Specify maximum time-to-live (in seconds)", MUNGE_MAXIMUM_TTL);
 
@@ -789,15 +1213,49 @@ _conf_display_help (char *prog)
     printf ("  %*s %s [%s]\n", w, "--pid-file=PATH",
             "Specify PID file", MUNGE_PIDFILE_PATH);
 
+    printf ("  %*s %s [%d]\n", w, "--probe-interval=SECS",
+            "Specify seconds between latency probes",
+            MUNGE_PROBE_INTERVAL_SECS);
+
+    printf ("  %*s %s [%d]\n", w, "--probe-threshold=MSECS",
+            "Specify latency probe threshold (in msecs)",
+            MUNGE_PROBE_THRESHOLD_MSECS);
+
+    printf ("  %*s %s [%d]\n", w, "--queue-limit=INT",
+            "Specify max requests queued between stages",
+            MUNGE_STAGE_QUEUE_LEN);
+
+    printf ("  %*s %s [%d]\n", w, "--request-timeout=MSECS",
+            "Specify deadline for each request",
+            MUNGE_REQUEST_TIMEOUT_MSECS);
+
     printf ("  %*s %s [%s]\n", w, "--seed-file=PATH",
             "Specify PRNG seed file", MUNGE_SEEDFILE_PATH);
 
     printf ("  %*s %s\n", w, "--syslog",
             "Redirect log messages to syslog");
 
+    printf ("  %*s %s\n", w, "--trace-file=PATH",
+            "Specify binary trace of client requests for replay");
+
     printf ("  %*s %s\n", w, "--trusted-group=GID",
             "Specify trusted group/GID for directory checks");
 
+    printf ("  %*s %s\n", w, "--upgrade",
+            "Hand off socket to new daemon without downtime");
+
+    printf ("  %*s %s [%d]\n", w, "--usage-report-time=SECS",
+            "Specify seconds between client CPU usage reports",
+            MUNGE_USAGE_REPORT_SECS);
+
+    printf ("  %*s %s [%d]\n", w, "--zip-cache=INT",
+            "Specify number of compressed payloads to cache",
+            MUNGE_ZIP_CACHE_LEN);
+
+    printf ("  %*s %s [%d]\n", w, "--zip-threads=INT",
+            "Specify number of threads for chunked compression",
+            MUNGE_ZIP_THREADS);
+
     printf ("\n");
     return;
 }
@@ -887,6 +1345,69 @@ _conf_process_stop (conf_t conf)
 }
 
 
+static void
+_conf_process_upgrade (conf_t conf)
+{
+/*  Process the --upgrade option.
+ *  A SIGUSR2 is sent to the process holding the write-lock, causing it to
+ *    exec a new daemon and hand off its socket and state.  The upgrade is
+ *    complete once the lock is held by a different process.
+ */
+    pid_t           pid;
+    pid_t           new_pid;
+    struct timespec wait_abstime;
+    int             rv;
+
+    assert (conf != NULL);
+    assert (MUNGE_UPGRADE_WAIT_MSECS > 0);
+
+    /*  Obtain pid of daemon bound to socket.
+     */
+    pid = lock_query (conf);
+    if (pid <= 0) {
+        log_err (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to query socket lockfile \"%s\": %s (%s)",
+                conf->lockfile_name,
+                (pid == 0) ? "Lock not held" : strerror (errno),
+                "Cannot find running process");
+    }
+    rv = clock_get_timespec (&wait_abstime, MUNGE_UPGRADE_WAIT_MSECS);
+    if (rv < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to get wait time for upgrade");
+    }
+    if (kill (pid, SIGUSR2) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to signal daemon (pid %d, sig %d)", pid, SIGUSR2);
+    }
+    /*  Wait for the new daemon to take the lock.
+     */
+    while (1) {
+        new_pid = lock_query (conf);
+        if ((new_pid > 0) && (new_pid != pid)) {
+            break;
+        }
+        rv = clock_is_timespec_expired (&wait_abstime);
+        if (rv < 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to check if upgrade wait time has expired");
+        }
+        if (rv == 1) {
+            log_err (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to upgrade daemon bound to socket \"%s\" (pid %d)",
+                    conf->socket_name, pid);
+        }
+        _conf_sleep (MUNGE_SIGNAL_CHECK_MSECS);
+    }
+    if (conf->got_verbose) {
+        log_msg (LOG_NOTICE,
+                "Upgraded daemon bound to socket \"%s\" (pid %d -> pid %d)",
+                conf->socket_name, pid, new_pid);
+    }
+    exit (EXIT_SUCCESS);
+}
+
+
 static int
 _conf_send_signal (pid_t pid, int signum, int msecs)
 {
@@ -1090,3 +1611,109 @@ _conf_open_keyfile (const char *keyfile, int got_force)
     }
     return (fd);
 }
+
+
+static int
+_conf_parse_file_opt (struct conf_file_opts *opts,
+        const char *key, const char *val)
+{
+/*  Parses the config file setting [key] with value [val] into [opts].
+ *  The values are validated the same as their command-line counterparts.
+ *  Returns 0 on success, or -1 if [key] is unknown or [val] is invalid.
+ */
+    int i;
+
+    assert (opts != NULL);
+    assert (key != NULL);
+    assert (val != NULL);
+
+    if (strcmp (key, "num-threads") == 0) {
+        return (_conf_parse_int (val, 1, INT_MAX, &opts->nthreads));
+    }
+    if (strcmp (key, "queue-limit") == 0) {
+        return (_conf_parse_int (val, 1, INT_MAX, &opts->queue_len));
+    }
+    if (strcmp (key, "max-ttl") == 0) {
+        return (_conf_parse_int (val, 1, MUNGE_MAXIMUM_TTL, &opts->max_ttl));
+    }
+    if (strcmp (key, "listen-backlog") == 0) {
+        if (_conf_parse_int (val, -1, INT_MAX, &i) < 0) {
+            return (-1);
+        }
+        opts->listen_backlog = (i == 0) ? MUNGE_SOCKET_BACKLOG
+                             : (i == -1) ? SOMAXCONN : i;
+        return (0);
+    }
+    if (strcmp (key, "log-level") == 0) {
+        if ((i = _conf_parse_log_level (val)) < 0) {
+            return (-1);
+        }
+        opts->log_priority = i;
+        return (0);
+    }
+    return (-1);
+}
+
+
+static int
+_conf_parse_int (const char *s, long min, long max, int *ip)
+{
+/*  Parses the decimal integer string [s] into [ip] if it is within the
+ *    range [min, max].
+ *  Returns 0 on success, or -1 on error.
+ */
+    char *p;
+    long  l;
+
+    assert (s != NULL);
+    assert (ip != NULL);
+
+    errno = 0;
+    l = strtol (s, &p, 10);
+    if (((errno == ERANGE) && ((l == LONG_MIN) || (l == LONG_MAX)))
+            || (s == p) || (*p != '\0')
+            || (l < min) || (l > max)) {
+        return (-1);
+    }
+    *ip = (int) l;
+    return (0);
+}
+
+
+static int
+_conf_parse_log_level (const char *s)
+{
+/*  Returns the log priority for the log level name [s], or -1 if unknown.
+ */
+    int i;
+
+    assert (s != NULL);
+
+    for (i = 0; _conf_log_levels[i].name != NULL; i++) {
+        if (strcasecmp (s, _conf_log_levels[i].name) == 0) {
+            return (_conf_log_levels[i].priority);
+        }
+    }
+    return (-1);
+}
+
+
+static char *
+_conf_strip (char *s)
+{
+/*  Strips leading and trailing whitespace from the string [s] in place.
+ *  Returns a ptr to the first non-whitespace character.
+ */
+    char *p;
+
+    assert (s != NULL);
+
+    while (isspace ((unsigned char) *s)) {
+        s++;
+    }
+    p = s + strlen (s);
+    while ((p > s) && isspace ((unsigned char) p[-1])) {
+        *--p = '\0';
+    }
+    return (s);
+}
@@ -32,7 +32,9 @@
 #include <inttypes.h>
 #include <munge.h>
 #include <netinet/in.h>
+#include <sys/types.h>
 #include "gids.h"
+#include "listener.h"
 
 
 /*****************************************************************************
@@ -46,11 +48,13 @@ struct conf {
     unsigned        got_force:1;        /* flag for FORCE option             */
     unsigned        got_foreground:1;   /* flag for FOREGROUND option        */
     unsigned        got_group_stat:1;   /* flag for gids stat'ing /etc/group */
+    unsigned        got_lock_stats:1;   /* flag for lock contention profiling*/
     unsigned        got_stop:1;         /* flag for stopping daemon          */
     unsigned        got_mlockall:1;     /* flag for locking all memory pages */
     unsigned        got_root_auth:1;    /* flag if root can decode any cred  */
     unsigned        got_socket_retry:1; /* flag for allowing decode retries  */
     unsigned        got_syslog:1;       /* flag if logging to syslog instead */
+    unsigned        got_upgrade:1;      /* flag for upgrading running daemon */
     unsigned        got_verbose:1;      /* flag for being verbose            */
     munge_cipher_t  def_cipher;         /* default cipher type               */
     munge_zip_t     def_zip;            /* default compression type          */
@@ -58,10 +62,11 @@ struct conf {
     munge_ttl_t     def_ttl;            /* default time-to-live in seconds   */
     munge_ttl_t     max_ttl;            /* maximum time-to-live in seconds   */
     char           *cwd;                /* current working dir at startup    */
-    char           *config_name;        /* configuration filename            */
+    char           *config_name;        /* runtime config filename           */
     int             lockfile_fd;        /* daemon lockfile fd                */
     char           *lockfile_name;      /* daemon lockfile name              */
     char           *logfile_name;       /* daemon logfile name               */
+    int             log_priority;       /* log priority level if not -1      */
     char           *pidfile_name;       /* daemon pidfile name               */
     char           *socket_name;        /* unix domain socket filename       */
     int             listen_backlog;     /* unix domain socket listen backlog */
@@ -77,6 +82,20 @@ struct conf {
     gids_t          gids;               /* supplementary group information   */
     int             gids_update_secs;   /* gids update interval in seconds   */
     int             nthreads;           /* num threads for processing creds  */
+    int             io_threads;         /* num threads for staged req I/O    */
+    int             queue_len;          /* max reqs queued between stages    */
+    int             request_timeout_msecs; /* deadline per request in msecs  */
+    int             zip_threads;        /* num helper threads for chunked zip*/
+    int             zip_cache_len;      /* num compressed payloads to cache  */
+    listener_t      listeners;          /* additional listening sockets      */
+    int             upgrade_fd;         /* fd for taking over from old daemon*/
+    int             probe_interval_secs;/* latency probe interval in seconds */
+    int             probe_threshold_msecs; /* latency probe health threshold */
+    int             usage_report_secs;  /* CPU usage report interval in secs */
+    char           *audit_name;         /* audit log filename if enabled     */
+    long            audit_max_bytes;    /* audit log size at which to rotate */
+    int             audit_sync_msecs;   /* audit log sync interval in msecs  */
+    char           *trace_name;         /* request trace filename if enabled */
     char           *auth_server_dir;    /* dir in which to create auth pipe  */
     char           *auth_client_dir;    /* dir in which to create auth file  */
     int             auth_rnd_bytes;     /* num rnd bytes in auth pipe name   */
@@ -104,6 +123,8 @@ void parse_cmdline (conf_t conf, int argc, char **argv);
 
 void process_conf (conf_t conf);
 
+int read_conf_file (conf_t conf, char *ebuf, size_t ebuflen);
+
 void write_origin_addr (conf_t conf);
 
 void create_subkeys (conf_t conf);
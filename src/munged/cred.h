@@ -33,6 +33,7 @@
 #include <munge.h>
 #include "munge_defs.h"
 #include "m_msg.h"
+#include "suite.h"
 
 
 /*****************************************************************************
@@ -40,8 +41,18 @@
  *****************************************************************************/
 
 /*  Current version of the munge credential format.
+ *  Version 4 compresses only the payload data at the end of the "inner"
+ *    credential, leaving the per-credential fields that precede it (salt,
+ *    origin addr, encode time, etc.) uncompressed so the compressed payload
+ *    can be cached.  Since older daemons cannot decode it, version 4 is only
+ *    used for compressed credentials when the payload cache is enabled;
+ *    otherwise, credentials are encoded as version 3.
  */
-#define MUNGE_CRED_VERSION              3
+#define MUNGE_CRED_VERSION              4
+
+/*  Oldest version of the munge credential format that can be decoded.
+ */
+#define MUNGE_CRED_VERSION_MIN          3
 
 #define MAX_DEK                         MUNGE_MAXIMUM_MD_LEN
 #define MAX_IV                          MUNGE_MAXIMUM_BLK_LEN
@@ -56,6 +67,7 @@
 struct munge_cred {
     uint8_t             version;        /* version of the munge cred format  */
     m_msg_t             msg;            /* ptr to corresponding munge msg    */
+    suite_t             suite;          /* resolved cipher/mac suite         */
     int                 outer_mem_len;  /* length of outer credential memory */
     unsigned char      *outer_mem;      /* outer cred memory allocation      */
     int                 outer_len;      /* length of outer credential data   */
@@ -68,6 +80,7 @@ struct munge_cred {
     unsigned char      *realm_mem;      /* realm string memory allocation    */
     int                 salt_len;       /* length of salt data               */
     unsigned char       salt[MAX_SALT]; /* cryptographic seasoning salt      */
+    uint32_t            ttl;            /* cred ttl before max-ttl bound     */
     int                 mac_len;        /* length of mac data                */
     unsigned char       mac[MAX_MAC];   /* message authentication code       */
     int                 dek_len;        /* length of dek data                */
@@ -75,6 +88,7 @@ struct munge_cred {
     int                 iv_len;         /* length of iv data                 */
     unsigned char       iv[MAX_IV];     /* initialization vector             */
     unsigned char      *outer_zip_ref;  /* ref to zip_t in outer cred memory */
+    unsigned char      *outer_version_ref;  /* ref to version in outer mem   */
 };
 
 typedef struct munge_cred * munge_cred_t;
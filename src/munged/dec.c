@@ -37,6 +37,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include "audit.h"
 #include "auth_recv.h"
 #include "base64.h"
 #include "cipher.h"
@@ -45,6 +46,7 @@
 #include "crypto.h"
 #include "dec.h"
 #include "gids.h"
+#include "listener.h"
 #include "log.h"
 #include "m_msg.h"
 #include "mac.h"
@@ -52,6 +54,7 @@
 #include "random.h"
 #include "replay.h"
 #include "str.h"
+#include "suite.h"
 #include "zip.h"
 
 
@@ -82,7 +85,33 @@ int
 dec_process_msg (m_msg_t m)
 {
     munge_cred_t c = NULL;              /* aux data for processing this cred */
-    int          rc = -1;               /* return code                       */
+    int          rc;                    /* return code                       */
+
+    rc = dec_prepare (m, &c);
+    if (rc == 0) {
+        rc = dec_crypto (c);
+    }
+    if (rc == 0) {
+        rc = dec_replay (c);
+    }
+    return (dec_respond (m, c, rc));
+}
+
+
+/*  Performs the request-specific setup for decoding the message [m]:
+ *    validating the request, timestamping it, and authenticating the client.
+ *    This may block on the client socket depending on the authentication
+ *    method.
+ *  Sets [*pc] to the newly-created credential (which may be NULL on error).
+ *  Returns 0 on success, or -1 on error (with the msg error set).
+ */
+int
+dec_prepare (m_msg_t m, munge_cred_t *pc)
+{
+    munge_cred_t c = NULL;
+    int          rc = -1;
+
+    assert (pc != NULL);
 
     if (dec_validate_msg (m) < 0)
         ;
@@ -94,7 +123,28 @@ dec_process_msg (m_msg_t m)
         ;
     else if (dec_check_retry (c) < 0)
         ;
-    else if (dec_unarmor (c) < 0)
+    else /* success */
+        rc = 0;
+
+    *pc = c;
+    return (rc);
+}
+
+
+/*  Performs the CPU-bound portion of decoding the credential [c]:
+ *    unarmoring, decryption, MAC validation, decompression, and the
+ *    time & authorization checks.  The replay check is not performed here.
+ *  This does not perform any socket I/O.
+ *  Returns 0 on success, or -1 on error (with the msg error set).
+ */
+int
+dec_crypto (munge_cred_t c)
+{
+    int rc = -1;
+
+    assert (c != NULL);
+
+    if (dec_unarmor (c) < 0)
         ;
     else if (dec_unpack_outer (c) < 0)
         ;
@@ -110,11 +160,33 @@ dec_process_msg (m_msg_t m)
         ;
     else if (dec_validate_time (c) < 0)
         ;
-    else if (dec_validate_replay (c) < 0)
-        ;
     else /* success */
         rc = 0;
 
+    return (rc);
+}
+
+
+/*  Checks whether the successfully-decoded credential [c] has been replayed,
+ *    inserting it into the replay hash if not.
+ *  Returns 0 on success, or -1 on error (with the msg error set).
+ */
+int
+dec_replay (munge_cred_t c)
+{
+    assert (c != NULL);
+
+    return (dec_validate_replay (c));
+}
+
+
+/*  Sends the decode response for message [m] based on the result [rc] of
+ *    the preceding stages, and destroys the credential [c].
+ *  Returns 0 on success, or -1 on error.
+ */
+int
+dec_respond (m_msg_t m, munge_cred_t c, int rc)
+{
     /*  Since the same m_msg struct is used for both the request and response,
      *    the response message data must be sanitized for most errors.
      *  The exception to this is for a credential that has been successfully
@@ -137,11 +209,14 @@ dec_process_msg (m_msg_t m)
      *    be in error.
      */
     if (m_msg_send (m, MUNGE_MSG_DEC_RSP, 0) != EMUNGE_SUCCESS) {
-        if (rc == 0) {
+        if ((rc == 0) && !m->is_probe) {
             replay_remove (c);
         }
         rc = -1;
     }
+    else if ((rc == 0) && !m->is_probe) {
+        audit_record (c);
+    }
     cred_destroy (c);
     return (rc);
 }
@@ -205,6 +280,17 @@ dec_authenticate (munge_cred_t c)
         return (m_msg_set_err (m, EMUNGE_SNAFU,
             strdup ("Failed to determine client identity")));
     }
+    m->client_is_known = 1;
+
+    /*  Check the access policy of an additional listening socket.
+     */
+    if ((m->listener != NULL) && !listener_is_allowed (m->listener,
+            m->client_uid, m->client_gid)) {
+        return (m_msg_set_err (m, EMUNGE_SOCKET,
+            strdupf ("Access denied for UID=%u GID=%u on socket \"%s\"",
+            (unsigned int) m->client_uid, (unsigned int) m->client_gid,
+            m->listener->socket_name)));
+    }
     return (0);
 }
 
@@ -217,9 +303,10 @@ dec_check_retry (munge_cred_t c)
     m_msg_t  m = c->msg;
 
     if (m->retry > 0) {
-        log_msg (LOG_INFO,
-            "Decode retry #%d for client UID=%u GID=%u", m->retry,
-            (unsigned int) m->client_uid, (unsigned int) m->client_gid);
+        log_msg_limit (LOG_INFO,
+            "Decode retry #%d for client UID=%u GID=%u%s%s", m->retry,
+            (unsigned int) m->client_uid, (unsigned int) m->client_gid,
+            M_MSG_REQ_ID_ARGS (m));
     }
     if (m->retry > MUNGE_SOCKET_RETRY_ATTEMPTS) {
         return (m_msg_set_err (m, EMUNGE_SOCKET,
@@ -354,10 +441,9 @@ dec_unpack_outer (munge_cred_t c)
     len = c->outer_len;
     /*
      *  Unpack the credential version.
-     *  Note that only one version (ie, the latest) of the credential format
-     *    is currently supported.  Support for multiple versions would
-     *    require a switch on the version number to invoke the appropriate
-     *    unpack routine, but it doesn't really seem worth the effort.
+     *  Versions 3 and 4 of the credential format share the same layout and
+     *    differ only in which part of the "inner" data is compressed
+     *    (see dec_decompress()).
      */
     n = sizeof (c->version);
     assert (n == 1);
@@ -366,7 +452,8 @@ dec_unpack_outer (munge_cred_t c)
             strdup ("Truncated credential version")));
     }
     c->version = *p;
-    if (c->version != MUNGE_CRED_VERSION) {
+    if ((c->version < MUNGE_CRED_VERSION_MIN)
+            || (c->version > MUNGE_CRED_VERSION)) {
         return (m_msg_set_err (m, EMUNGE_BAD_VERSION,
             strdupf ("Invalid credential version %d", c->version)));
     }
@@ -382,21 +469,10 @@ dec_unpack_outer (munge_cred_t c)
             strdup ("Truncated cipher type")));
     }
     m->cipher = *p;
-    if (m->cipher == MUNGE_CIPHER_NONE) {
-        c->iv_len = 0;
-    }
-    else {
-        if (cipher_map_enum (m->cipher, NULL) < 0) {
-            return (m_msg_set_err (m, EMUNGE_BAD_CIPHER,
-                strdupf ("Invalid cipher type %d", m->cipher)));
-        }
-        c->iv_len = cipher_iv_size (m->cipher);
-        if (c->iv_len < 0) {
-            return (m_msg_set_err (m, EMUNGE_SNAFU,
-                strdupf ("Failed to determine IV length for cipher type %d",
-                m->cipher)));
-        }
-        assert (c->iv_len <= sizeof (c->iv));
+    if ((m->cipher != MUNGE_CIPHER_NONE)
+            && (cipher_map_enum (m->cipher, NULL) < 0)) {
+        return (m_msg_set_err (m, EMUNGE_BAD_CIPHER,
+            strdupf ("Invalid cipher type %d", m->cipher)));
     }
     p += n;
     len -= n;
@@ -414,25 +490,25 @@ dec_unpack_outer (munge_cred_t c)
         return (m_msg_set_err (m, EMUNGE_BAD_MAC,
             strdupf ("Invalid MAC type %d", m->mac)));
     }
-    c->mac_len = mac_size (m->mac);
-    if (c->mac_len <= 0) {
-        return (m_msg_set_err (m, EMUNGE_SNAFU,
-            strdupf ("Failed to determine digest length for MAC type %d",
-            m->mac)));
-    }
-    assert (c->mac_len <= sizeof (c->mac));
     p += n;
     len -= n;
     /*
      *  Validate the message authentication code type against the cipher type
      *    to ensure the HMAC will generate a DEK of sufficient length for the
-     *    cipher.
+     *    cipher.  This is resolved by the suite table at startup, which
+     *    also provides the IV and MAC lengths for this combination.
      */
-    if (mac_size (m->mac) < cipher_key_size (m->cipher)) {
+    c->suite = suite_get (m->cipher, m->mac);
+    if (!c->suite || !c->suite->is_valid) {
         return (m_msg_set_err (m, EMUNGE_BAD_MAC,
             strdupf ("Invalid MAC type %d with cipher type %d",
             m->mac, m->cipher)));
     }
+    c->iv_len = c->suite->iv_len;
+    assert (c->iv_len <= sizeof (c->iv));
+    c->mac_len = c->suite->mac_len;
+    assert (c->mac_len > 0);
+    assert (c->mac_len <= sizeof (c->mac));
     /*
      *  Unpack the compression type.
      */
@@ -530,9 +606,9 @@ dec_decrypt (munge_cred_t c)
 {
 /*  Decrypts the "inner" credential data.
  *
- *  Note that if cipher_final() fails, an error condition is set but an error
+ *  Note that if cipher_block() fails, an error condition is set but an error
  *    status is not returned (yet).  Here's why:
- *  cipher_final() will return an error code during decryption if padding is
+ *  cipher_block() will return an error code during decryption if padding is
  *    enabled and the final block is not correctly formatted.
  *  If block cipher padding errors are not treated the same as MAC verification
  *    errors, an attacker may be able to launch Vaudenay's attack on padding:
@@ -540,16 +616,13 @@ dec_decrypt (munge_cred_t c)
  *    - <http://lasecwww.epfl.ch/php_code/publications/search.php?ref=Vau02a>
  *    - <http://lasecwww.epfl.ch/memo_ssl.shtml>
  *    - <http://www.openssl.org/~bodo/tls-cbc.txt>
- *  Consequently, if cipher_final() returns a failure, the error condition is
+ *  Consequently, if cipher_block() returns a failure, the error condition is
  *    set here and the MAC computation in dec_validate_mac() is performed
  *    regardless in order to minimize information leaked via timing.
  */
     m_msg_t           m = c->msg;
     int               buf_len;          /* length of plaintext buffer        */
     unsigned char    *buf;              /* plaintext buffer                  */
-    unsigned char    *buf_ptr;          /* ptr into plaintext buffer         */
-    cipher_ctx        x;                /* cipher context                    */
-    int               n_written;        /* number of bytes written to buf    */
     int               n;                /* all-purpose int                   */
 
     /*  Is this credential encrypted?
@@ -560,12 +633,8 @@ dec_decrypt (munge_cred_t c)
     /*  Compute DEK.
      *  msg-dek = MAC (msg-mac) using DEK subkey
      */
-    c->dek_len = mac_size (m->mac);
-    if (c->dek_len <= 0) {
-        return (m_msg_set_err (m, EMUNGE_SNAFU,
-            strdupf ("Failed to determine DEK key length for MAC type %d",
-                m->mac)));
-    }
+    c->dek_len = c->suite->mac_len;
+    assert (c->dek_len > 0);
     assert (c->dek_len <= sizeof (c->dek));
 
     n = c->dek_len;
@@ -575,45 +644,31 @@ dec_decrypt (munge_cred_t c)
             strdup ("Failed to compute DEK")));
     }
     assert (n <= c->dek_len);
-    assert (n >= cipher_key_size (m->cipher));
+    assert (n >= c->suite->key_len);
 
     /*  Allocate memory for plaintext.
      *  Ensure enough space by allocating an additional cipher block.
      */
-    n = cipher_block_size (m->cipher);
-    if (n <= 0) {
-        return (m_msg_set_err (m, EMUNGE_SNAFU,
-            strdupf ("Failed to determine block size for cipher type %d",
-                m->cipher)));
-    }
-    buf_len = c->inner_len + n;
+    assert (c->suite->blk_len > 0);
+    buf_len = c->inner_len + c->suite->blk_len;
     if (!(buf = malloc (buf_len))) {
         return (m_msg_set_err (m, EMUNGE_NO_MEMORY, NULL));
     }
     /*  Decrypt "inner" data.
      */
-    if (cipher_init (&x, m->cipher, c->dek, c->iv, CIPHER_DECRYPT) < 0) {
-        goto err;
-    }
-    buf_ptr = buf;
-    n_written = 0;
     n = buf_len;
-    if (cipher_update (&x, buf_ptr, &n, c->inner, c->inner_len) < 0) {
-        goto err_cleanup;
-    }
-    buf_ptr += n;
-    n_written += n;
-    n = buf_len - n_written;
-    if (cipher_final (&x, buf_ptr, &n) < 0) {
-        /*  Set but defer error until dec_validate_mac().  */
+    if (cipher_block (m->cipher, c->dek, c->iv, CIPHER_DECRYPT,
+            buf, &n, c->inner, c->inner_len) < 0) {
+        /*  Set but defer error until dec_validate_mac().
+         *  The MAC is still computed over a zeroed plaintext of the same
+         *    length as the ciphertext to minimize information leaked via
+         *    timing.
+         */
         m_msg_set_err (m, EMUNGE_CRED_INVALID, NULL);
+        memset (buf, 0, buf_len);
+        n = c->inner_len;
     }
-    buf_ptr += n;
-    n_written += n;
-    if (cipher_cleanup (&x) < 0) {
-        goto err;
-    }
-    assert (n_written <= buf_len);
+    assert (n <= buf_len);
 
     /*  Replace "inner" ciphertext with plaintext.
      */
@@ -622,16 +677,8 @@ dec_decrypt (munge_cred_t c)
     c->inner_mem = buf;
     c->inner_mem_len = buf_len;
     c->inner = buf;
-    c->inner_len = n_written;
+    c->inner_len = n;
     return (0);
-
-err_cleanup:
-    cipher_cleanup (&x);
-err:
-    memset (buf, 0, buf_len);
-    free (buf);
-    return (m_msg_set_err (m, EMUNGE_SNAFU,
-        strdup ("Failed to decrypt credential")));
 }
 
 
@@ -691,10 +738,15 @@ static int
 dec_decompress (munge_cred_t c)
 {
 /*  Decompresses the "inner" credential data.
+ *  A version 3 credential compresses all of the "inner" data, whereas a
+ *    version 4 credential compresses only the payload data following the
+ *    fixed fields: salt, ip addr len, origin ip addr, encode time, ttl,
+ *    uid, gid, uid restriction, gid restriction, and data length.
  */
     m_msg_t        m = c->msg;
     unsigned char *buf;                 /* decompression buffer              */
     int            buf_len;             /* length of decompression buffer    */
+    int            hdr_len;             /* length of uncompressed fields     */
     int            n;                   /* length of decompressed data       */
 
     /*  Is this credential compressed?
@@ -706,24 +758,51 @@ dec_decompress (munge_cred_t c)
      */
     assert (zip_is_valid_type (m->zip));
     /*
-     *  Allocate memory for decompressed "inner" data.
+     *  Locate the start of the compressed data.
+     *  The MAC has already been validated, so the origin IP addr length can
+     *    be trusted here; it is validated by dec_unpack_inner().
      */
-    buf = NULL;
-    buf_len = zip_decompress_length (m->zip, c->inner, c->inner_len);
-    if (buf_len <= 0) {
+    hdr_len = 0;
+    if (c->version > MUNGE_CRED_VERSION_MIN) {
+        hdr_len = MUNGE_CRED_SALT_LEN + sizeof (m->addr_len);
+        if (hdr_len > c->inner_len) {
+            return (m_msg_set_err (m, EMUNGE_BAD_CRED,
+                strdup ("Truncated origin IP addr length")));
+        }
+        hdr_len += c->inner[MUNGE_CRED_SALT_LEN];
+        hdr_len += sizeof (m->time0);
+        hdr_len += sizeof (m->ttl);
+        hdr_len += sizeof (m->cred_uid);
+        hdr_len += sizeof (m->cred_gid);
+        hdr_len += sizeof (m->auth_uid);
+        hdr_len += sizeof (m->auth_gid);
+        hdr_len += sizeof (m->data_len);
+        if (hdr_len > c->inner_len) {
+            return (m_msg_set_err (m, EMUNGE_BAD_CRED,
+                strdup ("Truncated data length")));
+        }
+    }
+    /*  Allocate memory for decompressed "inner" data.
+     */
+    n = zip_decompress_length (m->zip,
+            c->inner + hdr_len, c->inner_len - hdr_len);
+    if (n <= 0) {
         goto err;
     }
+    buf_len = hdr_len + n;
     if (!(buf = malloc (buf_len))) {
-        m_msg_set_err (m, EMUNGE_NO_MEMORY, NULL);
-        goto err;
+        return (m_msg_set_err (m, EMUNGE_NO_MEMORY, NULL));
     }
-    /*  Decompress "inner" data.
+    /*  Decompress "inner" data, copying the uncompressed fields (if any).
      */
-    n = buf_len;
-    if (zip_decompress_block (m->zip, buf, &n, c->inner, c->inner_len) < 0) {
+    memcpy (buf, c->inner, hdr_len);
+    if (zip_decompress_block (m->zip, buf + hdr_len, &n,
+            c->inner + hdr_len, c->inner_len - hdr_len) < 0) {
+        memset (buf, 0, buf_len);
+        free (buf);
         return (m_msg_set_err (m, EMUNGE_CRED_INVALID, NULL));
     }
-    assert (n == buf_len);
+    assert (hdr_len + n == buf_len);
     /*
      *  Replace compressed data with "inner" data.
      */
@@ -735,7 +814,7 @@ dec_decompress (munge_cred_t c)
     c->inner_mem = buf;
     c->inner_mem_len = buf_len;
     c->inner = buf;
-    c->inner_len = n;
+    c->inner_len = buf_len;
     return (0);
 
 err:
@@ -844,6 +923,7 @@ dec_unpack_inner (munge_cred_t c)
     }
     memcpy (&u, p, n);                  /* ensure proper byte-alignment */
     m->ttl = ntohl (u);
+    c->ttl = m->ttl;
     p += n;
     len -= n;
     /*
@@ -914,7 +994,7 @@ dec_unpack_inner (munge_cred_t c)
     /*
      *  Unpack the auxiliary data (if present).
      *  The 'data' memory is owned by the cred struct, so it will be
-     *    free()d by cred_destroy() called from dec_process_msg().
+     *    free()d by cred_destroy() called from dec_respond().
      */
     if (m->data_len > 0) {
         if (m->data_len > len) {
@@ -1008,6 +1088,12 @@ dec_validate_replay (munge_cred_t c)
     m_msg_t  m = c->msg;
     int      rc;
 
+    /*  Credentials decoded by the internal latency probe are never seen by
+     *    clients, so they are not inserted into the replay hash.
+     */
+    if (m->is_probe) {
+        return (0);
+    }
     rc = replay_insert (c);
 
     if (rc == 0) {
@@ -1017,9 +1103,10 @@ dec_validate_replay (munge_cred_t c)
         if ((conf->got_socket_retry)
                 && (m->retry > 0)
                 && (m->retry <= MUNGE_SOCKET_RETRY_ATTEMPTS)) {
-            log_msg (LOG_INFO,
-                "Allowed credential replay for client UID=%u GID=%u",
-                (unsigned int) m->client_uid, (unsigned int) m->client_gid);
+            log_msg_limit (LOG_INFO,
+                "Allowed credential replay for client UID=%u GID=%u%s%s",
+                (unsigned int) m->client_uid, (unsigned int) m->client_gid,
+                M_MSG_REQ_ID_ARGS (m));
             return (0);
         }
         else {
@@ -29,10 +29,19 @@
 #define MUNGE_DEC_H
 
 
+#include "cred.h"
 #include "m_msg.h"
 
 
 int dec_process_msg (m_msg_t m);
 
+int dec_prepare (m_msg_t m, munge_cred_t *pc);
+
+int dec_crypto (munge_cred_t c);
+
+int dec_replay (munge_cred_t c);
+
+int dec_respond (m_msg_t m, munge_cred_t c, int rc);
+
 
 #endif /* !MUNGE_DEC_H */
@@ -30,6 +30,7 @@
 #endif /* HAVE_CONFIG_H */
 
 #include <assert.h>
+#include <errno.h>
 #include <sys/types.h>                  /* include before in.h for bsd */
 #include <netinet/in.h>
 #include <stdlib.h>
@@ -41,12 +42,15 @@
 #include "conf.h"
 #include "cred.h"
 #include "enc.h"
+#include "listener.h"
 #include "log.h"
 #include "m_msg.h"
 #include "mac.h"
 #include "munge_defs.h"
 #include "random.h"
 #include "str.h"
+#include "suite.h"
+#include "zcache.h"
 #include "zip.h"
 
 
@@ -76,7 +80,30 @@ int
 enc_process_msg (m_msg_t m)
 {
     munge_cred_t c = NULL;              /* aux data for processing this cred */
-    int          rc = -1;               /* return code                       */
+    int          rc;                    /* return code                       */
+
+    rc = enc_prepare (m, &c);
+    if (rc == 0) {
+        rc = enc_crypto (c);
+    }
+    return (enc_respond (m, c, rc));
+}
+
+
+/*  Performs the request-specific setup for encoding the message [m]:
+ *    validating the request, authenticating the client, and timestamping
+ *    the credential.  This may block on the client socket depending on the
+ *    authentication method.
+ *  Sets [*pc] to the newly-created credential (which may be NULL on error).
+ *  Returns 0 on success, or -1 on error (with the msg error set).
+ */
+int
+enc_prepare (m_msg_t m, munge_cred_t *pc)
+{
+    munge_cred_t c = NULL;
+    int          rc = -1;
+
+    assert (pc != NULL);
 
     if (enc_validate_msg (m) < 0)
         ;
@@ -90,7 +117,27 @@ enc_process_msg (m_msg_t m)
         ;
     else if (enc_timestamp (c) < 0)
         ;
-    else if (enc_pack_outer (c) < 0)
+    else /* success */
+        rc = 0;
+
+    *pc = c;
+    return (rc);
+}
+
+
+/*  Performs the CPU-bound portion of encoding the credential [c]:
+ *    packing, compression, MAC, encryption, and armoring.
+ *  This does not perform any socket I/O.
+ *  Returns 0 on success, or -1 on error (with the msg error set).
+ */
+int
+enc_crypto (munge_cred_t c)
+{
+    int rc = -1;
+
+    assert (c != NULL);
+
+    if (enc_pack_outer (c) < 0)
         ;
     else if (enc_pack_inner (c) < 0)
         ;
@@ -107,6 +154,17 @@ enc_process_msg (m_msg_t m)
     else /* success */
         rc = 0;
 
+    return (rc);
+}
+
+
+/*  Sends the encode response for message [m] based on the result [rc] of
+ *    the preceding stages, and destroys the credential [c].
+ *  Returns 0 on success, or -1 on error.
+ */
+int
+enc_respond (m_msg_t m, munge_cred_t c, int rc)
+{
     /*  Since the same m_msg struct is used for both the request and response,
      *    the response message data must be sanitized for most errors.
      */
@@ -129,14 +187,18 @@ static int
 enc_validate_msg (m_msg_t m)
 {
 /*  Validates message types, setting defaults and limits as needed.
+ *  Requests accepted on an additional listening socket use its defaults.
  */
+    const struct listener *l = m->listener;
+    suite_t                s;
+
     assert (m != NULL);
     assert (m->type == MUNGE_MSG_ENC_REQ);
 
     /*  Validate cipher type.
      */
     if (m->cipher == MUNGE_CIPHER_DEFAULT) {
-        m->cipher = conf->def_cipher;
+        m->cipher = (l != NULL) ? l->def_cipher : conf->def_cipher;
     }
     else if (m->cipher == MUNGE_CIPHER_NONE) {
         ; /* disable encryption */
@@ -149,7 +211,7 @@ enc_validate_msg (m_msg_t m)
      *  Note that MUNGE_MAC_NONE is not valid -- MACs are REQUIRED!
      */
     if (m->mac == MUNGE_MAC_DEFAULT) {
-        m->mac = conf->def_mac;
+        m->mac = (l != NULL) ? l->def_mac : conf->def_mac;
     }
     else if (mac_map_enum (m->mac, NULL) < 0) {
         return (m_msg_set_err (m, EMUNGE_BAD_MAC,
@@ -159,9 +221,10 @@ enc_validate_msg (m_msg_t m)
     /*
      *  Validate the message authentication code type against the cipher type
      *    to ensure the HMAC will generate a DEK of sufficient length for the
-     *    cipher.
+     *    cipher.  This is resolved by the suite table at startup.
      */
-    if (mac_size (m->mac) < cipher_key_size (m->cipher)) {
+    s = suite_get (m->cipher, m->mac);
+    if (!s || !s->is_valid) {
         return (m_msg_set_err (m, EMUNGE_BAD_MAC,
             strdupf ("Invalid MAC type %d with cipher type %d",
             m->mac, m->cipher)));
@@ -170,7 +233,7 @@ enc_validate_msg (m_msg_t m)
      *  Disable compression if no optional data was specified.
      */
     if (m->zip == MUNGE_ZIP_DEFAULT) {
-        m->zip = conf->def_zip;
+        m->zip = (l != NULL) ? l->def_zip : conf->def_zip;
     }
     else if (m->zip == MUNGE_ZIP_NONE) {
         ; /* disable compression */
@@ -193,7 +256,7 @@ enc_validate_msg (m_msg_t m)
      *    state to be flushed from the replay hash at some point.
      */
     if (m->ttl == 0) {
-        m->ttl = conf->def_ttl;
+        m->ttl = (l != NULL) ? l->def_ttl : conf->def_ttl;
     }
     else if (m->ttl > conf->max_ttl) {
         m->ttl = conf->max_ttl;
@@ -209,27 +272,30 @@ enc_init (munge_cred_t c)
  */
     m_msg_t  m = c->msg;
 
+    /*  Set the credential version (see enc_compress()).
+     */
+    c->version = ((m->zip != MUNGE_ZIP_NONE) && (conf->zip_cache_len > 0))
+        ? MUNGE_CRED_VERSION : MUNGE_CRED_VERSION_MIN;
+
     /*  Generate salt.
      */
     c->salt_len = MUNGE_CRED_SALT_LEN;
     random_pseudo_bytes (c->salt, c->salt_len);
 
-    /*  Generate cipher initialization vector (if needed).
+    /*  Resolve the cipher/mac suite (validated by enc_validate_msg()).
      */
-    if (m->cipher == MUNGE_CIPHER_NONE) {
-        c->iv_len = 0;
+    c->suite = suite_get (m->cipher, m->mac);
+    if (!c->suite || !c->suite->is_valid) {
+        return (m_msg_set_err (m, EMUNGE_SNAFU,
+            strdupf ("Failed to resolve suite for cipher type %d MAC type %d",
+            m->cipher, m->mac)));
     }
-    else {
-        c->iv_len = cipher_iv_size (m->cipher);
-        if (c->iv_len < 0) {
-            return (m_msg_set_err (m, EMUNGE_SNAFU,
-                strdupf ("Failed to determine IV length for cipher type %d",
-                m->cipher)));
-        }
-        if (c->iv_len > 0) {
-            assert (c->iv_len <= sizeof (c->iv));
-            random_pseudo_bytes (c->iv, c->iv_len);
-        }
+    /*  Generate cipher initialization vector (if needed).
+     */
+    c->iv_len = c->suite->iv_len;
+    if (c->iv_len > 0) {
+        assert (c->iv_len <= sizeof (c->iv));
+        random_pseudo_bytes (c->iv, c->iv_len);
     }
     return (0);
 }
@@ -253,6 +319,17 @@ enc_authenticate (munge_cred_t c)
         return (m_msg_set_err (m, EMUNGE_SNAFU,
             strdup ("Failed to determine client identity")));
     }
+    m->client_is_known = 1;
+
+    /*  Check the access policy of an additional listening socket.
+     */
+    if ((m->listener != NULL) && !listener_is_allowed (m->listener,
+            m->client_uid, m->client_gid)) {
+        return (m_msg_set_err (m, EMUNGE_SOCKET,
+            strdupf ("Access denied for UID=%u GID=%u on socket \"%s\"",
+            (unsigned int) m->client_uid, (unsigned int) m->client_gid,
+            m->listener->socket_name)));
+    }
     return (0);
 }
 
@@ -265,9 +342,10 @@ enc_check_retry (munge_cred_t c)
     m_msg_t  m = c->msg;
 
     if (m->retry > 0) {
-        log_msg (LOG_INFO,
-            "Encode retry #%d for client UID=%u GID=%u", m->retry,
-            (unsigned int) m->client_uid, (unsigned int) m->client_gid);
+        log_msg_limit (LOG_INFO,
+            "Encode retry #%d for client UID=%u GID=%u%s%s", m->retry,
+            (unsigned int) m->client_uid, (unsigned int) m->client_gid,
+            M_MSG_REQ_ID_ARGS (m));
     }
     if (m->retry > MUNGE_SOCKET_RETRY_ATTEMPTS) {
         return (m_msg_set_err (m, EMUNGE_SOCKET,
@@ -326,6 +404,7 @@ enc_pack_outer (munge_cred_t c)
     c->outer_len = c->outer_mem_len;
 
     assert (sizeof (c->version) == 1);
+    c->outer_version_ref = p;
     *p = c->version;
     p += sizeof (c->version);
 
@@ -451,49 +530,63 @@ static int
 enc_compress (munge_cred_t c)
 {
 /*  Compresses the "inner" credential data.
+ *  For a version 4 credential, only the payload data at the end of the
+ *    "inner" data is compressed.  The fields preceding it differ for every
+ *    credential and are left uncompressed, allowing the compressed payload
+ *    to be reused from the cache for subsequent credentials.
  *  If the compressed data is larger than the original data, the
  *    compressed buffer is discarded and compression is disabled.
- *    This requires resetting the compression type in the credential's
- *    "outer" data header.  And since that field is included in the MAC,
- *    compression must be attempted before the MAC is computed.
+ *    This requires resetting the compression type and credential version
+ *    in the credential's "outer" data header.  And since those fields are
+ *    included in the MAC, compression must be attempted before the MAC is
+ *    computed.
  */
     m_msg_t        m = c->msg;
-    unsigned char *buf;                 /* compression buffer                */
-    int            buf_len;             /* length of compression buffer      */
-    int            n;                   /* length of compressed data         */
+    unsigned char *zbuf = NULL;         /* compressed payload data           */
+    int            zbuf_len = 0;        /* length of compressed payload data */
+    unsigned char *buf;                 /* new "inner" data buffer           */
+    int            buf_len;             /* length of new "inner" data buffer */
+    int            hdr_len;             /* length of uncompressed fields     */
 
     /*  Is compression disabled?
      */
     if (m->zip == MUNGE_ZIP_NONE) {
         return (0);
     }
-    /*  Allocate memory for compressed "inner" data.
-     */
-    buf = NULL;
-    buf_len = zip_compress_length (m->zip, c->inner, c->inner_len);
-    if (buf_len < 0) {
-        goto err;
-    }
-    if (!(buf = malloc (buf_len))) {
-        m_msg_set_err (m, EMUNGE_NO_MEMORY, NULL);
-        goto err;
-    }
+    assert (m->data_len > 0);
+    assert (c->inner_len > m->data_len);
+    hdr_len = (c->version > MUNGE_CRED_VERSION_MIN)
+        ? c->inner_len - m->data_len : 0;
+
     /*  Compress "inner" data.
      */
-    n = buf_len;
-    if (zip_compress_block (m->zip, buf, &n, c->inner, c->inner_len) < 0) {
-        goto err;
+    if (zcache_compress (m->zip, m->client_uid, (void **) &zbuf, &zbuf_len,
+            c->inner + hdr_len, c->inner_len - hdr_len) < 0) {
+        if (errno == ENOMEM) {
+            return (m_msg_set_err (m, EMUNGE_NO_MEMORY, NULL));
+        }
+        return (m_msg_set_err (m, EMUNGE_SNAFU,
+            strdup ("Failed to compress credential")));
     }
     /*  Disable compression and discard compressed data if it's larger.
      *    Replace "inner" data with compressed data if it's not.
      */
-    if (n >= c->inner_len) {
+    if (zbuf_len >= c->inner_len - hdr_len) {
         m->zip = MUNGE_ZIP_NONE;
         *c->outer_zip_ref = m->zip;
-        memset (buf, 0, buf_len);
-        free (buf);
+        c->version = MUNGE_CRED_VERSION_MIN;
+        *c->outer_version_ref = c->version;
     }
     else {
+        buf_len = hdr_len + zbuf_len;
+        if (!(buf = malloc (buf_len))) {
+            memset (zbuf, 0, zbuf_len);
+            free (zbuf);
+            return (m_msg_set_err (m, EMUNGE_NO_MEMORY, NULL));
+        }
+        memcpy (buf, c->inner, hdr_len);
+        memcpy (buf + hdr_len, zbuf, zbuf_len);
+
         assert (c->inner_mem_len > 0);
         memset (c->inner_mem, 0, c->inner_mem_len);
         free (c->inner_mem);
@@ -501,17 +594,11 @@ enc_compress (munge_cred_t c)
         c->inner_mem = buf;
         c->inner_mem_len = buf_len;
         c->inner = buf;
-        c->inner_len = n;
+        c->inner_len = buf_len;
     }
+    memset (zbuf, 0, zbuf_len);
+    free (zbuf);
     return (0);
-
-err:
-    if ((buf_len > 0) && (buf != NULL)) {
-        memset (buf, 0, buf_len);
-        free (buf);
-    }
-    return (m_msg_set_err (m, EMUNGE_SNAFU,
-        strdup ("Failed to compress credential")));
 }
 
 
@@ -527,12 +614,8 @@ enc_mac (munge_cred_t c)
 
     /*  Init MAC.
      */
-    c->mac_len = mac_size (m->mac);
-    if (c->mac_len <= 0) {
-        return (m_msg_set_err (m, EMUNGE_SNAFU,
-            strdupf ("Failed to determine digest length for MAC type %d",
-                m->mac)));
-    }
+    c->mac_len = c->suite->mac_len;
+    assert (c->mac_len > 0);
     assert (c->mac_len <= sizeof (c->mac));
     memset (c->mac, 0, c->mac_len);
 
@@ -573,9 +656,6 @@ enc_encrypt (munge_cred_t c)
     m_msg_t           m = c->msg;
     int               buf_len;          /* length of ciphertext buffer       */
     unsigned char    *buf;              /* ciphertext buffer                 */
-    unsigned char    *buf_ptr;          /* ptr into ciphertext buffer        */
-    cipher_ctx        x;                /* cipher context                    */
-    int               n_written;        /* number of bytes written to buf    */
     int               n;                /* all-purpose int                   */
 
     /*  Is encryption disabled?
@@ -586,12 +666,8 @@ enc_encrypt (munge_cred_t c)
     /*  Compute DEK.
      *  msg-dek = MAC (msg-mac) using DEK subkey
      */
-    c->dek_len = mac_size (m->mac);
-    if (c->dek_len <= 0) {
-        return (m_msg_set_err (m, EMUNGE_SNAFU,
-            strdupf ("Failed to determine DEK key length for MAC type %d",
-                m->mac)));
-    }
+    c->dek_len = c->suite->mac_len;
+    assert (c->dek_len > 0);
     assert (c->dek_len <= sizeof (c->dek));
 
     n = c->dek_len;
@@ -601,44 +677,24 @@ enc_encrypt (munge_cred_t c)
             strdup ("Failed to compute DEK")));
     }
     assert (n <= c->dek_len);
-    assert (n >= cipher_key_size (m->cipher));
+    assert (n >= c->suite->key_len);
 
     /*  Allocate memory for ciphertext.
      *  Ensure enough space by allocating an additional cipher block.
      */
-    n = cipher_block_size (m->cipher);
-    if (n <= 0) {
-        return (m_msg_set_err (m, EMUNGE_SNAFU,
-            strdupf ("Failed to determine block size for cipher type %d",
-                m->cipher)));
-    }
-    buf_len = c->inner_len + n;
+    assert (c->suite->blk_len > 0);
+    buf_len = c->inner_len + c->suite->blk_len;
     if (!(buf = malloc (buf_len))) {
         return (m_msg_set_err (m, EMUNGE_NO_MEMORY, NULL));
     }
     /*  Encrypt "inner" data.
      */
-    if (cipher_init (&x, m->cipher, c->dek, c->iv, CIPHER_ENCRYPT) < 0) {
-        goto err;
-    }
-    buf_ptr = buf;
-    n_written = 0;
     n = buf_len;
-    if (cipher_update (&x, buf_ptr, &n, c->inner, c->inner_len) < 0) {
-        goto err_cleanup;
-    }
-    buf_ptr += n;
-    n_written += n;
-    n = buf_len - n_written;
-    if (cipher_final (&x, buf_ptr, &n) < 0) {
-        goto err_cleanup;
-    }
-    buf_ptr += n;
-    n_written += n;
-    if (cipher_cleanup (&x) < 0) {
+    if (cipher_block (m->cipher, c->dek, c->iv, CIPHER_ENCRYPT,
+            buf, &n, c->inner, c->inner_len) < 0) {
         goto err;
     }
-    assert (n_written <= buf_len);
+    assert (n <= buf_len);
 
     /*  Replace "inner" plaintext with ciphertext.
      */
@@ -649,11 +705,9 @@ enc_encrypt (munge_cred_t c)
     c->inner_mem = buf;
     c->inner_mem_len = buf_len;
     c->inner = buf;
-    c->inner_len = n_written;
+    c->inner_len = n;
     return (0);
 
-err_cleanup:
-    cipher_cleanup (&x);
 err:
     memset (buf, 0, buf_len);
     free (buf);
@@ -772,7 +826,7 @@ enc_fini (munge_cred_t c)
     }
     /*  Place credential in message "data" payload for transit.
      *  This memory is still owned by the cred struct, so it will be
-     *    free()d by cred_destroy() called from enc_process_msg().
+     *    free()d by cred_destroy() called from enc_respond().
      */
     m->data = c->outer;
     m->data_len = c->outer_len;
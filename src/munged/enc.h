@@ -29,10 +29,17 @@
 #define MUNGE_ENC_H
 
 
+#include "cred.h"
 #include "m_msg.h"
 
 
 int enc_process_msg (m_msg_t m);
 
+int enc_prepare (m_msg_t m, munge_cred_t *pc);
+
+int enc_crypto (munge_cred_t c);
+
+int enc_respond (m_msg_t m, munge_cred_t c, int rc);
+
 
 #endif /* !MUNGE_ENC_H */
@@ -34,6 +34,7 @@
 #include <sys/types.h>                  /* include before grp.h for bsd */
 #include <assert.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stddef.h>
 #include <stdlib.h>
@@ -41,10 +42,12 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <munge.h>
+#include "clock.h"
 #include "common.h"
 #include "conf.h"
 #include "gids.h"
 #include "hash.h"
+#include "lockprof.h"
 #include "log.h"
 #include "munge_defs.h"
 #include "timer.h"
@@ -132,6 +135,12 @@ typedef struct uid_node * uid_node_p;
 typedef struct gid_node * gid_node_p;
 typedef struct gid_head * gid_head_p;
 
+struct gids_pack {
+    uint32_t           *buf;            /* buffer of packed gid_head objects */
+    size_t              len;            /* number of uint32s used in buffer  */
+    size_t              max;            /* number of uint32s allocated       */
+};
+
 
 /*****************************************************************************
  *  Prototypes
@@ -151,6 +160,8 @@ static void         _gids_gid_head_destroy (gid_head_p g);
 static int          _gids_gid_head_cmp (
                         const uid_t *uid1p, const uid_t *uid2p);
 static unsigned int _gids_gid_head_key (uid_t *uidp);
+static int          _gids_gid_head_pack (gid_head_p g, const uid_t *uidp,
+                        struct gids_pack *p);
 static gid_node_p   _gids_gid_node_create (gid_t gid);
 static uid_node_p   _gids_uid_node_create (const char *user, uid_t uid);
 static void         _gids_uid_node_destroy (uid_node_p u);
@@ -168,6 +179,15 @@ static void         _gids_ghost_node_dump (const char *data, const char *user,
 #endif /* _GIDS_DEBUG */
 
 
+/*****************************************************************************
+ *  Private Variables
+ *****************************************************************************/
+
+/*  Lock site for the mutex of the GIDs mapping.
+ */
+static lockprof_site_t _gids_site = LOCKPROF_SITE_INITIALIZER ("gids");
+
+
 /*****************************************************************************
  *  Public Functions
  *****************************************************************************/
@@ -232,7 +252,7 @@ gids_destroy (gids_t gids)
     if (!gids) {
         return;
     }
-    if ((errno = pthread_mutex_lock (&gids->mutex)) != 0) {
+    if ((errno = lockprof_mutex_lock (&gids->mutex, &_gids_site)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock gids mutex");
     }
     if (gids->timer > 0) {
@@ -264,7 +284,7 @@ gids_update (gids_t gids)
     if (!gids) {
         return;
     }
-    if ((errno = pthread_mutex_lock (&gids->mutex)) != 0) {
+    if ((errno = lockprof_mutex_lock (&gids->mutex, &_gids_site)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock gids mutex");
     }
     /*  Cancel a pending update before scheduling a new one.
@@ -303,7 +323,7 @@ gids_is_member (gids_t gids, uid_t uid, gid_t gid)
     if (!gids) {
         return (0);
     }
-    if ((errno = pthread_mutex_lock (&gids->mutex)) != 0) {
+    if ((errno = lockprof_mutex_lock (&gids->mutex, &_gids_site)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock gids mutex");
     }
     if ((gids->gid_hash) && (g = hash_find (gids->gid_hash, &uid))) {
@@ -322,6 +342,144 @@ gids_is_member (gids_t gids, uid_t uid, gid_t gid)
 }
 
 
+/*  Packs the GIDs mapping [gids] into a newly-allocated buffer in order to
+ *    hand it off to another munged process on this host.  Each UID is packed
+ *    as a sequence of 32-bit integers:  the UID, the number of GIDs, and the
+ *    GIDs themselves.  The caller is responsible for free()ing the buffer.
+ *  Sets [*bufp] and [*lenp] to the buffer and its length in bytes.
+ *  Returns the number of UIDs packed, or -1 on error with errno set.
+ */
+int
+gids_pack (gids_t gids, void **bufp, size_t *lenp)
+{
+    struct gids_pack p;
+    int              n = 0;
+
+    if ((bufp == NULL) || (lenp == NULL)) {
+        errno = EINVAL;
+        return (-1);
+    }
+    *bufp = NULL;
+    *lenp = 0;
+
+    if (!gids) {
+        return (0);
+    }
+    if ((errno = lockprof_mutex_lock (&gids->mutex, &_gids_site)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock gids mutex");
+    }
+    p.buf = NULL;
+    p.len = 0;
+    p.max = 0;
+
+    if (gids->gid_hash != NULL) {
+        /*  Size the buffer with a first pass over the hash, then fill it
+         *    with a second.  The mutex is held throughout so the mapping
+         *    cannot change in between.
+         */
+        n = hash_for_each (gids->gid_hash,
+                (hash_arg_f) _gids_gid_head_pack, &p);
+        if ((n > 0) && (p.max > 0)) {
+            if (!(p.buf = malloc (p.max * sizeof (uint32_t)))) {
+                n = -1;
+            }
+            else {
+                (void) hash_for_each (gids->gid_hash,
+                        (hash_arg_f) _gids_gid_head_pack, &p);
+            }
+        }
+    }
+    if ((errno = pthread_mutex_unlock (&gids->mutex)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to unlock gids mutex");
+    }
+    if (n < 0) {
+        errno = ENOMEM;
+        return (-1);
+    }
+    *bufp = p.buf;
+    *lenp = p.len * sizeof (uint32_t);
+    return (n);
+}
+
+
+/*  Unpacks the buffer [buf] of length [len] (as created by gids_pack() in
+ *    another munged process) into the GIDs mapping [gids].  The unpacked
+ *    mapping is only installed if the initial mapping has not yet been
+ *    computed; it will be replaced by the next scheduled update.
+ *  Returns the number of UIDs unpacked, or -1 on error with errno set.
+ */
+int
+gids_unpack (gids_t gids, const void *buf, size_t len)
+{
+    const unsigned char *p = buf;
+    hash_t               gid_hash;
+    uint32_t             uid;
+    uint32_t             num;
+    uint32_t             gid;
+    int                  n = 0;
+
+    if (((buf == NULL) && (len > 0)) || ((len % sizeof (uint32_t)) != 0)) {
+        errno = EINVAL;
+        return (-1);
+    }
+    if (!gids || (len == 0)) {
+        return (0);
+    }
+    gid_hash = hash_create (GID_HASH_SIZE,
+            (hash_key_f) _gids_gid_head_key,
+            (hash_cmp_f) _gids_gid_head_cmp,
+            (hash_del_f) _gids_gid_head_destroy);
+    if (!gid_hash) {
+        errno = ENOMEM;
+        return (-1);
+    }
+    while (len > 0) {
+        if (len < 2 * sizeof (uint32_t)) {
+            goto err_inval;
+        }
+        memcpy (&uid, p, sizeof (uid));
+        memcpy (&num, p + sizeof (uid), sizeof (num));
+        p += 2 * sizeof (uint32_t);
+        len -= 2 * sizeof (uint32_t);
+
+        if (num > len / sizeof (uint32_t)) {
+            goto err_inval;
+        }
+        while (num-- > 0) {
+            memcpy (&gid, p, sizeof (gid));
+            p += sizeof (uint32_t);
+            len -= sizeof (uint32_t);
+            if (_gids_gid_add (gid_hash, (uid_t) uid, (gid_t) gid) < 0) {
+                hash_destroy (gid_hash);
+                errno = ENOMEM;
+                return (-1);
+            }
+        }
+        n++;
+    }
+    if ((errno = lockprof_mutex_lock (&gids->mutex, &_gids_site)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock gids mutex");
+    }
+    if (gids->gid_hash == NULL) {
+        gids->gid_hash = gid_hash;
+        gid_hash = NULL;
+    }
+    if ((errno = pthread_mutex_unlock (&gids->mutex)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to unlock gids mutex");
+    }
+    if (gid_hash != NULL) {
+        hash_destroy (gid_hash);
+        n = 0;
+    }
+    return (n);
+
+err_inval:
+    hash_destroy (gid_hash);
+    errno = EINVAL;
+    return (-1);
+}
+
+
 /*****************************************************************************
  *  Private Functions
  *****************************************************************************/
@@ -339,7 +497,7 @@ _gids_map_update (gids_t gids)
 
     assert (gids != NULL);
 
-    if ((errno = pthread_mutex_lock (&gids->mutex)) != 0) {
+    if ((errno = lockprof_mutex_lock (&gids->mutex, &_gids_site)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock gids mutex");
     }
     do_group_stat = gids->do_group_stat;
@@ -348,7 +506,7 @@ _gids_map_update (gids_t gids)
     if ((errno = pthread_mutex_unlock (&gids->mutex)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to unlock gids mutex");
     }
-    if (time (&t_now) == (time_t) -1) {
+    if (clock_get_time (&t_now) < 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to query current time");
     }
     if (do_group_stat > 0) {
@@ -371,7 +529,7 @@ _gids_map_update (gids_t gids)
     if (do_update) {
         gid_hash = _gids_map_create (gids->ghost_hash);
     }
-    if ((errno = pthread_mutex_lock (&gids->mutex)) != 0) {
+    if ((errno = lockprof_mutex_lock (&gids->mutex, &_gids_site)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock gids mutex");
     }
     /*  Replace the old GIDs mapping if the update was successful.
@@ -590,13 +748,13 @@ _gids_user_to_uid (hash_t uid_hash, hash_t ghost_hash,
         (void) _gids_uid_add (uid_hash, user, uid);
         if (!hash_find (ghost_hash, user)) {
             (void) _gids_ghost_add (ghost_hash, user);
-            log_msg (LOG_INFO,
+            log_msg_limit (LOG_INFO,
                     "Failed to query passwd file for \"%s\": User not found",
                     user);
         }
     }
     else {
-        log_msg (LOG_INFO, "Failed to query passwd file for \"%s\": %s",
+        log_msg_limit (LOG_INFO, "Failed to query passwd file for \"%s\": %s",
                 user, strerror (errno));
     }
     if (uid == UID_SENTINEL) {
@@ -790,6 +948,33 @@ _gids_gid_head_key (uid_t *uidp)
 }
 
 
+static int
+_gids_gid_head_pack (gid_head_p g, const uid_t *uidp, struct gids_pack *p)
+{
+/*  Appends the gid_head [g] and its gid_node chain to the pack buffer [p].
+ *    If the buffer has not yet been allocated, only its size is computed.
+ *  Always returns 1 so hash_for_each() counts the number of UIDs.
+ */
+    gid_node_p node;
+    uint32_t   num = 0;
+
+    for (node = g->next; node; node = node->next) {
+        num++;
+    }
+    if (p->buf == NULL) {
+        p->max += 2 + num;
+        return (1);
+    }
+    assert (p->len + 2 + num <= p->max);
+    p->buf[p->len++] = (uint32_t) *uidp;
+    p->buf[p->len++] = num;
+    for (node = g->next; node; node = node->next) {
+        p->buf[p->len++] = (uint32_t) node->gid;
+    }
+    return (1);
+}
+
+
 static gid_node_p
 _gids_gid_node_create (gid_t gid)
 {
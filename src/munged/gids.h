@@ -58,5 +58,9 @@ void gids_update (gids_t gids);
 
 int gids_is_member (gids_t gids, uid_t uid, gid_t gid);
 
+int gids_pack (gids_t gids, void **bufp, size_t *lenp);
+
+int gids_unpack (gids_t gids, const void *buf, size_t len);
+
 
 #endif /* !GIDS_H */
@@ -34,25 +34,49 @@
 #include <errno.h>
 #include <munge.h>
 #include <netinet/in.h>                 /* for INET_ADDRSTRLEN */
+#include <poll.h>
 #include <signal.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #include "conf.h"
+#include "cred.h"
 #include "dec.h"
 #include "enc.h"
 #include "fd.h"
+#include "lockprof.h"
 #include "log.h"
 #include "m_msg.h"
 #include "munge_defs.h"
+#include "probe.h"
+#include "stage.h"
 #include "str.h"
+#include "timer.h"
+#include "trace.h"
+#include "upgrade.h"
+#include "usage.h"
 #include "work.h"
 
 
 /*****************************************************************************
  *  Constants
  *****************************************************************************/
-#define LOG_LIMIT_SECS  60
+#define LOG_FLUSH_SECS  60
+
+
+/*****************************************************************************
+ *  Private Data Types
+ *****************************************************************************/
+
+typedef struct job {
+    m_msg_t             m;              /* client request/response message   */
+    munge_cred_t        c;              /* aux data for processing this cred */
+    int                 type;           /* m_msg_type of the request         */
+    int                 rc;             /* result of the last stage          */
+    double              cpu_secs;       /* CPU secs consumed across stages   */
+    struct trace_req    tr;             /* request trace state               */
+} job_t, *job_p;
 
 
 /*****************************************************************************
@@ -61,13 +85,61 @@
 
 extern volatile sig_atomic_t got_reconfig;      /* defined in munged.c       */
 extern volatile sig_atomic_t got_terminate;     /* defined in munged.c       */
+extern volatile sig_atomic_t got_upgrade;       /* defined in munged.c       */
 
 
 /*****************************************************************************
  *  Private Prototypes
  *****************************************************************************/
 
+static int  _job_accept (conf_t conf, const struct listener **lp);
+static int  _job_queue (m_msg_t m);
 static void _job_exec (m_msg_t m);
+static void _job_log_err (m_msg_t m);
+static void _job_stages_init (conf_t conf);
+static void _job_stages_fini (void);
+static void _job_stages_report (void);
+static int  _job_stages_queue (m_msg_t m);
+static void _job_stage_recv (job_p *jobs, int n_jobs);
+static void _job_stage_crypto (job_p *jobs, int n_jobs);
+static void _job_stage_replay (job_p *jobs, int n_jobs);
+static void _job_stage_send (job_p *jobs, int n_jobs);
+static void _job_stage_next (stage_p sp, job_p job);
+static void _job_stage_cpu (job_p job, const struct timespec *t0);
+static void _job_log_flush (void *arg);
+static void _job_reconfig (conf_t conf);
+
+
+/*****************************************************************************
+ *  Private Variables
+ *****************************************************************************/
+
+/*  Stages of the staged request pipeline (if enabled via conf->io_threads).
+ *    Requests flow from the recv stage to the crypto stage, then (for
+ *    successful decodes) to the replay stage, and finally to the send stage.
+ *    A request that fails in any stage skips directly to the send stage.
+ */
+static stage_p _job_recv_stage = NULL;
+static stage_p _job_crypto_stage = NULL;
+static stage_p _job_replay_stage = NULL;
+static stage_p _job_send_stage = NULL;
+
+/*  Work crew for processing requests (if the staged pipeline is disabled).
+ */
+static work_p _job_work = NULL;
+
+/*  Listening sockets polled for connections (if additional sockets are
+ *    configured via conf->listeners).  The listener for _job_pfds[i] is
+ *    _job_listeners[i], which is NULL for the primary socket at index 0.
+ */
+static struct pollfd *_job_pfds = NULL;
+static const struct listener **_job_listeners = NULL;
+static int _job_n_pfds = 0;
+static int _job_next_pfd = 0;
+
+/*  Timer for periodically logging summaries of rate-limited log messages.
+ */
+static long _job_log_timer_id = 0;
 
 
 /*****************************************************************************
@@ -77,58 +149,101 @@ static void _job_exec (m_msg_t m);
 void
 job_accept (conf_t conf)
 {
-    work_p  w;
-    m_msg_t m;
-    int     sd;
-    int     curr_errno;
-    time_t  curr_time;
-    int     last_log_errno = 0;
-    time_t  last_log_time = 0;
+    work_p                 w = NULL;
+    m_msg_t                m;
+    int                    sd;
+    int                    rv;
+    const struct listener *l;
+    listener_t             lst;
+    int                    n;
 
     assert (conf != NULL);
     assert (conf->ld >= 0);
 
-    if (!(w = work_init ((work_func_t) _job_exec, conf->nthreads))) {
-        log_errno (EMUNGE_SNAFU, LOG_ERR,
-            "Failed to create %d work thread%s", conf->nthreads,
-            ((conf->nthreads > 1) ? "s" : ""));
+    if (conf->listeners != NULL) {
+        for (n = 1, lst = conf->listeners; lst != NULL; lst = lst->next) {
+            n++;
+        }
+        _job_pfds = calloc (n, sizeof (*_job_pfds));
+        _job_listeners = calloc (n, sizeof (*_job_listeners));
+        if ((_job_pfds == NULL) || (_job_listeners == NULL)) {
+            log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+                "Failed to allocate %d socket poll entries", n);
+        }
+        _job_pfds[0].fd = conf->ld;
+        _job_pfds[0].events = POLLIN;
+        _job_listeners[0] = NULL;
+        for (n = 1, lst = conf->listeners; lst != NULL; lst = lst->next) {
+            _job_pfds[n].fd = lst->ld;
+            _job_pfds[n].events = POLLIN;
+            _job_listeners[n] = lst;
+            n++;
+        }
+        _job_n_pfds = n;
+        log_msg (LOG_INFO, "Listening on %d sockets", n);
     }
-    log_msg (LOG_INFO, "Created %d work thread%s", conf->nthreads,
-            ((conf->nthreads > 1) ? "s" : ""));
+
+    if (conf->io_threads > 0) {
+        _job_stages_init (conf);
+    }
+    else {
+        if (!(w = work_init ((work_func_t) _job_exec, conf->nthreads))) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to create %d work thread%s", conf->nthreads,
+                ((conf->nthreads > 1) ? "s" : ""));
+        }
+        log_msg (LOG_INFO, "Created %d work thread%s", conf->nthreads,
+                ((conf->nthreads > 1) ? "s" : ""));
+    }
+    _job_work = w;
+    probe_init (conf, _job_queue);
+    _job_log_flush (NULL);
 
     while (!got_terminate) {
         if (got_reconfig) {
             log_msg (LOG_NOTICE, "Processing signal %d (%s)",
                     got_reconfig, strsignal (got_reconfig));
             got_reconfig = 0;
+            _job_reconfig (conf);
             gids_update (conf->gids);
+            _job_stages_report ();
+            probe_report ();
+            usage_report ();
+            lockprof_report ();
         }
-        sd = accept (conf->ld, NULL, NULL);
+        if (got_upgrade) {
+            log_msg (LOG_NOTICE, "Processing signal %d (%s)",
+                    got_upgrade, strsignal (got_upgrade));
+            got_upgrade = 0;
+            if (upgrade_spawn (conf) == 0) {
+                break;
+            }
+        }
+        sd = _job_accept (conf, &l);
         if (sd < 0) {
             switch (errno) {
                 case ECONNABORTED:
                 case EINTR:
+                case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+                case EWOULDBLOCK:
+#endif /* EWOULDBLOCK != EAGAIN */
                     continue;
                 case EMFILE:
                 case ENFILE:
                 case ENOBUFS:
                 case ENOMEM:
-                    curr_errno = errno; /* save errno before calling time() */
-                    curr_time = time (NULL);
-                    if (curr_time == (time_t) -1) {
-                        log_errno (EMUNGE_SNAFU, LOG_ERR,
-                                "Failed to query current time");
-                    }
-                    if ((curr_time > last_log_time + LOG_LIMIT_SECS) ||
-                            (curr_errno != last_log_errno)) {
-                        log_msg (LOG_INFO, "Failed to accept connection: %s",
-                                strerror (curr_errno));
-                        last_log_errno = curr_errno;
-                        last_log_time = curr_time;
-                    }
+                    log_msg_limit (LOG_INFO,
+                            "Failed to accept connection: %s",
+                            strerror (errno));
                     /*  Process backlog before accepting new connections.
                     */
-                    work_wait (w);
+                    if (w != NULL) {
+                        work_wait (w);
+                    }
+                    else {
+                        stage_wait (_job_recv_stage);
+                    }
                     continue;
                 default:
                     log_errno (EMUNGE_SNAFU, LOG_ERR,
@@ -149,26 +264,53 @@ job_accept (conf_t conf)
          */
         if (fd_set_nonblocking (sd) < 0) {
             close (sd);
-            log_msg (LOG_WARNING,
+            log_msg_limit (LOG_WARNING,
                 "Failed to set nonblocking client socket: %s",
                 strerror (errno));
         }
         else if (m_msg_create (&m) != EMUNGE_SUCCESS) {
             close (sd);
-            log_msg (LOG_WARNING, "Failed to create client request");
+            log_msg_limit (LOG_WARNING, "Failed to create client request");
         }
         else if (m_msg_bind (m, sd) != EMUNGE_SUCCESS) {
             m_msg_destroy (m);
-            log_msg (LOG_WARNING, "Failed to bind socket for client request");
+            log_msg_limit (LOG_WARNING,
+                "Failed to bind socket for client request");
         }
-        else if (work_queue (w, m) < 0) {
-            m_msg_destroy (m);
-            log_msg (LOG_WARNING, "Failed to queue client request");
+        else {
+            m->listener = l;
+            rv = _job_queue (m);
+            if (rv < 0) {
+                m_msg_destroy (m);
+                log_msg_limit (LOG_WARNING, "Failed to queue client request");
+            }
         }
     }
-    log_msg (LOG_NOTICE, "Exiting on signal %d (%s)",
-            got_terminate, strsignal (got_terminate));
-    work_fini (w, 1);
+    if (upgrade_is_pending ()) {
+        log_msg (LOG_NOTICE, "Exiting for upgrade");
+    }
+    else {
+        log_msg (LOG_NOTICE, "Exiting on signal %d (%s)",
+                got_terminate, strsignal (got_terminate));
+    }
+    probe_fini ();
+    if (w != NULL) {
+        _job_work = NULL;
+        work_fini (w, 1);
+    }
+    else {
+        _job_stages_fini ();
+    }
+    if (_job_log_timer_id > 0) {
+        (void) timer_cancel (_job_log_timer_id);
+        _job_log_timer_id = 0;
+    }
+    log_limit_flush (1);
+    free (_job_pfds);
+    _job_pfds = NULL;
+    free (_job_listeners);
+    _job_listeners = NULL;
+    _job_n_pfds = 0;
     return;
 }
 
@@ -177,19 +319,86 @@ job_accept (conf_t conf)
  *  Private Functions
  *****************************************************************************/
 
+static int
+_job_accept (conf_t conf, const struct listener **lp)
+{
+/*  Accepts the next client connection, setting [lp] to the listener of the
+ *    socket on which it arrived (or NULL for the primary socket).
+ *  With additional sockets, the sockets are polled and scanned starting
+ *    after the one last accepted from so a busy socket cannot starve others.
+ *  Returns the connected socket descriptor, or -1 on error (with errno set).
+ *    EAGAIN indicates no connection was pending after all.
+ */
+    int i;
+    int j;
+    int sd;
+
+    *lp = NULL;
+
+    if (_job_n_pfds == 0) {
+        return (accept (conf->ld, NULL, NULL));
+    }
+    if (poll (_job_pfds, _job_n_pfds, -1) < 0) {
+        return (-1);
+    }
+    for (i = 0; i < _job_n_pfds; i++) {
+        j = (_job_next_pfd + i) % _job_n_pfds;
+        if (!(_job_pfds[j].revents & POLLIN)) {
+            continue;
+        }
+        sd = accept (_job_pfds[j].fd, NULL, NULL);
+        if (sd >= 0) {
+            *lp = _job_listeners[j];
+            _job_next_pfd = (j + 1) % _job_n_pfds;
+            return (sd);
+        }
+        if ((errno != EAGAIN) && (errno != EWOULDBLOCK)
+                && (errno != ECONNABORTED)) {
+            return (-1);
+        }
+    }
+    errno = EAGAIN;
+    return (-1);
+}
+
+
+static int
+_job_queue (m_msg_t m)
+{
+/*  Queues the message request [m] for processing by either the work crew
+ *    or the staged request pipeline.
+ *  Returns 0 on success, or -1 on error.
+ */
+    assert (m != NULL);
+
+    if (_job_work != NULL) {
+        return (work_queue (_job_work, m));
+    }
+    return (_job_stages_queue (m));
+}
+
+
 static void
 _job_exec (m_msg_t m)
 {
 /*  Receives and responds to the message request [m].
  */
-    munge_err_t  e;
-    const char  *p;
+    munge_err_t      e;
+    m_msg_type_t     type = MUNGE_MSG_UNDEF;
+    struct timespec  t0;
+    struct timespec  t1;
+    struct trace_req tr;
 
     assert (m != NULL);
 
+    probe_dequeue (m);
+    m_msg_set_deadline (m, conf->request_timeout_msecs);
+    usage_get_time (&t0);
     e = m_msg_recv (m, MUNGE_MSG_UNDEF, MUNGE_MAXIMUM_REQ_LEN);
     if (e == EMUNGE_SUCCESS) {
-        switch (m->type) {
+        type = m->type;
+        trace_request (&tr, m);
+        switch (type) {
             case MUNGE_MSG_ENC_REQ:
                 enc_process_msg (m);
                 break;
@@ -201,34 +410,435 @@ _job_exec (m_msg_t m)
                     strdupf ("Invalid message type %d", m->type));
                 break;
         }
+        trace_record (&tr, m);
+    }
+    usage_get_time (&t1);
+    usage_add (m, type, usage_diff_secs (&t0, &t1));
+    _job_log_err (m);
+    m_msg_destroy (m);
+    return;
+}
+
+
+static void
+_job_log_err (m_msg_t m)
+{
+/*  Logs the error (if any) resulting from processing the message [m],
+ *    tagged with the client's request ID (if any).
+ */
+    const char *p;
+
+    if (m->error_num == EMUNGE_SUCCESS) {
+        return;
     }
     /*  For some errors, the credential was successfully decoded but deemed
      *    invalid for policy reasons.  In these cases, the origin IP address
      *    is added to the error message to aid in troubleshooting.
      */
-    if (m->error_num != EMUNGE_SUCCESS) {
-        p = (m->error_str != NULL)
-            ? m->error_str
-            : munge_strerror (m->error_num);
-        switch (m->error_num) {
-            case EMUNGE_CRED_EXPIRED:
-            case EMUNGE_CRED_REWOUND:
-            case EMUNGE_CRED_REPLAYED:
-                if (m->addr_len == 4) {
-                    char ip_addr_buf [INET_ADDRSTRLEN];
-                    if (inet_ntop (AF_INET, &m->addr, ip_addr_buf,
-                                   sizeof (ip_addr_buf)) != NULL) {
-                        log_msg (LOG_DEBUG, "%s from %s", p, ip_addr_buf);
-                        break;
-                    }
+    p = (m->error_str != NULL)
+        ? m->error_str
+        : munge_strerror (m->error_num);
+    switch (m->error_num) {
+        case EMUNGE_CRED_EXPIRED:
+        case EMUNGE_CRED_REWOUND:
+        case EMUNGE_CRED_REPLAYED:
+            if (m->addr_len == 4) {
+                char ip_addr_buf [INET_ADDRSTRLEN];
+                if (inet_ntop (AF_INET, &m->addr, ip_addr_buf,
+                               sizeof (ip_addr_buf)) != NULL) {
+                    log_msg_limit (LOG_DEBUG, "%s from %s%s%s", p,
+                        ip_addr_buf, M_MSG_REQ_ID_ARGS (m));
+                    break;
                 }
-                log_msg (LOG_DEBUG, "%s", p);
+            }
+            log_msg_limit (LOG_DEBUG, "%s%s%s", p, M_MSG_REQ_ID_ARGS (m));
+            break;
+        default:
+            log_msg_limit (LOG_INFO, "%s%s%s", p, M_MSG_REQ_ID_ARGS (m));
+            break;
+    }
+    return;
+}
+
+
+static void
+_job_stages_init (conf_t conf)
+{
+/*  Creates the stages of the staged request pipeline.
+ *  The recv & send stages are serviced by the I/O threads since they block on
+ *    client sockets; the crypto stage is serviced by the "num-threads" threads
+ *    since it is CPU-bound.  The replay stage is serviced by a single thread
+ *    in order to avoid contention on the replay hash.
+ */
+    _job_send_stage = stage_init ("send", (stage_func_t) _job_stage_send,
+            conf->io_threads, conf->queue_len, 1);
+    if (!_job_send_stage) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to create send stage");
+    }
+    _job_replay_stage = stage_init ("replay", (stage_func_t) _job_stage_replay,
+            1, conf->queue_len, MUNGE_STAGE_BATCH_LEN);
+    if (!_job_replay_stage) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to create replay stage");
+    }
+    _job_crypto_stage = stage_init ("crypto", (stage_func_t) _job_stage_crypto,
+            conf->nthreads, conf->queue_len, MUNGE_STAGE_BATCH_LEN);
+    if (!_job_crypto_stage) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to create crypto stage");
+    }
+    _job_recv_stage = stage_init ("recv", (stage_func_t) _job_stage_recv,
+            conf->io_threads, conf->queue_len, 1);
+    if (!_job_recv_stage) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to create recv stage");
+    }
+    return;
+}
+
+
+static void
+_job_stages_fini (void)
+{
+/*  Drains and destroys the stages of the staged request pipeline,
+ *    logging the final metrics of each.
+ *  Stages are finished in order from the head of the pipeline to its tail
+ *    so that requests in flight are passed along before each downstream
+ *    stage is closed.
+ */
+    if (!_job_recv_stage) {
+        return;
+    }
+    stage_fini (_job_recv_stage);
+    _job_recv_stage = NULL;
+    stage_fini (_job_crypto_stage);
+    _job_crypto_stage = NULL;
+    stage_fini (_job_replay_stage);
+    _job_replay_stage = NULL;
+    stage_fini (_job_send_stage);
+    _job_send_stage = NULL;
+    return;
+}
+
+
+static void
+_job_stages_report (void)
+{
+/*  Logs the metrics of the stages of the staged request pipeline.
+ */
+    if (!_job_recv_stage) {
+        return;
+    }
+    stage_report (_job_recv_stage);
+    stage_report (_job_crypto_stage);
+    stage_report (_job_replay_stage);
+    stage_report (_job_send_stage);
+    return;
+}
+
+
+static int
+_job_stages_queue (m_msg_t m)
+{
+/*  Queues the message request [m] at the head of the staged request pipeline.
+ *  Returns 0 on success, or -1 on error (with errno set).
+ */
+    job_p job;
+
+    assert (m != NULL);
+
+    if (!(job = calloc (1, sizeof (*job)))) {
+        return (-1);
+    }
+    job->m = m;
+    job->type = MUNGE_MSG_UNDEF;
+    if (stage_queue (_job_recv_stage, job) < 0) {
+        free (job);
+        return (-1);
+    }
+    return (0);
+}
+
+
+static void
+_job_stage_recv (job_p *jobs, int n_jobs)
+{
+/*  Receives each message request in [jobs], and authenticates the client.
+ */
+    job_p           job;
+    munge_err_t     e;
+    struct timespec t0;
+    int             i;
+
+    for (i = 0; i < n_jobs; i++) {
+        job = jobs[i];
+        probe_dequeue (job->m);
+        m_msg_set_deadline (job->m, conf->request_timeout_msecs);
+        usage_get_time (&t0);
+        e = m_msg_recv (job->m, MUNGE_MSG_UNDEF, MUNGE_MAXIMUM_REQ_LEN);
+        if (e != EMUNGE_SUCCESS) {
+            /*
+             *  The request could not be received, so no response is sent.
+             */
+            job->rc = -1;
+            _job_stage_cpu (job, &t0);
+            _job_stage_next (_job_send_stage, job);
+            continue;
+        }
+        job->type = job->m->type;
+        trace_request (&job->tr, job->m);
+        switch (job->type) {
+            case MUNGE_MSG_ENC_REQ:
+                job->rc = enc_prepare (job->m, &job->c);
+                break;
+            case MUNGE_MSG_DEC_REQ:
+                job->rc = dec_prepare (job->m, &job->c);
                 break;
             default:
-                log_msg (LOG_INFO, "%s", p);
+                job->rc = m_msg_set_err (job->m, EMUNGE_SNAFU,
+                    strdupf ("Invalid message type %d", job->type));
                 break;
         }
+        _job_stage_cpu (job, &t0);
+        _job_stage_next ((job->rc == 0)
+                ? _job_crypto_stage : _job_send_stage, job);
+    }
+    return;
+}
+
+
+static void
+_job_stage_crypto (job_p *jobs, int n_jobs)
+{
+/*  Performs the CPU-bound encode/decode processing for each request in [jobs].
+ */
+    job_p           job;
+    struct timespec t0;
+    int             i;
+
+    for (i = 0; i < n_jobs; i++) {
+        job = jobs[i];
+        usage_get_time (&t0);
+        if (job->type == MUNGE_MSG_ENC_REQ) {
+            job->rc = enc_crypto (job->c);
+            _job_stage_cpu (job, &t0);
+            _job_stage_next (_job_send_stage, job);
+        }
+        else {
+            assert (job->type == MUNGE_MSG_DEC_REQ);
+            job->rc = dec_crypto (job->c);
+            _job_stage_cpu (job, &t0);
+            _job_stage_next ((job->rc == 0)
+                    ? _job_replay_stage : _job_send_stage, job);
+        }
+    }
+    return;
+}
+
+
+static void
+_job_stage_replay (job_p *jobs, int n_jobs)
+{
+/*  Performs the replay check for each successfully-decoded cred in [jobs].
+ */
+    job_p           job;
+    struct timespec t0;
+    int             i;
+
+    for (i = 0; i < n_jobs; i++) {
+        job = jobs[i];
+        assert (job->type == MUNGE_MSG_DEC_REQ);
+        usage_get_time (&t0);
+        job->rc = dec_replay (job->c);
+        _job_stage_cpu (job, &t0);
+        _job_stage_next (_job_send_stage, job);
+    }
+    return;
+}
+
+
+static void
+_job_stage_send (job_p *jobs, int n_jobs)
+{
+/*  Sends the response for each request in [jobs], and releases the request.
+ */
+    job_p           job;
+    struct timespec t0;
+    int             i;
+
+    for (i = 0; i < n_jobs; i++) {
+        job = jobs[i];
+        usage_get_time (&t0);
+        switch (job->type) {
+            case MUNGE_MSG_ENC_REQ:
+                (void) enc_respond (job->m, job->c, job->rc);
+                break;
+            case MUNGE_MSG_DEC_REQ:
+                (void) dec_respond (job->m, job->c, job->rc);
+                break;
+            default:
+                assert (job->c == NULL);
+                break;
+        }
+        _job_stage_cpu (job, &t0);
+        trace_record (&job->tr, job->m);
+        usage_add (job->m, job->type, job->cpu_secs);
+        _job_log_err (job->m);
+        m_msg_destroy (job->m);
+        free (job);
+    }
+    return;
+}
+
+
+static void
+_job_stage_cpu (job_p job, const struct timespec *t0)
+{
+/*  Adds the CPU time consumed by the calling thread since [t0] to [job].
+ *  This must be called before passing the job on to the next stage.
+ */
+    struct timespec t1;
+
+    usage_get_time (&t1);
+    job->cpu_secs += usage_diff_secs (t0, &t1);
+    return;
+}
+
+
+static void
+_job_stage_next (stage_p sp, job_p job)
+{
+/*  Passes the request [job] on to the stage [sp].
+ *  Stages are finished in pipeline order, so a downstream stage should never
+ *    refuse work; if it does, the request is dropped.
+ */
+    if (stage_queue (sp, job) < 0) {
+        log_msg_limit (LOG_WARNING, "Failed to queue client request: %s",
+                strerror (errno));
+        if (job->c != NULL) {
+            cred_destroy (job->c);
+        }
+        m_msg_destroy (job->m);
+        free (job);
+    }
+    return;
+}
+
+
+static void
+_job_log_flush (void *arg)
+{
+/*  Logs summaries of rate-limited log messages whose interval has elapsed,
+ *    and schedules the next flush.
+ */
+    log_limit_flush (0);
+    _job_log_timer_id = timer_set_relative ((callback_f) _job_log_flush,
+            NULL, LOG_FLUSH_SECS * 1000);
+    if (_job_log_timer_id < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to schedule log message flush");
+    }
+    return;
+}
+
+
+static void
+_job_reconfig (conf_t conf)
+{
+/*  Rereads the config file (if specified) and applies any changed settings
+ *    to the running daemon.  If the file cannot be read or contains an
+ *    invalid setting, the current configuration remains in effect.
+ */
+    char            ebuf[1024];
+    int             nthreads;
+    int             queue_len;
+    int             listen_backlog;
+    int             max_ttl;
+    int             log_priority;
+    listener_t      l;
+
+    if (conf->config_name == NULL) {
+        return;
+    }
+    nthreads = conf->nthreads;
+    queue_len = conf->queue_len;
+    listen_backlog = conf->listen_backlog;
+    max_ttl = conf->max_ttl;
+    log_priority = conf->log_priority;
+
+    if (read_conf_file (conf, ebuf, sizeof (ebuf)) < 0) {
+        log_msg (LOG_WARNING, "Failed to reload config: %s", ebuf);
+        return;
+    }
+    log_msg (LOG_INFO, "Reloaded config file \"%s\"", conf->config_name);
+
+    if (conf->log_priority != log_priority) {
+        log_msg (LOG_NOTICE, "Set log priority to %d", conf->log_priority);
+        log_set_priority (conf->log_priority);
+    }
+    if (conf->nthreads != nthreads) {
+        if (_job_work == NULL) {
+            log_msg (LOG_WARNING,
+                    "Cannot change number of threads of staged pipeline");
+            conf->nthreads = nthreads;
+        }
+        else if (work_set_threads (_job_work, conf->nthreads) < 0) {
+            log_msg (LOG_WARNING, "Failed to set %d work threads: %s",
+                    conf->nthreads, strerror (errno));
+            conf->nthreads = nthreads;
+        }
+        else {
+            log_msg (LOG_NOTICE, "Set number of work threads to %d",
+                    conf->nthreads);
+        }
+    }
+    if ((conf->queue_len != queue_len) && (_job_recv_stage != NULL)) {
+        if ((stage_set_queue_len (_job_recv_stage, conf->queue_len) < 0)
+                || (stage_set_queue_len (_job_crypto_stage,
+                        conf->queue_len) < 0)
+                || (stage_set_queue_len (_job_replay_stage,
+                        conf->queue_len) < 0)
+                || (stage_set_queue_len (_job_send_stage,
+                        conf->queue_len) < 0)) {
+            log_msg (LOG_WARNING, "Failed to set stage queue limit to %d: %s",
+                    conf->queue_len, strerror (errno));
+        }
+        else {
+            log_msg (LOG_NOTICE, "Set stage queue limit to %d",
+                    conf->queue_len);
+        }
+    }
+    if (conf->listen_backlog != listen_backlog) {
+        /*
+         *  Calling listen() again on a listening socket updates its backlog.
+         */
+        if (listen (conf->ld, conf->listen_backlog) < 0) {
+            log_msg (LOG_WARNING, "Failed to set socket listen backlog: %s",
+                    strerror (errno));
+        }
+        for (l = conf->listeners; l != NULL; l = l->next) {
+            if (listen (l->ld, conf->listen_backlog) < 0) {
+                log_msg (LOG_WARNING,
+                        "Failed to set listen backlog of socket \"%s\": %s",
+                        l->socket_name, strerror (errno));
+            }
+        }
+        log_msg (LOG_NOTICE, "Set socket listen backlog to %d",
+                conf->listen_backlog);
+    }
+    if (conf->max_ttl != max_ttl) {
+        log_msg (LOG_NOTICE, "Set maximum time-to-live to %d second%s",
+                conf->max_ttl, (conf->max_ttl == 1) ? "" : "s");
+        /*
+         *  Bound the default ttl of each additional socket by the new max ttl
+         *    as check_listeners() does at startup.
+         */
+        for (l = conf->listeners; l != NULL; l = l->next) {
+            if (l->def_ttl > conf->max_ttl) {
+                l->def_ttl = conf->max_ttl;
+                log_msg (LOG_NOTICE,
+                        "Set default time-to-live of socket \"%s\" to %d "
+                        "second%s", l->socket_name, l->def_ttl,
+                        (l->def_ttl == 1) ? "" : "s");
+            }
+        }
     }
-    m_msg_destroy (m);
     return;
 }
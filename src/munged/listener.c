@@ -0,0 +1,304 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <munge.h>
+#include "conf.h"
+#include "gids.h"
+#include "listener.h"
+#include "query.h"
+#include "str.h"
+#include "zip.h"
+
+
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static int _listener_set_opt (listener_t l, const char *key, const char *val,
+    char *errbuf, size_t errbuflen);
+
+static int _listener_set_enum (munge_enum_t type, int *dst, const char *val);
+
+static int _listener_set_err (char *buf, size_t buflen,
+    const char *format, ...);
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+/*  Creates a listener from the specification string [spec] of the form
+ *    "PATH[,KEY=VALUE]...".  A relative PATH is resolved against [cwd].
+ *  Supported keys are "ttl", "cipher", "mac", and "zip" to override the
+ *    daemon-wide defaults (passed in [def_cipher], [def_mac], [def_zip], and
+ *    [def_ttl]) for requests accepted on this socket, and "uid" and "gid"
+ *    (which may be repeated) to restrict which clients may use it.
+ *  The socket itself is not created here.
+ *  Returns the new listener, or NULL on error (with a description written
+ *    to [errbuf] of length [errbuflen]).
+ */
+listener_t
+listener_create (const char *spec, const char *cwd,
+                 munge_cipher_t def_cipher, munge_mac_t def_mac,
+                 munge_zip_t def_zip, munge_ttl_t def_ttl,
+                 char *errbuf, size_t errbuflen)
+{
+    listener_t  l;
+    char       *buf;
+    char       *tok;
+    char       *val;
+    char       *save_ptr = NULL;
+
+    assert (spec != NULL);
+
+    if (!(l = calloc (1, sizeof (*l)))) {
+        _listener_set_err (errbuf, errbuflen, "%s", strerror (ENOMEM));
+        return (NULL);
+    }
+    l->ld = -1;
+    l->def_cipher = def_cipher;
+    l->def_mac = def_mac;
+    l->def_zip = def_zip;
+    l->def_ttl = def_ttl;
+
+    if (!(buf = strdup (spec))) {
+        _listener_set_err (errbuf, errbuflen, "%s", strerror (ENOMEM));
+        goto err;
+    }
+    tok = strtok_r (buf, ",", &save_ptr);
+    if ((tok == NULL) || (*tok == '\0')) {
+        _listener_set_err (errbuf, errbuflen, "Missing socket name");
+        goto err;
+    }
+    l->socket_name = ((tok[0] == '/') || (cwd == NULL))
+        ? strdup (tok)
+        : strdupf ("%s/%s", cwd, tok);
+    if (l->socket_name == NULL) {
+        _listener_set_err (errbuf, errbuflen, "%s", strerror (ENOMEM));
+        goto err;
+    }
+    while ((tok = strtok_r (NULL, ",", &save_ptr)) != NULL) {
+        if (!(val = strchr (tok, '=')) || (val == tok)) {
+            _listener_set_err (errbuf, errbuflen,
+                "Invalid option \"%s\"", tok);
+            goto err;
+        }
+        *val++ = '\0';
+        if (_listener_set_opt (l, tok, val, errbuf, errbuflen) < 0) {
+            goto err;
+        }
+    }
+    free (buf);
+    return (l);
+
+err:
+    free (buf);
+    listener_destroy (l);
+    return (NULL);
+}
+
+
+/*  Destroys the listener [l].
+ *  The socket must have already been closed.
+ */
+void
+listener_destroy (listener_t l)
+{
+    if (!l) {
+        return;
+    }
+    assert (l->ld < 0);
+
+    if (l->socket_name) {
+        free (l->socket_name);
+    }
+    free (l);
+    return;
+}
+
+
+/*  Returns non-zero if a client with [uid] and [gid] is allowed to use the
+ *    socket of listener [l] according to its access policy.
+ *  A client is allowed if no UIDs or GIDs have been specified, if its UID
+ *    is listed, or if its primary or supplementary group is listed.
+ */
+int
+listener_is_allowed (const struct listener *l, uid_t uid, gid_t gid)
+{
+    int i;
+
+    assert (l != NULL);
+
+    if ((l->n_uids == 0) && (l->n_gids == 0)) {
+        return (1);
+    }
+    for (i = 0; i < l->n_uids; i++) {
+        if (l->uids [i] == uid) {
+            return (1);
+        }
+    }
+    for (i = 0; i < l->n_gids; i++) {
+        if (l->gids [i] == gid) {
+            return (1);
+        }
+        if (gids_is_member (conf->gids, uid, l->gids [i])) {
+            return (1);
+        }
+    }
+    return (0);
+}
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static int
+_listener_set_opt (listener_t l, const char *key, const char *val,
+                   char *errbuf, size_t errbuflen)
+{
+/*  Sets the option [key] to [val] for the listener [l].
+ *  Returns 0 on success, or -1 on error (with a description written
+ *    to [errbuf] of length [errbuflen]).
+ */
+    long  n;
+    char *p;
+    int   i;
+
+    if (!strcmp (key, "ttl")) {
+        errno = 0;
+        n = strtol (val, &p, 10);
+        if ((errno != 0) || (val == p) || (*p != '\0')
+                || (n <= 0) || (n > INT_MAX)) {
+            goto err;
+        }
+        l->def_ttl = n;
+    }
+    else if (!strcmp (key, "cipher")) {
+        if (_listener_set_enum (MUNGE_ENUM_CIPHER, &i, val) < 0) {
+            goto err;
+        }
+        l->def_cipher = i;
+    }
+    else if (!strcmp (key, "mac")) {
+        if ((_listener_set_enum (MUNGE_ENUM_MAC, &i, val) < 0)
+                || (i == MUNGE_MAC_NONE)) {
+            goto err;
+        }
+        l->def_mac = i;
+    }
+    else if (!strcmp (key, "zip")) {
+        if ((_listener_set_enum (MUNGE_ENUM_ZIP, &i, val) < 0)
+                || ((i != MUNGE_ZIP_NONE) && !zip_is_valid_type (i))) {
+            goto err;
+        }
+        l->def_zip = i;
+    }
+    else if (!strcmp (key, "uid")) {
+        if (l->n_uids >= LISTENER_MAX_IDS) {
+            return (_listener_set_err (errbuf, errbuflen,
+                "Exceeded maximum of %d UIDs", LISTENER_MAX_IDS));
+        }
+        if (query_uid (val, &l->uids [l->n_uids]) < 0) {
+            goto err;
+        }
+        l->n_uids++;
+    }
+    else if (!strcmp (key, "gid")) {
+        if (l->n_gids >= LISTENER_MAX_IDS) {
+            return (_listener_set_err (errbuf, errbuflen,
+                "Exceeded maximum of %d GIDs", LISTENER_MAX_IDS));
+        }
+        if (query_gid (val, &l->gids [l->n_gids]) < 0) {
+            goto err;
+        }
+        l->n_gids++;
+    }
+    else {
+        return (_listener_set_err (errbuf, errbuflen,
+            "Invalid option \"%s\"", key));
+    }
+    return (0);
+
+err:
+    return (_listener_set_err (errbuf, errbuflen,
+        "Invalid value \"%s\" for %s", val, key));
+}
+
+
+static int
+_listener_set_enum (munge_enum_t type, int *dst, const char *val)
+{
+/*  Converts [val] (by name or number) into a value of the enum [type],
+ *    excluding "default", and stores it in [dst].
+ *  Returns 0 on success, or -1 on error.
+ */
+    int i;
+
+    i = munge_enum_str_to_int (type, val);
+    if ((i < 0) || !munge_enum_is_valid (type, i)) {
+        return (-1);
+    }
+    if (((type == MUNGE_ENUM_CIPHER) && (i == MUNGE_CIPHER_DEFAULT))
+            || ((type == MUNGE_ENUM_MAC) && (i == MUNGE_MAC_DEFAULT))
+            || ((type == MUNGE_ENUM_ZIP) && (i == MUNGE_ZIP_DEFAULT))) {
+        return (-1);
+    }
+    *dst = i;
+    return (0);
+}
+
+
+static int
+_listener_set_err (char *buf, size_t buflen, const char *format, ...)
+{
+/*  Writes the expanded [format] string to the buffer [buf] of length
+ *    [buflen] (if non-NULL).
+ *  Returns -1.
+ */
+    va_list vargs;
+
+    if ((buf != NULL) && (buflen > 0)) {
+        va_start (vargs, format);
+        (void) vsnprintf (buf, buflen, format, vargs);
+        buf [buflen - 1] = '\0';
+        va_end (vargs);
+    }
+    return (-1);
+}
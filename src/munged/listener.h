@@ -0,0 +1,86 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+
+#ifndef LISTENER_H
+#define LISTENER_H
+
+
+#include <sys/types.h>
+#include <munge.h>
+
+
+/*****************************************************************************
+ *  Constants
+ *****************************************************************************/
+
+/*  Maximum number of UIDs and of GIDs in the access policy of an
+ *    additional listening socket.
+ */
+#define LISTENER_MAX_IDS                16
+
+
+/*****************************************************************************
+ *  Data Types
+ *****************************************************************************/
+
+/*  An additional listening socket specified via "--extra-socket".
+ *  Requests accepted on it share the daemon's work crew and replay cache,
+ *    but use its own defaults and access policy.  Requests accepted on the
+ *    primary socket have no listener and use the daemon-wide defaults.
+ */
+struct listener {
+    struct listener    *next;           /* next listener in list             */
+    char               *socket_name;    /* unix domain socket filename       */
+    int                 ld;             /* listening socket descriptor       */
+    munge_cipher_t      def_cipher;     /* default cipher for this socket    */
+    munge_mac_t         def_mac;        /* default mac for this socket       */
+    munge_zip_t         def_zip;        /* default zip for this socket       */
+    munge_ttl_t         def_ttl;        /* default ttl for this socket       */
+    int                 n_uids;         /* num UIDs allowed (0 for any)      */
+    uid_t               uids [LISTENER_MAX_IDS];    /* UIDs allowed          */
+    int                 n_gids;         /* num GIDs allowed (0 for any)      */
+    gid_t               gids [LISTENER_MAX_IDS];    /* GIDs allowed          */
+};
+
+typedef struct listener * listener_t;
+
+
+/*****************************************************************************
+ *  Prototypes
+ *****************************************************************************/
+
+listener_t listener_create (const char *spec, const char *cwd,
+    munge_cipher_t def_cipher, munge_mac_t def_mac, munge_zip_t def_zip,
+    munge_ttl_t def_ttl, char *errbuf, size_t errbuflen);
+
+void listener_destroy (listener_t l);
+
+int listener_is_allowed (const struct listener *l, uid_t uid, gid_t gid);
+
+
+#endif /* !LISTENER_H */
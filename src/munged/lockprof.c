@@ -0,0 +1,343 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <munge.h>
+#include "lockprof.h"
+#include "log.h"
+
+
+/*****************************************************************************
+ *  Notes
+ *****************************************************************************
+ *
+ *  When enabled, each profiled acquisition first tries the lock.  Only if
+ *  that fails is the wait for the lock timed with the monotonic clock, so an
+ *  uncontended acquisition adds little more than updating the site counters.
+ *  When disabled, lockprof_mutex_lock() reduces to pthread_mutex_lock() after
+ *  testing lockprof_is_enabled; since that flag is only set before any
+ *  threads are created, it is read without synchronization.
+ *
+ *  The mutexes used here are locked directly with pthread_mutex_lock() in
+ *  order to avoid profiling the profiler.
+ */
+
+
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static double _lockprof_diff_secs (const struct timespec *t0,
+        const struct timespec *t1);
+static int _lockprof_hist_index (double secs);
+static int _lockprof_site_cmp (const void *p1, const void *p2);
+static void _lockprof_site_report (const lockprof_site_t *sp);
+
+
+/*****************************************************************************
+ *  Variables
+ *****************************************************************************/
+
+int lockprof_is_enabled = 0;
+
+static pthread_mutex_t   _lockprof_mutex = PTHREAD_MUTEX_INITIALIZER;
+static lockprof_site_t  *_lockprof_sites = NULL;
+static int               _lockprof_n_sites = 0;
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+/*  Initializes lock profiling, enabling it if [enable] is non-zero.
+ *  This must be called before any threads are created.
+ */
+void
+lockprof_init (int enable)
+{
+    lockprof_is_enabled = (enable != 0);
+    if (lockprof_is_enabled) {
+        log_msg (LOG_INFO, "Enabled lock contention profiling");
+    }
+    return;
+}
+
+
+/*  Logs the lock profile report (if enabled).
+ *  This must be called after all other threads have been stopped.
+ */
+void
+lockprof_fini (void)
+{
+    if (!lockprof_is_enabled) {
+        return;
+    }
+    lockprof_report ();
+    lockprof_is_enabled = 0;
+    return;
+}
+
+
+/*  Locks the [mutex] on behalf of the lock site [site], recording whether
+ *    the acquisition was contended and, if so, how long it waited.
+ *  Returns 0 on success, or an error number on failure.
+ */
+int
+lockprof_lock (pthread_mutex_t *mutex, lockprof_site_t *site)
+{
+    struct timespec  t0;
+    struct timespec  t1;
+    double           secs = 0.0;
+    int              is_contended = 0;
+    int              e;
+
+    assert (mutex != NULL);
+    assert (site != NULL);
+
+    e = pthread_mutex_trylock (mutex);
+    if (e == EBUSY) {
+        is_contended = 1;
+        (void) clock_gettime (CLOCK_MONOTONIC, &t0);
+        e = pthread_mutex_lock (mutex);
+        (void) clock_gettime (CLOCK_MONOTONIC, &t1);
+        secs = _lockprof_diff_secs (&t0, &t1);
+    }
+    if (e != 0) {
+        return (e);
+    }
+    if ((e = pthread_mutex_lock (&site->mutex)) != 0) {
+        (void) pthread_mutex_unlock (mutex);
+        return (e);
+    }
+    site->n_acquired++;
+    if (is_contended) {
+        site->n_contended++;
+        site->wait_secs += secs;
+        if (secs > site->max_secs) {
+            site->max_secs = secs;
+        }
+        site->hist [_lockprof_hist_index (secs)]++;
+    }
+    if (!site->is_registered) {
+        /*
+         *  Lock order is always site before list.
+         */
+        if (pthread_mutex_lock (&_lockprof_mutex) == 0) {
+            site->next = _lockprof_sites;
+            _lockprof_sites = site;
+            _lockprof_n_sites++;
+            site->is_registered = 1;
+            (void) pthread_mutex_unlock (&_lockprof_mutex);
+        }
+    }
+    (void) pthread_mutex_unlock (&site->mutex);
+    return (0);
+}
+
+
+/*  Logs the statistics of each lock site acquired so far, in decreasing
+ *    order of total wait time.
+ */
+void
+lockprof_report (void)
+{
+    lockprof_site_t **ptrs;
+    lockprof_site_t  *sites;
+    lockprof_site_t  *sp;
+    int               n;
+    int               i;
+    int               e;
+
+    if (!lockprof_is_enabled) {
+        return;
+    }
+    if ((e = pthread_mutex_lock (&_lockprof_mutex)) != 0) {
+        errno = e;
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock lockprof mutex");
+    }
+    n = _lockprof_n_sites;
+    ptrs = (n > 0) ? malloc (n * sizeof (*ptrs)) : NULL;
+    if (ptrs != NULL) {
+        for (i = 0, sp = _lockprof_sites; i < n; i++, sp = sp->next) {
+            assert (sp != NULL);
+            ptrs[i] = sp;
+        }
+    }
+    if ((e = pthread_mutex_unlock (&_lockprof_mutex)) != 0) {
+        errno = e;
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to unlock lockprof mutex");
+    }
+    sites = (n > 0) ? malloc (n * sizeof (*sites)) : NULL;
+    if ((n > 0) && ((ptrs == NULL) || (sites == NULL))) {
+        log_msg (LOG_WARNING, "Failed to allocate lock profile report");
+        free (ptrs);
+        free (sites);
+        return;
+    }
+    /*  Copy each site under its own mutex (and without the list mutex in
+     *    order to respect the lock order) so the report can be logged
+     *    without holding either.
+     */
+    for (i = 0; i < n; i++) {
+        if ((e = pthread_mutex_lock (&ptrs[i]->mutex)) != 0) {
+            errno = e;
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to lock lockprof site mutex");
+        }
+        sites[i] = *ptrs[i];
+        if ((e = pthread_mutex_unlock (&ptrs[i]->mutex)) != 0) {
+            errno = e;
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to unlock lockprof site mutex");
+        }
+    }
+    free (ptrs);
+
+    log_msg (LOG_INFO, "Lock profile: %d lock site%s acquired",
+            n, (n == 1) ? "" : "s");
+    if (n == 0) {
+        return;
+    }
+    qsort (sites, n, sizeof (*sites), _lockprof_site_cmp);
+    for (i = 0; i < n; i++) {
+        _lockprof_site_report (&sites[i]);
+    }
+    free (sites);
+    return;
+}
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static double
+_lockprof_diff_secs (const struct timespec *t0, const struct timespec *t1)
+{
+/*  Returns the number of seconds from [t0] to [t1].
+ */
+    return ((double) (t1->tv_sec - t0->tv_sec)
+            + ((double) (t1->tv_nsec - t0->tv_nsec) / 1e9));
+}
+
+
+static int
+_lockprof_hist_index (double secs)
+{
+/*  Returns the histogram bucket for a wait of [secs] seconds.
+ */
+    double usecs = secs * 1e6;
+    int    i;
+
+    for (i = 0; i < LOCKPROF_HIST_LEN - 1; i++) {
+        if (usecs < (double) (1UL << i)) {
+            break;
+        }
+    }
+    return (i);
+}
+
+
+static int
+_lockprof_site_cmp (const void *p1, const void *p2)
+{
+/*  Compares lock sites for sorting in decreasing order of total wait time,
+ *    then of acquisitions.
+ */
+    const lockprof_site_t *s1 = p1;
+    const lockprof_site_t *s2 = p2;
+
+    if (s1->wait_secs != s2->wait_secs) {
+        return ((s1->wait_secs < s2->wait_secs) ? 1 : -1);
+    }
+    if (s1->n_acquired != s2->n_acquired) {
+        return ((s1->n_acquired < s2->n_acquired) ? 1 : -1);
+    }
+    return (0);
+}
+
+
+static void
+_lockprof_site_report (const lockprof_site_t *sp)
+{
+/*  Logs the statistics for the lock site [sp], followed by its wait-time
+ *    histogram if it was ever contended.
+ */
+    const char *file;
+    char        buf [512];
+    char       *p;
+    int         len;
+    int         n;
+    int         i;
+
+    file = strrchr (sp->file, '/');
+    file = (file != NULL) ? file + 1 : sp->file;
+
+    log_msg (LOG_INFO,
+            "Lock %s at %s:%d: %lu acquired, %lu contended (%0.2f%%), "
+            "wait %0.6fs (avg %0.1fus, max %0.1fus)",
+            sp->name, file, sp->line, sp->n_acquired, sp->n_contended,
+            (sp->n_acquired > 0)
+                ? (100.0 * sp->n_contended / sp->n_acquired) : 0.0,
+            sp->wait_secs,
+            (sp->n_contended > 0)
+                ? (sp->wait_secs * 1e6 / sp->n_contended) : 0.0,
+            sp->max_secs * 1e6);
+
+    if (sp->n_contended == 0) {
+        return;
+    }
+    p = buf;
+    len = sizeof (buf);
+    for (i = 0; i < LOCKPROF_HIST_LEN; i++) {
+        if (sp->hist[i] == 0) {
+            continue;
+        }
+        n = snprintf (p, len, " %s%luus:%lu",
+                (i < LOCKPROF_HIST_LEN - 1) ? "<" : ">=",
+                (i < LOCKPROF_HIST_LEN - 1) ? (1UL << i) : (1UL << (i - 1)),
+                sp->hist[i]);
+        if ((n < 0) || (n >= len)) {
+            break;
+        }
+        p += n;
+        len -= n;
+    }
+    log_msg (LOG_INFO, "Lock %s at %s:%d wait histogram:%s",
+            sp->name, file, sp->line, buf);
+    return;
+}
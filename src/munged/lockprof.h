@@ -0,0 +1,111 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#ifndef LOCKPROF_H
+#define LOCKPROF_H
+
+
+#include <pthread.h>
+
+
+/*****************************************************************************
+ *  Constants
+ *****************************************************************************/
+
+/*  Number of buckets in the wait-time histogram of a lock site.
+ *  Bucket 0 counts waits under 1us; bucket i counts waits in [2^(i-1),2^i)us;
+ *    the last bucket counts everything longer.
+ */
+#define LOCKPROF_HIST_LEN               16
+
+
+/*****************************************************************************
+ *  Data Types
+ *****************************************************************************/
+
+/*  Acquisition statistics for a lock site.
+ *  A site is declared statically (via LOCKPROF_SITE_INITIALIZER) where the
+ *    mutex is locked, and registered for reporting upon its first profiled
+ *    acquisition.  Its statistics are protected by its own [mutex] since the
+ *    same site may lock different mutex instances (e.g., one per hash table).
+ */
+struct lockprof_site {
+    const char             *name;       /* lock description                  */
+    const char             *file;       /* source file of the lock site      */
+    int                     line;       /* source line of the lock site      */
+    pthread_mutex_t         mutex;      /* protects the fields below         */
+    struct lockprof_site   *next;       /* next registered site              */
+    unsigned                is_registered:1; /* true if in the site list     */
+    unsigned long           n_acquired; /* number of acquisitions            */
+    unsigned long           n_contended;/* number of contended acquisitions  */
+    double                  wait_secs;  /* total secs waited for the lock    */
+    double                  max_secs;   /* longest wait for the lock in secs */
+    unsigned long           hist [LOCKPROF_HIST_LEN];   /* wait histogram    */
+};
+
+typedef struct lockprof_site lockprof_site_t;
+
+#define LOCKPROF_SITE_INITIALIZER(name)                                       \
+    { (name), __FILE__, __LINE__, PTHREAD_MUTEX_INITIALIZER }
+
+
+/*****************************************************************************
+ *  External Variables
+ *****************************************************************************/
+
+extern int lockprof_is_enabled;         /* defined in lockprof.c             */
+
+
+/*****************************************************************************
+ *  Macros
+ *****************************************************************************/
+
+/*  Locks the mutex [pmutex] on behalf of the lock site [psite].
+ *  Returns 0 on success, or an error number on failure (as per
+ *    pthread_mutex_lock()).
+ *  When profiling is disabled, this costs a single branch.
+ */
+#define lockprof_mutex_lock(pmutex, psite)                                    \
+    (lockprof_is_enabled                                                      \
+        ? lockprof_lock ((pmutex), (psite))                                   \
+        : pthread_mutex_lock (pmutex))
+
+
+/*****************************************************************************
+ *  Prototypes
+ *****************************************************************************/
+
+void lockprof_init (int enable);
+
+void lockprof_fini (void);
+
+int lockprof_lock (pthread_mutex_t *mutex, lockprof_site_t *site);
+
+void lockprof_report (void);
+
+
+#endif /* !LOCKPROF_H */
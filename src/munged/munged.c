@@ -46,16 +46,19 @@
 #include <sys/types.h>
 #include <sys/un.h>
 #include <unistd.h>
+#include "audit.h"
 #include "auth_recv.h"
 #include "cipher.h"
 #include "common.h"
 #include "conf.h"
 #include "crypto.h"
 #include "daemonpipe.h"
+#include "fd.h"
 #include "gids.h"
 #include "hash.h"
 #include "job.h"
 #include "lock.h"
+#include "lockprof.h"
 #include "log.h"
 #include "md.h"
 #include "munge_defs.h"
@@ -63,8 +66,14 @@
 #include "random.h"
 #include "replay.h"
 #include "str.h"
+#include "suite.h"
 #include "timer.h"
+#include "trace.h"
+#include "upgrade.h"
+#include "usage.h"
 #include "xsignal.h"
+#include "zcache.h"
+#include "zip.h"
 
 
 /*****************************************************************************
@@ -73,14 +82,16 @@
 
 static void disable_core_dumps (void);
 static void daemonize_init (char *progname, conf_t conf);
-static void daemonize_fini (void);
+static void daemonize_fini (int do_notify);
 static void open_logfile (const char *logfile, int priority, int got_force);
 static void handle_signals (void);
 static void sig_handler (int sig);
 static void write_pidfile (const char *pidfile, int got_force);
 static void lock_memory (void);
+static void check_listeners (conf_t conf);
 static void sock_create (conf_t conf);
-static void sock_destroy (conf_t conf);
+static int sock_bind (conf_t conf, const char *name, int do_lock);
+static void sock_destroy (conf_t conf, int do_unlink);
 
 
 /*****************************************************************************
@@ -89,6 +100,7 @@ static void sock_destroy (conf_t conf);
 
 volatile sig_atomic_t got_reconfig = 0;     /* signum if HUP received        */
 volatile sig_atomic_t got_terminate = 0;    /* signum if INT/TERM received   */
+volatile sig_atomic_t got_upgrade = 0;      /* signum if USR2 received       */
 
 
 /*****************************************************************************
@@ -101,6 +113,8 @@ main (int argc, char *argv[])
     char *log_identity = argv[0];
     int   log_priority = LOG_INFO;
     int   log_options = LOG_OPT_PRIORITY;
+    int   got_takeover;
+    int   do_unlink;
 
 #ifndef NDEBUG
     log_priority = LOG_DEBUG;
@@ -109,14 +123,26 @@ main (int argc, char *argv[])
     log_open_file (stderr, log_identity, log_priority, log_options);
 
     disable_core_dumps ();
+    upgrade_init (argc, argv);
     conf = create_conf ();
     parse_cmdline (conf, argc, argv);
     process_conf (conf);
+    if (conf->log_priority >= 0) {
+        log_priority = conf->log_priority;
+        log_set_priority (log_priority);
+    }
+    got_takeover = (conf->upgrade_fd >= 0);
     auth_recv_init (conf->auth_server_dir, conf->auth_client_dir,
         conf->got_force);
 
     if (!conf->got_foreground) {
-        daemonize_init (argv[0], conf);
+        /*
+         *  When taking over from an old daemon during an upgrade, the process
+         *    is already detached (having been fork/exec'd by the old daemon).
+         */
+        if (!got_takeover) {
+            daemonize_init (argv[0], conf);
+        }
         if (conf->got_syslog) {
             log_close_file ();
             log_open_syslog (log_identity, LOG_DAEMON);
@@ -132,9 +158,14 @@ main (int argc, char *argv[])
     if (conf->got_mlockall) {
         lock_memory ();
     }
+    lockprof_init (conf->got_lock_stats);
     crypto_init ();
     cipher_init_subsystem ();
     md_init_subsystem ();
+    suite_init ();
+    check_listeners (conf);
+    zip_init (conf->zip_threads);
+    zcache_init (conf->zip_cache_len);
     if (random_init (conf->seed_name) < 0) {
         if (conf->seed_name) {
             free (conf->seed_name);
@@ -144,23 +175,45 @@ main (int argc, char *argv[])
     create_subkeys (conf);
     conf->gids = gids_create (conf->gids_update_secs, conf->got_group_stat);
     replay_init ();
+    usage_init (conf);
+    audit_init (conf);
+    trace_init (conf);
     timer_init ();
-    sock_create (conf);
+    if (got_takeover) {
+        upgrade_recv_state (conf);
+    }
+    else {
+        sock_create (conf);
+    }
     write_pidfile (conf->pidfile_name, conf->got_force);
 
     if (!conf->got_foreground) {
-        daemonize_fini ();
+        daemonize_fini (!got_takeover);
     }
     job_accept (conf);
 
-    sock_destroy (conf);
+    /*  On upgrade, the socket, lockfile, and pidfile now belong to the new
+     *    daemon and must not be removed.
+     */
+    do_unlink = !upgrade_is_pending ();
+    if (!do_unlink) {
+        upgrade_send_state (conf);
+    }
+    sock_destroy (conf, do_unlink);
+    upgrade_fini ();
+    usage_fini ();
+    audit_fini ();
+    trace_fini ();
     timer_fini ();
+    zip_fini ();
+    zcache_fini ();
     replay_fini ();
     gids_destroy (conf->gids);
     hash_drop_memory ();
+    lockprof_fini ();
     random_fini (conf->seed_name);
     crypto_fini ();
-    destroy_conf (conf, 1);
+    destroy_conf (conf, do_unlink);
 
     log_msg (LOG_NOTICE, "Stopping %s-%s daemon (pid %d)",
         PACKAGE, VERSION, (int) getpid ());
@@ -276,9 +329,10 @@ daemonize_init (char *progname, conf_t conf)
 
 
 static void
-daemonize_fini (void)
+daemonize_fini (int do_notify)
 {
 /*  Completes the daemonization of the process.
+ *  If [do_notify] is set, the original parent process is signaled to exit.
  */
     int dev_null;
 
@@ -314,6 +368,9 @@ daemonize_fini (void)
      *    daemonpipe_close_writes() closes the daemonpipe which will cause
      *    daemonpipe_read() to read an EOF.
      */
+    if (!do_notify) {
+        return;
+    }
     if (daemonpipe_write (0, 0, NULL) < 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR,
             "Failed to signal parent process that startup is complete");
@@ -446,6 +503,13 @@ handle_signals (void)
                 "Failed to set handler for signal %d (%s)", sig,
                 strsignal (sig));
     }
+    sig = SIGUSR2;
+    rv = sigaction (sig, &sa, NULL);
+    if (rv == -1) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to set handler for signal %d (%s)", sig,
+                strsignal (sig));
+    }
     xsignal_ignore (SIGPIPE);
     return;
 }
@@ -460,6 +524,9 @@ sig_handler (int sig)
     else if ((sig == SIGINT) || (sig == SIGTERM)) {
         got_terminate = sig;
     }
+    else if (sig == SIGUSR2) {
+        got_upgrade = sig;
+    }
     return;
 }
 
@@ -585,9 +652,73 @@ lock_memory (void)
 }
 
 
+static void
+check_listeners (conf_t conf)
+{
+/*  Validates the default cipher & mac combination of each additional socket
+ *    now that the crypto subsystems have been initialized, and bounds its
+ *    default ttl by the configuration's max ttl.
+ */
+    listener_t l;
+    suite_t    s;
+
+    assert (conf != NULL);
+
+    for (l = conf->listeners; l != NULL; l = l->next) {
+        s = suite_get (l->def_cipher, l->def_mac);
+        if (!s || !s->is_valid) {
+            log_err (EMUNGE_SNAFU, LOG_ERR,
+                "Invalid MAC type %d with cipher type %d for socket \"%s\"",
+                l->def_mac, l->def_cipher, l->socket_name);
+        }
+        if (l->def_ttl > conf->max_ttl) {
+            l->def_ttl = conf->max_ttl;
+        }
+    }
+    return;
+}
+
+
 static void
 sock_create (conf_t conf)
 {
+/*  Creates the primary socket (along with its lockfile) and any additional
+ *    sockets.  When there are additional sockets, all sockets are set
+ *    non-blocking since they are multiplexed with poll().
+ */
+    listener_t l;
+
+    assert (conf != NULL);
+
+    if (conf->socket_name == NULL) {
+        log_err (EMUNGE_SNAFU, LOG_ERR, "MUNGE socket name is undefined");
+    }
+    conf->ld = sock_bind (conf, conf->socket_name, 1);
+
+    for (l = conf->listeners; l != NULL; l = l->next) {
+        l->ld = sock_bind (conf, l->socket_name, 0);
+        if (fd_set_nonblocking (l->ld) < 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to set nonblocking socket \"%s\"", l->socket_name);
+        }
+    }
+    if ((conf->listeners != NULL) && (fd_set_nonblocking (conf->ld) < 0)) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to set nonblocking socket \"%s\"", conf->socket_name);
+    }
+    log_msg (LOG_INFO, "Set socket listen backlog to %d",
+            conf->listen_backlog);
+    return;
+}
+
+
+static int
+sock_bind (conf_t conf, const char *name, int do_lock)
+{
+/*  Creates the socket [name] and listens on it.
+ *  If [do_lock] is set, the lockfile is created beforehand.
+ *  Returns the listening socket descriptor.
+ */
     size_t              path_len;
     char                sockdir [PATH_MAX];
     char                ebuf [1024];
@@ -597,11 +728,12 @@ sock_create (conf_t conf)
     int                 rv;
 
     assert (conf != NULL);
+    assert (name != NULL);
 
-    if ((conf->socket_name == NULL) || (*conf->socket_name == '\0')) {
+    if (*name == '\0') {
         log_err (EMUNGE_SNAFU, LOG_ERR, "MUNGE socket name is undefined");
     }
-    path_len = strnlen (conf->socket_name, sizeof addr.sun_path);
+    path_len = strnlen (name, sizeof addr.sun_path);
     if (path_len >= sizeof addr.sun_path) {
         log_err (EMUNGE_SNAFU, LOG_ERR,
             "Exceeded maximum length of %lu bytes for socket pathname",
@@ -609,10 +741,10 @@ sock_create (conf_t conf)
     }
     /*  Ensure socket dir is secure against modification by others.
      */
-    rv = path_dirname (conf->socket_name, sockdir, sizeof (sockdir));
+    rv = path_dirname (name, sockdir, sizeof (sockdir));
     if (rv < 0) {
         log_err (EMUNGE_SNAFU, LOG_ERR,
-            "Failed to determine dirname of socket \"%s\"", conf->socket_name);
+            "Failed to determine dirname of socket \"%s\"", name);
     }
     rv = path_is_secure (sockdir, ebuf, sizeof (ebuf), PATH_SECURITY_NO_FLAGS);
     if (rv < 0) {
@@ -634,21 +766,23 @@ sock_create (conf_t conf)
     }
     /*  Create lockfile for exclusive access to the socket.
      */
-    lock_create (conf);
+    if (do_lock) {
+        lock_create (conf);
+    }
     /*
      *  Remove existing socket from previous instance.
      */
     do {
-        rv = unlink (conf->socket_name);
+        rv = unlink (name);
     } while ((rv < 0) && (errno == EINTR));
 
     if ((rv < 0) && (errno != ENOENT)) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to remove socket \"%s\"",
-            conf->socket_name);
+            name);
     }
     else if (rv == 0) {
         log_msg (LOG_INFO, "Removed existing socket \"%s\"",
-            conf->socket_name);
+            name);
     }
     /*  Create socket for communicating with clients.
      */
@@ -658,7 +792,7 @@ sock_create (conf_t conf)
     }
     memset (&addr, 0, sizeof (addr));
     addr.sun_family = AF_UNIX;
-    memcpy (addr.sun_path, conf->socket_name, path_len + 1);
+    memcpy (addr.sun_path, name, path_len + 1);
     /*
      *  Ensure socket is accessible by all.
      */
@@ -668,30 +802,31 @@ sock_create (conf_t conf)
 
     if (rv < 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR,
-            "Failed to bind socket \"%s\"", conf->socket_name);
+            "Failed to bind socket \"%s\"", name);
     }
     if (listen (sd, conf->listen_backlog) < 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR,
-            "Failed to listen on socket \"%s\"", conf->socket_name);
+            "Failed to listen on socket \"%s\"", name);
     }
-    conf->ld = sd;
-    log_msg (LOG_INFO, "Created socket \"%s\"", conf->socket_name);
-    log_msg (LOG_INFO, "Set socket listen backlog to %d",
-            conf->listen_backlog);
-    return;
+    log_msg (LOG_INFO, "Created socket \"%s\"", name);
+    return (sd);
 }
 
 
 static void
-sock_destroy (conf_t conf)
+sock_destroy (conf_t conf, int do_unlink)
 {
-    int rv;
+/*  Closes the sockets and lockfile.
+ *  If [do_unlink] is set, the sockets and lockfile are also removed.
+ */
+    listener_t l;
+    int        rv;
 
     assert (conf != NULL);
     assert (conf->ld >= 0);
     assert (conf->socket_name != NULL);
 
-    if (conf->socket_name) {
+    if (conf->socket_name && do_unlink) {
         do {
             rv = unlink (conf->socket_name);
         } while ((rv < 0) && (errno == EINTR));
@@ -709,7 +844,27 @@ sock_destroy (conf_t conf)
         }
         conf->ld = -1;
     }
-    if (conf->lockfile_name) {
+    for (l = conf->listeners; l != NULL; l = l->next) {
+        if (do_unlink) {
+            do {
+                rv = unlink (l->socket_name);
+            } while ((rv < 0) && (errno == EINTR));
+
+            if (rv < 0) {
+                log_msg (LOG_WARNING, "Failed to remove socket \"%s\": %s",
+                    l->socket_name, strerror (errno));
+            }
+        }
+        if (l->ld >= 0) {
+            rv = close (l->ld);
+            if (rv < 0) {
+                log_msg (LOG_WARNING, "Failed to close socket \"%s\": %s",
+                    l->socket_name, strerror (errno));
+            }
+            l->ld = -1;
+        }
+    }
+    if (conf->lockfile_name && do_unlink) {
         do {
             rv = unlink (conf->lockfile_name);
         } while ((rv < 0) && (errno == EINTR));
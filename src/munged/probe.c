@@ -0,0 +1,597 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <munge.h>
+#include "clock.h"
+#include "conf.h"
+#include "fd.h"
+#include "log.h"
+#include "m_msg.h"
+#include "munge_defs.h"
+#include "probe.h"
+#include "thread.h"
+
+
+/*****************************************************************************
+ *  Notes
+ *****************************************************************************
+ *
+ *  The probe periodically performs an encode/decode round trip through the
+ *  daemon's own request queue in order to detect when munged is slow before
+ *  clients start failing.  Each request is sent over one end of a socketpair
+ *  while the other end is queued as if it had just been accepted; this
+ *  exercises the same receive, authentication, crypto, and send paths as a
+ *  client request.  Credentials decoded by the probe are flagged so they are
+ *  not inserted into the replay hash.
+ *
+ *  The probe runs in its own thread since queueing a request blocks while
+ *  the request queue is full, and the round trip can take up to the socket
+ *  timeouts.  A stalled queue thereby delays only the probe (and is itself
+ *  reported as a slow or failed probe), not the timer thread.
+ *
+ *  The daemon is considered unhealthy while the round-trip latency exceeds
+ *  the threshold (or the probe fails).  A message is logged on each change
+ *  in health, and the probe metrics are logged on SIGHUP and at shutdown.
+ */
+
+
+/*****************************************************************************
+ *  Private Data Types
+ *****************************************************************************/
+
+typedef struct probe {
+    pthread_mutex_t     lock;           /* mutex for accessing struct        */
+    pthread_mutex_t     t_lock;         /* mutex for accessing t_dequeued    */
+    pthread_cond_t      cond;           /* cond for waking the probe thread  */
+    pthread_t           tid;            /* probe thread ID                   */
+    probe_queue_f       queue;          /* function to queue request msgs    */
+    int                 interval_secs;  /* seconds between probes            */
+    int                 threshold_msecs;/* latency threshold for health      */
+    int                 got_fini;       /* true prevents further probes      */
+    int                 is_healthy;     /* true if last probe was healthy    */
+    struct timespec     t_dequeued;     /* time at which probe msg dequeued  */
+    /*
+     *  Metrics (protected by the mutex).
+     */
+    unsigned long       n_probes;       /* number of probes performed        */
+    unsigned long       n_failed;       /* number of probes that failed      */
+    unsigned long       n_slow;         /* number of probes over threshold   */
+    double              last_secs;      /* latency of last successful probe  */
+    double              max_secs;       /* max latency of successful probes  */
+    double              total_secs;     /* total latency of successful probes*/
+    double              max_wait_secs;  /* max secs probe msgs were queued   */
+    double              wait_secs;      /* total secs probe msgs were queued */
+} probe_t;
+
+
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static void * _probe_thread (void *arg);
+static void _probe_update (int rv, double latency_secs, double wait_secs);
+static int  _probe_round_trip (double *latency_secs, double *wait_secs);
+static int  _probe_xfer (m_msg_t mreq, m_msg_type_t type, m_msg_t *pmrsp,
+        double *wait_secs);
+static void _probe_set_health (int is_healthy, const char *reason);
+static double _probe_diff_secs (const struct timespec *t0,
+        const struct timespec *t1);
+static void _probe_get_time (struct timespec *tsp);
+
+
+/*****************************************************************************
+ *  Private Variables
+ *****************************************************************************/
+
+static probe_t _probe = {
+    .lock   = PTHREAD_MUTEX_INITIALIZER,
+    .t_lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond   = PTHREAD_COND_INITIALIZER,
+};
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+/*  Starts the latency probe thread, queueing its request messages via
+ *    [queue].
+ */
+void
+probe_init (conf_t conf, probe_queue_f queue)
+{
+    assert (conf != NULL);
+    assert (queue != NULL);
+
+    if ((conf->probe_interval_secs <= 0) || (conf->got_benchmark)) {
+        log_msg (LOG_INFO, "Disabled latency probe");
+        return;
+    }
+#if defined (AUTH_METHOD_RECVFD_MKFIFO) || defined (AUTH_METHOD_RECVFD_MKNOD)
+    /*  These auth methods require the client to pass a file descriptor back
+     *    to the server, which the probe does not implement.
+     */
+    log_msg (LOG_INFO, "Disabled latency probe: Unsupported auth method");
+    return;
+#endif /* AUTH_METHOD_RECVFD_MKFIFO || AUTH_METHOD_RECVFD_MKNOD */
+
+    lsd_mutex_lock (&_probe.lock);
+    _probe.queue = queue;
+    _probe.interval_secs = conf->probe_interval_secs;
+    _probe.threshold_msecs = conf->probe_threshold_msecs;
+    _probe.got_fini = 0;
+    _probe.is_healthy = 1;
+    if ((errno = pthread_create (&_probe.tid, NULL, _probe_thread, NULL))
+            != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to create probe thread");
+    }
+    lsd_mutex_unlock (&_probe.lock);
+
+    log_msg (LOG_INFO,
+            "Probing latency every %d second%s with %d msec threshold",
+            conf->probe_interval_secs,
+            (conf->probe_interval_secs == 1) ? "" : "s",
+            conf->probe_threshold_msecs);
+    return;
+}
+
+
+/*  Stops the latency probe thread, waiting for a probe in progress to
+ *    complete, and logs its final metrics.
+ *  This must be called before the request queue is destroyed.
+ */
+void
+probe_fini (void)
+{
+    lsd_mutex_lock (&_probe.lock);
+    if (_probe.queue == NULL) {
+        lsd_mutex_unlock (&_probe.lock);
+        return;
+    }
+    _probe.got_fini = 1;
+    if ((errno = pthread_cond_signal (&_probe.cond)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to signal probe thread");
+    }
+    lsd_mutex_unlock (&_probe.lock);
+
+    if ((errno = pthread_join (_probe.tid, NULL)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to join probe thread");
+    }
+
+    probe_report ();
+
+    lsd_mutex_lock (&_probe.lock);
+    _probe.queue = NULL;
+    lsd_mutex_unlock (&_probe.lock);
+    return;
+}
+
+
+/*  Notes the time at which the request message [m] was dequeued for
+ *    processing if [m] was queued by the latency probe.
+ */
+void
+probe_dequeue (m_msg_t m)
+{
+    assert (m != NULL);
+
+    if (!m->is_probe) {
+        return;
+    }
+    lsd_mutex_lock (&_probe.t_lock);
+    _probe_get_time (&_probe.t_dequeued);
+    lsd_mutex_unlock (&_probe.t_lock);
+    return;
+}
+
+
+/*  Logs the latency probe metrics.
+ */
+void
+probe_report (void)
+{
+    unsigned long n_probes;
+    unsigned long n_failed;
+    unsigned long n_slow;
+    unsigned long n_good;
+    double        last_secs;
+    double        max_secs;
+    double        avg_secs;
+    double        max_wait_secs;
+    double        avg_wait_secs;
+    int           is_healthy;
+
+    lsd_mutex_lock (&_probe.lock);
+    if (_probe.queue == NULL) {
+        lsd_mutex_unlock (&_probe.lock);
+        return;
+    }
+    n_probes = _probe.n_probes;
+    n_failed = _probe.n_failed;
+    n_slow = _probe.n_slow;
+    n_good = n_probes - n_failed;
+    last_secs = _probe.last_secs;
+    max_secs = _probe.max_secs;
+    avg_secs = (n_good > 0) ? (_probe.total_secs / n_good) : 0.0;
+    max_wait_secs = _probe.max_wait_secs;
+    avg_wait_secs = (n_good > 0) ? (_probe.wait_secs / n_good) : 0.0;
+    is_healthy = _probe.is_healthy;
+    lsd_mutex_unlock (&_probe.lock);
+
+    log_msg (LOG_INFO,
+            "Probe: %lu round trip%s (%lu failed, %lu slow), "
+            "latency last %0.6fs avg %0.6fs max %0.6fs, "
+            "queue wait avg %0.6fs max %0.6fs, status %s",
+            n_probes, (n_probes == 1) ? "" : "s", n_failed, n_slow,
+            last_secs, avg_secs, max_secs, avg_wait_secs, max_wait_secs,
+            (is_healthy ? "healthy" : "unhealthy"));
+    return;
+}
+
+
+/*  Returns true (non-zero) if the most recent probe completed within the
+ *    latency threshold (or if the probe is disabled); o/w, returns false.
+ */
+int
+probe_is_healthy (void)
+{
+    int is_healthy;
+
+    lsd_mutex_lock (&_probe.lock);
+    is_healthy = (_probe.queue == NULL) || _probe.is_healthy;
+    lsd_mutex_unlock (&_probe.lock);
+    return (is_healthy);
+}
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static void *
+_probe_thread (void *arg)
+{
+/*  Performs a probe every interval until probe_fini() is called.
+ *  The mutex is released during the round trip so the metrics can still be
+ *    reported while the request queue is stalled.
+ */
+    sigset_t        sigset;
+    struct timespec ts;
+    double          latency_secs;
+    double          wait_secs;
+    int             rv;
+
+    if (sigfillset (&sigset)) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to init probe sigset");
+    }
+    if (pthread_sigmask (SIG_SETMASK, &sigset, NULL) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to set probe sigset");
+    }
+    lsd_mutex_lock (&_probe.lock);
+    while (!_probe.got_fini) {
+        (void) clock_get_timespec (&ts, _probe.interval_secs * 1000);
+        rv = 0;
+        while (!_probe.got_fini && (rv != ETIMEDOUT)) {
+            rv = pthread_cond_timedwait (&_probe.cond, &_probe.lock, &ts);
+        }
+        if (_probe.got_fini) {
+            break;
+        }
+        lsd_mutex_unlock (&_probe.lock);
+
+        latency_secs = 0.0;
+        wait_secs = 0.0;
+        rv = _probe_round_trip (&latency_secs, &wait_secs);
+
+        lsd_mutex_lock (&_probe.lock);
+        _probe_update (rv, latency_secs, wait_secs);
+    }
+    lsd_mutex_unlock (&_probe.lock);
+    return (NULL);
+}
+
+
+static void
+_probe_update (int rv, double latency_secs, double wait_secs)
+{
+/*  Updates the metrics and health with the result of a probe returning
+ *    [rv] after [latency_secs] of which [wait_secs] were spent queued.
+ *  The mutex must be held when calling this routine.
+ */
+    char buf [64];
+
+    _probe.n_probes++;
+
+    if (rv < 0) {
+        _probe.n_failed++;
+        _probe_set_health (0, "Probe request failed");
+    }
+    else {
+        _probe.last_secs = latency_secs;
+        _probe.total_secs += latency_secs;
+        if (latency_secs > _probe.max_secs) {
+            _probe.max_secs = latency_secs;
+        }
+        _probe.wait_secs += wait_secs;
+        if (wait_secs > _probe.max_wait_secs) {
+            _probe.max_wait_secs = wait_secs;
+        }
+        if (latency_secs * 1000.0 > _probe.threshold_msecs) {
+            _probe.n_slow++;
+            (void) snprintf (buf, sizeof (buf),
+                    "Probe latency %0.6fs (queue wait %0.6fs) exceeded %dms",
+                    latency_secs, wait_secs, _probe.threshold_msecs);
+            _probe_set_health (0, buf);
+        }
+        else {
+            (void) snprintf (buf, sizeof (buf),
+                    "Probe latency %0.6fs within %dms",
+                    latency_secs, _probe.threshold_msecs);
+            _probe_set_health (1, buf);
+        }
+    }
+    return;
+}
+
+
+static int
+_probe_round_trip (double *latency_secs, double *wait_secs)
+{
+/*  Encodes and decodes an empty credential through the request queue.
+ *  Sets [latency_secs] to the end-to-end latency, and [wait_secs] to the
+ *    total time the requests spent queued.
+ *  Returns 0 on success, or -1 on error.
+ */
+    struct timespec t_start;
+    struct timespec t_stop;
+    m_msg_t         menc = NULL;
+    m_msg_t         mdec = NULL;
+    m_msg_t         mrsp = NULL;
+    double          enc_wait_secs = 0.0;
+    double          dec_wait_secs = 0.0;
+    int             rv = -1;
+
+    _probe_get_time (&t_start);
+
+    if (m_msg_create (&menc) != EMUNGE_SUCCESS) {
+        log_msg (LOG_WARNING, "Failed to create probe encode request");
+        goto end;
+    }
+    menc->cipher = MUNGE_CIPHER_DEFAULT;
+    menc->mac = MUNGE_MAC_DEFAULT;
+    menc->zip = MUNGE_ZIP_DEFAULT;
+    menc->ttl = MUNGE_TTL_DEFAULT;
+    menc->auth_uid = MUNGE_UID_ANY;
+    menc->auth_gid = MUNGE_GID_ANY;
+
+    if (_probe_xfer (menc, MUNGE_MSG_ENC_REQ, &mrsp, &enc_wait_secs) < 0) {
+        goto end;
+    }
+    if (m_msg_create (&mdec) != EMUNGE_SUCCESS) {
+        log_msg (LOG_WARNING, "Failed to create probe decode request");
+        goto end;
+    }
+    mdec->data_len = strlen (mrsp->data) + 1;
+    mdec->data = mrsp->data;
+    mdec->data_is_copy = 1;
+
+    if (_probe_xfer (mdec, MUNGE_MSG_DEC_REQ, NULL, &dec_wait_secs) < 0) {
+        goto end;
+    }
+    _probe_get_time (&t_stop);
+    *latency_secs = _probe_diff_secs (&t_start, &t_stop);
+    *wait_secs = enc_wait_secs + dec_wait_secs;
+    rv = 0;
+
+end:
+    if (mdec != NULL) {
+        m_msg_destroy (mdec);
+    }
+    if (mrsp != NULL) {
+        m_msg_destroy (mrsp);
+    }
+    if (menc != NULL) {
+        m_msg_destroy (menc);
+    }
+    return (rv);
+}
+
+
+static int
+_probe_xfer (m_msg_t mreq, m_msg_type_t type, m_msg_t *pmrsp,
+        double *wait_secs)
+{
+/*  Queues a request over a new socketpair, sends the request message [mreq]
+ *    of [type], and receives the response.
+ *  If [pmrsp] is non-NULL, it is set to the response message (which must
+ *    be destroyed by the caller).
+ *  Sets [wait_secs] to the time the request spent queued.
+ *  Returns 0 on success, or -1 on error.
+ */
+    m_msg_type_t    rsp_type;
+    m_msg_t         msrv = NULL;
+    m_msg_t         mrsp = NULL;
+    int             sv[2] = { -1, -1 };
+    struct timespec t_queued;
+    struct timespec t_dequeued;
+    munge_err_t     e;
+    int             rv = -1;
+
+    rsp_type = (type == MUNGE_MSG_ENC_REQ)
+        ? MUNGE_MSG_ENC_RSP : MUNGE_MSG_DEC_RSP;
+
+    if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        log_msg (LOG_WARNING, "Failed to create probe socketpair: %s",
+                strerror (errno));
+        return (-1);
+    }
+    /*  The server end is set non-blocking as in job_accept().
+     */
+    if (fd_set_nonblocking (sv[0]) < 0) {
+        log_msg (LOG_WARNING, "Failed to set nonblocking probe socket: %s",
+                strerror (errno));
+        (void) close (sv[0]);
+        (void) close (sv[1]);
+        return (-1);
+    }
+    if ((m_msg_create (&msrv) != EMUNGE_SUCCESS)
+            || (m_msg_bind (msrv, sv[0]) != EMUNGE_SUCCESS)) {
+        log_msg (LOG_WARNING, "Failed to create probe server request");
+        if (msrv != NULL) {
+            m_msg_destroy (msrv);
+        }
+        (void) close (sv[0]);
+        (void) close (sv[1]);
+        return (-1);
+    }
+    msrv->is_probe = 1;
+
+    lsd_mutex_lock (&_probe.t_lock);
+    _probe.t_dequeued.tv_sec = 0;
+    _probe.t_dequeued.tv_nsec = 0;
+    lsd_mutex_unlock (&_probe.t_lock);
+
+    _probe_get_time (&t_queued);
+    if (_probe.queue (msrv) < 0) {
+        log_msg (LOG_WARNING, "Failed to queue probe request");
+        m_msg_destroy (msrv);
+        (void) close (sv[1]);
+        return (-1);
+    }
+    /*  Ownership of [msrv] (and sv[0]) has passed to the request queue.
+     */
+    if (m_msg_bind (mreq, sv[1]) != EMUNGE_SUCCESS) {
+        log_msg (LOG_WARNING, "Failed to bind probe request");
+        (void) close (sv[1]);
+        return (-1);
+    }
+    if ((e = m_msg_send (mreq, type, MUNGE_MAXIMUM_REQ_LEN))
+            != EMUNGE_SUCCESS) {
+        log_msg (LOG_WARNING, "Failed to send probe request: %s",
+                (mreq->error_str ? mreq->error_str : munge_strerror (e)));
+    }
+    else if ((e = m_msg_create (&mrsp)) != EMUNGE_SUCCESS) {
+        log_msg (LOG_WARNING, "Failed to create probe response");
+    }
+    else if ((e = m_msg_bind (mrsp, mreq->sd)) != EMUNGE_SUCCESS) {
+        log_msg (LOG_WARNING, "Failed to bind probe response");
+    }
+    else if ((e = m_msg_recv (mrsp, rsp_type, 0)) != EMUNGE_SUCCESS) {
+        log_msg (LOG_WARNING, "Failed to receive probe response: %s",
+                (mrsp->error_str ? mrsp->error_str : munge_strerror (e)));
+    }
+    else if (mrsp->error_num != EMUNGE_SUCCESS) {
+        log_msg (LOG_WARNING, "Probe %s failed: %s",
+                (type == MUNGE_MSG_ENC_REQ) ? "encode" : "decode",
+                (mrsp->error_str ? mrsp->error_str
+                                 : munge_strerror (mrsp->error_num)));
+    }
+    else if ((type == MUNGE_MSG_ENC_REQ) && (mrsp->data_len == 0)) {
+        log_msg (LOG_WARNING, "Probe encode returned no credential");
+    }
+    else {
+        rv = 0;
+    }
+    /*  The request and response share the socket; only the request closes it.
+     */
+    if (mrsp != NULL) {
+        mrsp->sd = -1;
+    }
+    (void) close (mreq->sd);
+    mreq->sd = -1;
+
+    lsd_mutex_lock (&_probe.t_lock);
+    t_dequeued = _probe.t_dequeued;
+    lsd_mutex_unlock (&_probe.t_lock);
+
+    if ((t_dequeued.tv_sec != 0) || (t_dequeued.tv_nsec != 0)) {
+        *wait_secs = _probe_diff_secs (&t_queued, &t_dequeued);
+    }
+    if ((rv == 0) && (pmrsp != NULL)) {
+        *pmrsp = mrsp;
+    }
+    else if (mrsp != NULL) {
+        m_msg_destroy (mrsp);
+    }
+    return (rv);
+}
+
+
+static void
+_probe_set_health (int is_healthy, const char *reason)
+{
+/*  Sets the health flag to [is_healthy], logging [reason] on a change.
+ *  The mutex must be held when calling this routine.
+ */
+    if (is_healthy == _probe.is_healthy) {
+        return;
+    }
+    _probe.is_healthy = is_healthy;
+    if (is_healthy) {
+        log_msg (LOG_NOTICE, "Recovered from slow request processing: %s",
+                reason);
+    }
+    else {
+        log_msg (LOG_WARNING, "Detected slow request processing: %s",
+                reason);
+    }
+    return;
+}
+
+
+static double
+_probe_diff_secs (const struct timespec *t0, const struct timespec *t1)
+{
+/*  Returns the number of seconds elapsed from [t0] to [t1].
+ */
+    return ((t1->tv_sec - t0->tv_sec) + ((t1->tv_nsec - t0->tv_nsec) / 1e9));
+}
+
+
+static void
+_probe_get_time (struct timespec *tsp)
+{
+/*  Sets [tsp] to the current time of the monotonic clock.
+ */
+    if (clock_gettime (CLOCK_MONOTONIC, tsp) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to query current time");
+    }
+    return;
+}
@@ -0,0 +1,62 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#ifndef PROBE_H
+#define PROBE_H
+
+
+#include "conf.h"
+#include "m_msg.h"
+
+
+/*****************************************************************************
+ *  Data Types
+ *****************************************************************************/
+
+typedef int (*probe_queue_f) (m_msg_t m);
+/*
+ *  Function prototype for queueing a request message [m] for processing.
+ *  Returns 0 on success, or -1 on error.
+ */
+
+
+/*****************************************************************************
+ *  Functions
+ *****************************************************************************/
+
+void probe_init (conf_t conf, probe_queue_f queue);
+
+void probe_fini (void);
+
+void probe_dequeue (m_msg_t m);
+
+void probe_report (void);
+
+int probe_is_healthy (void);
+
+
+#endif /* !PROBE_H */
@@ -0,0 +1,305 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <munge.h>
+#include "clock.h"
+#include "log.h"
+#include "reclog.h"
+#include "thread.h"
+
+
+/*****************************************************************************
+ *  Notes
+ *****************************************************************************
+ *
+ *  A record log buffers fixed-length binary records for the audit log and
+ *  the request trace so that workers never touch the file.  A record is
+ *  copied into one of RECLOG_NUM_SHARDS in-memory buffers (selected by a key
+ *  such as the client's socket descriptor so concurrent requests rarely
+ *  share a buffer), and a dedicated writer thread drains all buffers into a
+ *  single write every RECLOG_FLUSH_MSECS or as soon as a buffer is half
+ *  full.  If a buffer fills up before it can be drained, records are dropped
+ *  and counted rather than stalling the response to the client.
+ *
+ *  The file itself is managed by the owner's write callback.
+ */
+
+
+/*****************************************************************************
+ *  Constants
+ *****************************************************************************/
+
+#define RECLOG_NUM_SHARDS       16
+#define RECLOG_SHARD_RECS       512
+#define RECLOG_FLUSH_MSECS      100
+
+
+/*****************************************************************************
+ *  Private Data Types
+ *****************************************************************************/
+
+struct reclog_shard {
+    pthread_mutex_t     mutex;          /* mutex for accessing shard         */
+    int                 n;              /* num records copied into buf       */
+    unsigned long       n_dropped;      /* num records dropped when full     */
+    unsigned char      *buf;            /* RECLOG_SHARD_RECS records         */
+};
+
+struct reclog {
+    pthread_mutex_t     mutex;          /* mutex for accessing is_done       */
+    pthread_cond_t      cond;           /* cond for waking writer thread     */
+    pthread_t           tid;            /* writer thread ID                  */
+    int                 is_done;        /* true if writer thread should exit */
+    char               *desc;           /* description for log messages      */
+    size_t              rec_len;        /* length of each packed record      */
+    reclog_write_f      write_f;        /* function to write batched records */
+    void               *arg;            /* arg passed to write_f             */
+    unsigned char      *batch;          /* buf for batching all shards' recs */
+    unsigned long       n_written;      /* num records written               */
+    unsigned long       n_lost;         /* num records lost on write error   */
+    struct reclog_shard shards[RECLOG_NUM_SHARDS];
+};
+
+
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static void * _reclog_thread (void *arg);
+static void _reclog_flush (reclog_t log);
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+/*  Creates a record log of [rec_len]-byte records described as [desc] in
+ *    log messages, and starts its writer thread.  Batched records are written
+ *    by calling [write_f] with [arg].
+ *  Returns the new record log; errors are fatal.
+ */
+reclog_t
+reclog_create (const char *desc, size_t rec_len,
+        reclog_write_f write_f, void *arg)
+{
+    reclog_t log;
+    int      i;
+
+    assert (desc != NULL);
+    assert (rec_len > 0);
+    assert (write_f != NULL);
+
+    if (!(log = calloc (1, sizeof (*log)))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+                "Failed to allocate %s", desc);
+    }
+    if (!(log->desc = strdup (desc))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+                "Failed to copy %s description", desc);
+    }
+    if (!(log->batch = malloc (rec_len * RECLOG_SHARD_RECS
+                    * RECLOG_NUM_SHARDS))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+                "Failed to allocate %s buffer", desc);
+    }
+    for (i = 0; i < RECLOG_NUM_SHARDS; i++) {
+        if (!(log->shards[i].buf = malloc (rec_len * RECLOG_SHARD_RECS))) {
+            log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+                    "Failed to allocate %s buffer", desc);
+        }
+        lsd_mutex_init (&log->shards[i].mutex);
+    }
+    lsd_mutex_init (&log->mutex);
+    if ((errno = pthread_cond_init (&log->cond, NULL)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to init %s condition", desc);
+    }
+    log->rec_len = rec_len;
+    log->write_f = write_f;
+    log->arg = arg;
+    log->is_done = 0;
+
+    if ((errno = pthread_create (&log->tid, NULL, _reclog_thread, log))
+            != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to create %s thread", desc);
+    }
+    return (log);
+}
+
+
+/*  Flushes pending records, stops the writer thread of the record log [log],
+ *    and destroys it.
+ *  Sets [n_written] and [n_dropped] to the number of records written and
+ *    dropped (either when a buffer was full or on a write error).
+ *  The log file can be closed by its owner afterwards.
+ */
+void
+reclog_destroy (reclog_t log,
+        unsigned long *n_written, unsigned long *n_dropped)
+{
+    int i;
+
+    assert (log != NULL);
+    assert (n_written != NULL);
+    assert (n_dropped != NULL);
+
+    lsd_mutex_lock (&log->mutex);
+    log->is_done = 1;
+    if ((errno = pthread_cond_signal (&log->cond)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to signal %s thread", log->desc);
+    }
+    lsd_mutex_unlock (&log->mutex);
+
+    if ((errno = pthread_join (log->tid, NULL)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to join %s thread", log->desc);
+    }
+    *n_written = log->n_written;
+    *n_dropped = log->n_lost;
+    for (i = 0; i < RECLOG_NUM_SHARDS; i++) {
+        *n_dropped += log->shards[i].n_dropped;
+        lsd_mutex_destroy (&log->shards[i].mutex);
+        free (log->shards[i].buf);
+    }
+
+    (void) pthread_cond_destroy (&log->cond);
+    lsd_mutex_destroy (&log->mutex);
+    free (log->batch);
+    free (log->desc);
+    free (log);
+    return;
+}
+
+
+/*  Appends the packed record [rec] to the record log [log] in the buffer
+ *    selected by [key].
+ *  This never blocks on file I/O; if the buffer is full, the record is
+ *    dropped.
+ */
+void
+reclog_append (reclog_t log, unsigned int key, const unsigned char *rec)
+{
+    struct reclog_shard *sp;
+    int                  do_signal = 0;
+
+    assert (log != NULL);
+    assert (rec != NULL);
+
+    sp = &log->shards[key % RECLOG_NUM_SHARDS];
+
+    lsd_mutex_lock (&sp->mutex);
+    if (sp->n >= RECLOG_SHARD_RECS) {
+        sp->n_dropped++;
+    }
+    else {
+        memcpy (sp->buf + (sp->n * log->rec_len), rec, log->rec_len);
+        sp->n++;
+        do_signal = (sp->n == RECLOG_SHARD_RECS / 2);
+    }
+    lsd_mutex_unlock (&sp->mutex);
+
+    /*  The writer is signaled without holding its mutex.  A lost wakeup only
+     *    delays the flush until the writer's next timeout.
+     */
+    if (do_signal) {
+        (void) pthread_cond_signal (&log->cond);
+    }
+    return;
+}
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static void *
+_reclog_thread (void *arg)
+{
+/*  Drains the per-shard buffers of the record log [arg] until
+ *    reclog_destroy() is called, at which point the remaining records are
+ *    written out.
+ */
+    reclog_t        log = arg;
+    struct timespec ts;
+    int             is_done = 0;
+
+    while (!is_done) {
+        lsd_mutex_lock (&log->mutex);
+        if (!log->is_done) {
+            (void) clock_get_timespec (&ts, RECLOG_FLUSH_MSECS);
+            (void) pthread_cond_timedwait (&log->cond, &log->mutex, &ts);
+        }
+        is_done = log->is_done;
+        lsd_mutex_unlock (&log->mutex);
+
+        _reclog_flush (log);
+    }
+    return (NULL);
+}
+
+
+static void
+_reclog_flush (reclog_t log)
+{
+/*  Moves the records from all shards of [log] into the batch buffer and
+ *    writes them in a single batch.
+ *  Each shard's mutex is held only for the memcpy.
+ */
+    struct reclog_shard *sp;
+    size_t               len = 0;
+    size_t               n;
+    int                  i;
+
+    for (i = 0; i < RECLOG_NUM_SHARDS; i++) {
+        sp = &log->shards[i];
+        lsd_mutex_lock (&sp->mutex);
+        n = sp->n * log->rec_len;
+        memcpy (log->batch + len, sp->buf, n);
+        sp->n = 0;
+        lsd_mutex_unlock (&sp->mutex);
+        len += n;
+    }
+    if (log->write_f (log->batch, len, log->arg) < 0) {
+        log->n_lost += len / log->rec_len;
+    }
+    else {
+        log->n_written += len / log->rec_len;
+    }
+    return;
+}
@@ -0,0 +1,68 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#ifndef RECLOG_H
+#define RECLOG_H
+
+
+#include <stddef.h>
+
+
+/*****************************************************************************
+ *  Data Types
+ *****************************************************************************/
+
+typedef struct reclog * reclog_t;
+/*
+ *  Record log opaque data type.
+ */
+
+typedef int (*reclog_write_f) (const unsigned char *buf, size_t len,
+        void *arg);
+/*
+ *  Function prototype for writing [len] bytes of packed fixed-length records
+ *    in [buf] to the log file, passing [arg] from reclog_create().
+ *  This is called from the writer thread after each flush interval, with
+ *    [len] of 0 if no records are pending.
+ *  Returns 0 on success, or -1 if the records were lost.
+ */
+
+
+/*****************************************************************************
+ *  Functions
+ *****************************************************************************/
+
+reclog_t reclog_create (const char *desc, size_t rec_len,
+        reclog_write_f write_f, void *arg);
+
+void reclog_destroy (reclog_t log,
+        unsigned long *n_written, unsigned long *n_dropped);
+
+void reclog_append (reclog_t log, unsigned int key, const unsigned char *rec);
+
+
+#endif /* !RECLOG_H */
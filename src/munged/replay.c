@@ -31,9 +31,12 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include "clock.h"
 #include "conf.h"
 #include "cred.h"
 #include "hash.h"
@@ -52,6 +55,11 @@
 #define REPLAY_HASH_SIZE        65537
 #define REPLAY_NODE_ALLOC_NUM   1024
 
+/*  Length of a packed replay_t object:
+ *    64-bit expiration time + truncated mac.
+ */
+#define REPLAY_PACK_LEN         (sizeof (uint64_t) + MUNGE_MINIMUM_MD_LEN)
+
 
 /*****************************************************************************
  *  Private Data Types
@@ -69,6 +77,13 @@ union replay_node {
 
 typedef union replay_node * replay_t;
 
+struct replay_pack {
+    unsigned char     *buf;             /* buffer of packed replay_t objects */
+    size_t             len;             /* number of bytes used in buffer    */
+    size_t             max;             /* number of bytes allocated         */
+    time_t             now;             /* time at which packing started     */
+};
+
 
 /*****************************************************************************
  *  Private Prototypes
@@ -80,12 +95,16 @@ static int replay_cmp_f (const replay_t r1, const replay_t r2);
 
 static int replay_is_expired (replay_t r, void *key, time_t *pnow);
 
+static int replay_pack_node (replay_t r, void *key, struct replay_pack *p);
+
 static replay_t replay_alloc (void);
 
 static void replay_free (replay_t r);
 
 static void replay_drop_memory (void);
 
+static time_t replay_get_t_expired (munge_cred_t c);
+
 
 /*****************************************************************************
  *  Private Variables
@@ -161,9 +180,14 @@ replay_fini (void)
  *    is canceled via timer_fini() as soon as munged's event loop is exited.
  *    And shortly _thereafter_, this routine is invoked.
  */
+    int n;
+
     if (!replay_hash) {
         return;
     }
+    n = hash_count (replay_hash);
+    log_msg (LOG_INFO, "Replay hash: %d credential%s at exit",
+        n, ((n == 1) ? "" : "s"));
     hash_destroy (replay_hash);
     replay_hash = NULL;
     replay_drop_memory ();
@@ -182,7 +206,6 @@ replay_insert (munge_cred_t c)
  *    Returns 1 if the credential is already present (ie, replay).
  *    Returns -1 on error with errno set.
  */
-    m_msg_t   m;
     int       e;
     replay_t  r;
 
@@ -196,12 +219,10 @@ replay_insert (munge_cred_t c)
         errno = EINVAL;
         return (-1);
     }
-    m = c->msg;
-
     if (!(r = replay_alloc ())) {
         return (-1);
     }
-    r->data.t_expired = (time_t) (m->time0 + m->ttl);
+    r->data.t_expired = replay_get_t_expired (c);
     assert (c->mac_len >= sizeof (r->data.mac));
     memcpy (r->data.mac, c->mac, sizeof (r->data.mac));
     /*
@@ -229,7 +250,6 @@ replay_remove (munge_cred_t c)
 {
 /*  Removes the credential [c] from the replay hash.
  */
-    m_msg_t            m;
     union replay_node  rnode;
     replay_t           r;
 
@@ -243,11 +263,9 @@ replay_remove (munge_cred_t c)
         errno = EINVAL;
         return (-1);
     }
-    m = c->msg;
-
     /*  Compute the cred's "hash key".
      */
-    rnode.data.t_expired = (time_t) (m->time0 + m->ttl);
+    rnode.data.t_expired = replay_get_t_expired (c);
     assert (c->mac_len >= sizeof (rnode.data.mac));
     memcpy (rnode.data.mac, c->mac, sizeof (rnode.data.mac));
 
@@ -270,7 +288,7 @@ replay_purge (void)
     if (!replay_hash) {
         return;
     }
-    if (time (&now) == (time_t) -1) {
+    if (clock_get_time (&now) < 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to query current time");
     }
     n = hash_delete_if (replay_hash, (hash_arg_f) replay_is_expired, &now);
@@ -287,6 +305,104 @@ replay_purge (void)
 }
 
 
+int
+replay_pack (void **bufp, size_t *lenp)
+{
+/*  Packs the unexpired credentials in the replay hash into a newly-allocated
+ *    buffer in order to hand them off to another munged process on this host.
+ *    The caller is responsible for free()ing the buffer.
+ *  Sets [*bufp] and [*lenp] to the buffer and its length in bytes.
+ *  Returns the number of credentials packed, or -1 on error with errno set.
+ */
+    struct replay_pack p;
+    int                n;
+
+    if ((bufp == NULL) || (lenp == NULL)) {
+        errno = EINVAL;
+        return (-1);
+    }
+    *bufp = NULL;
+    *lenp = 0;
+
+    if (!replay_hash) {
+        return (0);
+    }
+    if (clock_get_time (&p.now) < 0) {
+        return (-1);
+    }
+    /*  The hash cannot grow while being packed since the caller is expected
+     *    to have stopped processing requests.  It can only shrink via
+     *    replay_purge(), so any entries beyond the initial count are skipped.
+     */
+    n = hash_count (replay_hash);
+    if (n <= 0) {
+        return (0);
+    }
+    p.len = 0;
+    p.max = n * REPLAY_PACK_LEN;
+    if (!(p.buf = malloc (p.max))) {
+        return (-1);
+    }
+    n = hash_for_each (replay_hash, (hash_arg_f) replay_pack_node, &p);
+    *bufp = p.buf;
+    *lenp = p.len;
+    return (n);
+}
+
+
+int
+replay_unpack (const void *buf, size_t len)
+{
+/*  Unpacks credentials from [buf] of length [len] (as created by
+ *    replay_pack() in another munged process) and inserts the unexpired
+ *    ones into the replay hash.
+ *  Returns the number of credentials inserted, or -1 on error with errno set.
+ */
+    const unsigned char *p;
+    uint64_t             t_expired;
+    time_t               now;
+    replay_t             r;
+    int                  n = 0;
+
+    if ((buf == NULL) && (len > 0)) {
+        errno = EINVAL;
+        return (-1);
+    }
+    if ((len % REPLAY_PACK_LEN) != 0) {
+        errno = EINVAL;
+        return (-1);
+    }
+    if (!replay_hash) {
+        return (0);
+    }
+    if (clock_get_time (&now) < 0) {
+        return (-1);
+    }
+    for (p = buf; len > 0; p += REPLAY_PACK_LEN, len -= REPLAY_PACK_LEN) {
+        memcpy (&t_expired, p, sizeof (t_expired));
+        if ((time_t) t_expired < now) {
+            continue;
+        }
+        if (!(r = replay_alloc ())) {
+            return (-1);
+        }
+        r->data.t_expired = (time_t) t_expired;
+        memcpy (r->data.mac, p + sizeof (t_expired), sizeof (r->data.mac));
+
+        if (hash_insert (replay_hash, r, r) != NULL) {
+            n++;
+        }
+        else {
+            replay_free (r);
+            if (errno != EEXIST) {
+                return (-1);
+            }
+        }
+    }
+    return (n);
+}
+
+
 /*****************************************************************************
  *  Private Functions
  *****************************************************************************/
@@ -302,6 +418,22 @@ replay_key_f (const replay_t r)
 }
 
 
+static time_t
+replay_get_t_expired (munge_cred_t c)
+{
+/*  Returns the time after which the credential [c] expires for the replay
+ *    hash key.
+ *  The cred's own ttl is bounded only by MUNGE_MAXIMUM_TTL (and not by the
+ *    configuration's max ttl) so the key of a cred in the replay hash does
+ *    not change if the max ttl is reconfigured.
+ */
+    uint32_t ttl;
+
+    ttl = (c->ttl < MUNGE_MAXIMUM_TTL) ? c->ttl : MUNGE_MAXIMUM_TTL;
+    return ((time_t) (c->msg->time0 + ttl));
+}
+
+
 static int
 replay_cmp_f (const replay_t r1, const replay_t r2)
 {
@@ -337,6 +469,29 @@ replay_is_expired (replay_t r, void *key, time_t *pnow)
 }
 
 
+static int
+replay_pack_node (replay_t r, void *key, struct replay_pack *p)
+{
+/*  Appends the unexpired replay_t object [r] to the pack buffer [p].
+ *  Returns 1 if the object was packed, or 0 if not.
+ */
+    uint64_t t_expired;
+
+    if (r->data.t_expired < p->now) {
+        return (0);
+    }
+    if (p->len + REPLAY_PACK_LEN > p->max) {
+        return (0);
+    }
+    t_expired = (uint64_t) r->data.t_expired;
+    memcpy (p->buf + p->len, &t_expired, sizeof (t_expired));
+    memcpy (p->buf + p->len + sizeof (t_expired), r->data.mac,
+            sizeof (r->data.mac));
+    p->len += REPLAY_PACK_LEN;
+    return (1);
+}
+
+
 static replay_t
 replay_alloc (void)
 {
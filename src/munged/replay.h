@@ -29,6 +29,7 @@
 #define REPLAY_H
 
 
+#include <stddef.h>
 #include "cred.h"
 
 
@@ -46,5 +47,9 @@ int replay_remove (munge_cred_t c);
 
 void replay_purge (void);
 
+int replay_pack (void **bufp, size_t *lenp);
+
+int replay_unpack (const void *buf, size_t len);
+
 
 #endif /* !REPLAY_H */
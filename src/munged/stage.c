@@ -0,0 +1,549 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************
+ *  Refer to "stage.h" for documentation on public functions.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <munge.h>
+#include "log.h"
+#include "stage.h"
+#include "thread.h"
+
+
+/*****************************************************************************
+ *  Notes
+ *****************************************************************************
+ *
+ *  A stage is a pool of threads servicing a bounded FIFO queue.  Stages are
+ *  chained together (in the style of SEDA) by having the function of one stage
+ *  queue its output onto the next.  Since a queue is bounded, stage_queue()
+ *  blocks while the queue is full; this propagates back-pressure upstream to
+ *  the accept loop (and ultimately to the listen backlog) instead of letting
+ *  the queues grow without bound.
+ *
+ *  A stage thread dequeues up to [batch_len] items at a time, thereby
+ *  amortizing the locking overhead across the batch.  It does not wait for
+ *  a batch to fill; it takes whatever is available.
+ *
+ *  Unlike the work crew in "work.c", stage threads are not canceled.  Instead,
+ *  stage_fini() closes the queue and waits for the threads to drain it.  This
+ *  allows a pipeline to be shut down in order from its head to its tail
+ *  without losing any requests in flight.
+ */
+
+
+/*****************************************************************************
+ *  Private Data Types
+ *****************************************************************************/
+
+typedef struct stage_item {
+    void               *item;           /* item describing work to be done   */
+    struct timespec     t_queued;       /* time at which item was queued     */
+} stage_item_t, *stage_item_p;
+
+typedef struct stage {
+    pthread_mutex_t     lock;           /* mutex for accessing struct        */
+    pthread_cond_t      not_empty;      /* cond for when queue is not empty  */
+    pthread_cond_t      not_full;       /* cond for when queue is not full   */
+    pthread_cond_t      finished_work;  /* cond for when all work is done    */
+    char               *name;           /* stage name for log messages       */
+    stage_func_t        func;           /* function to perform work in queue */
+    pthread_t          *threads;        /* ptr to array of stage thread IDs  */
+    stage_item_p        queue;          /* circular array of queued items    */
+    int                 queue_size;     /* num items allocated for the queue */
+    int                 queue_len;      /* max number of items in the queue  */
+    int                 head;           /* index of next item to dequeue     */
+    int                 count;          /* number of items in the queue      */
+    int                 batch_len;      /* max number of items per batch     */
+    int                 n_threads;      /* number of stage threads (total)   */
+    int                 n_working;      /* number of stage threads working   */
+    int                 got_fini;       /* true prevents new work after fini */
+    /*
+     *  Metrics (protected by the mutex).
+     */
+    unsigned long       n_items;        /* number of items processed         */
+    unsigned long       n_batches;      /* number of batches processed       */
+    unsigned long       n_blocked;      /* number of enqueues that blocked   */
+    int                 max_count;      /* high-water mark of queue depth    */
+    double              wait_secs;      /* total secs items spent in queue   */
+    double              busy_secs;      /* total secs spent processing work  */
+} stage_t;
+
+
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static void * _stage_exec (void *arg);
+static double _stage_diff_secs (const struct timespec *t0,
+        const struct timespec *t1);
+static void   _stage_get_time (struct timespec *tsp);
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+/*  Initializes the stage [name] comprised of [n_threads] threads servicing a
+ *    queue holding at most [queue_len] items.  The stage function [f] will be
+ *    invoked with batches of up to [batch_len] items queued by stage_queue().
+ *  Returns a ptr to the stage, or NULL on error (with errno set).
+ */
+stage_p
+stage_init (const char *name, stage_func_t f, int n_threads,
+        int queue_len, int batch_len)
+{
+    stage_p sp;
+    pthread_attr_t tattr;
+    size_t stacksize = 256 * 1024;
+    int i;
+
+    if ((name == NULL) || (f == NULL)) {
+        errno = EINVAL;
+        return (NULL);
+    }
+    if ((n_threads <= 0) || (queue_len <= 0) || (batch_len <= 0)) {
+        errno = EINVAL;
+        return (NULL);
+    }
+    if (!(sp = calloc (1, sizeof (stage_t)))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+            "Failed to allocate %s stage struct", name);
+    }
+    if (!(sp->name = strdup (name))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+            "Failed to copy %s stage name", name);
+    }
+    if (!(sp->threads = calloc (n_threads, sizeof (*sp->threads)))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+            "Failed to allocate tid array for %s stage", name);
+    }
+    if (!(sp->queue = calloc (queue_len, sizeof (*sp->queue)))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+            "Failed to allocate queue for %s stage", name);
+    }
+    if ((errno = pthread_attr_init (&tattr)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to init %s stage thread attribute", name);
+    }
+#ifdef _POSIX_THREAD_ATTR_STACKSIZE
+    if ((errno = pthread_attr_setstacksize (&tattr, stacksize)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to set %s stage thread stacksize", name);
+    }
+#endif /* _POSIX_THREAD_ATTR_STACKSIZE */
+
+    lsd_mutex_init (&sp->lock);
+
+    if ((errno = pthread_cond_init (&sp->not_empty, NULL)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to init %s stage condition for non-empty queue", name);
+    }
+    if ((errno = pthread_cond_init (&sp->not_full, NULL)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to init %s stage condition for non-full queue", name);
+    }
+    if ((errno = pthread_cond_init (&sp->finished_work, NULL)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to init %s stage condition for finished work", name);
+    }
+    sp->func = f;
+    sp->queue_size = queue_len;
+    sp->queue_len = queue_len;
+    sp->batch_len = batch_len;
+    sp->n_threads = n_threads;
+
+    for (i = 0; i < sp->n_threads; i++) {
+        if ((errno = pthread_create
+                    (&sp->threads[i], &tattr, _stage_exec, sp)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to create %s stage thread #%d", name, i+1);
+        }
+    }
+    if ((errno = pthread_attr_destroy (&tattr)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to destroy %s stage thread attribute", name);
+    }
+    log_msg (LOG_INFO, "Created %d %s stage thread%s", n_threads, name,
+            ((n_threads > 1) ? "s" : ""));
+    return (sp);
+}
+
+
+/*  Stops the stage [sp] after all currently-queued work has been processed,
+ *    logs its final metrics, and releases associated resources.  New work is
+ *    prevented from being added to the queue once this routine has been called.
+ */
+void
+stage_fini (stage_p sp)
+{
+    int i;
+
+    if (!sp) {
+        errno = EINVAL;
+        return;
+    }
+    lsd_mutex_lock (&sp->lock);
+    sp->got_fini = 1;
+    lsd_mutex_unlock (&sp->lock);
+    /*
+     *  Awaken all stage threads so idle ones can notice the queue is closed,
+     *    and all blocked producers so they can notice new work is refused.
+     */
+    if ((errno = pthread_cond_broadcast (&sp->not_empty)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to broadcast %s stage condition for non-empty queue",
+            sp->name);
+    }
+    if ((errno = pthread_cond_broadcast (&sp->not_full)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to broadcast %s stage condition for non-full queue",
+            sp->name);
+    }
+    for (i = 0; i < sp->n_threads; i++) {
+        if ((errno = pthread_join (sp->threads[i], NULL)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to join %s stage thread #%d", sp->name, i+1);
+        }
+        sp->threads[i] = 0;
+    }
+    assert (sp->count == 0);
+    stage_report (sp);
+
+    if ((errno = pthread_cond_destroy (&sp->finished_work)) != 0) {
+        log_msg (LOG_ERR,
+            "Failed to destroy %s stage condition for finished work: %s",
+            sp->name, strerror (errno));
+    }
+    if ((errno = pthread_cond_destroy (&sp->not_full)) != 0) {
+        log_msg (LOG_ERR,
+            "Failed to destroy %s stage condition for non-full queue: %s",
+            sp->name, strerror (errno));
+    }
+    if ((errno = pthread_cond_destroy (&sp->not_empty)) != 0) {
+        log_msg (LOG_ERR,
+            "Failed to destroy %s stage condition for non-empty queue: %s",
+            sp->name, strerror (errno));
+    }
+    lsd_mutex_destroy (&sp->lock);
+    free (sp->queue);
+    free (sp->threads);
+    free (sp->name);
+    free (sp);
+    return;
+}
+
+
+/*  Queues the [item] for processing by the stage [sp].
+ *    If the queue is full, this blocks until space becomes available.
+ *  Returns 0 on success, or -1 on error (with errno set).
+ */
+int
+stage_queue (stage_p sp, void *item)
+{
+    int i;
+    int rc = 0;
+
+    if (!sp || !item) {
+        errno = EINVAL;
+        return (-1);
+    }
+    lsd_mutex_lock (&sp->lock);
+
+    if ((sp->count >= sp->queue_len) && (!sp->got_fini)) {
+        sp->n_blocked++;
+        do {
+            if ((errno = pthread_cond_wait (&sp->not_full, &sp->lock)) != 0) {
+                log_errno (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to wait on %s stage for non-full queue",
+                    sp->name);
+            }
+        } while ((sp->count >= sp->queue_len) && (!sp->got_fini));
+    }
+    if (sp->got_fini) {
+        errno = EPERM;
+        rc = -1;
+    }
+    else {
+        i = (sp->head + sp->count) % sp->queue_size;
+        sp->queue[i].item = item;
+        _stage_get_time (&sp->queue[i].t_queued);
+        sp->count++;
+        if (sp->count > sp->max_count) {
+            sp->max_count = sp->count;
+        }
+    }
+    lsd_mutex_unlock (&sp->lock);
+
+    if (rc == 0) {
+        if ((errno = pthread_cond_signal (&sp->not_empty)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to signal %s stage for non-empty queue", sp->name);
+        }
+    }
+    return (rc);
+}
+
+
+/*  Changes the maximum number of items in the queue of stage [sp] to
+ *    [queue_len].  If the queue is shrunk below its current depth, queued
+ *    items are kept and stage_queue() blocks until the depth drops below
+ *    the new limit.
+ *  Returns 0 on success, or -1 on error (with errno set).
+ */
+int
+stage_set_queue_len (stage_p sp, int queue_len)
+{
+    stage_item_p queue;
+    int          i;
+
+    if (!sp || (queue_len <= 0)) {
+        errno = EINVAL;
+        return (-1);
+    }
+    lsd_mutex_lock (&sp->lock);
+
+    if (queue_len > sp->queue_size) {
+        if (!(queue = calloc (queue_len, sizeof (*queue)))) {
+            lsd_mutex_unlock (&sp->lock);
+            errno = ENOMEM;
+            return (-1);
+        }
+        /*  Unwrap the circular array so the queued items start at index 0.
+         */
+        for (i = 0; i < sp->count; i++) {
+            queue[i] = sp->queue[(sp->head + i) % sp->queue_size];
+        }
+        free (sp->queue);
+        sp->queue = queue;
+        sp->queue_size = queue_len;
+        sp->head = 0;
+    }
+    sp->queue_len = queue_len;
+    lsd_mutex_unlock (&sp->lock);
+
+    if ((errno = pthread_cond_broadcast (&sp->not_full)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to broadcast %s stage for non-full queue", sp->name);
+    }
+    return (0);
+}
+
+
+/*  Waits until all queued work is processed by the stage [sp].
+ */
+void
+stage_wait (stage_p sp)
+{
+    if (!sp) {
+        errno = EINVAL;
+        return;
+    }
+    lsd_mutex_lock (&sp->lock);
+    while ((sp->count > 0) || (sp->n_working > 0)) {
+        if ((errno = pthread_cond_wait (&sp->finished_work, &sp->lock)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to wait on %s stage for finished work", sp->name);
+        }
+    }
+    lsd_mutex_unlock (&sp->lock);
+    return;
+}
+
+
+/*  Logs the metrics accumulated by the stage [sp].
+ */
+void
+stage_report (stage_p sp)
+{
+    unsigned long n_items;
+    unsigned long n_batches;
+    unsigned long n_blocked;
+    int           count;
+    int           max_count;
+    int           queue_len;
+    double        wait_secs;
+    double        busy_secs;
+
+    if (!sp) {
+        errno = EINVAL;
+        return;
+    }
+    lsd_mutex_lock (&sp->lock);
+    n_items = sp->n_items;
+    n_batches = sp->n_batches;
+    n_blocked = sp->n_blocked;
+    count = sp->count;
+    max_count = sp->max_count;
+    queue_len = sp->queue_len;
+    wait_secs = sp->wait_secs;
+    busy_secs = sp->busy_secs;
+    lsd_mutex_unlock (&sp->lock);
+
+    log_msg (LOG_INFO,
+            "Stage %s: %lu item%s in %lu batch%s, "
+            "avg wait %0.6fs, avg busy %0.6fs, "
+            "depth %d (max %d of %d), %lu blocked enqueue%s",
+            sp->name,
+            n_items, ((n_items == 1) ? "" : "s"),
+            n_batches, ((n_batches == 1) ? "" : "es"),
+            ((n_items > 0) ? wait_secs / n_items : 0.0),
+            ((n_items > 0) ? busy_secs / n_items : 0.0),
+            count, max_count, queue_len,
+            n_blocked, ((n_blocked == 1) ? "" : "s"));
+    return;
+}
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static void *
+_stage_exec (void *arg)
+{
+/*  The stage thread.  It continually removes the next batch of items
+ *    from the stage queue and processes it -- until the queue is closed
+ *    and drained.
+ */
+    stage_p          sp;
+    sigset_t         sigset;
+    void           **batch;
+    int              n;
+    struct timespec  t_start;
+    struct timespec  t_stop;
+    double           wait_secs;
+
+    assert (arg != NULL);
+    sp = arg;
+
+    if (sigfillset (&sigset)) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to init %s stage thread sigset", sp->name);
+    }
+    if (pthread_sigmask (SIG_SETMASK, &sigset, NULL) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to set %s stage thread sigset", sp->name);
+    }
+    if (!(batch = malloc (sp->batch_len * sizeof (*batch)))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+            "Failed to allocate batch for %s stage thread", sp->name);
+    }
+    lsd_mutex_lock (&sp->lock);
+
+    for (;;) {
+        /*
+         *  Wait for new work if none is currently queued.
+         */
+        while ((sp->count == 0) && (!sp->got_fini)) {
+            if ((errno = pthread_cond_wait
+                        (&sp->not_empty, &sp->lock)) != 0) {
+                log_errno (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to wait on %s stage for non-empty queue",
+                    sp->name);
+            }
+        }
+        if (sp->count == 0) {
+            break;                      /* queue is closed and drained */
+        }
+        /*  Dequeue a batch of whatever work is available.
+         */
+        _stage_get_time (&t_start);
+        wait_secs = 0.0;
+        for (n = 0; (n < sp->batch_len) && (sp->count > 0); n++) {
+            batch[n] = sp->queue[sp->head].item;
+            wait_secs += _stage_diff_secs
+                (&sp->queue[sp->head].t_queued, &t_start);
+            sp->queue[sp->head].item = NULL;
+            sp->head = (sp->head + 1) % sp->queue_size;
+            sp->count--;
+        }
+        sp->n_working++;
+        sp->wait_secs += wait_secs;
+        lsd_mutex_unlock (&sp->lock);
+
+        if ((errno = pthread_cond_broadcast (&sp->not_full)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to broadcast %s stage for non-full queue", sp->name);
+        }
+        /*  Process the work.
+         */
+        sp->func (batch, n);
+        _stage_get_time (&t_stop);
+
+        lsd_mutex_lock (&sp->lock);
+        sp->n_working--;
+        sp->n_items += n;
+        sp->n_batches++;
+        sp->busy_secs += _stage_diff_secs (&t_start, &t_stop);
+        /*
+         *  Check to see if all the queued work is now finished.
+         */
+        if ((sp->n_working == 0) && (sp->count == 0)) {
+            if ((errno = pthread_cond_broadcast (&sp->finished_work)) != 0) {
+                log_errno (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to broadcast %s stage for finished work",
+                    sp->name);
+            }
+        }
+    }
+    lsd_mutex_unlock (&sp->lock);
+    free (batch);
+    return (NULL);
+}
+
+
+static double
+_stage_diff_secs (const struct timespec *t0, const struct timespec *t1)
+{
+/*  Returns the number of seconds elapsed from [t0] to [t1].
+ */
+    return ((t1->tv_sec - t0->tv_sec) + ((t1->tv_nsec - t0->tv_nsec) / 1e9));
+}
+
+
+static void
+_stage_get_time (struct timespec *tsp)
+{
+/*  Sets [tsp] to the current time of the monotonic clock.
+ */
+    if (clock_gettime (CLOCK_MONOTONIC, tsp) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to query current time");
+    }
+    return;
+}
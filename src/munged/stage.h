@@ -0,0 +1,68 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#ifndef STAGE_H
+#define STAGE_H
+
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+/*****************************************************************************
+ *  Data Types
+ *****************************************************************************/
+
+typedef struct stage * stage_p;
+
+typedef void (*stage_func_t) (void **items, int n_items);
+/*
+ *  Function prototype for processing a batch of [n_items] work [items]
+ *    dequeued from a stage.
+ */
+
+
+/*****************************************************************************
+ *  Functions
+ *****************************************************************************/
+
+stage_p stage_init (const char *name, stage_func_t f, int n_threads,
+        int queue_len, int batch_len);
+
+void stage_fini (stage_p sp);
+
+int stage_queue (stage_p sp, void *item);
+
+int stage_set_queue_len (stage_p sp, int queue_len);
+
+void stage_wait (stage_p sp);
+
+void stage_report (stage_p sp);
+
+
+#endif /* !STAGE_H */
@@ -0,0 +1,137 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <assert.h>
+#include <munge.h>
+#include <string.h>
+#include "cipher.h"
+#include "log.h"
+#include "mac.h"
+#include "munge_defs.h"
+#include "suite.h"
+
+
+/*****************************************************************************
+ *  Private Data
+ *****************************************************************************/
+
+static struct suite _suite_map [MUNGE_CIPHER_LAST_ITEM][MUNGE_MAC_LAST_ITEM];
+
+static int _suite_is_initialized = 0;
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+/*  Initializes the suite dispatch table by resolving the lengths for every
+ *    supported (cipher, mac) combination.
+ *  This must be called after the cipher and md subsystems are initialized.
+ *  WARNING: This routine is *NOT* guaranteed to be thread-safe.
+ */
+void
+suite_init (void)
+{
+    struct suite *s;
+    int           c;
+    int           m;
+    int           num_valid = 0;
+
+    if (_suite_is_initialized) {
+        return;
+    }
+    memset (_suite_map, 0, sizeof (_suite_map));
+
+    for (c = 0; c < MUNGE_CIPHER_LAST_ITEM; c++) {
+        for (m = 0; m < MUNGE_MAC_LAST_ITEM; m++) {
+            s = &_suite_map [c][m];
+            s->cipher = c;
+            s->mac = m;
+
+            if ((c == MUNGE_CIPHER_DEFAULT) || (m == MUNGE_MAC_DEFAULT)) {
+                continue;
+            }
+            if (mac_map_enum (m, NULL) < 0) {
+                continue;
+            }
+            if ((s->mac_len = mac_size (m)) <= 0) {
+                continue;
+            }
+            assert (s->mac_len <= MUNGE_MAXIMUM_MD_LEN);
+
+            if (c != MUNGE_CIPHER_NONE) {
+                if (cipher_map_enum (c, NULL) < 0) {
+                    continue;
+                }
+                s->key_len = cipher_key_size (c);
+                s->iv_len = cipher_iv_size (c);
+                s->blk_len = cipher_block_size (c);
+                if ((s->key_len <= 0) || (s->iv_len < 0)
+                        || (s->blk_len <= 0)) {
+                    continue;
+                }
+                assert (s->iv_len <= MUNGE_MAXIMUM_BLK_LEN);
+                assert (s->blk_len <= MUNGE_MAXIMUM_BLK_LEN);
+            }
+            /*  The DEK is the output of the MAC, so it must be long enough to
+             *    key the cipher.
+             */
+            if (s->mac_len < s->key_len) {
+                continue;
+            }
+            s->is_valid = 1;
+            num_valid++;
+        }
+    }
+    _suite_is_initialized = 1;
+    log_msg (LOG_DEBUG, "Resolved %d cipher/mac suites", num_valid);
+    return;
+}
+
+
+/*  Returns the suite for the [cipher] and [mac] combination, or NULL if
+ *    either type is out of range.  The returned suite must still be checked
+ *    for [is_valid] before use.
+ */
+suite_t
+suite_get (munge_cipher_t cipher, munge_mac_t mac)
+{
+    assert (_suite_is_initialized);
+
+    if (((int) cipher < 0) || (cipher >= MUNGE_CIPHER_LAST_ITEM)) {
+        return (NULL);
+    }
+    if (((int) mac < 0) || (mac >= MUNGE_MAC_LAST_ITEM)) {
+        return (NULL);
+    }
+    return (&_suite_map [cipher][mac]);
+}
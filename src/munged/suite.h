@@ -0,0 +1,67 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+
+#ifndef SUITE_H
+#define SUITE_H
+
+
+#include <munge.h>
+
+
+/*****************************************************************************
+ *  Data Types
+ *****************************************************************************/
+
+/*  A cryptographic suite is a (cipher, mac) combination along with the
+ *    lengths the encode/decode pipelines need for it.  These are resolved
+ *    once at startup so the per-credential path does not have to query
+ *    the crypto library for each stage.
+ */
+struct suite {
+    munge_cipher_t      cipher;         /* cipher type                       */
+    munge_mac_t         mac;            /* message authentication code type  */
+    unsigned            is_valid:1;     /* true if combination is usable     */
+    int                 key_len;        /* cipher key length (0 if none)     */
+    int                 iv_len;         /* cipher IV length (0 if none)      */
+    int                 blk_len;        /* cipher block length (0 if none)   */
+    int                 mac_len;        /* MAC digest length (also DEK len)  */
+};
+
+typedef const struct suite * suite_t;
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+void suite_init (void);
+
+suite_t suite_get (munge_cipher_t cipher, munge_mac_t mac);
+
+
+#endif /* !SUITE_H */
@@ -33,6 +33,7 @@
 #  include <errno.h>
 #  include <pthread.h>
 #  include <stdlib.h>
+#  include "lockprof.h"
 #endif /* WITH_PTHREADS */
 
 
@@ -63,7 +64,9 @@
 
 #  define lsd_mutex_lock(pmutex)                                              \
      do {                                                                     \
-         int e = pthread_mutex_lock (pmutex);                                 \
+         static lockprof_site_t lsd_site =                                    \
+             LOCKPROF_SITE_INITIALIZER (#pmutex);                             \
+         int e = lockprof_mutex_lock (pmutex, &lsd_site);                     \
          if (e != 0) {                                                        \
              errno = e;                                                       \
              lsd_fatal_error (__FILE__, __LINE__, "mutex_lock");              \
@@ -44,6 +44,7 @@
 #include <unistd.h>
 #include <munge.h>
 #include "clock.h"
+#include "lockprof.h"
 #include "log.h"
 #include "thread.h"
 #include "timer.h"
@@ -72,6 +73,8 @@ static void * _timer_thread (void *arg);
 
 static void _timer_thread_cleanup (void *arg);
 
+static int _timer_dispatch (void);
+
 static timer_p _timer_alloc (void);
 
 
@@ -82,6 +85,8 @@ static timer_p _timer_alloc (void);
 static pthread_t       _timer_tid = 0;
 static pthread_cond_t  _timer_cond = PTHREAD_COND_INITIALIZER;
 static pthread_mutex_t _timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static lockprof_site_t _timer_site =
+    LOCKPROF_SITE_INITIALIZER ("timer");
 
 /*  The _timer_id is the ID of the last timer that was set.
  */
@@ -152,21 +157,21 @@ timer_fini (void)
     timer_p *t_prev_ptr;
     timer_p  t;
 
-    if (_timer_tid == 0) {
-        return;
-    }
-    if ((errno = pthread_cancel (_timer_tid)) != 0) {
-        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to cancel timer thread");
-    }
-    if ((errno = pthread_join (_timer_tid, &result)) != 0) {
-        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to join timer thread");
-    }
-    if (result != PTHREAD_CANCELED) {
-        log_err (EMUNGE_SNAFU, LOG_ERR, "Timer thread was not canceled");
+    if (_timer_tid != 0) {
+        if ((errno = pthread_cancel (_timer_tid)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to cancel timer thread");
+        }
+        if ((errno = pthread_join (_timer_tid, &result)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to join timer thread");
+        }
+        if (result != PTHREAD_CANCELED) {
+            log_err (EMUNGE_SNAFU, LOG_ERR, "Timer thread was not canceled");
+        }
+        _timer_tid = 0;
     }
-    _timer_tid = 0;
 
-    if ((errno = pthread_mutex_lock (&_timer_mutex)) != 0) {
+    if ((errno = lockprof_mutex_lock (&_timer_mutex, &_timer_site)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock timer mutex");
     }
     /*  Cancel pending timers by moving active timers to the inactive list.
@@ -209,7 +214,7 @@ timer_set_absolute (callback_f cb, void *arg, const struct timespec *tsp)
         errno = EINVAL;
         return (-1);
     }
-    if ((errno = pthread_mutex_lock (&_timer_mutex)) != 0) {
+    if ((errno = lockprof_mutex_lock (&_timer_mutex, &_timer_site)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock timer mutex");
     }
     if (!(t = _timer_alloc ())) {
@@ -290,7 +295,7 @@ timer_cancel (long id)
         errno = EINVAL;
         return (-1);
     }
-    if ((errno = pthread_mutex_lock (&_timer_mutex)) != 0) {
+    if ((errno = lockprof_mutex_lock (&_timer_mutex, &_timer_site)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock timer mutex");
     }
     /*  Locate the active timer specified by [id].
@@ -327,6 +332,60 @@ timer_cancel (long id)
 }
 
 
+/*  Dispatches all timers that have expired according to the current clock.
+ *    This is intended for driving timers from a virtual clock (see
+ *    clock_set_virtual()) in place of the timer thread, and should not be
+ *    called while the timer thread is running.
+ *  Returns the number of timers dispatched, or -1 on error (with errno set).
+ */
+int
+timer_run_expired (void)
+{
+    int n;
+
+    if (_timer_tid != 0) {
+        errno = EBUSY;
+        return (-1);
+    }
+    if ((errno = lockprof_mutex_lock (&_timer_mutex, &_timer_site)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock timer mutex");
+    }
+    n = _timer_dispatch ();
+
+    if ((errno = pthread_mutex_unlock (&_timer_mutex)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to unlock timer mutex");
+    }
+    return (n);
+}
+
+
+/*  Sets timespec [tsp] to the expiration time of the next active timer.
+ *  Returns 1 if an active timer exists, 0 if not, or -1 on error
+ *    (with errno set appropriately).
+ */
+int
+timer_get_next (struct timespec *tsp)
+{
+    int rv = 0;
+
+    if (tsp == NULL) {
+        errno = EINVAL;
+        return (-1);
+    }
+    if ((errno = lockprof_mutex_lock (&_timer_mutex, &_timer_site)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock timer mutex");
+    }
+    if (_timer_active) {
+        *tsp = _timer_active->ts;
+        rv = 1;
+    }
+    if ((errno = pthread_mutex_unlock (&_timer_mutex)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to unlock timer mutex");
+    }
+    return (rv);
+}
+
+
 /*****************************************************************************
  *  Private Functions
  *****************************************************************************/
@@ -339,10 +398,6 @@ _timer_thread (void *arg)
  */
     sigset_t         sigset;
     int              cancel_state;
-    struct timespec  ts_now;
-    timer_p         *t_prev_ptr;
-    timer_p          timer_expired;
-    int              rv;
 
     if (sigfillset (&sigset)) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to init timer sigset");
@@ -350,7 +405,7 @@ _timer_thread (void *arg)
     if (pthread_sigmask (SIG_SETMASK, &sigset, NULL) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to set timer sigset");
     }
-    if ((errno = pthread_mutex_lock (&_timer_mutex)) != 0) {
+    if ((errno = lockprof_mutex_lock (&_timer_mutex, &_timer_site)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock timer mutex");
     }
     pthread_cleanup_push (_timer_thread_cleanup, NULL);
@@ -377,55 +432,8 @@ _timer_thread (void *arg)
             log_errno (EMUNGE_SNAFU, LOG_ERR,
                     "Failed to disable timer thread cancellation");
         }
-        rv = clock_get_timespec (&ts_now, 0);
-        if (rv < 0) {
-            log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to query current time");
-        }
-        /*  Select expired timers.
-         */
-        t_prev_ptr = &_timer_active;
-        while (*t_prev_ptr
-                && clock_is_timespec_le (&(*t_prev_ptr)->ts, &ts_now)) {
-            t_prev_ptr = &(*t_prev_ptr)->next;
-        }
-        if (t_prev_ptr != &_timer_active) {
-            /*
-             *  Move expired timers from the active list onto an expired list.
-             *  All expired timers are dispatched before the active list is
-             *    rescanned.  This protects against an erroneous ts_now set in
-             *    the future from causing recurring timers to be continually
-             *    dispatched since ts_now will be requeried once the expired
-             *    list is processed.  (Issue 15)
-             */
-            timer_expired = _timer_active;
-            _timer_active = *t_prev_ptr;
-            *t_prev_ptr = NULL;
-            /*
-             *  Unlock the mutex while dispatching callback functions in case
-             *    any need to set/cancel timers.
-             */
-            if ((errno = pthread_mutex_unlock (&_timer_mutex)) != 0) {
-                log_errno (EMUNGE_SNAFU, LOG_ERR,
-                        "Failed to unlock timer mutex");
-            }
-            /*  Dispatch expired timers.
-             */
-            t_prev_ptr = &timer_expired;
-            while (*t_prev_ptr) {
-                (*t_prev_ptr)->f ((*t_prev_ptr)->arg);
-                t_prev_ptr = &(*t_prev_ptr)->next;
-            }
-            if ((errno = pthread_mutex_lock (&_timer_mutex)) != 0) {
-                log_errno (EMUNGE_SNAFU, LOG_ERR,
-                        "Failed to lock timer mutex");
-            }
-            /*  Move the expired timers onto the inactive list.
-             *  At the end of the previous while-loop, t_prev_ptr is the
-             *    address of the terminating NULL of the timer_expired list.
-             */
-            *t_prev_ptr = _timer_inactive;
-            _timer_inactive = timer_expired;
-        }
+        (void) _timer_dispatch ();
+
         /*  Enable the thread's cancellation state.
          *  Since enabling cancellation is not a cancellation point,
          *    a pending cancel request must be tested for.  But a
@@ -478,6 +486,73 @@ _timer_thread_cleanup (void *arg)
 }
 
 
+static int
+_timer_dispatch (void)
+{
+/*  Dispatches expired timers according to the current clock.
+ *  The mutex must be locked before calling this routine.  It is released
+ *    while the callback functions are invoked.
+ *  Returns the number of timers dispatched.
+ */
+    struct timespec  ts_now;
+    timer_p         *t_prev_ptr;
+    timer_p          timer_expired;
+    int              n = 0;
+    int              rv;
+
+    rv = clock_get_timespec (&ts_now, 0);
+    if (rv < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to query current time");
+    }
+    /*  Select expired timers.
+     */
+    t_prev_ptr = &_timer_active;
+    while (*t_prev_ptr
+            && clock_is_timespec_le (&(*t_prev_ptr)->ts, &ts_now)) {
+        t_prev_ptr = &(*t_prev_ptr)->next;
+    }
+    if (t_prev_ptr != &_timer_active) {
+        /*
+         *  Move expired timers from the active list onto an expired list.
+         *  All expired timers are dispatched before the active list is
+         *    rescanned.  This protects against an erroneous ts_now set in
+         *    the future from causing recurring timers to be continually
+         *    dispatched since ts_now will be requeried once the expired
+         *    list is processed.  (Issue 15)
+         */
+        timer_expired = _timer_active;
+        _timer_active = *t_prev_ptr;
+        *t_prev_ptr = NULL;
+        /*
+         *  Unlock the mutex while dispatching callback functions in case
+         *    any need to set/cancel timers.
+         */
+        if ((errno = pthread_mutex_unlock (&_timer_mutex)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to unlock timer mutex");
+        }
+        /*  Dispatch expired timers.
+         */
+        t_prev_ptr = &timer_expired;
+        while (*t_prev_ptr) {
+            (*t_prev_ptr)->f ((*t_prev_ptr)->arg);
+            t_prev_ptr = &(*t_prev_ptr)->next;
+            n++;
+        }
+        errno = lockprof_mutex_lock (&_timer_mutex, &_timer_site);
+        if (errno != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock timer mutex");
+        }
+        /*  Move the expired timers onto the inactive list.
+         *  At the end of the previous while-loop, t_prev_ptr is the
+         *    address of the terminating NULL of the timer_expired list.
+         */
+        *t_prev_ptr = _timer_inactive;
+        _timer_inactive = timer_expired;
+    }
+    return (n);
+}
+
+
 static timer_p
 _timer_alloc (void)
 {
@@ -60,5 +60,9 @@ long timer_set_relative (callback_f cb, void *arg, long msec);
 
 int timer_cancel (long id);
 
+int timer_run_expired (void);
+
+int timer_get_next (struct timespec *tsp);
+
 
 #endif /* !TIMER_H */
@@ -0,0 +1,334 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+#include <munge.h>
+#include "conf.h"
+#include "fd.h"
+#include "log.h"
+#include "m_msg.h"
+#include "reclog.h"
+#include "trace.h"
+#include "trace_rec.h"
+
+
+/*****************************************************************************
+ *  Notes
+ *****************************************************************************
+ *
+ *  Each encode/decode request is recorded in the request trace as a
+ *  fixed-length binary record (see "trace_rec.h") describing its arrival
+ *  time, type, payload size, cipher/mac/zip types, ttl, restrictions, error
+ *  outcome, and service time.  No UIDs, GIDs, addresses, credentials, or
+ *  payloads are recorded, so a trace captured in production can be handed
+ *  to "remunge --replay" elsewhere.
+ *
+ *  Records are buffered by a record log (see "reclog.c") the same way as the
+ *  audit log, with its writer thread calling _trace_flush() with each batch.
+ *  If a buffer fills up before it can be drained, records are dropped and
+ *  counted rather than stalling the response to the client.
+ *
+ *  Arrival times are relative to the start of the trace, so an existing
+ *  trace file is overwritten rather than appended to.
+ */
+
+
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static int _trace_flush (const unsigned char *buf, size_t len, void *arg);
+static int _trace_open (char *ebuf, size_t ebuflen);
+static unsigned long long _trace_diff_usecs (const struct timespec *t0,
+        const struct timespec *t1);
+
+
+/*****************************************************************************
+ *  Private Variables
+ *****************************************************************************/
+
+static reclog_t             _trace_log = NULL;
+static struct timespec      _trace_start;
+
+/*  The following are only accessed by the writer thread once it is running.
+ */
+static char                *_trace_name = NULL;
+static int                  _trace_fd = -1;
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+/*  Creates the request trace [conf->trace_name] and starts the writer thread.
+ *  If [conf->trace_name] is NULL, requests are not traced.
+ */
+void
+trace_init (conf_t conf)
+{
+    char ebuf[1024];
+
+    assert (conf != NULL);
+
+    if (conf->trace_name == NULL) {
+        return;
+    }
+    if (!(_trace_name = strdup (conf->trace_name))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+                "Failed to copy trace-file name");
+    }
+    if (clock_gettime (CLOCK_MONOTONIC, &_trace_start) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to query monotonic clock for request trace");
+    }
+    if (_trace_open (ebuf, sizeof (ebuf)) < 0) {
+        log_err (EMUNGE_SNAFU, LOG_ERR, "%s", ebuf);
+    }
+    _trace_log = reclog_create ("request trace", TRACE_REC_LEN, _trace_flush,
+            NULL);
+
+    log_msg (LOG_INFO, "Recording client requests in trace \"%s\"",
+            _trace_name);
+    return;
+}
+
+
+/*  Flushes pending records to the request trace, stops the writer thread,
+ *    and closes the request trace.
+ */
+void
+trace_fini (void)
+{
+    unsigned long n_written;
+    unsigned long n_dropped;
+
+    if (_trace_log == NULL) {
+        return;
+    }
+    reclog_destroy (_trace_log, &n_written, &n_dropped);
+    _trace_log = NULL;
+
+    if (_trace_fd >= 0) {
+        if (close (_trace_fd) < 0) {
+            log_msg (LOG_WARNING, "Failed to close request trace \"%s\": %s",
+                    _trace_name, strerror (errno));
+        }
+        _trace_fd = -1;
+    }
+    log_msg (LOG_INFO, "Request trace: %lu record%s written, %lu dropped",
+            n_written, (n_written == 1) ? "" : "s", n_dropped);
+
+    free (_trace_name);
+    _trace_name = NULL;
+    return;
+}
+
+
+/*  Notes the arrival of the successfully received request [m] in [tp].
+ *  Internal probe requests are not traced.
+ */
+void
+trace_request (struct trace_req *tp, m_msg_t m)
+{
+    assert (tp != NULL);
+    assert (m != NULL);
+
+    tp->is_traced = 0;
+    if ((_trace_log == NULL) || m->is_probe) {
+        return;
+    }
+    if (clock_gettime (CLOCK_MONOTONIC, &tp->t_arrive) < 0) {
+        return;
+    }
+    tp->type = m->type;
+    tp->data_len = (m->type == MUNGE_MSG_ENC_REQ) ? m->data_len : 0;
+    tp->is_traced = 1;
+    return;
+}
+
+
+/*  Records the request noted in [tp] now that the response to message [m]
+ *    has been sent.
+ *  This never blocks on file I/O; if the buffer is full, the record is
+ *    dropped.
+ */
+void
+trace_record (struct trace_req *tp, m_msg_t m)
+{
+    struct timespec     now;
+    struct trace_rec    r;
+    unsigned char       buf[TRACE_REC_LEN];
+    unsigned long long  usecs;
+
+    assert (tp != NULL);
+    assert (m != NULL);
+
+    if (!tp->is_traced || (_trace_log == NULL)) {
+        return;
+    }
+    if (clock_gettime (CLOCK_MONOTONIC, &now) < 0) {
+        return;
+    }
+    memset (&r, 0, sizeof (r));
+    usecs = _trace_diff_usecs (&_trace_start, &tp->t_arrive);
+    r.arrive_secs = usecs / 1000000;
+    r.arrive_usecs = usecs % 1000000;
+    usecs = _trace_diff_usecs (&tp->t_arrive, &now);
+    r.service_usecs = (usecs > UINT32_MAX) ? UINT32_MAX : usecs;
+    /*
+     *  The encode payload was replaced by the credential in the response,
+     *    whereas the decode response carries the decoded payload.
+     */
+    r.data_len = (tp->type == MUNGE_MSG_ENC_REQ) ? tp->data_len : m->data_len;
+    r.ttl = m->ttl;
+    r.type = tp->type;
+    r.cipher = m->cipher;
+    r.mac = m->mac;
+    r.zip = m->zip;
+    if (m->auth_uid != MUNGE_UID_ANY) {
+        r.flags |= TRACE_FLAG_AUTH_UID;
+    }
+    if (m->auth_gid != MUNGE_GID_ANY) {
+        r.flags |= TRACE_FLAG_AUTH_GID;
+    }
+    r.error_num = m->error_num;
+
+    trace_rec_pack (buf, &r);
+    reclog_append (_trace_log, (unsigned int) m->sd, buf);
+    tp->is_traced = 0;
+    return;
+}
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static int
+_trace_flush (const unsigned char *buf, size_t len, void *arg)
+{
+/*  Appends the batch of [len] bytes of packed records in [buf] to the
+ *    request trace.
+ *  This is called from the record log's writer thread after each flush
+ *    interval.
+ *  Returns 0 on success, or -1 if the records were dropped.
+ */
+    if (len == 0) {
+        return (0);
+    }
+    if (fd_write_n (_trace_fd, buf, len) != (ssize_t) len) {
+        log_msg_limit (LOG_WARNING,
+                "Failed to write request trace \"%s\": %s",
+                _trace_name, strerror (errno));
+        return (-1);
+    }
+    return (0);
+}
+
+
+static int
+_trace_open (char *ebuf, size_t ebuflen)
+{
+/*  Creates the request trace (truncating any existing file), and writes
+ *    the header.
+ *  Returns 0 on success, or -1 on error (with a message written to [ebuf]).
+ */
+    unsigned char hdr[TRACE_HDR_LEN];
+    struct stat   st;
+    time_t        now;
+    int           fd;
+
+    assert (_trace_fd < 0);
+
+    fd = open (_trace_name, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND,
+            S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        (void) snprintf (ebuf, ebuflen,
+                "Failed to open request trace \"%s\": %s",
+                _trace_name, strerror (errno));
+        return (-1);
+    }
+    if (fd_set_close_on_exec (fd) < 0) {
+        (void) snprintf (ebuf, ebuflen,
+                "Failed to set close-on-exec flag for trace \"%s\": %s",
+                _trace_name, strerror (errno));
+        goto err;
+    }
+    if (fstat (fd, &st) < 0) {
+        (void) snprintf (ebuf, ebuflen,
+                "Failed to stat request trace \"%s\": %s",
+                _trace_name, strerror (errno));
+        goto err;
+    }
+    if (!S_ISREG (st.st_mode)) {
+        (void) snprintf (ebuf, ebuflen,
+                "Failed to open request trace \"%s\": Not a regular file",
+                _trace_name);
+        goto err;
+    }
+    (void) time (&now);
+    trace_hdr_pack (hdr, (uint32_t) now);
+    if (fd_write_n (fd, hdr, sizeof (hdr)) != sizeof (hdr)) {
+        (void) snprintf (ebuf, ebuflen,
+                "Failed to write request trace header \"%s\": %s",
+                _trace_name, strerror (errno));
+        goto err;
+    }
+    _trace_fd = fd;
+    return (0);
+
+err:
+    (void) close (fd);
+    return (-1);
+}
+
+
+static unsigned long long
+_trace_diff_usecs (const struct timespec *t0, const struct timespec *t1)
+{
+/*  Returns the number of microseconds from [t0] to [t1], or 0 if [t1]
+ *    precedes [t0].
+ */
+    long long usecs;
+
+    usecs = ((long long) (t1->tv_sec - t0->tv_sec) * 1000000)
+        + ((t1->tv_nsec - t0->tv_nsec) / 1000);
+    return ((usecs < 0) ? 0 : (unsigned long long) usecs);
+}
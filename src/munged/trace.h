@@ -0,0 +1,65 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#ifndef TRACE_H
+#define TRACE_H
+
+
+#include <inttypes.h>
+#include <time.h>
+#include "conf.h"
+#include "m_msg.h"
+
+
+/*****************************************************************************
+ *  Data Types
+ *****************************************************************************/
+
+/*  Per-request state collected between trace_request() and trace_record().
+ */
+struct trace_req {
+    struct timespec     t_arrive;       /* monotonic time request arrived    */
+    uint32_t            data_len;       /* length of encode payload data     */
+    uint8_t             type;           /* m_msg_type of request             */
+    unsigned            is_traced:1;    /* true if request is being traced   */
+};
+
+
+/*****************************************************************************
+ *  Functions
+ *****************************************************************************/
+
+void trace_init (conf_t conf);
+
+void trace_fini (void);
+
+void trace_request (struct trace_req *tp, m_msg_t m);
+
+void trace_record (struct trace_req *tp, m_msg_t m);
+
+
+#endif /* !TRACE_H */
@@ -0,0 +1,719 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "conf.h"
+#include "fd.h"
+#include "gids.h"
+#include "lock.h"
+#include "log.h"
+#include "munge_defs.h"
+#include "replay.h"
+#include "upgrade.h"
+
+
+/*****************************************************************************
+ *  Notes
+ *****************************************************************************
+ *
+ *  An upgrade hands off the listening socket of a running daemon to a new
+ *  daemon without ever unlinking or re-binding the socket.  Clients that
+ *  connect during the handoff wait in the listen backlog instead of failing.
+ *
+ *  On SIGUSR2, the old daemon creates a socketpair channel and fork/execs a
+ *  new daemon with its original command-line plus "--upgrade-fd=N".  The new
+ *  daemon initializes itself and writes a single byte to the channel once
+ *  it is ready to take over.  If this byte does not arrive, the new daemon
+ *  is killed and the old daemon continues as before.
+ *
+ *  Once ready, the old daemon stops accepting connections and drains its
+ *  in-flight requests.  It then passes the listening socket descriptor via
+ *  SCM_RIGHTS, followed by the replay cache and supplementary group mapping
+ *  as length-prefixed blobs.  Finally, it releases the socket lock and closes
+ *  the channel.  The new daemon acquires the lock upon reading EOF.
+ */
+
+
+/*****************************************************************************
+ *  Constants
+ *****************************************************************************/
+
+#define UPGRADE_FD_OPT          "--upgrade-fd="
+#define UPGRADE_READY           'R'
+
+
+/*****************************************************************************
+ *  Private Data
+ *****************************************************************************/
+
+static int      _upgrade_argc = 0;      /* num args in orig command-line     */
+static char   **_upgrade_argv = NULL;   /* orig command-line args            */
+static int      _upgrade_fd = -1;       /* channel between old & new daemons */
+static pid_t    _upgrade_pid = 0;       /* pid of new daemon                 */
+
+
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static char ** _upgrade_argv_create (int fd);
+static void _upgrade_argv_destroy (char **argv);
+static void _upgrade_exec (conf_t conf, char **argv, int fd);
+static int _upgrade_abort (pid_t pid);
+static int _upgrade_send_fd (int sd, int fd);
+static int _upgrade_recv_fd (int sd, const struct timeval *tvp);
+static int _upgrade_send_blob (int sd, void *buf, size_t len);
+static int _upgrade_recv_blob (int sd, void **bufp, size_t *lenp,
+        const struct timeval *tvp);
+static void _upgrade_get_timeval (struct timeval *tvp, int msecs);
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+void
+upgrade_init (int argc, char *argv[])
+{
+/*  Saves the command-line [argc] and [argv] for re-executing the daemon
+ *    on a subsequent upgrade.
+ */
+    _upgrade_argc = argc;
+    _upgrade_argv = argv;
+    return;
+}
+
+
+int
+upgrade_spawn (conf_t conf)
+{
+/*  Fork/execs a new daemon to take over the socket and waits for it to
+ *    signal that it is ready.
+ *  Returns 0 on success, or -1 on error (in which case the old daemon
+ *    should continue to service requests).
+ */
+    int             sv[2];
+    char          **argv;
+    pid_t           pid;
+    struct timeval  tv;
+    char            c;
+    ssize_t         n;
+
+    assert (conf != NULL);
+
+    if (_upgrade_fd >= 0) {
+        log_msg (LOG_WARNING, "Upgrade already in progress");
+        return (-1);
+    }
+    if ((_upgrade_argc <= 0) || (_upgrade_argv == NULL)) {
+        log_msg (LOG_WARNING, "Failed to upgrade: Command-line unknown");
+        return (-1);
+    }
+    if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        log_msg (LOG_WARNING, "Failed to create upgrade channel: %s",
+                strerror (errno));
+        return (-1);
+    }
+    if (fd_set_close_on_exec (sv[0]) < 0) {
+        log_msg (LOG_WARNING, "Failed to set close-on-exec on upgrade channel: "
+                "%s", strerror (errno));
+        (void) close (sv[0]);
+        (void) close (sv[1]);
+        return (-1);
+    }
+    /*  Build the new command-line before forking since the child should
+     *    only call async-signal-safe functions before exec.
+     */
+    if (!(argv = _upgrade_argv_create (sv[1]))) {
+        log_msg (LOG_WARNING, "Failed to create upgrade command-line");
+        (void) close (sv[0]);
+        (void) close (sv[1]);
+        return (-1);
+    }
+    pid = fork ();
+    if (pid < 0) {
+        log_msg (LOG_WARNING, "Failed to fork upgrade process: %s",
+                strerror (errno));
+        _upgrade_argv_destroy (argv);
+        (void) close (sv[0]);
+        (void) close (sv[1]);
+        return (-1);
+    }
+    if (pid == 0) {
+        _upgrade_exec (conf, argv, sv[1]);
+        _exit (127);
+    }
+    _upgrade_argv_destroy (argv);
+    (void) close (sv[1]);
+
+    log_msg (LOG_NOTICE, "Started upgrade daemon (pid %d)", (int) pid);
+
+    /*  Wait for the new daemon to become ready.  An EOF indicates it has
+     *    exited (or failed to exec).
+     */
+    _upgrade_get_timeval (&tv, MUNGE_UPGRADE_WAIT_MSECS);
+    errno = 0;
+    n = fd_timed_read_n (sv[0], &c, 1, &tv, 0);
+    if ((n != 1) || (c != UPGRADE_READY)) {
+        log_msg (LOG_WARNING, "Failed to upgrade daemon: %s",
+                (n < 0) ? strerror (errno) :
+                (errno == ETIMEDOUT) ? "Timed-out waiting for new daemon" :
+                "New daemon exited during startup");
+        (void) close (sv[0]);
+        (void) _upgrade_abort (pid);
+        return (-1);
+    }
+    _upgrade_fd = sv[0];
+    _upgrade_pid = pid;
+    return (0);
+}
+
+
+int
+upgrade_is_pending (void)
+{
+/*  Returns true (non-zero) if a new daemon is waiting to take over.
+ */
+    return (_upgrade_fd >= 0);
+}
+
+
+void
+upgrade_send_state (conf_t conf)
+{
+/*  Hands off the listening socket and cached state to the new daemon.
+ *  This must be called after all in-flight requests have been drained.
+ */
+    listener_t  l;
+    void       *buf;
+    size_t      len;
+    int         n;
+
+    assert (conf != NULL);
+    assert (conf->ld >= 0);
+    assert (_upgrade_fd >= 0);
+
+    if (_upgrade_send_fd (_upgrade_fd, conf->ld) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to send socket to upgrade daemon");
+    }
+    /*  Additional sockets follow in command-line order, which is the same
+     *    for the new daemon since it is exec'd with the same arguments.
+     */
+    for (l = conf->listeners; l != NULL; l = l->next) {
+        assert (l->ld >= 0);
+        if (_upgrade_send_fd (_upgrade_fd, l->ld) < 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to send socket \"%s\" to upgrade daemon",
+                    l->socket_name);
+        }
+    }
+    if ((n = replay_pack (&buf, &len)) < 0) {
+        log_msg (LOG_WARNING, "Failed to pack replay cache: %s",
+                strerror (errno));
+        buf = NULL;
+        len = 0;
+    }
+    if (_upgrade_send_blob (_upgrade_fd, buf, len) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to send replay cache to upgrade daemon");
+    }
+    free (buf);
+    log_msg (LOG_INFO, "Sent %d replay cache entr%s to upgrade daemon",
+            (n > 0) ? n : 0, (n == 1) ? "y" : "ies");
+
+    if ((n = gids_pack (conf->gids, &buf, &len)) < 0) {
+        log_msg (LOG_WARNING, "Failed to pack supplementary group mapping: "
+                "%s", strerror (errno));
+        buf = NULL;
+        len = 0;
+    }
+    if (_upgrade_send_blob (_upgrade_fd, buf, len) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to send supplementary group mapping to upgrade daemon");
+    }
+    free (buf);
+    log_msg (LOG_INFO, "Sent %d supplementary group mapping%s "
+            "to upgrade daemon", (n > 0) ? n : 0, (n == 1) ? "" : "s");
+
+    log_msg (LOG_NOTICE, "Handed off socket \"%s\" to upgrade daemon (pid %d)",
+            conf->socket_name, (int) _upgrade_pid);
+    return;
+}
+
+
+void
+upgrade_recv_state (conf_t conf)
+{
+/*  Takes over the listening socket and cached state from the old daemon
+ *    over the channel given by "--upgrade-fd".
+ */
+    struct timeval  tv;
+    char            c = UPGRADE_READY;
+    listener_t      l;
+    void           *buf;
+    size_t          len;
+    int             n;
+    ssize_t         nread;
+
+    assert (conf != NULL);
+    assert (conf->upgrade_fd >= 0);
+
+    if (fd_set_close_on_exec (conf->upgrade_fd) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to set close-on-exec on upgrade channel");
+    }
+    if (fd_write_n (conf->upgrade_fd, &c, 1) != 1) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to signal old daemon that upgrade is ready");
+    }
+    /*  The old daemon drains its in-flight requests before sending the
+     *    socket, so each step has its own deadline.
+     */
+    _upgrade_get_timeval (&tv, MUNGE_UPGRADE_WAIT_MSECS);
+    if ((conf->ld = _upgrade_recv_fd (conf->upgrade_fd, &tv)) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to receive socket from old daemon");
+    }
+    if (fd_set_close_on_exec (conf->ld) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to set close-on-exec on socket \"%s\"",
+                conf->socket_name);
+    }
+    for (l = conf->listeners; l != NULL; l = l->next) {
+        if ((l->ld = _upgrade_recv_fd (conf->upgrade_fd, &tv)) < 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to receive socket \"%s\" from old daemon",
+                    l->socket_name);
+        }
+        if (fd_set_close_on_exec (l->ld) < 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to set close-on-exec on socket \"%s\"",
+                    l->socket_name);
+        }
+        if (fd_set_nonblocking (l->ld) < 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to set nonblocking socket \"%s\"",
+                    l->socket_name);
+        }
+    }
+    if ((conf->listeners != NULL) && (fd_set_nonblocking (conf->ld) < 0)) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to set nonblocking socket \"%s\"",
+                conf->socket_name);
+    }
+    _upgrade_get_timeval (&tv, MUNGE_UPGRADE_WAIT_MSECS);
+    if (_upgrade_recv_blob (conf->upgrade_fd, &buf, &len, &tv) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to receive replay cache from old daemon");
+    }
+    if ((n = replay_unpack (buf, len)) < 0) {
+        log_msg (LOG_WARNING, "Failed to unpack replay cache: %s",
+                strerror (errno));
+    }
+    else {
+        log_msg (LOG_INFO, "Received %d replay cache entr%s from old daemon",
+                n, (n == 1) ? "y" : "ies");
+    }
+    free (buf);
+
+    if (_upgrade_recv_blob (conf->upgrade_fd, &buf, &len, &tv) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to receive supplementary group mapping "
+                "from old daemon");
+    }
+    if ((n = gids_unpack (conf->gids, buf, len)) < 0) {
+        log_msg (LOG_WARNING, "Failed to unpack supplementary group mapping: "
+                "%s", strerror (errno));
+    }
+    else {
+        log_msg (LOG_INFO, "Received %d supplementary group mapping%s "
+                "from old daemon", n, (n == 1) ? "" : "s");
+    }
+    free (buf);
+
+    /*  Wait for the old daemon to release the lock and close the channel.
+     */
+    errno = 0;
+    nread = fd_timed_read_n (conf->upgrade_fd, &c, 1, &tv, 0);
+    if (nread != 0) {
+        log_err (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to wait for old daemon to release socket: %s",
+                (nread > 0) ? "Unexpected data" : strerror (errno));
+    }
+    if (close (conf->upgrade_fd) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to close upgrade channel");
+    }
+    conf->upgrade_fd = -1;
+
+    lock_create (conf);
+    log_msg (LOG_INFO, "Took over socket \"%s\"", conf->socket_name);
+    return;
+}
+
+
+void
+upgrade_fini (void)
+{
+/*  Closes the channel to the new daemon, signaling that the socket lock
+ *    has been released.
+ */
+    if (_upgrade_fd < 0) {
+        return;
+    }
+    if (close (_upgrade_fd) < 0) {
+        log_msg (LOG_WARNING, "Failed to close upgrade channel: %s",
+                strerror (errno));
+    }
+    _upgrade_fd = -1;
+    _upgrade_pid = 0;
+    return;
+}
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static char **
+_upgrade_argv_create (int fd)
+{
+/*  Creates a copy of the original command-line with "--upgrade-fd" set
+ *    to [fd].  Any previous "--upgrade-fd" is removed.
+ *  Returns a NULL-terminated argv array, or NULL on error.
+ */
+    char  **argv;
+    char    buf [32];
+    int     i;
+    int     j;
+
+    argv = calloc (_upgrade_argc + 2, sizeof (char *));
+    if (!argv) {
+        return (NULL);
+    }
+    for (i = 0, j = 0; i < _upgrade_argc; i++) {
+        if (strncmp (_upgrade_argv[i], UPGRADE_FD_OPT,
+                    sizeof (UPGRADE_FD_OPT) - 1) == 0) {
+            continue;
+        }
+        if (strcmp (_upgrade_argv[i], "--upgrade-fd") == 0) {
+            i++;
+            continue;
+        }
+        argv[j++] = _upgrade_argv[i];
+    }
+    (void) snprintf (buf, sizeof (buf), "%s%d", UPGRADE_FD_OPT, fd);
+    if (!(argv[j] = strdup (buf))) {
+        free (argv);
+        return (NULL);
+    }
+    return (argv);
+}
+
+
+static void
+_upgrade_argv_destroy (char **argv)
+{
+/*  Destroys the [argv] array created by _upgrade_argv_create().
+ *  Only the trailing "--upgrade-fd" arg is owned by the array.
+ */
+    int i;
+
+    if (!argv) {
+        return;
+    }
+    for (i = 0; argv[i] != NULL; i++) {
+        if (strncmp (argv[i], UPGRADE_FD_OPT,
+                    sizeof (UPGRADE_FD_OPT) - 1) == 0) {
+            free (argv[i]);
+        }
+    }
+    free (argv);
+    return;
+}
+
+
+static void
+_upgrade_exec (conf_t conf, char **argv, int fd)
+{
+/*  Execs the new daemon in the child process, passing it the channel [fd].
+ *  Only returns on error.
+ */
+    sigset_t sigset;
+    long     open_max;
+    int      i;
+
+    /*  Relative pathnames on the command-line (including argv[0]) are
+     *    relative to the directory from which the old daemon was started.
+     */
+    if ((conf->cwd != NULL) && (chdir (conf->cwd) < 0)) {
+        return;
+    }
+    if ((sigemptyset (&sigset) < 0) ||
+            (sigprocmask (SIG_SETMASK, &sigset, NULL) < 0)) {
+        return;
+    }
+    open_max = sysconf (_SC_OPEN_MAX);
+    if ((open_max <= 0) || (open_max > INT_MAX)) {
+        open_max = 1024;
+    }
+    for (i = STDERR_FILENO + 1; i < open_max; i++) {
+        if (i != fd) {
+            (void) close (i);
+        }
+    }
+    (void) execvp (argv[0], argv);
+    return;
+}
+
+
+static int
+_upgrade_abort (pid_t pid)
+{
+/*  Terminates the new daemon [pid] after a failed upgrade.
+ *  Returns 0 on success, or -1 on error.
+ */
+    int status;
+
+    if ((kill (pid, SIGKILL) < 0) && (errno != ESRCH)) {
+        return (-1);
+    }
+    while (waitpid (pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return (-1);
+        }
+    }
+    return (0);
+}
+
+
+static int
+_upgrade_send_fd (int sd, int fd)
+{
+/*  Sends the file descriptor [fd] over the Unix domain socket [sd].
+ *  Returns 0 on success, or -1 on error.
+ */
+    struct msghdr   msg;
+    struct iovec    iov;
+    struct cmsghdr *cmsg;
+    char            c = 0;
+    union {
+        struct cmsghdr  align;
+        char            buf [CMSG_SPACE (sizeof (int))];
+    } u;
+    ssize_t         n;
+
+    memset (&msg, 0, sizeof (msg));
+    memset (&u, 0, sizeof (u));
+    iov.iov_base = &c;
+    iov.iov_len = 1;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = u.buf;
+    msg.msg_controllen = sizeof (u.buf);
+
+    cmsg = CMSG_FIRSTHDR (&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+    memcpy (CMSG_DATA (cmsg), &fd, sizeof (int));
+
+    do {
+        n = sendmsg (sd, &msg, 0);
+    } while ((n < 0) && (errno == EINTR));
+
+    return ((n == 1) ? 0 : -1);
+}
+
+
+static int
+_upgrade_recv_fd (int sd, const struct timeval *tvp)
+{
+/*  Receives a file descriptor over the Unix domain socket [sd],
+ *    timing-out at [tvp].
+ *  Returns the new file descriptor, or -1 on error.
+ */
+    struct msghdr   msg;
+    struct iovec    iov;
+    struct cmsghdr *cmsg;
+    char            c;
+    union {
+        struct cmsghdr  align;
+        char            buf [CMSG_SPACE (sizeof (int))];
+    } u;
+    struct pollfd   pfd;
+    struct timeval  now;
+    int             msecs;
+    int             fd;
+    ssize_t         n;
+
+    pfd.fd = sd;
+    pfd.events = POLLIN;
+    while (1) {
+        if (gettimeofday (&now, NULL) < 0) {
+            return (-1);
+        }
+        msecs = ((tvp->tv_sec - now.tv_sec) * 1000)
+            + ((tvp->tv_usec - now.tv_usec) / 1000);
+        if (msecs <= 0) {
+            errno = ETIMEDOUT;
+            return (-1);
+        }
+        n = poll (&pfd, 1, msecs);
+        if (n > 0) {
+            break;
+        }
+        if ((n < 0) && (errno != EINTR)) {
+            return (-1);
+        }
+    }
+    memset (&msg, 0, sizeof (msg));
+    iov.iov_base = &c;
+    iov.iov_len = 1;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = u.buf;
+    msg.msg_controllen = sizeof (u.buf);
+
+    do {
+        n = recvmsg (sd, &msg, 0);
+    } while ((n < 0) && (errno == EINTR));
+
+    if (n < 0) {
+        return (-1);
+    }
+    cmsg = CMSG_FIRSTHDR (&msg);
+    if ((n != 1) || (cmsg == NULL)
+            || (cmsg->cmsg_len != CMSG_LEN (sizeof (int)))
+            || (cmsg->cmsg_level != SOL_SOCKET)
+            || (cmsg->cmsg_type != SCM_RIGHTS)) {
+        errno = EPROTO;
+        return (-1);
+    }
+    memcpy (&fd, CMSG_DATA (cmsg), sizeof (int));
+    return (fd);
+}
+
+
+static int
+_upgrade_send_blob (int sd, void *buf, size_t len)
+{
+/*  Sends the [len]-byte [buf] over [sd] prefixed by its 32-bit length.
+ *  Returns 0 on success, or -1 on error.
+ */
+    uint32_t n;
+
+    if (len > UINT32_MAX) {
+        errno = EMSGSIZE;
+        return (-1);
+    }
+    n = (uint32_t) len;
+    if (fd_write_n (sd, &n, sizeof (n)) != sizeof (n)) {
+        return (-1);
+    }
+    if ((len > 0) && (fd_write_n (sd, buf, len) != (ssize_t) len)) {
+        return (-1);
+    }
+    return (0);
+}
+
+
+static int
+_upgrade_recv_blob (int sd, void **bufp, size_t *lenp,
+        const struct timeval *tvp)
+{
+/*  Receives a length-prefixed blob over [sd], timing-out at [tvp].
+ *  Sets [*bufp] to a newly-allocated buffer (or NULL if empty) and [*lenp]
+ *    to its length.  The caller is responsible for free()ing the buffer.
+ *  Returns 0 on success, or -1 on error.
+ */
+    uint32_t  n;
+    void     *buf = NULL;
+
+    *bufp = NULL;
+    *lenp = 0;
+
+    errno = 0;
+    if (fd_timed_read_n (sd, &n, sizeof (n), tvp, 0) != sizeof (n)) {
+        if (errno == 0) {
+            errno = EPIPE;
+        }
+        return (-1);
+    }
+    if (n > 0) {
+        if (!(buf = malloc (n))) {
+            return (-1);
+        }
+        errno = 0;
+        if (fd_timed_read_n (sd, buf, n, tvp, 0) != (ssize_t) n) {
+            if (errno == 0) {
+                errno = EPIPE;
+            }
+            free (buf);
+            return (-1);
+        }
+    }
+    *bufp = buf;
+    *lenp = n;
+    return (0);
+}
+
+
+static void
+_upgrade_get_timeval (struct timeval *tvp, int msecs)
+{
+/*  Sets [tvp] to the absolute time [msecs] milliseconds from now.
+ */
+    if (gettimeofday (tvp, NULL) < 0) {
+        tvp->tv_sec = tvp->tv_usec = 0;
+    }
+    tvp->tv_sec += msecs / 1000;
+    tvp->tv_usec += (msecs % 1000) * 1000;
+    if (tvp->tv_usec >= 1000000) {
+        tvp->tv_sec += tvp->tv_usec / 1000000;
+        tvp->tv_usec %= 1000000;
+    }
+    return;
+}
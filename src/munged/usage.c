@@ -0,0 +1,436 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <munge.h>
+#include "conf.h"
+#include "hash.h"
+#include "log.h"
+#include "m_msg.h"
+#include "munge_defs.h"
+#include "thread.h"
+#include "timer.h"
+#include "usage.h"
+
+
+/*****************************************************************************
+ *  Notes
+ *****************************************************************************
+ *
+ *  The CPU time consumed by each request is measured with the per-thread CPU
+ *  clock around its processing and attributed to the client UID.  Since the
+ *  number of UIDs on a host is unbounded, the table is limited to
+ *  MUNGE_USAGE_MAX_UIDS entries; requests from additional UIDs (as well as
+ *  requests whose client could not be identified) are lumped together into
+ *  an "other" entry.  The top MUNGE_USAGE_REPORT_NUM UIDs by CPU time are
+ *  logged periodically, upon receipt of a SIGHUP, and at shutdown.
+ */
+
+
+/*****************************************************************************
+ *  Constants
+ *****************************************************************************/
+
+#define USAGE_HASH_SIZE         1031
+
+
+/*****************************************************************************
+ *  Private Data Types
+ *****************************************************************************/
+
+struct usage_node {
+    uid_t               uid;            /* usage_hash key                    */
+    unsigned long       n_enc;          /* number of encode requests         */
+    unsigned long       n_dec;          /* number of decode requests         */
+    double              cpu_secs;       /* total CPU secs for all requests   */
+};
+
+typedef struct usage_node * usage_node_p;
+
+struct usage_list {
+    usage_node_p       *nodes;          /* array of ptrs to usage nodes      */
+    int                 n;              /* number of nodes in the array      */
+};
+
+
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static void _usage_timer (void *arg);
+static void _usage_schedule (void);
+static void _usage_node_add (usage_node_p u, m_msg_type_t type,
+        double cpu_secs);
+static int _usage_node_collect (usage_node_p u, const uid_t *uidp,
+        struct usage_list *list);
+static int _usage_node_cmp (const void *p1, const void *p2);
+static int _usage_uid_cmp (const uid_t *uid1p, const uid_t *uid2p);
+static unsigned int _usage_uid_key (const uid_t *uidp);
+
+
+/*****************************************************************************
+ *  Private Variables
+ *****************************************************************************/
+
+static pthread_mutex_t      _usage_mutex = PTHREAD_MUTEX_INITIALIZER;
+static hash_t               _usage_hash = NULL;
+static struct usage_node    _usage_other;
+static struct usage_node    _usage_total;
+static long                 _usage_timer_id = 0;
+static int                  _usage_report_secs = 0;
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+/*  Initializes the per-client CPU usage table.
+ *  The [conf->usage_report_secs] is the number of seconds between reports.
+ *    If 0, reports are only logged on SIGHUP and at shutdown.
+ *    If negative, CPU usage is not tracked.
+ */
+void
+usage_init (conf_t conf)
+{
+    assert (conf != NULL);
+
+    if (conf->usage_report_secs < 0) {
+        log_msg (LOG_INFO, "Disabled per-client CPU usage tracking");
+        return;
+    }
+    lsd_mutex_lock (&_usage_mutex);
+    _usage_hash = hash_create (USAGE_HASH_SIZE,
+            (hash_key_f) _usage_uid_key,
+            (hash_cmp_f) _usage_uid_cmp,
+            (hash_del_f) free);
+    if (!_usage_hash) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+                "Failed to allocate CPU usage hash");
+    }
+    memset (&_usage_other, 0, sizeof (_usage_other));
+    memset (&_usage_total, 0, sizeof (_usage_total));
+    _usage_report_secs = conf->usage_report_secs;
+    if (_usage_report_secs > 0) {
+        _usage_schedule ();
+    }
+    lsd_mutex_unlock (&_usage_mutex);
+
+    if (conf->usage_report_secs > 0) {
+        log_msg (LOG_INFO,
+                "Reporting per-client CPU usage every %d second%s",
+                conf->usage_report_secs,
+                (conf->usage_report_secs == 1) ? "" : "s");
+    }
+    return;
+}
+
+
+/*  Logs the final per-client CPU usage and destroys the table.
+ */
+void
+usage_fini (void)
+{
+    lsd_mutex_lock (&_usage_mutex);
+    if (_usage_timer_id > 0) {
+        (void) timer_cancel (_usage_timer_id);
+        _usage_timer_id = 0;
+    }
+    _usage_report_secs = 0;
+    lsd_mutex_unlock (&_usage_mutex);
+
+    usage_report ();
+
+    lsd_mutex_lock (&_usage_mutex);
+    hash_destroy (_usage_hash);
+    _usage_hash = NULL;
+    lsd_mutex_unlock (&_usage_mutex);
+    return;
+}
+
+
+/*  Sets [tsp] to the CPU time consumed by the calling thread.
+ */
+void
+usage_get_time (struct timespec *tsp)
+{
+    assert (tsp != NULL);
+
+    if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, tsp) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to query thread CPU time");
+    }
+    return;
+}
+
+
+/*  Returns the number of seconds elapsed from [t0] to [t1].
+ */
+double
+usage_diff_secs (const struct timespec *t0, const struct timespec *t1)
+{
+    return ((t1->tv_sec - t0->tv_sec) + ((t1->tv_nsec - t0->tv_nsec) / 1e9));
+}
+
+
+/*  Attributes [cpu_secs] of CPU time for processing a request of [type]
+ *    to the client that sent msg [m].
+ */
+void
+usage_add (m_msg_t m, m_msg_type_t type, double cpu_secs)
+{
+    usage_node_p u;
+    uid_t        uid;
+
+    assert (m != NULL);
+
+    if (m->is_probe) {
+        return;
+    }
+    lsd_mutex_lock (&_usage_mutex);
+    if (!_usage_hash) {
+        lsd_mutex_unlock (&_usage_mutex);
+        return;
+    }
+    _usage_node_add (&_usage_total, type, cpu_secs);
+
+    if (!m->client_is_known) {
+        u = &_usage_other;
+    }
+    else {
+        uid = (uid_t) m->client_uid;
+        u = hash_find (_usage_hash, &uid);
+        if (u == NULL) {
+            if (hash_count (_usage_hash) >= MUNGE_USAGE_MAX_UIDS) {
+                u = &_usage_other;
+            }
+            else if (!(u = calloc (1, sizeof (*u)))) {
+                u = &_usage_other;
+            }
+            else {
+                u->uid = uid;
+                if (!hash_insert (_usage_hash, &u->uid, u)) {
+                    free (u);
+                    u = &_usage_other;
+                }
+            }
+        }
+    }
+    _usage_node_add (u, type, cpu_secs);
+    lsd_mutex_unlock (&_usage_mutex);
+    return;
+}
+
+
+/*  Logs the top UIDs by CPU usage.
+ */
+void
+usage_report (void)
+{
+    struct usage_list  list;
+    struct usage_node  other;
+    struct usage_node  total;
+    usage_node_p       u;
+    int                n_uids;
+    int                i;
+
+    lsd_mutex_lock (&_usage_mutex);
+    if (!_usage_hash) {
+        lsd_mutex_unlock (&_usage_mutex);
+        return;
+    }
+    list.n = 0;
+    n_uids = hash_count (_usage_hash);
+    list.nodes = (n_uids > 0) ? malloc (n_uids * sizeof (usage_node_p)) : NULL;
+    if (list.nodes != NULL) {
+        /*
+         *  Copy the nodes so the report can be logged without the mutex.
+         */
+        (void) hash_for_each (_usage_hash,
+                (hash_arg_f) _usage_node_collect, &list);
+    }
+    other = _usage_other;
+    total = _usage_total;
+    lsd_mutex_unlock (&_usage_mutex);
+
+    if ((n_uids > 0) && (list.nodes == NULL)) {
+        log_msg (LOG_WARNING, "Failed to allocate CPU usage report");
+        return;
+    }
+    log_msg (LOG_INFO,
+            "CPU usage: %lu encode%s and %lu decode%s in %0.6fs by %d UID%s",
+            total.n_enc, (total.n_enc == 1) ? "" : "s",
+            total.n_dec, (total.n_dec == 1) ? "" : "s",
+            total.cpu_secs, n_uids, (n_uids == 1) ? "" : "s");
+
+    if (list.n > 1) {
+        qsort (list.nodes, list.n, sizeof (usage_node_p), _usage_node_cmp);
+    }
+
+    for (i = 0; (i < list.n) && (i < MUNGE_USAGE_REPORT_NUM); i++) {
+        u = list.nodes[i];
+        log_msg (LOG_INFO,
+                "CPU usage for UID=%u: %0.6fs (%lu encode%s, %lu decode%s)",
+                (unsigned int) u->uid, u->cpu_secs,
+                u->n_enc, (u->n_enc == 1) ? "" : "s",
+                u->n_dec, (u->n_dec == 1) ? "" : "s");
+    }
+    if (other.n_enc + other.n_dec > 0) {
+        log_msg (LOG_INFO,
+                "CPU usage for other clients: %0.6fs (%lu encode%s, "
+                "%lu decode%s)", other.cpu_secs,
+                other.n_enc, (other.n_enc == 1) ? "" : "s",
+                other.n_dec, (other.n_dec == 1) ? "" : "s");
+    }
+    for (i = 0; i < list.n; i++) {
+        free (list.nodes[i]);
+    }
+    free (list.nodes);
+    return;
+}
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static void
+_usage_timer (void *arg)
+{
+/*  Logs the periodic CPU usage report and schedules the next one.
+ */
+    lsd_mutex_lock (&_usage_mutex);
+    _usage_timer_id = 0;
+    if (_usage_report_secs <= 0) {
+        lsd_mutex_unlock (&_usage_mutex);
+        return;
+    }
+    _usage_schedule ();
+    lsd_mutex_unlock (&_usage_mutex);
+
+    usage_report ();
+    return;
+}
+
+
+static void
+_usage_schedule (void)
+{
+/*  Schedules the next periodic CPU usage report.
+ *  The mutex must be held when calling this routine.
+ */
+    _usage_timer_id = timer_set_relative ((callback_f) _usage_timer, NULL,
+            _usage_report_secs * 1000);
+    if (_usage_timer_id < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to schedule CPU usage report");
+    }
+    return;
+}
+
+
+static void
+_usage_node_add (usage_node_p u, m_msg_type_t type, double cpu_secs)
+{
+/*  Adds a request of [type] consuming [cpu_secs] to the usage node [u].
+ */
+    if (type == MUNGE_MSG_ENC_REQ) {
+        u->n_enc++;
+    }
+    else if (type == MUNGE_MSG_DEC_REQ) {
+        u->n_dec++;
+    }
+    u->cpu_secs += cpu_secs;
+    return;
+}
+
+
+static int
+_usage_node_collect (usage_node_p u, const uid_t *uidp,
+        struct usage_list *list)
+{
+/*  Appends a copy of the usage node [u] to the [list].
+ */
+    usage_node_p copy;
+
+    if (!(copy = malloc (sizeof (*copy)))) {
+        return (0);
+    }
+    *copy = *u;
+    list->nodes[list->n++] = copy;
+    return (1);
+}
+
+
+static int
+_usage_node_cmp (const void *p1, const void *p2)
+{
+/*  Comparison function for qsort() to sort usage nodes by decreasing CPU.
+ */
+    const usage_node_p u1 = * (const usage_node_p *) p1;
+    const usage_node_p u2 = * (const usage_node_p *) p2;
+
+    if (u1->cpu_secs > u2->cpu_secs) {
+        return (-1);
+    }
+    if (u1->cpu_secs < u2->cpu_secs) {
+        return (1);
+    }
+    return (0);
+}
+
+
+static int
+_usage_uid_cmp (const uid_t *uid1p, const uid_t *uid2p)
+{
+/*  Hash comparison function for usage_hash keys [uid1p] and [uid2p].
+ */
+    if (*uid1p < *uid2p) {
+        return (-1);
+    }
+    if (*uid1p > *uid2p) {
+        return (1);
+    }
+    return (0);
+}
+
+
+static unsigned int
+_usage_uid_key (const uid_t *uidp)
+{
+/*  Hash key function for converting [uidp] into a usage_hash key.
+ */
+    return (*uidp);
+}
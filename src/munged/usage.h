@@ -0,0 +1,55 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#ifndef USAGE_H
+#define USAGE_H
+
+
+#include <sys/types.h>
+#include <time.h>
+#include "conf.h"
+#include "m_msg.h"
+
+
+/*****************************************************************************
+ *  Functions
+ *****************************************************************************/
+
+void usage_init (conf_t conf);
+
+void usage_fini (void);
+
+void usage_get_time (struct timespec *tsp);
+
+double usage_diff_secs (const struct timespec *t0, const struct timespec *t1);
+
+void usage_add (m_msg_t m, m_msg_type_t type, double cpu_secs);
+
+void usage_report (void);
+
+
+#endif /* !USAGE_H */
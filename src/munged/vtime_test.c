@@ -0,0 +1,421 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <munge.h>
+#include "clock.h"
+#include "conf.h"
+#include "cred.h"
+#include "gids.h"
+#include "log.h"
+#include "m_msg.h"
+#include "munge_defs.h"
+#include "replay.h"
+#include "tap.h"
+#include "timer.h"
+
+
+/*****************************************************************************
+ *  Drives the timer list, replay purge, and gids map update scheduling from
+ *    a virtual clock instead of the timer thread.  Time only advances when
+ *    run_until() is called, so hours of timer activity complete in the time
+ *    it takes to run the callbacks.  Callback run times are still measured
+ *    against the real clock to report the pause caused by each purge.
+ *
+ *  The number of replay creds can be raised via the VTIME_TEST_REPLAY_CREDS
+ *    environment variable for benchmarking purge pauses at scale.
+ *****************************************************************************/
+
+#define VTIME_START             1000000000
+#define NUM_TIMERS              10000
+#define NUM_REPLAY_CREDS        200000
+
+
+struct vtimer {
+    struct timespec ts;
+    long            id;
+};
+
+
+int check_clock (void);
+int check_timers (void);
+int check_recurring_timer (void);
+int check_replay (void);
+int check_gids (void);
+int run_until (time_t t, double *max_pausep);
+void vtimer_cb (struct vtimer *v);
+void recurring_cb (void *arg);
+unsigned long lcg (unsigned long *seedp);
+double real_secs (void);
+
+
+static struct conf vtime_conf;
+conf_t conf = &vtime_conf;
+
+static int n_vtimer_early;
+static int n_vtimer_late;
+static struct timespec vtimer_last;
+static int n_recurring;
+
+
+int
+main (int argc, char *argv[])
+{
+    log_open_file (stderr, NULL, LOG_WARNING, 0);
+
+    plan (NO_PLAN);
+
+    check_clock ();
+    check_timers ();
+    check_recurring_timer ();
+    check_replay ();
+    check_gids ();
+
+    clock_set_source (NULL);
+
+    done_testing ();
+}
+
+
+int
+check_clock (void)
+{
+    struct timespec ts;
+    struct timespec ts_start = { VTIME_START, 0 };
+    time_t t;
+
+    ok (clock_advance_virtual (1000) < 0,
+            "clock_advance_virtual fails without virtual clock");
+    ok (clock_set_virtual (&ts_start) == 0, "clock_set_virtual");
+    ok ((clock_get_time (&t) == 0) && (t == VTIME_START),
+            "clock_get_time returns virtual time");
+    ok ((clock_advance_virtual (1500) == 0)
+            && (clock_get_timespec (&ts, 0) == 0)
+            && (ts.tv_sec == VTIME_START + 1)
+            && (ts.tv_nsec == 500 * 1000 * 1000),
+            "clock_advance_virtual by 1500ms");
+    ok ((clock_advance_virtual (500) == 0)
+            && (clock_get_timespec (&ts, 0) == 0)
+            && (ts.tv_sec == VTIME_START + 2) && (ts.tv_nsec == 0),
+            "clock_advance_virtual carries into seconds");
+    ok ((clock_get_timespec (&ts, 250) == 0)
+            && (ts.tv_sec == VTIME_START + 2)
+            && (ts.tv_nsec == 250 * 1000 * 1000),
+            "clock_get_timespec offset from virtual time");
+    ts.tv_sec = VTIME_START + 2;
+    ts.tv_nsec = 0;
+    ok (clock_is_timespec_expired (&ts) == 1,
+            "clock_is_timespec_expired at virtual time");
+    ts.tv_nsec = 1;
+    ok (clock_is_timespec_expired (&ts) == 0,
+            "clock_is_timespec_expired after virtual time");
+
+    clock_set_source (NULL);
+    ok ((clock_get_time (&t) == 0) && (t > VTIME_START),
+            "clock_set_source restores realtime clock");
+    return (0);
+}
+
+
+int
+check_timers (void)
+{
+    struct timespec ts_start = { VTIME_START, 0 };
+    struct vtimer *v;
+    unsigned long seed = 1;
+    int n_expected = 0;
+    int n;
+    int i;
+
+    if (!(v = malloc (NUM_TIMERS * sizeof (*v)))) {
+        BAIL_OUT ("Failed to allocate %d timers", NUM_TIMERS);
+    }
+    clock_set_virtual (&ts_start);
+    n_vtimer_early = 0;
+    n_vtimer_late = 0;
+    vtimer_last = ts_start;
+
+    for (i = 0; i < NUM_TIMERS; i++) {
+        long msecs = 1 + (lcg (&seed) % (3600 * 1000));
+        clock_get_timespec (&v[i].ts, msecs);
+        v[i].id = timer_set_relative ((callback_f) vtimer_cb, &v[i], msecs);
+        if (v[i].id <= 0) {
+            BAIL_OUT ("Failed to set timer #%d", i + 1);
+        }
+    }
+    n = 0;
+    for (i = 0; i < NUM_TIMERS; i += 10) {
+        n += timer_cancel (v[i].id);
+    }
+    ok (n == (NUM_TIMERS + 9) / 10, "canceled %d timers", n);
+    n_expected = NUM_TIMERS - n;
+
+    ok (timer_run_expired () == 0, "no timers expired at start");
+    n = run_until (VTIME_START + 1800, NULL);
+    ok ((n > 0) && (n < n_expected), "dispatched %d timers in 30 mins", n);
+    n += run_until (VTIME_START + 3600 + 1, NULL);
+    ok (n == n_expected, "dispatched %d of %d timers in 1 hour",
+            n, n_expected);
+    ok (n_vtimer_early == 0, "no timers dispatched before expiration");
+    ok (n_vtimer_late == 0, "timers dispatched in order at expiration");
+
+    timer_fini ();
+    free (v);
+    return (0);
+}
+
+
+int
+check_recurring_timer (void)
+{
+    struct timespec ts_start = { VTIME_START, 0 };
+    int n;
+
+    clock_set_virtual (&ts_start);
+    n_recurring = 0;
+
+    if (timer_set_relative (recurring_cb, NULL, 60 * 1000) < 0) {
+        BAIL_OUT ("Failed to set recurring timer");
+    }
+    n = run_until (VTIME_START + 59, NULL);
+    ok (n == 0, "recurring timer not dispatched before 60s");
+    n = run_until (VTIME_START + 86400, NULL);
+    ok ((n == 1440) && (n_recurring == 1440),
+            "recurring timer dispatched %d times in 1 day", n);
+
+    timer_fini ();
+    return (0);
+}
+
+
+int
+check_replay (void)
+{
+    struct timespec ts_start = { VTIME_START, 0 };
+    struct m_msg m;
+    struct munge_cred c;
+    const char *p;
+    double max_pause;
+    int n_creds = NUM_REPLAY_CREDS;
+    int n_replay;
+    int n_errors;
+    int n;
+    int i;
+
+    if ((p = getenv ("VTIME_TEST_REPLAY_CREDS")) && (atoi (p) > 0)) {
+        n_creds = atoi (p);
+    }
+    clock_set_virtual (&ts_start);
+    memset (&vtime_conf, 0, sizeof (vtime_conf));
+    memset (&m, 0, sizeof (m));
+    memset (&c, 0, sizeof (c));
+    c.msg = &m;
+    c.mac_len = MUNGE_MINIMUM_MD_LEN;
+    m.time0 = VTIME_START;
+
+    replay_init ();
+
+    /*  Creds expire uniformly over the hour following the start time.
+     *    The first 4 bytes of the mac are the replay hash key.
+     */
+    n_errors = 0;
+    for (i = 0; i < n_creds; i++) {
+        uint32_t u = i;
+        memcpy (c.mac, &u, sizeof (u));
+        m.ttl = c.ttl = 1 + (i % 3600);
+        if (replay_insert (&c) != 0) {
+            n_errors++;
+        }
+    }
+    ok (n_errors == 0, "inserted %d creds into replay hash", n_creds);
+
+    n_replay = 0;
+    for (i = 0; i < n_creds; i += 100) {
+        uint32_t u = i;
+        memcpy (c.mac, &u, sizeof (u));
+        m.ttl = c.ttl = 1 + (i % 3600);
+        n_replay += (replay_insert (&c) == 1);
+    }
+    ok (n_replay == (n_creds + 99) / 100, "detected %d replayed creds",
+            n_replay);
+
+    n = run_until (VTIME_START + MUNGE_REPLAY_PURGE_SECS - 1, NULL);
+    ok (n == 0, "replay purge not dispatched before %ds",
+            MUNGE_REPLAY_PURGE_SECS);
+    n = run_until (VTIME_START + 1800, &max_pause);
+    ok (n == 1800 / MUNGE_REPLAY_PURGE_SECS,
+            "replay purge dispatched %d times in 30 mins", n);
+    diag ("replay purge of %d creds: max pause %0.3f ms",
+            n_creds, max_pause * 1000.0);
+
+    /*  The last purge at 1800s removed every cred expiring before then.
+     */
+    n_errors = 0;
+    for (i = 0; i < n_creds; i++) {
+        uint32_t u = i;
+        memcpy (c.mac, &u, sizeof (u));
+        m.ttl = c.ttl = 1 + (i % 3600);
+        if ((replay_remove (&c) == 0) != (m.ttl >= 1800)) {
+            n_errors++;
+        }
+    }
+    ok (n_errors == 0, "replay purge removed only expired creds");
+
+    replay_fini ();
+    timer_fini ();
+    return (0);
+}
+
+
+int
+check_gids (void)
+{
+    struct timespec ts_start = { VTIME_START, 0 };
+    struct timespec ts;
+    gids_t gids;
+    int n;
+
+    clock_set_virtual (&ts_start);
+    memset (&vtime_conf, 0, sizeof (vtime_conf));
+
+    gids = gids_create (600, 0);
+    ok (gids != NULL, "gids_create");
+    ok ((timer_get_next (&ts) == 1) && (ts.tv_sec == VTIME_START),
+            "gids map update scheduled immediately");
+    ok (timer_run_expired () == 1, "gids map update dispatched");
+    ok ((timer_get_next (&ts) == 1) && (ts.tv_sec == VTIME_START + 600),
+            "gids map update rescheduled after interval");
+    n = run_until (VTIME_START + 599, NULL);
+    ok (n == 0, "gids map update not dispatched before interval");
+    n = run_until (VTIME_START + 600, NULL);
+    ok (n == 1, "gids map update dispatched at interval");
+
+    clock_advance_virtual (30 * 1000);
+    gids_update (gids);
+    ok ((timer_get_next (&ts) == 1) && (ts.tv_sec == VTIME_START + 630),
+            "gids_update reschedules map update immediately");
+    n = run_until (VTIME_START + 3600, NULL);
+    ok (n == 5, "gids map update dispatched %d times after reschedule", n);
+
+    gids_destroy (gids);
+    ok (timer_get_next (&ts) == 0, "gids_destroy cancels map update");
+
+    timer_fini ();
+    return (0);
+}
+
+
+/*  Advances the virtual clock to time [t], dispatching each timer as the
+ *    clock reaches its expiration time.
+ *  If [max_pausep] is non-NULL, it is set to the longest time (in real
+ *    seconds) spent dispatching the timers expiring at a given instant.
+ *  Returns the number of timers dispatched.
+ */
+int
+run_until (time_t t, double *max_pausep)
+{
+    struct timespec ts_stop = { t, 0 };
+    struct timespec ts_now;
+    struct timespec ts;
+    double t0;
+    double pause;
+    int n = 0;
+
+    if (max_pausep != NULL) {
+        *max_pausep = 0.0;
+    }
+    while ((timer_get_next (&ts) == 1) && clock_is_timespec_le (&ts, &ts_stop))
+    {
+        clock_get_timespec (&ts_now, 0);
+        if (!clock_is_timespec_le (&ts, &ts_now)) {
+            clock_set_virtual (&ts);
+        }
+        t0 = real_secs ();
+        n += timer_run_expired ();
+        pause = real_secs () - t0;
+        if ((max_pausep != NULL) && (pause > *max_pausep)) {
+            *max_pausep = pause;
+        }
+    }
+    clock_get_timespec (&ts_now, 0);
+    if (!clock_is_timespec_le (&ts_stop, &ts_now)) {
+        clock_set_virtual (&ts_stop);
+    }
+    return (n);
+}
+
+
+void
+vtimer_cb (struct vtimer *v)
+{
+    struct timespec ts_now;
+
+    clock_get_timespec (&ts_now, 0);
+    if (!clock_is_timespec_le (&v->ts, &ts_now)) {
+        n_vtimer_early++;
+    }
+    if (!clock_is_timespec_le (&vtimer_last, &v->ts)) {
+        n_vtimer_late++;
+    }
+    vtimer_last = v->ts;
+}
+
+
+void
+recurring_cb (void *arg)
+{
+    n_recurring++;
+    if (timer_set_relative (recurring_cb, arg, 60 * 1000) < 0) {
+        BAIL_OUT ("Failed to reset recurring timer");
+    }
+}
+
+
+unsigned long
+lcg (unsigned long *seedp)
+{
+    *seedp = (*seedp * 1103515245UL + 12345UL) & 0x7fffffffUL;
+    return (*seedp);
+}
+
+
+double
+real_secs (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + (ts.tv_nsec / 1e9));
+}
@@ -39,6 +39,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <munge.h>
+#include "lockprof.h"
 #include "log.h"
 #include "work.h"
 
@@ -56,6 +57,7 @@ typedef struct work {
     pthread_mutex_t     lock;           /* mutex for accessing struct        */
     pthread_cond_t      received_work;  /* cond for when new work is recv'd  */
     pthread_cond_t      finished_work;  /* cond for when all work is done    */
+    pthread_attr_t      tattr;          /* attributes for new worker threads */
     pthread_t          *workers;        /* ptr to array of worker thread IDs */
     work_func_t         work_func;      /* function to perform work in queue */
     work_arg_p          work_head;      /* head of the work queue            */
@@ -76,6 +78,16 @@ static void * _work_enqueue (work_p wp, void *work);
 static void * _work_dequeue (work_p wp);
 
 
+/*****************************************************************************
+ *  Private Variables
+ *****************************************************************************/
+
+/*  Lock site for the mutexes of all work crews.
+ */
+static lockprof_site_t _work_site =
+    LOCKPROF_SITE_INITIALIZER ("work crew");
+
+
 /*****************************************************************************
  *  Public Functions
  *****************************************************************************/
@@ -89,7 +101,6 @@ work_p
 work_init (work_func_t f, int n_threads)
 {
     work_p wp;
-    pthread_attr_t tattr;
     size_t stacksize = 256 * 1024;
     int i;
 
@@ -115,16 +126,16 @@ work_init (work_func_t f, int n_threads)
     }
     /*  Initialize struct.
      */
-    if ((errno = pthread_attr_init (&tattr)) != 0) {
+    if ((errno = pthread_attr_init (&wp->tattr)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR,
             "Failed to init work thread attribute");
     }
 #ifdef _POSIX_THREAD_ATTR_STACKSIZE
-    if ((errno = pthread_attr_setstacksize (&tattr, stacksize)) != 0) {
+    if ((errno = pthread_attr_setstacksize (&wp->tattr, stacksize)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR,
             "Failed to set work thread stacksize");
     }
-    if ((errno = pthread_attr_getstacksize (&tattr, &stacksize)) != 0) {
+    if ((errno = pthread_attr_getstacksize (&wp->tattr, &stacksize)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR,
             "Failed to get work thread stacksize");
     }
@@ -153,17 +164,11 @@ work_init (work_func_t f, int n_threads)
      */
     for (i = 0; i < wp->n_workers; i++) {
         if ((errno = pthread_create
-                    (&wp->workers[i], &tattr, _work_exec, wp)) != 0) {
+                    (&wp->workers[i], &wp->tattr, _work_exec, wp)) != 0) {
             log_errno (EMUNGE_SNAFU, LOG_ERR,
                 "Failed to create work thread #%d", i+1);
         }
     }
-    /*  Cleanup.
-     */
-    if ((errno = pthread_attr_destroy (&tattr)) != 0) {
-        log_errno (EMUNGE_SNAFU, LOG_ERR,
-            "Failed to destroy work thread attribute");
-    }
     return (wp);
 }
 
@@ -182,7 +187,7 @@ work_fini (work_p wp, int do_wait)
         errno = EINVAL;
         return;
     }
-    if ((errno = pthread_mutex_lock (&wp->lock)) != 0) {
+    if ((errno = lockprof_mutex_lock (&wp->lock, &_work_site)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR,
             "Failed to lock work thread mutex");
     }
@@ -249,12 +254,87 @@ work_fini (work_p wp, int do_wait)
         log_msg (LOG_ERR,
             "Failed to destroy work thread mutex: %s", strerror (errno));
     }
+    if ((errno = pthread_attr_destroy (&wp->tattr)) != 0) {
+        log_msg (LOG_ERR,
+            "Failed to destroy work thread attribute: %s", strerror (errno));
+    }
     free (wp->workers);
     free (wp);
     return;
 }
 
 
+/*  Changes the number of worker threads in the work crew [wp] to [n_threads].
+ *    Additional workers are started immediately.  Excess workers are canceled
+ *    and joined, which waits for any work they are processing to finish.
+ *  Returns 0 on success, or -1 on error (with errno set).
+ */
+int
+work_set_threads (work_p wp, int n_threads)
+{
+    pthread_t *workers;
+    int        n_old;
+    int        i;
+    int        e = 0;
+
+    if (!wp || (n_threads <= 0)) {
+        errno = EINVAL;
+        return (-1);
+    }
+    if ((errno = lockprof_mutex_lock (&wp->lock, &_work_site)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to lock work thread mutex");
+    }
+    n_old = wp->n_workers;
+    if (n_threads > n_old) {
+        workers = realloc (wp->workers, sizeof (*wp->workers) * n_threads);
+        if (workers == NULL) {
+            e = ENOMEM;
+        }
+        else {
+            wp->workers = workers;
+            for (i = n_old; i < n_threads; i++) {
+                e = pthread_create
+                    (&wp->workers[i], &wp->tattr, _work_exec, wp);
+                if (e != 0) {
+                    break;
+                }
+            }
+            wp->n_workers = i;
+        }
+    }
+    else {
+        wp->n_workers = n_threads;
+    }
+    if ((errno = pthread_mutex_unlock (&wp->lock)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to unlock work thread mutex");
+    }
+    /*  Excess workers are canceled outside the monitor lock since the cleanup
+     *    handler of a worker canceled in pthread_cond_wait() re-acquires it.
+     *  Only this thread (and work_fini) access the workers array.
+     */
+    for (i = n_threads; i < n_old; i++) {
+        if ((errno = pthread_cancel (wp->workers[i])) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to cancel work thread #%d", i+1);
+        }
+    }
+    for (i = n_threads; i < n_old; i++) {
+        if ((errno = pthread_join (wp->workers[i], NULL)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to join work thread #%d", i+1);
+        }
+        wp->workers[i] = 0;
+    }
+    if (e != 0) {
+        errno = e;
+        return (-1);
+    }
+    return (0);
+}
+
+
 /*  Queues the [work] element for processing by the work crew [wp].
  *    The [work] will be passed to the function specified during work_init().
  *  Returns 0 on success, or -1 on error (with errno set).
@@ -269,7 +349,7 @@ work_queue (work_p wp, void *work)
         errno = EINVAL;
         return (-1);
     }
-    if ((errno = pthread_mutex_lock (&wp->lock)) != 0) {
+    if ((errno = lockprof_mutex_lock (&wp->lock, &_work_site)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR,
             "Failed to lock work thread mutex");
     }
@@ -311,7 +391,7 @@ work_wait (work_p wp)
         errno = EINVAL;
         return;
     }
-    if ((errno = pthread_mutex_lock (&wp->lock)) != 0) {
+    if ((errno = lockprof_mutex_lock (&wp->lock, &_work_site)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR,
             "Failed to lock work thread mutex");
     }
@@ -355,7 +435,7 @@ _work_exec (void *arg)
     if (pthread_sigmask (SIG_SETMASK, &sigset, NULL) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to set work thread sigset");
     }
-    if ((errno = pthread_mutex_lock (&wp->lock)) != 0) {
+    if ((errno = lockprof_mutex_lock (&wp->lock, &_work_site)) != 0) {
         log_errno (EMUNGE_SNAFU, LOG_ERR,
             "Failed to lock work thread mutex");
     }
@@ -394,7 +474,7 @@ _work_exec (void *arg)
         }
         wp->work_func (work);
 
-        if ((errno = pthread_mutex_lock (&wp->lock)) != 0) {
+        if ((errno = lockprof_mutex_lock (&wp->lock, &_work_site)) != 0) {
             log_errno (EMUNGE_SNAFU, LOG_ERR,
                 "Failed to lock work thread mutex");
         }
@@ -51,6 +51,8 @@ work_p work_init (work_func_t f, int n_threads);
 
 void work_fini (work_p wp, int do_wait);
 
+int work_set_threads (work_p wp, int n_threads);
+
 int work_queue (work_p wp, void *work);
 
 void work_wait (work_p wp);
@@ -0,0 +1,373 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <munge.h>
+#include "lockprof.h"
+#include "log.h"
+#include "md.h"
+#include "zcache.h"
+#include "zip.h"
+
+
+/*****************************************************************************
+ *  Notes
+ *****************************************************************************
+ *
+ *  A job launcher typically encodes the same payload (e.g., an environment
+ *  blob) into many credentials in quick succession.  Since the version 4
+ *  credential format compresses only the payload data and not the
+ *  per-credential fields that precede it, the compressed form of a given
+ *  payload is the same for every credential and can be reused.
+ *
+ *  The cache holds a small, fixed number of compressed payloads.  Each entry
+ *  is keyed by a SHA-256 digest of the uncompressed payload along with its
+ *  length, the compression type, and the UID of the requesting client.
+ *  Including the UID prevents one user from learning (via a faster response)
+ *  whether another user has recently encoded a given payload.  When the
+ *  cache is full, the least-recently-used entry is replaced.  Payloads
+ *  outside [ZCACHE_MIN_LEN, ZCACHE_MAX_LEN] are not cached: small ones are
+ *  cheaper to compress than to hash, and large ones would bloat the cache.
+ */
+
+
+/*****************************************************************************
+ *  Constants
+ *****************************************************************************/
+
+#define ZCACHE_MD               MUNGE_MAC_SHA256
+#define ZCACHE_MD_LEN           32
+#define ZCACHE_MIN_LEN          1024
+#define ZCACHE_MAX_LEN          262144
+
+
+/*****************************************************************************
+ *  Private Data Types
+ *****************************************************************************/
+
+struct zcache_entry {
+    unsigned char       md[ZCACHE_MD_LEN];  /* digest of uncompressed data   */
+    munge_zip_t         type;           /* compression type                  */
+    uid_t               uid;            /* UID of client that encoded data   */
+    int                 src_len;        /* length of uncompressed data       */
+    unsigned char      *dst;            /* compressed data, or NULL if free  */
+    int                 dst_len;        /* length of compressed data         */
+    unsigned long       last_used;      /* _zcache_clock value of last use   */
+};
+
+
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static int _zcache_digest (unsigned char *md, const void *src, int srclen);
+static struct zcache_entry * _zcache_find (const unsigned char *md,
+    munge_zip_t type, uid_t uid, int srclen);
+static void _zcache_insert (const unsigned char *md, munge_zip_t type,
+    uid_t uid, int srclen, const unsigned char *dst, int dstlen);
+static void _zcache_clear (struct zcache_entry *e);
+
+
+/*****************************************************************************
+ *  Private Variables
+ *****************************************************************************/
+
+static struct zcache_entry *_zcache = NULL;
+static int                  _zcache_n = 0;
+static unsigned long        _zcache_clock = 0;
+static unsigned long        _zcache_n_hits = 0;
+static unsigned long        _zcache_n_misses = 0;
+static pthread_mutex_t      _zcache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static lockprof_site_t      _zcache_site =
+    LOCKPROF_SITE_INITIALIZER ("zip cache");
+
+
+/*****************************************************************************
+ *  Public Functions
+ *****************************************************************************/
+
+/*  Initializes the compressed payload cache to hold up to [n_entries]
+ *    compressed payloads.  If [n_entries] is 0, the cache is disabled.
+ *  WARNING: This routine is *NOT* guaranteed to be thread-safe.
+ */
+void
+zcache_init (int n_entries)
+{
+    if (n_entries <= 0) {
+        return;
+    }
+    if (!(_zcache = calloc (n_entries, sizeof (struct zcache_entry)))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+                "Failed to allocate zip cache");
+    }
+    _zcache_n = n_entries;
+    log_msg (LOG_INFO, "Caching up to %d compressed payload%s",
+            n_entries, (n_entries == 1) ? "" : "s");
+    return;
+}
+
+
+/*  Reports the cache statistics and frees the cached payloads.
+ *  WARNING: This routine is *NOT* guaranteed to be thread-safe.
+ */
+void
+zcache_fini (void)
+{
+    int i;
+
+    if (_zcache == NULL) {
+        return;
+    }
+    log_msg (LOG_INFO, "Zip cache: %lu hit%s, %lu miss%s",
+            _zcache_n_hits, (_zcache_n_hits == 1) ? "" : "s",
+            _zcache_n_misses, (_zcache_n_misses == 1) ? "" : "es");
+
+    for (i = 0; i < _zcache_n; i++) {
+        _zcache_clear (&_zcache[i]);
+    }
+    free (_zcache);
+    _zcache = NULL;
+    _zcache_n = 0;
+    return;
+}
+
+
+/*  Compresses [srclen] bytes of [src] using the compression [type] on behalf
+ *    of the client [uid], reusing a previously compressed copy if cached.
+ *  Sets [*pdst] to a newly-allocated buffer containing [*pdstlen] bytes of
+ *    compressed data; the caller is responsible for free()ing it.
+ *    Note that the compressed data may be larger than the original data.
+ *  Returns 0 on success, or -1 on error (with errno set).
+ */
+int
+zcache_compress (munge_zip_t type, uid_t uid,
+    void **pdst, int *pdstlen, const void *src, int srclen)
+{
+    unsigned char        md[ZCACHE_MD_LEN];
+    struct zcache_entry *e;
+    unsigned char       *dst = NULL;
+    int                  dst_len = 0;
+    int                  is_cacheable;
+    int                  n;
+
+    if ((pdst == NULL) || (pdstlen == NULL) || (src == NULL)
+            || (srclen <= 0)) {
+        errno = EINVAL;
+        return (-1);
+    }
+    is_cacheable = (_zcache != NULL)
+        && (srclen >= ZCACHE_MIN_LEN)
+        && (srclen <= ZCACHE_MAX_LEN)
+        && (_zcache_digest (md, src, srclen) == 0);
+
+    if (is_cacheable) {
+        if ((errno = lockprof_mutex_lock (&_zcache_mutex, &_zcache_site))
+                != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock zip cache");
+        }
+        e = _zcache_find (md, type, uid, srclen);
+        if (e != NULL) {
+            e->last_used = ++_zcache_clock;
+            dst_len = e->dst_len;
+            if ((dst = malloc (dst_len)) != NULL) {
+                memcpy (dst, e->dst, dst_len);
+            }
+            _zcache_n_hits++;
+        }
+        else {
+            _zcache_n_misses++;
+        }
+        if ((errno = pthread_mutex_unlock (&_zcache_mutex)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to unlock zip cache");
+        }
+        if (e != NULL) {
+            if (dst == NULL) {
+                errno = ENOMEM;
+                return (-1);
+            }
+            *pdst = dst;
+            *pdstlen = dst_len;
+            return (0);
+        }
+    }
+    /*  Compress the payload without holding the mutex.
+     */
+    dst_len = zip_compress_length (type, src, srclen);
+    if (dst_len < 0) {
+        errno = EINVAL;
+        return (-1);
+    }
+    if (!(dst = malloc (dst_len))) {
+        return (-1);
+    }
+    n = dst_len;
+    if (zip_compress_block (type, dst, &n, src, srclen) < 0) {
+        free (dst);
+        errno = EIO;
+        return (-1);
+    }
+    if (is_cacheable) {
+        _zcache_insert (md, type, uid, srclen, dst, n);
+    }
+    *pdst = dst;
+    *pdstlen = n;
+    return (0);
+}
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static int
+_zcache_digest (unsigned char *md, const void *src, int srclen)
+{
+/*  Computes the digest of [srclen] bytes of [src] into [md].
+ *  Returns 0 on success, or -1 on error.
+ */
+    md_ctx x;
+    int    n = ZCACHE_MD_LEN;
+
+    if (md_init (&x, ZCACHE_MD) < 0) {
+        return (-1);
+    }
+    if ((md_update (&x, src, srclen) < 0) || (md_final (&x, md, &n) < 0)) {
+        (void) md_cleanup (&x);
+        return (-1);
+    }
+    if (md_cleanup (&x) < 0) {
+        return (-1);
+    }
+    assert (n == ZCACHE_MD_LEN);
+    return (0);
+}
+
+
+static struct zcache_entry *
+_zcache_find (const unsigned char *md, munge_zip_t type, uid_t uid,
+    int srclen)
+{
+/*  Returns the cache entry matching the given key, or NULL if not found.
+ *  The mutex must be locked before calling this routine.
+ */
+    int i;
+
+    for (i = 0; i < _zcache_n; i++) {
+        struct zcache_entry *e = &_zcache[i];
+        if ((e->dst != NULL)
+                && (e->type == type)
+                && (e->uid == uid)
+                && (e->src_len == srclen)
+                && (memcmp (e->md, md, ZCACHE_MD_LEN) == 0)) {
+            return (e);
+        }
+    }
+    return (NULL);
+}
+
+
+static void
+_zcache_insert (const unsigned char *md, munge_zip_t type, uid_t uid,
+    int srclen, const unsigned char *dst, int dstlen)
+{
+/*  Inserts a copy of the [dstlen] bytes of compressed data [dst] into the
+ *    cache under the given key, replacing the least-recently-used entry.
+ *  The entry is not inserted if another thread already did so, or if
+ *    memory cannot be allocated for it.
+ */
+    unsigned char       *copy;
+    unsigned char       *old = NULL;
+    int                  old_len = 0;
+    struct zcache_entry *e;
+    int                  i;
+
+    if (!(copy = malloc (dstlen))) {
+        return;
+    }
+    memcpy (copy, dst, dstlen);
+
+    if ((errno = lockprof_mutex_lock (&_zcache_mutex, &_zcache_site)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock zip cache");
+    }
+    if (_zcache_find (md, type, uid, srclen) != NULL) {
+        old = copy;
+        old_len = dstlen;
+    }
+    else {
+        e = &_zcache[0];
+        for (i = 1; (i < _zcache_n) && (e->dst != NULL); i++) {
+            if ((_zcache[i].dst == NULL)
+                    || (_zcache[i].last_used < e->last_used)) {
+                e = &_zcache[i];
+            }
+        }
+        old = e->dst;
+        old_len = e->dst_len;
+        memcpy (e->md, md, ZCACHE_MD_LEN);
+        e->type = type;
+        e->uid = uid;
+        e->src_len = srclen;
+        e->dst = copy;
+        e->dst_len = dstlen;
+        e->last_used = ++_zcache_clock;
+    }
+    if ((errno = pthread_mutex_unlock (&_zcache_mutex)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to unlock zip cache");
+    }
+    /*  Free the replaced payload without holding the mutex.
+     */
+    if (old != NULL) {
+        memset (old, 0, old_len);
+        free (old);
+    }
+    return;
+}
+
+
+static void
+_zcache_clear (struct zcache_entry *e)
+{
+/*  Frees the compressed data held by the cache entry [e].
+ */
+    if (e->dst != NULL) {
+        memset (e->dst, 0, e->dst_len);
+        free (e->dst);
+        e->dst = NULL;
+        e->dst_len = 0;
+    }
+    memset (e->md, 0, ZCACHE_MD_LEN);
+    return;
+}
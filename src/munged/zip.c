@@ -39,11 +39,18 @@
 #endif /* HAVE_ZLIB_H */
 
 #include <assert.h>
+#include <errno.h>
 #include <inttypes.h>
 #include <netinet/in.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 #include <munge.h>
 #include "common.h"
+#include "lockprof.h"
+#include "log.h"
+#include "munge_defs.h"
+#include "work.h"
 #include "zip.h"
 
 
@@ -58,6 +65,19 @@
  *    The first 4 bytes contain a sentinel to check if the metadata is valid.
  *    The next 4 bytes contain the original length of the uncompressed data.
  *    Both values are in MSBF (ie, big endian) format.
+ *
+ *  When zip helper threads are enabled (via zip_init), payloads larger than
+ *    MUNGE_ZIP_CHUNK_LEN are split into chunks that are compressed
+ *    independently and in parallel.  This framed output begins with 16 bytes
+ *    of metadata (zip_chunk_meta_t): a distinct sentinel, the original length
+ *    of the uncompressed data, the uncompressed length of each chunk (the
+ *    last chunk may be shorter), and the number of chunks.  This is followed
+ *    by a table of the compressed length of each chunk, followed by the
+ *    compressed chunks themselves.  All values are in MSBF format.
+ *    Since the first 8 bytes match the layout of zip_meta_t,
+ *    zip_decompress_length() handles both formats.  The framed format is
+ *    always recognized when decompressing, regardless of whether helper
+ *    threads are enabled.
  */
 
 
@@ -66,6 +86,7 @@
  *****************************************************************************/
 
 #define ZIP_MAGIC                       0xCACACACA
+#define ZIP_CHUNK_MAGIC                 0xCACA5A5A
 
 
 /*****************************************************************************
@@ -77,11 +98,97 @@ typedef struct {
     uint32_t length;
 } zip_meta_t;
 
+typedef struct {
+    uint32_t magic;
+    uint32_t length;
+    uint32_t chunk_len;
+    uint32_t n_chunks;
+} zip_chunk_meta_t;
+
+typedef struct {
+    pthread_mutex_t     lock;           /* mutex for accessing struct        */
+    pthread_cond_t      done;           /* cond for when all chunks are done */
+    int                 n_pending;      /* num chunks queued but not done    */
+} zip_batch_t;
+
+typedef struct {
+    zip_batch_t        *batch;          /* batch to notify when done         */
+    munge_zip_t         type;           /* compression type                  */
+    int                 do_compress;    /* true to compress, else decompress */
+    int                 rc;             /* result of processing this chunk   */
+    unsigned char      *dst;            /* output buffer for this chunk      */
+    unsigned int        dstlen;         /* size of dst on entry, len on exit */
+    const unsigned char *src;           /* input data for this chunk         */
+    unsigned int        srclen;         /* length of input data              */
+} zip_chunk_t;
+
+
+/*****************************************************************************
+ *  Private Data
+ *****************************************************************************/
+
+static work_p _zip_work = NULL;         /* helper threads for chunked zip    */
+
+static lockprof_site_t _zip_site =     /* lock site for chunk batches       */
+    LOCKPROF_SITE_INITIALIZER ("zip batch");
+
+
+/*****************************************************************************
+ *  Private Prototypes
+ *****************************************************************************/
+
+static int _zip_compress_raw (munge_zip_t type, unsigned char *dst,
+    unsigned int *pdstlen, const unsigned char *src, unsigned int srclen);
+static int _zip_decompress_raw (munge_zip_t type, unsigned char *dst,
+    unsigned int *pdstlen, const unsigned char *src, unsigned int srclen);
+static int _zip_raw_length (munge_zip_t type, int len);
+static int _zip_is_chunked (int len);
+static int _zip_compress_chunked (munge_zip_t type,
+    void *dst, int *pdstlen, const void *src, int srclen);
+static int _zip_decompress_chunked (munge_zip_t type,
+    void *dst, int *pdstlen, const void *src, int srclen);
+static int _zip_run_chunks (zip_chunk_t *chunks, int n);
+static void _zip_chunk_exec (zip_chunk_t *z);
+static void _zip_chunk_process (zip_chunk_t *z);
+
 
 /*****************************************************************************
  *  Public Functions
  *****************************************************************************/
 
+/*  Initializes the zip subsystem with [n_threads] helper threads for
+ *    compressing and decompressing large payloads in parallel chunks.
+ *  If [n_threads] is 0, payloads are always compressed in a single pass.
+ *  WARNING: This routine is *NOT* guaranteed to be thread-safe.
+ */
+void
+zip_init (int n_threads)
+{
+    if (n_threads <= 0) {
+        return;
+    }
+    if (!(_zip_work = work_init ((work_func_t) _zip_chunk_exec, n_threads))) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to create zip threads");
+    }
+    log_msg (LOG_INFO, "Created %d zip helper thread%s for %d-byte chunks",
+        n_threads, (n_threads == 1) ? "" : "s", MUNGE_ZIP_CHUNK_LEN);
+    return;
+}
+
+
+/*  Stops the zip helper threads (if any).
+ */
+void
+zip_fini (void)
+{
+    if (_zip_work != NULL) {
+        work_fini (_zip_work, 1);
+        _zip_work = NULL;
+    }
+    return;
+}
+
+
 /*  Returns non-zero if the given [type] is a supported valid MUNGE compression
  *    type according to the current configuration.  The NONE and DEFAULT types
  *    are not considered valid types by this routine.
@@ -106,6 +213,9 @@ zip_is_valid_type (munge_zip_t type)
 /*  Compresses the [src] buffer of length [srclen] in a single pass using the
  *    compression method [type].  The resulting compressed output is stored
  *    in the [dst] buffer.
+ *  If zip helper threads are enabled and [srclen] exceeds the chunk length,
+ *    the data is instead compressed in parallel chunks using the framed
+ *    format described above.
  *  Upon entry, [*pdstlen] must be set to the size of the [dst] buffer.
  *  Upon exit, [*pdstlen] is set to the size of the compressed data.
  *  Returns 0 on success, or -1 or error.
@@ -114,10 +224,7 @@ int
 zip_compress_block (munge_zip_t type,
                     void *dst, int *pdstlen, const void *src, int srclen)
 {
-    unsigned char *xdst;
     unsigned int   xdstlen;
-    unsigned char *xsrc;
-    unsigned int   xsrclen;
     zip_meta_t    *pmeta;
 
     assert (dst != NULL);
@@ -133,38 +240,18 @@ zip_compress_block (munge_zip_t type,
     if (srclen <= 0) {
         return (-1);
     }
-    xdst = (unsigned char *) dst + sizeof (zip_meta_t);
-    xdstlen = *pdstlen - sizeof (zip_meta_t);
-    xsrc = (unsigned char *) src;
-    xsrclen = srclen;
-
-#if HAVE_PKG_BZLIB
-    if (type == MUNGE_ZIP_BZLIB) {
-        if (BZ2_bzBuffToBuffCompress ((char *) xdst, &xdstlen,
-                (char *) xsrc, xsrclen, 9, 0, 0) != BZ_OK)
-            return (-1);
+    if (_zip_is_chunked (srclen)) {
+        return (_zip_compress_chunked (type, dst, pdstlen, src, srclen));
     }
-#endif /* HAVE_PKG_BZLIB */
-
-#if HAVE_PKG_ZLIB
-    /*
-     *  XXX: The use of the "xdstlen_ul" temporary variable is to avoid the
-     *       gcc3.3 compiler warning: "dereferencing type-punned pointer
-     *       will break strict-aliasing rules".  A mere cast doesn't suffice.
-     */
-    if (type == MUNGE_ZIP_ZLIB) {
-        unsigned long xdstlen_ul = xdstlen;
-        if (compress (xdst, &xdstlen_ul,
-                xsrc, (unsigned long) xsrclen) != Z_OK)
-            return (-1);
-        xdstlen = xdstlen_ul;
+    xdstlen = *pdstlen - sizeof (zip_meta_t);
+    if (_zip_compress_raw (type, (unsigned char *) dst + sizeof (zip_meta_t),
+            &xdstlen, src, srclen) < 0) {
+        return (-1);
     }
-#endif /* HAVE_PKG_ZLIB */
-
     *pdstlen = xdstlen + sizeof (zip_meta_t);
     pmeta = dst;
     pmeta->magic = htonl (ZIP_MAGIC);
-    pmeta->length = htonl (xsrclen);
+    pmeta->length = htonl (srclen);
     return (0);
 }
 
@@ -172,6 +259,8 @@ zip_compress_block (munge_zip_t type,
 /*  Decompresses the [src] buffer of length [srclen] in a single pass using the
  *    compression method [type].  The resulting decompressed (original) output
  *    is stored in the [dst] buffer.
+ *  Data in the framed format is decompressed in parallel chunks if zip helper
+ *    threads are enabled, or sequentially otherwise.
  *  Upon entry, [*pdstlen] must be set to the size of the [dst] buffer.
  *  Upon exit, [*pdstlen] is set to the size of the decompressed data.
  *  Returns 0 on success, or -1 or error.
@@ -180,10 +269,8 @@ int
 zip_decompress_block (munge_zip_t type,
                       void *dst, int *pdstlen, const void *src, int srclen)
 {
-    unsigned char *xdst;
     unsigned int   xdstlen;
-    unsigned char *xsrc;
-    unsigned int   xsrclen;
+    zip_meta_t    *pmeta;
     int            n;
 
     assert (dst != NULL);
@@ -203,34 +290,16 @@ zip_decompress_block (munge_zip_t type,
     if (srclen <= 0) {
         return (-1);
     }
-    xdst = dst;
-    xdstlen = *pdstlen;
-    xsrc = (unsigned char *) src + sizeof (zip_meta_t);
-    xsrclen = srclen - sizeof (zip_meta_t);
-
-#if HAVE_PKG_BZLIB
-    if (type == MUNGE_ZIP_BZLIB) {
-        if (BZ2_bzBuffToBuffDecompress ((char *) xdst, &xdstlen,
-                (char *) xsrc, xsrclen, 0, 0) != BZ_OK)
-            return (-1);
+    pmeta = (void *) src;
+    if (ntohl (pmeta->magic) == ZIP_CHUNK_MAGIC) {
+        return (_zip_decompress_chunked (type, dst, pdstlen, src, srclen));
     }
-#endif /* HAVE_PKG_BZLIB */
-
-#if HAVE_PKG_ZLIB
-    /*
-     *  XXX: The use of the "xdstlen_ul" temporary variable is to avoid the
-     *       gcc3.3 compiler warning: "dereferencing type-punned pointer
-     *       will break strict-aliasing rules".  A mere cast doesn't suffice.
-     */
-    if (type == MUNGE_ZIP_ZLIB) {
-        unsigned long xdstlen_ul = xdstlen;
-        if (uncompress (xdst, &xdstlen_ul,
-                xsrc, (unsigned long) xsrclen) != Z_OK)
-            return (-1);
-        xdstlen = xdstlen_ul;
+    xdstlen = *pdstlen;
+    if (_zip_decompress_raw (type, dst, &xdstlen,
+            (unsigned char *) src + sizeof (zip_meta_t),
+            srclen - sizeof (zip_meta_t)) < 0) {
+        return (-1);
     }
-#endif /* HAVE_PKG_ZLIB */
-
     *pdstlen = xdstlen;
     return (0);
 }
@@ -243,26 +312,33 @@ zip_decompress_block (munge_zip_t type,
 int
 zip_compress_length (munge_zip_t type, const void *src, int len)
 {
-/*  For zlib "deflate" compression, allocate an output buffer at least 0.1%
- *    larger than the uncompressed input, plus an additional 12 bytes.
- *  For bzlib compression, allocate an output buffer at least 1% larger than
- *    the uncompressed input, plus an additional 600 bytes.
- *  Also reserve space for encoding the size of the uncompressed data.
- *  The "+1" is for the double-to-int conversion to perform a ceiling function.
+/*  Reserve space for encoding the size of the uncompressed data.
+ *  For the framed format, also reserve space for the chunk length table and
+ *    the worst case of each chunk since they are compressed independently.
  *
  *  XXX: Note the [src] parm is not currently used here.
  */
-#if HAVE_PKG_BZLIB
-    if (type == MUNGE_ZIP_BZLIB)
-        return ((int) ((len * 1.01) + 600 + 1 + sizeof (zip_meta_t)));
-#endif /* HAVE_PKG_BZLIB */
+    int n_chunks;
+    int n;
+    int i;
+    int m;
 
-#if HAVE_PKG_ZLIB
-    if (type == MUNGE_ZIP_ZLIB)
-        return ((int) ((len * 1.001) + 12 + 1 + sizeof (zip_meta_t)));
-#endif /* HAVE_PKG_ZLIB */
-
-    return (-1);
+    if (_zip_raw_length (type, 0) < 0) {
+        return (-1);
+    }
+    if (!_zip_is_chunked (len)) {
+        return (_zip_raw_length (type, len) + sizeof (zip_meta_t));
+    }
+    n_chunks = (len + MUNGE_ZIP_CHUNK_LEN - 1) / MUNGE_ZIP_CHUNK_LEN;
+    n = sizeof (zip_chunk_meta_t) + (n_chunks * sizeof (uint32_t));
+    for (i = 0; i < n_chunks; i++) {
+        m = len - (i * MUNGE_ZIP_CHUNK_LEN);
+        if (m > MUNGE_ZIP_CHUNK_LEN) {
+            m = MUNGE_ZIP_CHUNK_LEN;
+        }
+        n += _zip_raw_length (type, m);
+    }
+    return (n);
 }
 
 
@@ -275,6 +351,7 @@ zip_decompress_length (munge_zip_t type, const void *src, int len)
 /*  XXX: Note the [type] parm is not currently used here.
  */
     zip_meta_t    *pmeta;
+    uint32_t       magic;
 
     assert (src != NULL);
 
@@ -282,7 +359,8 @@ zip_decompress_length (munge_zip_t type, const void *src, int len)
         return (-1);
     }
     pmeta = (void *) src;
-    if (ntohl (pmeta->magic) != ZIP_MAGIC) {
+    magic = ntohl (pmeta->magic);
+    if ((magic != ZIP_MAGIC) && (magic != ZIP_CHUNK_MAGIC)) {
         return (-1);
     }
     return ((int) ntohl (pmeta->length));
@@ -327,3 +405,367 @@ zip_select_default_type (munge_zip_t type)
     }
     return (z);
 }
+
+
+/*****************************************************************************
+ *  Private Functions
+ *****************************************************************************/
+
+static int
+_zip_compress_raw (munge_zip_t type, unsigned char *dst,
+                   unsigned int *pdstlen, const unsigned char *src,
+                   unsigned int srclen)
+{
+/*  Compresses [srclen] bytes of [src] into [dst] without any metadata.
+ *  Upon entry, [*pdstlen] is the size of [dst]; upon exit, it is the length
+ *    of the compressed data.
+ */
+#if HAVE_PKG_BZLIB
+    if (type == MUNGE_ZIP_BZLIB) {
+        if (BZ2_bzBuffToBuffCompress ((char *) dst, pdstlen,
+                (char *) src, srclen, 9, 0, 0) != BZ_OK)
+            return (-1);
+        return (0);
+    }
+#endif /* HAVE_PKG_BZLIB */
+
+#if HAVE_PKG_ZLIB
+    /*
+     *  XXX: The use of the "dstlen_ul" temporary variable is to avoid the
+     *       gcc3.3 compiler warning: "dereferencing type-punned pointer
+     *       will break strict-aliasing rules".  A mere cast doesn't suffice.
+     */
+    if (type == MUNGE_ZIP_ZLIB) {
+        unsigned long dstlen_ul = *pdstlen;
+        if (compress (dst, &dstlen_ul, src, (unsigned long) srclen) != Z_OK)
+            return (-1);
+        *pdstlen = dstlen_ul;
+        return (0);
+    }
+#endif /* HAVE_PKG_ZLIB */
+
+    return (-1);
+}
+
+
+static int
+_zip_decompress_raw (munge_zip_t type, unsigned char *dst,
+                     unsigned int *pdstlen, const unsigned char *src,
+                     unsigned int srclen)
+{
+/*  Decompresses [srclen] bytes of [src] (without any metadata) into [dst].
+ *  Upon entry, [*pdstlen] is the size of [dst]; upon exit, it is the length
+ *    of the decompressed data.
+ */
+#if HAVE_PKG_BZLIB
+    if (type == MUNGE_ZIP_BZLIB) {
+        if (BZ2_bzBuffToBuffDecompress ((char *) dst, pdstlen,
+                (char *) src, srclen, 0, 0) != BZ_OK)
+            return (-1);
+        return (0);
+    }
+#endif /* HAVE_PKG_BZLIB */
+
+#if HAVE_PKG_ZLIB
+    /*
+     *  XXX: See _zip_compress_raw() regarding "dstlen_ul".
+     */
+    if (type == MUNGE_ZIP_ZLIB) {
+        unsigned long dstlen_ul = *pdstlen;
+        if (uncompress (dst, &dstlen_ul, src, (unsigned long) srclen) != Z_OK)
+            return (-1);
+        *pdstlen = dstlen_ul;
+        return (0);
+    }
+#endif /* HAVE_PKG_ZLIB */
+
+    return (-1);
+}
+
+
+static int
+_zip_raw_length (munge_zip_t type, int len)
+{
+/*  Returns a worst-case estimate for the buffer length needed to compress
+ *    [len] bytes using compression method [type] (without any metadata),
+ *    or -1 on error.
+ *  For zlib "deflate" compression, allocate an output buffer at least 0.1%
+ *    larger than the uncompressed input, plus an additional 12 bytes.
+ *  For bzlib compression, allocate an output buffer at least 1% larger than
+ *    the uncompressed input, plus an additional 600 bytes.
+ *  The "+1" is for the double-to-int conversion to perform a ceiling function.
+ */
+#if HAVE_PKG_BZLIB
+    if (type == MUNGE_ZIP_BZLIB)
+        return ((int) ((len * 1.01) + 600 + 1));
+#endif /* HAVE_PKG_BZLIB */
+
+#if HAVE_PKG_ZLIB
+    if (type == MUNGE_ZIP_ZLIB)
+        return ((int) ((len * 1.001) + 12 + 1));
+#endif /* HAVE_PKG_ZLIB */
+
+    return (-1);
+}
+
+
+static int
+_zip_is_chunked (int len)
+{
+/*  Returns non-zero if [len] bytes of data should be compressed using the
+ *    framed format.
+ */
+    return ((_zip_work != NULL) && (len > MUNGE_ZIP_CHUNK_LEN));
+}
+
+
+static int
+_zip_compress_chunked (munge_zip_t type,
+                       void *dst, int *pdstlen, const void *src, int srclen)
+{
+/*  Compresses [src] in parallel chunks into the framed format.
+ *  Each chunk is compressed into its own worst-case slot within [dst], after
+ *    which the chunks are slid down to be contiguous.
+ */
+    zip_chunk_meta_t  meta;
+    zip_chunk_t      *chunks;
+    unsigned char    *p;
+    uint32_t          u;
+    int               n_chunks;
+    int               hdr_len;
+    int               off;
+    int               i;
+    int               rc = -1;
+
+    n_chunks = (srclen + MUNGE_ZIP_CHUNK_LEN - 1) / MUNGE_ZIP_CHUNK_LEN;
+    hdr_len = sizeof (meta) + (n_chunks * sizeof (uint32_t));
+    if (*pdstlen < hdr_len) {
+        return (-1);
+    }
+    if (!(chunks = calloc (n_chunks, sizeof (*chunks)))) {
+        return (-1);
+    }
+    off = hdr_len;
+    for (i = 0; i < n_chunks; i++) {
+        chunks[i].type = type;
+        chunks[i].do_compress = 1;
+        chunks[i].src =
+            (const unsigned char *) src + (i * MUNGE_ZIP_CHUNK_LEN);
+        chunks[i].srclen = srclen - (i * MUNGE_ZIP_CHUNK_LEN);
+        if (chunks[i].srclen > MUNGE_ZIP_CHUNK_LEN) {
+            chunks[i].srclen = MUNGE_ZIP_CHUNK_LEN;
+        }
+        chunks[i].dst = (unsigned char *) dst + off;
+        chunks[i].dstlen = _zip_raw_length (type, chunks[i].srclen);
+        off += chunks[i].dstlen;
+        if (off > *pdstlen) {
+            goto end;
+        }
+    }
+    if (_zip_run_chunks (chunks, n_chunks) < 0) {
+        goto end;
+    }
+    p = (unsigned char *) dst + hdr_len;
+    for (i = 0; i < n_chunks; i++) {
+        memmove (p, chunks[i].dst, chunks[i].dstlen);
+        p += chunks[i].dstlen;
+        u = htonl (chunks[i].dstlen);
+        memcpy ((unsigned char *) dst + sizeof (meta) + (i * sizeof (u)),
+            &u, sizeof (u));
+    }
+    meta.magic = htonl (ZIP_CHUNK_MAGIC);
+    meta.length = htonl (srclen);
+    meta.chunk_len = htonl (MUNGE_ZIP_CHUNK_LEN);
+    meta.n_chunks = htonl (n_chunks);
+    memcpy (dst, &meta, sizeof (meta));
+    *pdstlen = p - (unsigned char *) dst;
+    rc = 0;
+
+end:
+    free (chunks);
+    return (rc);
+}
+
+
+static int
+_zip_decompress_chunked (munge_zip_t type,
+                         void *dst, int *pdstlen, const void *src, int srclen)
+{
+/*  Decompresses framed data in [src] into [dst].
+ *  The metadata is validated before any chunk is processed, and each chunk
+ *    must decompress to exactly its expected length.
+ */
+    zip_chunk_meta_t     meta;
+    zip_chunk_t         *chunks;
+    const unsigned char *p;
+    uint32_t             u;
+    uint32_t             length;
+    uint32_t             chunk_len;
+    uint32_t             n_chunks;
+    int                  hdr_len;
+    int                  off;
+    int                  i;
+    int                  rc = -1;
+
+    if (srclen < sizeof (meta)) {
+        return (-1);
+    }
+    memcpy (&meta, src, sizeof (meta));
+    length = ntohl (meta.length);
+    chunk_len = ntohl (meta.chunk_len);
+    n_chunks = ntohl (meta.n_chunks);
+
+    if ((length == 0) || (length > *pdstlen) || (chunk_len == 0)) {
+        return (-1);
+    }
+    if (n_chunks != ((length - 1) / chunk_len) + 1) {
+        return (-1);
+    }
+    if (n_chunks > (srclen - sizeof (meta)) / sizeof (uint32_t)) {
+        return (-1);
+    }
+    hdr_len = sizeof (meta) + (n_chunks * sizeof (uint32_t));
+    if (!(chunks = calloc (n_chunks, sizeof (*chunks)))) {
+        return (-1);
+    }
+    p = (const unsigned char *) src + sizeof (meta);
+    off = hdr_len;
+    for (i = 0; i < n_chunks; i++) {
+        memcpy (&u, p + (i * sizeof (u)), sizeof (u));
+        u = ntohl (u);
+        if ((u == 0) || (u > srclen - off)) {
+            goto end;
+        }
+        chunks[i].type = type;
+        chunks[i].do_compress = 0;
+        chunks[i].src = (const unsigned char *) src + off;
+        chunks[i].srclen = u;
+        chunks[i].dst = (unsigned char *) dst + (i * chunk_len);
+        chunks[i].dstlen = length - (i * chunk_len);
+        if (chunks[i].dstlen > chunk_len) {
+            chunks[i].dstlen = chunk_len;
+        }
+        off += u;
+    }
+    if (off != srclen) {
+        goto end;
+    }
+    if (_zip_run_chunks (chunks, n_chunks) < 0) {
+        goto end;
+    }
+    *pdstlen = length;
+    rc = 0;
+
+end:
+    free (chunks);
+    return (rc);
+}
+
+
+static int
+_zip_run_chunks (zip_chunk_t *chunks, int n)
+{
+/*  Processes the [n] [chunks], handing all but the first to the zip helper
+ *    threads while the calling thread processes the first itself.
+ *  Returns 0 if every chunk succeeded, or -1 on error.
+ */
+    zip_batch_t batch;
+    int         i;
+    int         rc = 0;
+
+    assert (chunks != NULL);
+    assert (n > 0);
+
+    if ((errno = pthread_mutex_init (&batch.lock, NULL)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to init zip batch mutex");
+    }
+    if ((errno = pthread_cond_init (&batch.done, NULL)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR,
+            "Failed to init zip batch condition");
+    }
+    batch.n_pending = n - 1;
+
+    for (i = 1; i < n; i++) {
+        chunks[i].batch = &batch;
+        if ((_zip_work == NULL) || (work_queue (_zip_work, &chunks[i]) < 0)) {
+            _zip_chunk_exec (&chunks[i]);
+        }
+    }
+    _zip_chunk_process (&chunks[0]);
+
+    if ((errno = lockprof_mutex_lock (&batch.lock, &_zip_site)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock zip batch mutex");
+    }
+    while (batch.n_pending > 0) {
+        if ((errno = pthread_cond_wait (&batch.done, &batch.lock)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to wait on zip batch condition");
+        }
+    }
+    if ((errno = pthread_mutex_unlock (&batch.lock)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to unlock zip batch mutex");
+    }
+    if ((errno = pthread_cond_destroy (&batch.done)) != 0) {
+        log_msg (LOG_ERR, "Failed to destroy zip batch condition: %s",
+            strerror (errno));
+    }
+    if ((errno = pthread_mutex_destroy (&batch.lock)) != 0) {
+        log_msg (LOG_ERR, "Failed to destroy zip batch mutex: %s",
+            strerror (errno));
+    }
+    for (i = 0; i < n; i++) {
+        if (chunks[i].rc < 0) {
+            rc = -1;
+        }
+    }
+    return (rc);
+}
+
+
+static void
+_zip_chunk_exec (zip_chunk_t *z)
+{
+/*  Processes chunk [z] on behalf of its batch, notifying the waiting thread
+ *    once the last pending chunk is done.
+ */
+    zip_batch_t *batch = z->batch;
+
+    _zip_chunk_process (z);
+
+    if ((errno = lockprof_mutex_lock (&batch->lock, &_zip_site)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to lock zip batch mutex");
+    }
+    if (--batch->n_pending == 0) {
+        if ((errno = pthread_cond_signal (&batch->done)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to signal zip batch condition");
+        }
+    }
+    if ((errno = pthread_mutex_unlock (&batch->lock)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to unlock zip batch mutex");
+    }
+    return;
+}
+
+
+static void
+_zip_chunk_process (zip_chunk_t *z)
+{
+/*  Compresses or decompresses the single chunk [z], setting its [rc].
+ */
+    unsigned int expected;
+
+    if (z->do_compress) {
+        z->rc = _zip_compress_raw (z->type, z->dst, &z->dstlen,
+            z->src, z->srclen);
+    }
+    else {
+        expected = z->dstlen;
+        z->rc = _zip_decompress_raw (z->type, z->dst, &z->dstlen,
+            z->src, z->srclen);
+        if ((z->rc == 0) && (z->dstlen != expected)) {
+            z->rc = -1;
+        }
+    }
+    return;
+}
@@ -41,6 +41,10 @@
  *  Prototypes
  *****************************************************************************/
 
+void zip_init (int n_threads);
+
+void zip_fini (void);
+
 int zip_is_valid_type (munge_zip_t type);
 
 int zip_compress_block (munge_zip_t type,
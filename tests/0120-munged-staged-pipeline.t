@@ -0,0 +1,102 @@
+#!/bin/sh
+
+test_description='Check munged staged request pipeline'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Check invalid values for the io-threads and queue-limit options.
+#
+test_expect_success 'munged --io-threads with negative value' '
+    test_must_fail "${MUNGED}" --io-threads=-1 --foreground --stop
+'
+
+test_expect_success 'munged --queue-limit with zero value' '
+    test_must_fail "${MUNGED}" --queue-limit=0 --foreground --stop
+'
+
+# Start the daemon with the staged pipeline enabled and a small queue limit
+#   so that back-pressure between stages is exercised, or bail out.
+# The stage threads are created after the pidfile is written, so retry the
+#   log checks until they appear.
+#
+test_expect_success 'start munged with staged pipeline' '
+    munged_start t-bail-out-on-error --io-threads=2 --queue-limit=4 &&
+    retry 5 "grep -q \"Created 2 recv stage threads\" \"\${MUNGE_LOGFILE}\"" &&
+    retry 5 "grep -q \"Created 1 replay stage thread\" \"\${MUNGE_LOGFILE}\""
+'
+
+# Encode and decode a credential through the pipeline.
+#
+test_expect_success 'encode and decode credential' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --string="xyzzy-$$" </dev/null \
+        >cred.$$ &&
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" <cred.$$ >out.$$ &&
+    grep -q "^STATUS: *Success (0)$" out.$$ &&
+    tail -n 1 out.$$ | grep -q "^xyzzy-$$$"
+'
+
+# Check the replay stage detects a replayed credential.
+# Expect EMUNGE_CRED_REPLAYED (STATUS=17).
+#
+test_expect_success 'replay credential' '
+    test_expect_code 17 "${UNMUNGE}" --socket="${MUNGE_SOCKET}" \
+        <cred.$$ >/dev/null
+'
+
+# Check an invalid credential is rejected by the crypto stage.
+# Expect EMUNGE_CRED_INVALID (STATUS=9) or EMUNGE_BAD_CRED (STATUS=8).
+#
+test_expect_success 'decode invalid credential' '
+    echo "MUNGE:garbage:" >bad.$$ &&
+    test_must_fail "${UNMUNGE}" --socket="${MUNGE_SOCKET}" <bad.$$
+'
+
+# Drive concurrent encode & decode requests through the pipeline.
+#
+test_expect_success 'concurrent encode requests' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --encode --num-threads=8 \
+        --num-creds=2000
+'
+
+test_expect_success 'concurrent decode requests' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --num-threads=8 \
+        --num-creds=2000
+'
+
+# Stop the daemon.
+#
+test_expect_success 'stop munged' '
+    munged_stop
+'
+
+# Check the per-stage metrics reported at shutdown.
+#
+test_expect_success 'check stage metrics' '
+    for stage in recv crypto replay send; do
+        grep -q "Stage ${stage}: [1-9][0-9]* items" "${MUNGE_LOGFILE}" ||
+        return 1
+    done
+'
+
+# Perform housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
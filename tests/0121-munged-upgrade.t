@@ -0,0 +1,106 @@
+#!/bin/sh
+
+test_description='Check munged --upgrade'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Check the upgrade fails when no daemon is bound to the socket.
+#
+test_expect_success 'munged --upgrade without running daemon' '
+    test_must_fail "${MUNGED}" --socket="${MUNGE_SOCKET}" --upgrade
+'
+
+# Check an invalid upgrade-fd is rejected.
+#
+test_expect_success 'munged --upgrade-fd with stderr' '
+    test_must_fail "${MUNGED}" --upgrade-fd=2 --foreground --stop
+'
+
+# Start the daemon, or bail out.
+#
+test_expect_success 'start munged' '
+    munged_start t-bail-out-on-error &&
+    cat "${MUNGE_PIDFILE}" >pid.old.$$
+'
+
+# Encode and decode a credential before the upgrade.
+#
+test_expect_success 'encode and decode credential' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --string="xyzzy-$$" </dev/null \
+        >cred.$$ &&
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" <cred.$$ >out.$$ &&
+    grep -q "^STATUS: *Success (0)$" out.$$
+'
+
+# Upgrade the daemon in place.
+#
+test_expect_success 'munged --upgrade' '
+    "${MUNGED}" --socket="${MUNGE_SOCKET}" --upgrade --verbose
+'
+
+# Check the new daemon has taken over the socket and pidfile.
+#
+test_expect_success 'check new daemon' '
+    cat "${MUNGE_PIDFILE}" >pid.new.$$ &&
+    ! cmp -s pid.old.$$ pid.new.$$ &&
+    test -S "${MUNGE_SOCKET}" &&
+    grep -q "Exiting for upgrade" "${MUNGE_LOGFILE}" &&
+    grep -q "Took over socket" "${MUNGE_LOGFILE}"
+'
+
+# Check the replay cache was handed off to the new daemon.
+# Expect EMUNGE_CRED_REPLAYED (STATUS=17).
+#
+test_expect_success 'replay credential after upgrade' '
+    test_expect_code 17 "${UNMUNGE}" --socket="${MUNGE_SOCKET}" \
+        <cred.$$ >/dev/null
+'
+
+# Check the new daemon services requests.
+#
+test_expect_success 'encode and decode credential after upgrade' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --string="plugh-$$" </dev/null |
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" >out2.$$ &&
+    grep -q "^STATUS: *Success (0)$" out2.$$ &&
+    tail -n 1 out2.$$ | grep -q "^plugh-$$$"
+'
+
+# Check requests issued during the upgrade are not refused.
+#
+test_expect_success 'concurrent requests during upgrade' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --encode --num-threads=4 \
+        --duration=3 >remunge.$$ 2>&1 &
+    remunge_pid=$! &&
+    sleep 1 &&
+    "${MUNGED}" --socket="${MUNGE_SOCKET}" --upgrade &&
+    wait ${remunge_pid}
+'
+
+# Stop the daemon.
+#
+test_expect_success 'stop munged' '
+    munged_stop
+'
+
+# Perform housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
@@ -0,0 +1,88 @@
+#!/bin/sh
+
+test_description='Check munged latency probe'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Check invalid values for the probe-interval and probe-threshold options.
+#
+test_expect_success 'munged --probe-interval with negative value' '
+    test_must_fail "${MUNGED}" --probe-interval=-1 --foreground --stop
+'
+
+test_expect_success 'munged --probe-threshold with zero value' '
+    test_must_fail "${MUNGED}" --probe-threshold=0 --foreground --stop
+'
+
+# Check the probe can be disabled.
+#
+test_expect_success 'start munged with probe disabled' '
+    munged_start t-bail-out-on-error --probe-interval=0 &&
+    munged_stop &&
+    grep -q "Disabled latency probe" "${MUNGE_LOGFILE}"
+'
+
+# Check the probe runs through the work crew without tripping the replay
+#   cache, and reports its metrics at shutdown.
+# The probe is started after the pidfile is written, so retry the check.
+#
+test_expect_success 'start munged with probe every second' '
+    munged_start t-bail-out-on-error --probe-interval=1 \
+        --probe-threshold=60000 &&
+    retry 5 "grep -q \"Probing latency\" \"\${MUNGE_LOGFILE}\"" &&
+    grep -q "Probing latency every 1 second with 60000 msec threshold" \
+        "${MUNGE_LOGFILE}"
+'
+
+test_expect_success 'encode and decode credential during probes' '
+    sleep 3 &&
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" </dev/null |
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" >out.$$ &&
+    grep -q "^STATUS: *Success (0)$" out.$$
+'
+
+test_expect_success 'stop munged' '
+    munged_stop
+'
+
+test_expect_success 'check probe metrics' '
+    grep -q "Probe: [1-9][0-9]* round trips* (0 failed, 0 slow)" \
+        "${MUNGE_LOGFILE}" &&
+    grep -q "status healthy" "${MUNGE_LOGFILE}" &&
+    ! grep -q "Probe.*failed:" "${MUNGE_LOGFILE}"
+'
+
+# Check the probe runs through the staged request pipeline.
+#
+test_expect_success 'start munged with probe and staged pipeline' '
+    munged_start t-bail-out-on-error --probe-interval=1 --io-threads=2
+'
+
+test_expect_success 'stop munged after probes' '
+    sleep 3 &&
+    munged_stop &&
+    grep -q "Probe: [1-9][0-9]* round trips* (0 failed" "${MUNGE_LOGFILE}"
+'
+
+# Perform housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
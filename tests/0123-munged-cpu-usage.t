@@ -0,0 +1,73 @@
+#!/bin/sh
+
+test_description='Check munged per-client CPU usage tracking'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Check an invalid value for the usage-report-time option.
+#
+test_expect_success 'munged --usage-report-time with invalid value' '
+    test_must_fail "${MUNGED}" --usage-report-time=-2 --foreground --stop
+'
+
+# Check CPU usage tracking can be disabled.
+#
+test_expect_success 'start munged with CPU usage tracking disabled' '
+    munged_start t-bail-out-on-error --usage-report-time=-1 &&
+    munged_stop &&
+    grep -q "Disabled per-client CPU usage tracking" "${MUNGE_LOGFILE}" &&
+    ! grep -q "CPU usage:" "${MUNGE_LOGFILE}"
+'
+
+# Check CPU usage is attributed to the client UID and reported periodically
+#   and at shutdown.
+#
+test_expect_success 'start munged with periodic CPU usage reports' '
+    munged_start t-bail-out-on-error --usage-report-time=1 &&
+    grep -q "Reporting per-client CPU usage every 1 second" \
+        "${MUNGE_LOGFILE}"
+'
+
+test_expect_success 'encode and decode credentials' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --encode --num-creds=10 &&
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --num-creds=5
+'
+
+test_expect_success 'wait for periodic CPU usage report' '
+    sleep 2 &&
+    grep -q "CPU usage: " "${MUNGE_LOGFILE}"
+'
+
+test_expect_success 'stop munged' '
+    munged_stop
+'
+
+test_expect_success 'check CPU usage report' '
+    grep "CPU usage: 15 encodes and 5 decodes in .* by 1 UID$" \
+        "${MUNGE_LOGFILE}" &&
+    grep "CPU usage for UID=$(id -u): .* (15 encodes, 5 decodes)$" \
+        "${MUNGE_LOGFILE}"
+'
+
+# Perform housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
@@ -0,0 +1,95 @@
+#!/bin/sh
+
+test_description='Check libmunge client-side credential pool'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Start the daemon, or bail out.
+#
+test_expect_success 'start munged' '
+    munged_start t-bail-out-on-error
+'
+
+# Check invalid values for the pool size.
+#
+test_expect_success 'remunge --pool-size with negative value' '
+    test_must_fail "${REMUNGE}" --socket="${MUNGE_SOCKET}" --pool-size=-1
+'
+
+test_expect_success 'remunge --pool-size exceeding maximum' '
+    test_must_fail "${REMUNGE}" --socket="${MUNGE_SOCKET}" --pool-size=257
+'
+
+# Check pooled credentials decode successfully without being replayed.
+#
+test_expect_success 'encode and decode pooled credentials' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --pool-size=8 \
+        --num-threads=2 --num-creds=500 >out.$$ 2>&1 &&
+    cat out.$$ &&
+    grep -q "Processed 500 credentials" out.$$ &&
+    ! grep -q "error" out.$$
+'
+
+# Check pooled credentials are discarded before they expire.
+# With a 2s ttl, credentials are discarded from the pool after 1s.
+#
+test_expect_success 'pooled credentials do not expire' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --pool-size=8 \
+        --ttl=2 --duration=3 >out.$$ 2>&1 &&
+    cat out.$$ &&
+    ! grep -q "error" out.$$
+'
+
+# Check pooled credentials are discarded before they expire when munged
+#   clamps the default ttl to its maximum.
+# With a 2s max ttl, credentials are discarded from the pool after 1s.
+#
+test_expect_success 'pooled credentials do not expire with clamped ttl' '
+    munged_stop &&
+    munged_start t-bail-out-on-error --max-ttl=2 &&
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --pool-size=8 \
+        --duration=3 >out.$$ 2>&1 &&
+    cat out.$$ &&
+    ! grep -q "error" out.$$ &&
+    munged_stop &&
+    munged_start t-bail-out-on-error
+'
+
+# Check credentials with a payload bypass the pool.
+#
+test_expect_success 'encode and decode credentials with payload' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --pool-size=8 \
+        --length=64 --num-creds=100 >out.$$ 2>&1 &&
+    cat out.$$ &&
+    grep -q "Processed 100 credentials" out.$$ &&
+    ! grep -q "error" out.$$
+'
+
+# Stop the daemon.
+#
+test_expect_success 'stop munged' '
+    munged_stop
+'
+
+# Perform any housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
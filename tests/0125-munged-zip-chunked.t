@@ -0,0 +1,102 @@
+#!/bin/sh
+
+test_description='Check munged parallel chunked compression'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Create a payload spanning several chunks, and list the compression types
+#   supported by this build.
+#
+test_expect_success 'create payload and list zips' '
+    seq 1 100000 >payload.$$ &&
+    test "$(wc -c <payload.$$)" -gt 262144 &&
+    "${MUNGE}" --list-zips |
+    awk "/([0-9]+)/ { gsub(/[()]/, \"\"); print \$1 }" |
+    grep -v -e "^none$" -e "^default$" >zips.$$ || :
+'
+
+test_expect_success 'check for compression support' '
+    test -s zips.$$ && test_set_prereq ZIP
+'
+
+# Check an invalid value for the zip-threads option.
+#
+test_expect_success 'munged --zip-threads with negative value' '
+    test_must_fail "${MUNGED}" --zip-threads=-1 --foreground --stop
+'
+
+# Check payloads are compressed in chunks and restored intact.
+#
+test_expect_success ZIP 'start munged with zip threads' '
+    munged_start t-bail-out-on-error --zip-threads=2 &&
+    grep -q "Created 2 zip helper threads for 131072-byte chunks" \
+        "${MUNGE_LOGFILE}"
+'
+
+test_expect_success ZIP 'encode and decode chunked payload for each zip' '
+    local name &&
+    >fail.$$ &&
+    while read name; do
+        "${MUNGE}" --socket="${MUNGE_SOCKET}" --zip="${name}" \
+                --input=payload.$$ --output=cred.${name}.$$ &&
+        "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --ignore-replay \
+                --input=cred.${name}.$$ --output=out.${name}.$$ \
+                --metadata=meta.${name}.$$ &&
+        grep -q "^ZIP: *${name} " meta.${name}.$$ &&
+        cmp payload.$$ out.${name}.$$ ||
+        echo "${name}" >>fail.$$
+    done <zips.$$ &&
+    test ! -s fail.$$
+'
+
+test_expect_success ZIP 'stop munged with zip threads' '
+    munged_stop
+'
+
+# Check chunked credentials are decoded by a daemon without zip threads.
+#
+test_expect_success ZIP 'start munged without zip threads' '
+    munged_start t-bail-out-on-error &&
+    ! grep -q "zip helper thread" "${MUNGE_LOGFILE}"
+'
+
+test_expect_success ZIP 'decode chunked credential for each zip' '
+    local name &&
+    >fail.$$ &&
+    while read name; do
+        rm -f out.${name}.$$ &&
+        "${UNMUNGE}" --socket="${MUNGE_SOCKET}" \
+                --input=cred.${name}.$$ --output=out.${name}.$$ \
+                --metadata=/dev/null &&
+        cmp payload.$$ out.${name}.$$ ||
+        echo "${name}" >>fail.$$
+    done <zips.$$ &&
+    test ! -s fail.$$
+'
+
+test_expect_success ZIP 'stop munged without zip threads' '
+    munged_stop
+'
+
+# Perform housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
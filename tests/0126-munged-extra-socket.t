@@ -0,0 +1,92 @@
+#!/bin/sh
+
+test_description='Check munged --extra-socket'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Check invalid socket specifications are rejected.
+#
+test_expect_success 'munged --extra-socket with invalid key' '
+    test_must_fail "${MUNGED}" --extra-socket="${MUNGE_SOCKET}.x,foo=1" \
+            --foreground --stop
+'
+
+test_expect_success 'munged --extra-socket with invalid ttl' '
+    test_must_fail "${MUNGED}" --extra-socket="${MUNGE_SOCKET}.x,ttl=-1" \
+            --foreground --stop
+'
+
+test_expect_success 'munged --extra-socket with invalid mac' '
+    test_must_fail "${MUNGED}" --extra-socket="${MUNGE_SOCKET}.x,mac=none" \
+            --foreground --stop
+'
+
+# Start munged with an unrestricted socket having its own default ttl, and a
+#   socket restricted to a UID other than that of the client.
+# The sockets are polled after the pidfile is written, so retry the check.
+#
+test_expect_success 'start munged with extra sockets' '
+    munged_start t-bail-out-on-error \
+            --extra-socket="${MUNGE_SOCKET}.a,ttl=600,mac=sha512" \
+            --extra-socket="${MUNGE_SOCKET}.b,uid=$(( $(id -u) + 1 ))" &&
+    test -S "${MUNGE_SOCKET}.a" &&
+    test -S "${MUNGE_SOCKET}.b" &&
+    retry 5 "grep -q \"Listening on 3 sockets\" \"\${MUNGE_LOGFILE}\""
+'
+
+# Check the defaults of the extra socket apply to credentials encoded on it,
+#   and that the credential is decoded on the primary socket.
+#
+test_expect_success 'encode on extra socket uses its defaults' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}.a" --no-input >cred.$$ &&
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --input=cred.$$ \
+            --metadata=meta.$$ --output=/dev/null &&
+    grep -q "^TTL: *600$" meta.$$ &&
+    grep -q "^MAC: *sha512 " meta.$$
+'
+
+# Check requests on the primary socket still use the daemon-wide defaults.
+#
+test_expect_success 'encode on primary socket uses daemon defaults' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input |
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}.a" --metadata=meta.$$ \
+            --output=/dev/null &&
+    grep -q "^TTL: *300$" meta.$$
+'
+
+# Check a client not permitted by the access policy is denied.
+#
+test_expect_success 'encode on restricted socket is denied' '
+    test_must_fail "${MUNGE}" --socket="${MUNGE_SOCKET}.b" --no-input \
+            2>err.$$ &&
+    grep -q "Access denied" err.$$
+'
+
+test_expect_success 'stop munged with extra sockets' '
+    munged_stop &&
+    test ! -S "${MUNGE_SOCKET}.a" &&
+    test ! -S "${MUNGE_SOCKET}.b"
+'
+
+# Perform housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
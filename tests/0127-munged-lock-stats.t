@@ -0,0 +1,67 @@
+#!/bin/sh
+
+test_description='Check munged --lock-stats'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Check lock profiling is disabled by default.
+#
+test_expect_success 'start munged without lock stats' '
+    munged_start t-bail-out-on-error
+'
+
+test_expect_success 'stop munged without lock stats' '
+    munged_stop &&
+    ! grep -q "Lock profile:" "${MUNGE_LOGFILE}"
+'
+
+# Check the lock profile is reported on SIGHUP and at shutdown.
+#
+test_expect_success 'start munged with lock stats' '
+    munged_start t-bail-out-on-error --lock-stats &&
+    grep -q "Enabled lock contention profiling" "${MUNGE_LOGFILE}"
+'
+
+test_expect_success 'encode and decode credentials' '
+    local i &&
+    for i in 1 2 3 4 5; do
+        "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input |
+        "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --output=/dev/null ||
+        return 1
+    done
+'
+
+test_expect_success 'report lock stats on SIGHUP' '
+    kill -HUP "$(cat "${MUNGE_PIDFILE}")" &&
+    retry 5 "grep -q \"Lock profile:\" \"\${MUNGE_LOGFILE}\""
+'
+
+test_expect_success 'stop munged with lock stats' '
+    munged_stop &&
+    test "$(grep -c "Lock profile:" "${MUNGE_LOGFILE}")" -eq 2 &&
+    grep -q "Lock work crew at work\.c:[0-9]*: [1-9][0-9]* acquired" \
+            "${MUNGE_LOGFILE}"
+'
+
+# Perform housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
@@ -0,0 +1,100 @@
+#!/bin/sh
+
+test_description='Check munged against slow and adversarial clients'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# The badclient helper is built by "make check".
+#
+test -x "${BADCLIENT}" && test_set_prereq BADCLIENT
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Check an invalid value for the request-timeout option.
+#
+test_expect_success 'munged --request-timeout with negative value' '
+    test_must_fail "${MUNGED}" --request-timeout=-1 --foreground --stop
+'
+
+# Check the connections of each kind of misbehaving client are closed by the
+#   request deadline.  With 2 threads and a 500ms deadline, 4 connections
+#   should all be closed in about 1s; allow for a slow host, but stay under
+#   the 2s that a single socket timeout alone would take.
+#
+test_expect_success BADCLIENT 'start munged with request deadline' '
+    munged_start t-bail-out-on-error --num-threads=2 --request-timeout=500
+'
+
+for mode in idle trickle stall; do
+    test_expect_success BADCLIENT "close ${mode} clients by deadline" '
+        "${BADCLIENT}" --socket="${MUNGE_SOCKET}" --mode='"${mode}"' \
+                --num-conns=4 --duration=10 >out.$$ &&
+        cat out.$$ &&
+        grep -q "conns=4 closed=4 " out.$$ &&
+        max=$(sed -n "s/.*max_msecs=\([0-9]*\).*/\1/p" out.$$) &&
+        test "${max}" -lt 2000
+    '
+done
+
+# Check good clients are served promptly while stalled clients are active.
+#
+test_expect_success BADCLIENT 'serve good clients alongside stalled clients' '
+    "${BADCLIENT}" --socket="${MUNGE_SOCKET}" --mode=stall \
+            --num-conns=8 --duration=10 >bad.$$ &
+    pid=$! &&
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --num-creds=20 \
+            --num-threads=2 --warn-time=3 >good.$$ 2>&1 &&
+    wait ${pid} &&
+    cat good.$$ bad.$$ &&
+    grep -q "Processed 20 credentials" good.$$ &&
+    ! grep -q -e "took" -e "failed" good.$$ &&
+    grep -q "conns=8 closed=8 " bad.$$
+'
+
+test_expect_success BADCLIENT 'log timed-out requests' '
+    grep -q "Timed-out" "${MUNGE_LOGFILE}"
+'
+
+test_expect_success BADCLIENT 'stop munged with request deadline' '
+    munged_stop
+'
+
+# Check the request deadline also applies to the staged request pipeline.
+#
+test_expect_success BADCLIENT 'start munged with staged pipeline' '
+    munged_start t-bail-out-on-error --io-threads=1 --request-timeout=500
+'
+
+test_expect_success BADCLIENT 'close trickle clients by deadline in pipeline' '
+    "${BADCLIENT}" --socket="${MUNGE_SOCKET}" --mode=trickle \
+            --num-conns=2 --duration=10 >out.$$ &&
+    cat out.$$ &&
+    grep -q "conns=2 closed=2 " out.$$ &&
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input |
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --output=/dev/null
+'
+
+test_expect_success BADCLIENT 'stop munged with staged pipeline' '
+    munged_stop
+'
+
+# Perform housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
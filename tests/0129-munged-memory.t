@@ -0,0 +1,143 @@
+#!/bin/sh
+
+test_description='Check munged peak memory and allocations under load'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Thresholds for heap growth over an idle munged.  Peak bytes are the growth
+#   in the high-water mark of bytes allocated; allocs are the number of heap
+#   allocations per credential encoded or decoded.  These are set at roughly
+#   twice the values measured on x86_64 Linux with glibc and OpenSSL 3, and
+#   higher for the concurrent peak since it varies with thread scheduling.
+#
+MEMSTAT_LARGE_PEAK_BYTES=1048576
+MEMSTAT_LARGE_ALLOCS=80
+MEMSTAT_CONC_PEAK_BYTES=524288
+MEMSTAT_CONC_ALLOCS=80
+
+# The memstat preload shim is built by "make check".  Check it can be
+#   preloaded and writes its counters at exit.
+#
+if test -f "${MEMSTAT}" &&
+        LD_PRELOAD="${MEMSTAT}" MEMSTAT_FILE=memstat.prereq cat </dev/null &&
+        cat memstat.prereq.* 2>/dev/null | grep -q "^allocs=[0-9]"; then
+    test_set_prereq MEMSTAT
+fi
+rm -f memstat.prereq.*
+
+# Start munged with the memstat shim preloaded.  MEMSTAT_FILE must be an
+#   absolute path since munged changes to the root directory.
+#
+memstat_munged_start()
+{
+    MEMSTAT_FILE="$(pwd)/memstat.out" &&
+    export MEMSTAT_FILE &&
+    rm -f memstat.out.* &&
+    munged_start t-exec="env LD_PRELOAD=${MEMSTAT}" "$@" &&
+    cat "${MUNGE_PIDFILE}" >memstat.pid
+}
+
+# Stop munged and save the memstat counters of the process named in the
+#   pidfile to the file [$1].
+#
+memstat_munged_stop()
+{
+    local pid
+
+    pid=$(cat memstat.pid) &&
+    munged_stop &&
+    cp "memstat.out.${pid}" "$1" &&
+    cat "$1"
+}
+
+# Output the value of the memstat counter [$2] saved in the file [$1].
+#
+memstat_get()
+{
+    tr ' ' '\n' <"$1" | sed -n "s/^$2=//p"
+}
+
+# Check the measured growth [$1] is at most the threshold [$2].
+#
+memstat_check()
+{
+    echo "$1 <= $2" >&2
+    test "$1" -le "$2"
+}
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Measure an idle munged as the baseline.
+#
+test_expect_success MEMSTAT 'measure idle munged' '
+    memstat_munged_start &&
+    memstat_munged_stop idle.memstat
+'
+
+# Check the large-payload workload.  Each credential carries 64KiB of data,
+#   so bloat in the buffers of the enc/dec pipelines is multiplied.
+#
+test_expect_success MEMSTAT 'measure munged with large payloads' '
+    memstat_munged_start &&
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --length=65536 \
+            --num-creds=200 &&
+    memstat_munged_stop large.memstat
+'
+
+test_expect_success MEMSTAT 'check peak heap for large payloads' '
+    memstat_check \
+            $(( $(memstat_get large.memstat peak_bytes) - \
+                $(memstat_get idle.memstat peak_bytes) )) \
+            "${MEMSTAT_LARGE_PEAK_BYTES}"
+'
+
+test_expect_success MEMSTAT 'check allocations per cred for large payloads' '
+    memstat_check \
+            $(( ($(memstat_get large.memstat allocs) - \
+                $(memstat_get idle.memstat allocs)) / 400 )) \
+            "${MEMSTAT_LARGE_ALLOCS}"
+'
+
+# Check the high-concurrency workload.
+#
+test_expect_success MEMSTAT 'measure munged with many concurrent clients' '
+    memstat_munged_start --num-threads=8 &&
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --num-threads=16 \
+            --num-creds=2000 &&
+    memstat_munged_stop conc.memstat
+'
+
+test_expect_success MEMSTAT 'check peak heap for many concurrent clients' '
+    memstat_check \
+            $(( $(memstat_get conc.memstat peak_bytes) - \
+                $(memstat_get idle.memstat peak_bytes) )) \
+            "${MEMSTAT_CONC_PEAK_BYTES}"
+'
+
+test_expect_success MEMSTAT 'check allocations per cred for many clients' '
+    memstat_check \
+            $(( ($(memstat_get conc.memstat allocs) - \
+                $(memstat_get idle.memstat allocs)) / 4000 )) \
+            "${MEMSTAT_CONC_ALLOCS}"
+'
+
+# Clean up after a munged process that may not have terminated.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
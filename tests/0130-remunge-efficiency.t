@@ -0,0 +1,81 @@
+#!/bin/sh
+
+test_description='Check remunge efficiency reporting'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Efficiency reporting samples the munged process from /proc.
+#
+test -r /proc/self/stat && test_set_prereq PROCFS
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Check invalid values for the pid options.
+#
+test_expect_success 'remunge --pid with invalid value' '
+    test_must_fail "${REMUNGE}" --socket="${MUNGE_SOCKET}" --pid=0 &&
+    test_must_fail "${REMUNGE}" --socket="${MUNGE_SOCKET}" --pid=x
+'
+
+test_expect_success 'remunge --pid-file with missing file' '
+    test_must_fail "${REMUNGE}" --socket="${MUNGE_SOCKET}" \
+            --pid-file=missing.pid.$$
+'
+
+test_expect_success 'start munged' '
+    munged_start t-bail-out-on-error
+'
+
+# Check the efficiency report when given the munged pid.
+#
+test_expect_success PROCFS 'remunge --pid' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --num-creds=1000 \
+            --pid="$(cat "${MUNGE_PIDFILE}")" >out.$$ &&
+    cat out.$$ &&
+    grep -q "Munged CPU: [0-9.]*s ([0-9.]*s user, [0-9.]*s sys)" out.$$ &&
+    grep -q "Client CPU: [0-9.]*s ([0-9.]*s user, [0-9.]*s sys)" out.$$ &&
+    grep -q "Efficiency: " out.$$
+'
+
+# Check the efficiency report when reading the munged pidfile.
+#
+test_expect_success PROCFS 'remunge --pid-file' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --num-creds=1000 \
+            --pid-file="${MUNGE_PIDFILE}" >out.$$ &&
+    cat out.$$ &&
+    grep -q "Munged CPU: " out.$$ &&
+    grep -q "Efficiency: " out.$$
+'
+
+# Check the efficiency report is not output by default.
+#
+test_expect_success 'remunge without --pid' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --num-creds=10 >out.$$ &&
+    cat out.$$ &&
+    ! grep -q "Efficiency: " out.$$
+'
+
+test_expect_success 'stop munged' '
+    munged_stop
+'
+
+# Clean up after a munged process that may not have terminated.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
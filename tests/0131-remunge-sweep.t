@@ -0,0 +1,74 @@
+#!/bin/sh
+
+test_description='Check remunge thread-scaling sweep'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Check invalid values for the sweep & warmup options.
+#
+for range in 0-2 2-1 2 1-2:0 1-x; do
+    test_expect_success "remunge --sweep=${range}" '
+        test_must_fail "${REMUNGE}" --socket="${MUNGE_SOCKET}" \
+                --sweep='"${range}"'
+    '
+done
+
+test_expect_success 'remunge --warmup with negative value' '
+    test_must_fail "${REMUNGE}" --socket="${MUNGE_SOCKET}" --sweep=1-2 \
+            --warmup=-1
+'
+
+test_expect_success 'start munged' '
+    munged_start t-bail-out-on-error
+'
+
+# Check a doubling sweep outputs a row for each step and a saturation line.
+#
+test_expect_success 'remunge --sweep doubling threads' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --num-creds=100 \
+            --sweep=1-6 --warmup=0 >out.$$ &&
+    cat out.$$ &&
+    grep -q "^Threads  *Creds/sec " out.$$ &&
+    awk "\$1 ~ /^[0-9]+$/ { print \$1 }" out.$$ >threads.$$ &&
+    printf "1\n2\n4\n6\n" >expected.$$ &&
+    test_cmp expected.$$ threads.$$ &&
+    grep -q "^Saturation " out.$$
+'
+
+# Check a sweep with a step, including a warmup phase.
+#
+test_expect_success 'remunge --sweep with step and warmup' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --num-creds=100 \
+            --sweep=2-4:2 --warmup=1 >out.$$ &&
+    cat out.$$ &&
+    awk "\$1 ~ /^[0-9]+$/ { print \$1 }" out.$$ >threads.$$ &&
+    printf "2\n4\n" >expected.$$ &&
+    test_cmp expected.$$ threads.$$
+'
+
+test_expect_success 'stop munged' '
+    munged_stop
+'
+
+# Clean up after a munged process that may not have terminated.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
@@ -0,0 +1,60 @@
+#!/bin/sh
+
+test_description='Check munged rate-limiting of per-request log messages'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+test_expect_success 'start munged' '
+    munged_start t-bail-out-on-error
+'
+
+# Send a burst of invalid credentials, each of which logs an error message
+#   from the same call site.
+#
+test_expect_success 'decode invalid credentials' '
+    i=0 &&
+    while test "${i}" -lt 12; do
+        echo "MUNGE:invalid:" |
+        test_expect_code 8 "${UNMUNGE}" --socket="${MUNGE_SOCKET}" \
+                --no-output || return 1
+        i=$((i + 1))
+    done
+'
+
+test_expect_success 'stop munged' '
+    munged_stop
+'
+
+# Check only the first messages of the burst are logged, and the rest are
+#   summarized when the log is flushed at shutdown.
+#
+test_expect_success 'check log for rate-limited messages' '
+    n=$(grep -c "Info: *Failed to base64-decode credential" \
+            "${MUNGE_LOGFILE}") &&
+    test "${n}" -eq 5 &&
+    grep -q "Suppressed 7 similar messages: Failed to base64-decode" \
+            "${MUNGE_LOGFILE}"
+'
+
+# Clean up after a munged process that may not have terminated.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
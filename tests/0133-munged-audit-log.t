@@ -0,0 +1,165 @@
+#!/bin/sh
+
+test_description='Check munged binary audit log of decoded credentials'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Encode and decode [num] credentials, each from a separate client process.
+#
+audit_decode_creds()
+{
+    local num=$1 i=0
+
+    while test "${i}" -lt "${num}"; do
+        "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input |
+        "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --no-output || return 1
+        i=$((i + 1))
+    done
+}
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Check invalid values for the audit options.
+#
+test_expect_success 'munged --audit-max-size with negative value' '
+    test_must_fail "${MUNGED}" --audit-max-size=-1 --foreground --stop \
+            2>err.$$ &&
+    grep -q "Invalid value \"-1\" for audit-max-size" err.$$
+'
+
+test_expect_success 'munged --audit-sync with invalid value' '
+    test_must_fail "${MUNGED}" --audit-sync=-2 --foreground --stop \
+            2>err.$$ &&
+    grep -q "Invalid value \"-2\" for audit-sync" err.$$ &&
+    test_must_fail "${MUNGED}" --audit-sync=foo --foreground --stop \
+            2>err.$$ &&
+    grep -q "Invalid value \"foo\" for audit-sync" err.$$
+'
+
+test_expect_success 'start munged with audit log' '
+    rm -f audit.log &&
+    munged_start t-bail-out-on-error --audit-file=audit.log
+'
+
+# Only successfully decoded credentials are recorded.
+#
+test_expect_success 'decode credentials' '
+    audit_decode_creds 10 &&
+    echo "MUNGE:invalid:" |
+    test_expect_code 8 "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --no-output
+'
+
+test_expect_success 'stop munged' '
+    munged_stop &&
+    grep -q "Audit log: 10 records written, 0 dropped" "${MUNGE_LOGFILE}"
+'
+
+# The file consists of a 16-byte header followed by 40-byte records.
+#
+test_expect_success 'check audit log size and permissions' '
+    test "$(wc -c <audit.log)" -eq 416 &&
+    test "$(ls -l audit.log | cut -c1-10)" = "-rw-------"
+'
+
+test_expect_success 'convert audit log to text' '
+    "${MUNGEAUDIT}" audit.log >audit.out &&
+    test "$(wc -l <audit.out)" -eq 10 &&
+    ids="$(id -u):$(id -g)" &&
+    test "$(grep -c " client=${ids} cred=${ids} " audit.out)" -eq 10 &&
+    test "$(grep -cE " mac=[a-z0-9]+:[0-9a-f]{16}\$" audit.out)" -eq 10
+'
+
+test_expect_success 'convert audit log from stdin numerically' '
+    "${MUNGEAUDIT}" --numeric <audit.log >audit.out &&
+    test "$(wc -l <audit.out)" -eq 10 &&
+    test "$(grep -cE "^[0-9]+ encoded=[0-9]+ .* mac=[0-9]+:" audit.out)" \
+            -eq 10
+'
+
+# Restarting munged appends to the existing audit log.
+#
+test_expect_success 'append to existing audit log' '
+    munged_start t-bail-out-on-error --audit-file=audit.log &&
+    audit_decode_creds 5 &&
+    munged_stop &&
+    test "$("${MUNGEAUDIT}" audit.log | wc -l)" -eq 15
+'
+
+test_expect_success 'reject file without audit log header' '
+    echo "not an audit log" >bogus.log &&
+    test_must_fail munged_start --audit-file=bogus.log &&
+    grep -q "Error:.* Invalid header" "${MUNGE_LOGFILE}" &&
+    test_must_fail "${MUNGEAUDIT}" bogus.log
+'
+
+# Check for an error when the audit log is a symlink to a regular file.
+#
+test_expect_success 'audit log symlink failure' '
+    rm -f target.log link.log &&
+    ln -s target.log link.log &&
+    test_must_fail munged_start --audit-file=link.log &&
+    grep -q "Error:.* Audit log.* should not be a symbolic link" \
+            "${MUNGE_LOGFILE}" &&
+    test ! -f target.log
+'
+
+# Check if the error can be overridden when the audit log is a symlink.
+#
+test_expect_success 'audit log symlink override' '
+    munged_start t-bail-out-on-error --audit-file=link.log --force &&
+    audit_decode_creds 1 &&
+    munged_stop &&
+    grep -q "Warning:.* Audit log.* should not be a symbolic link" \
+            "${MUNGE_LOGFILE}" &&
+    test "$("${MUNGEAUDIT}" target.log | wc -l)" -eq 1
+'
+
+# Check for an error when the audit log dir is writable by other without the
+#   sticky bit set.
+#
+test_expect_success 'audit log dir writable by other failure' '
+    mkdir -p audit.d &&
+    chmod 0707 audit.d &&
+    test_must_fail munged_start --audit-file=audit.d/audit.log &&
+    chmod 0755 audit.d &&
+    grep -q "Error:.* Audit log is insecure: world-writable permissions" \
+            "${MUNGE_LOGFILE}" &&
+    test ! -f audit.d/audit.log
+'
+
+# With a maximum size of a single record, each batch written after the first
+#   rotates the audit log.  Batches are written every 100ms.
+#
+test_expect_success 'rotate audit log' '
+    rm -f rotate.log rotate.log.1 &&
+    munged_start t-bail-out-on-error --audit-file=rotate.log \
+            --audit-max-size=56 &&
+    audit_decode_creds 1 &&
+    sleep 1 &&
+    audit_decode_creds 1 &&
+    munged_stop &&
+    grep -q "Rotated audit log" "${MUNGE_LOGFILE}" &&
+    test "$("${MUNGEAUDIT}" rotate.log.1 | wc -l)" -eq 1 &&
+    test "$("${MUNGEAUDIT}" rotate.log | wc -l)" -eq 1
+'
+
+# Clean up after a munged process that may not have terminated.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
@@ -0,0 +1,211 @@
+#!/bin/sh
+
+test_description='Check munged --config-file reconfiguration on SIGHUP'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Write the config file from stdin, and ensure it is not group/other writable.
+#
+write_conf()
+{
+    cat >munged.conf.$$ && chmod 0600 munged.conf.$$
+}
+
+# Send SIGHUP to munged.
+#
+hup_munged()
+{
+    kill -HUP "$(cat "${MUNGE_PIDFILE}")"
+}
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Check invalid log levels are rejected.
+#
+test_expect_success 'munged --log-level invalid value' '
+    test_must_fail "${MUNGED}" --log-level=loud --foreground --stop \
+            2>err.$$ &&
+    grep -q "Invalid value \"loud\" for log-level" err.$$
+'
+
+# Check a bad config file prevents munged from starting.
+#
+test_expect_success 'munged --config-file with invalid setting' '
+    printf "num-threads = 2\nbogus = 1\n" | write_conf &&
+    test_must_fail munged_start --config-file=munged.conf.$$ 2>err.$$ &&
+    grep -q "Invalid setting \"bogus = 1\" at line 2" err.$$
+'
+
+test_expect_success 'munged --config-file with missing file' '
+    test_must_fail munged_start --config-file=missing.conf.$$
+'
+
+# Check settings in the config file are applied at startup.
+#
+test_expect_success 'start munged with config file' '
+    cat <<-EOF | write_conf &&
+	# munged runtime config
+	num-threads = 2
+	EOF
+    munged_start t-bail-out-on-error --config-file=munged.conf.$$ &&
+    retry 5 "grep -q \"Created 2 work threads\" \"\${MUNGE_LOGFILE}\""
+'
+
+# Check the worker count and max ttl are changed on SIGHUP.
+#
+test_expect_success 'grow work threads and set max ttl on SIGHUP' '
+    cat <<-EOF | write_conf &&
+	num-threads = 4
+	max-ttl     = 60
+	EOF
+    hup_munged &&
+    retry 5 "grep -q \"Set maximum time-to-live to 60 seconds\" \
+            \"\${MUNGE_LOGFILE}\"" &&
+    grep -q "Set number of work threads to 4" "${MUNGE_LOGFILE}"
+'
+
+test_expect_success 'check max ttl is enforced' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input --ttl=300 |
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --keys=TTL --numeric >out.$$ &&
+    grep -q "^TTL: *60$" out.$$
+'
+
+# Check a credential decoded before the max ttl is lowered below its ttl on
+#   SIGHUP is still detected as replayed afterwards.
+# Expect EMUNGE_CRED_REPLAYED (STATUS=17).
+#
+test_expect_success 'detect replay across max ttl change on SIGHUP' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input --ttl=300 >cred.$$ &&
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --output=/dev/null <cred.$$ &&
+    cat <<-EOF | write_conf &&
+	num-threads = 4
+	max-ttl     = 30
+	EOF
+    hup_munged &&
+    retry 5 "grep -q \"Set maximum time-to-live to 30 seconds\" \
+            \"\${MUNGE_LOGFILE}\"" &&
+    test_expect_code 17 "${UNMUNGE}" --socket="${MUNGE_SOCKET}" \
+            --output=/dev/null <cred.$$
+'
+
+# Check the worker count can be shrunk while requests are in flight.
+#
+test_expect_success 'shrink work threads under load' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --num-creds=2000 \
+            --num-threads=4 --quiet &
+    pid=$! &&
+    echo "num-threads = 1" | write_conf &&
+    hup_munged &&
+    retry 5 "grep -q \"Set number of work threads to 1\" \
+            \"\${MUNGE_LOGFILE}\"" &&
+    wait "${pid}"
+'
+
+test_expect_success 'encode and decode with one work thread' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input |
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --output=/dev/null
+'
+
+# Check an invalid config file is rejected on SIGHUP without changing the
+#   current settings.
+#
+test_expect_success 'reject invalid config on SIGHUP' '
+    echo "num-threads = 0" | write_conf &&
+    hup_munged &&
+    retry 5 "grep -q \"Failed to reload config:.*num-threads = 0\" \
+            \"\${MUNGE_LOGFILE}\"" &&
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input |
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --output=/dev/null
+'
+
+test_expect_success 'reject insecure config on SIGHUP' '
+    echo "num-threads = 2" | write_conf &&
+    chmod 0666 munged.conf.$$ &&
+    hup_munged &&
+    retry 5 "grep -q \"Failed to reload config: Config file is insecure\" \
+            \"\${MUNGE_LOGFILE}\"" &&
+    ! grep -q "Set number of work threads to 2" "${MUNGE_LOGFILE}"
+'
+
+# Check the log level is changed on SIGHUP.
+#
+test_expect_success 'lower log level on SIGHUP' '
+    printf "num-threads = 1\nlog-level = warning\n" | write_conf &&
+    n=$(grep -c "Reloaded config file" "${MUNGE_LOGFILE}") &&
+    hup_munged &&
+    retry 5 "grep -q \"Set log priority to 4\" \"\${MUNGE_LOGFILE}\"" &&
+    hup_munged &&
+    sleep 2 &&
+    test "$(grep -c "Reloaded config file" "${MUNGE_LOGFILE}")" -eq "$((n+1))"
+'
+
+test_expect_success 'stop munged' '
+    munged_stop
+'
+
+# Check the stage queue limit is changed on SIGHUP in staged pipeline mode,
+#   and the thread count is left unchanged.
+#
+test_expect_success 'start munged in staged mode with config file' '
+    echo "queue-limit = 8" | write_conf &&
+    munged_start t-bail-out-on-error --io-threads=1 \
+            --config-file=munged.conf.$$
+'
+
+test_expect_success 'set stage queue limit on SIGHUP' '
+    printf "queue-limit = 16\nnum-threads = 3\n" | write_conf &&
+    hup_munged &&
+    retry 5 "grep -q \"Set stage queue limit to 16\" \"\${MUNGE_LOGFILE}\"" &&
+    grep -q "Cannot change number of threads of staged pipeline" \
+            "${MUNGE_LOGFILE}" &&
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input |
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --output=/dev/null
+'
+
+test_expect_success 'stop munged in staged mode' '
+    munged_stop
+'
+
+# Check the default ttl of an additional socket is bounded by the max ttl
+#   when it is lowered on SIGHUP.
+#
+test_expect_success 'start munged with extra socket and config file' '
+    echo "max-ttl = 300" | write_conf &&
+    munged_start t-bail-out-on-error --config-file=munged.conf.$$ \
+            --extra-socket="${MUNGE_SOCKET}.x,ttl=200"
+'
+
+test_expect_success 'bound extra socket default ttl on SIGHUP' '
+    echo "max-ttl = 30" | write_conf &&
+    hup_munged &&
+    retry 5 "grep -q \"Set default time-to-live of socket.* to 30 seconds\" \
+            \"\${MUNGE_LOGFILE}\"" &&
+    "${MUNGE}" --socket="${MUNGE_SOCKET}.x" --no-input |
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --keys=TTL --numeric >out.$$ &&
+    grep -q "^TTL: *30$" out.$$
+'
+
+test_expect_success 'stop munged with extra socket' '
+    munged_stop
+'
+
+# Perform housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
@@ -0,0 +1,152 @@
+#!/bin/sh
+
+test_description='Check munged --zip-cache'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Output the credential format version of the credential in file [$1].
+#
+cred_version()
+{
+    sed -e 's/^MUNGE://' -e 's/:$//' "$1" | base64 -d | od -An -tu1 -N1 |
+    tr -d ' '
+}
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Create a compressible payload large enough to be cached, and list the
+#   compression types supported by this build.
+#
+test_expect_success 'create payload and list zips' '
+    seq 1 2000 >payload.$$ &&
+    test "$(wc -c <payload.$$)" -gt 1024 &&
+    "${MUNGE}" --list-zips |
+    awk "/([0-9]+)/ { gsub(/[()]/, \"\"); print \$1 }" |
+    grep -v -e "^none$" -e "^default$" >zips.$$ || :
+'
+
+test_expect_success 'check for compression support' '
+    test -s zips.$$ && test_set_prereq ZIP
+'
+
+# Check invalid values for the zip-cache option.
+#
+test_expect_success 'munged --zip-cache with negative value' '
+    test_must_fail "${MUNGED}" --zip-cache=-1 --foreground --stop \
+            2>err.$$ &&
+    grep -q "Invalid value \"-1\" for zip-cache" err.$$
+'
+
+test_expect_success 'munged --zip-cache with non-numeric value' '
+    test_must_fail "${MUNGED}" --zip-cache=lots --foreground --stop \
+            2>err.$$ &&
+    grep -q "Invalid value \"lots\" for zip-cache" err.$$
+'
+
+# Check compressed credentials are encoded as version 4 with the cache
+#   enabled, and that repeated payloads are served from the cache.
+#
+test_expect_success ZIP 'start munged with zip cache' '
+    munged_start t-bail-out-on-error --zip-cache=4 &&
+    grep -q "Caching up to 4 compressed payloads" "${MUNGE_LOGFILE}"
+'
+
+test_expect_success ZIP 'encode and decode cached payload for each zip' '
+    local name i &&
+    >fail.$$ &&
+    while read name; do
+        for i in 1 2 3; do
+            "${MUNGE}" --socket="${MUNGE_SOCKET}" --zip="${name}" \
+                    --input=payload.$$ --output=cred.${name}.${i}.$$ &&
+            test "$(cred_version cred.${name}.${i}.$$)" = 4 &&
+            "${UNMUNGE}" --socket="${MUNGE_SOCKET}" \
+                    --input=cred.${name}.${i}.$$ \
+                    --output=out.${name}.${i}.$$ \
+                    --metadata=meta.${name}.${i}.$$ &&
+            grep -q "^ZIP: *${name} " meta.${name}.${i}.$$ &&
+            cmp payload.$$ out.${name}.${i}.$$ ||
+            echo "${name}.${i}" >>fail.$$
+        done
+    done <zips.$$ &&
+    test ! -s fail.$$
+'
+
+test_expect_success ZIP 'check cached payloads are not shared' '
+    ! cmp cred.$(head -1 zips.$$).1.$$ cred.$(head -1 zips.$$).2.$$
+'
+
+test_expect_success ZIP 'encode uncompressed credential with zip cache' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --zip=none --input=payload.$$ \
+            --output=cred.none.$$ &&
+    test "$(cred_version cred.none.$$)" = 3
+'
+
+test_expect_success ZIP 'stop munged with zip cache' '
+    munged_stop &&
+    n=$(wc -l <zips.$$) &&
+    grep -q "Zip cache: $((n * 2)) hits*, ${n} miss" "${MUNGE_LOGFILE}"
+'
+
+# Check version 4 credentials are decoded by a daemon without the cache,
+#   and that it encodes version 3 credentials.
+#
+test_expect_success ZIP 'start munged without zip cache' '
+    munged_start t-bail-out-on-error &&
+    ! grep -q "Caching up to" "${MUNGE_LOGFILE}"
+'
+
+test_expect_success ZIP 'decode version 4 credential for each zip' '
+    local name &&
+    >fail.$$ &&
+    while read name; do
+        rm -f out.${name}.1.$$ &&
+        "${UNMUNGE}" --socket="${MUNGE_SOCKET}" \
+                --input=cred.${name}.1.$$ --output=out.${name}.1.$$ \
+                --metadata=/dev/null &&
+        cmp payload.$$ out.${name}.1.$$ ||
+        echo "${name}" >>fail.$$
+    done <zips.$$ &&
+    test ! -s fail.$$
+'
+
+test_expect_success ZIP 'encode version 3 credential for each zip' '
+    local name &&
+    >fail.$$ &&
+    while read name; do
+        "${MUNGE}" --socket="${MUNGE_SOCKET}" --zip="${name}" \
+                --input=payload.$$ --output=cred3.${name}.$$ &&
+        test "$(cred_version cred3.${name}.$$)" = 3 &&
+        "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --input=cred3.${name}.$$ \
+                --output=out3.${name}.$$ --metadata=meta3.${name}.$$ &&
+        grep -q "^ZIP: *${name} " meta3.${name}.$$ &&
+        cmp payload.$$ out3.${name}.$$ ||
+        echo "${name}" >>fail.$$
+    done <zips.$$ &&
+    test ! -s fail.$$
+'
+
+test_expect_success ZIP 'stop munged without zip cache' '
+    munged_stop &&
+    ! grep -q "Zip cache:" "${MUNGE_LOGFILE}"
+'
+
+# Perform housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
@@ -0,0 +1,80 @@
+#!/bin/sh
+
+test_description='Check libmunge client-side timing breakdown'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Start the daemon, or bail out.
+#
+test_expect_success 'start munged' '
+    munged_start t-bail-out-on-error
+'
+
+# Check the breakdown is only reported when requested.
+#
+test_expect_success 'remunge without --breakdown' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --num-creds=10 >out.$$ 2>&1 &&
+    cat out.$$ &&
+    ! grep -q "Client usecs per call" out.$$
+'
+
+# Check the breakdown accounts for the time spent in each call.
+#
+test_expect_success 'remunge --breakdown' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --breakdown \
+        --num-threads=2 --num-creds=200 >out.$$ 2>&1 &&
+    cat out.$$ &&
+    grep -q "Processed 200 credentials" out.$$ &&
+    grep "Client usecs per call" out.$$ >timing.$$ &&
+    ! grep -q "total 0\.0)" timing.$$ &&
+    grep -q "Client retries: [0-9]* connect, [0-9]* xfer" out.$$
+'
+
+# Check the breakdown with a large payload.
+#
+test_expect_success 'remunge --breakdown with payload' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --breakdown \
+        --length=64k --num-creds=10 >out.$$ 2>&1 &&
+    cat out.$$ &&
+    grep -q "Processed 10 credentials" out.$$ &&
+    grep -q "Client usecs per call" out.$$
+'
+
+# Check credentials taken from the pool count as calls with no time spent.
+#
+test_expect_success 'remunge --breakdown with credential pool' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --breakdown --pool-size=8 \
+        --num-creds=100 >out.$$ 2>&1 &&
+    cat out.$$ &&
+    grep -q "Processed 100 credentials" out.$$ &&
+    grep -q "Client usecs per call" out.$$
+'
+
+# Stop the daemon.
+#
+test_expect_success 'stop munged' '
+    munged_stop
+'
+
+# Perform any housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
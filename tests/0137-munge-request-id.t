@@ -0,0 +1,87 @@
+#!/bin/sh
+
+test_description='Check request IDs carried from libmunge into munged logs'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Start the daemon, or bail out.
+#
+test_expect_success 'start munged' '
+    munged_start t-bail-out-on-error
+'
+
+# Check invalid request IDs are rejected by the client.
+#
+test_expect_success 'munge --request-id with space' '
+    test_must_fail "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input \
+        --request-id="job 42"
+'
+
+test_expect_success 'munge --request-id exceeding maximum length' '
+    test_must_fail "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input \
+        --request-id="$(printf "%065d" 0)"
+'
+
+test_expect_success 'unmunge --request-id empty' '
+    test_must_fail "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --request-id= \
+        </dev/null
+'
+
+# Check a credential round-trips with request IDs on both encode and decode.
+# The client verifies that each response echoes the request ID.
+#
+test_expect_success 'encode and decode with request IDs' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input \
+            --request-id=job.42:enc |
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --request-id=job.42:dec
+'
+
+# Check the request ID is attached to the munged log message for a failed
+#   request.
+#
+test_expect_success 'munged logs request ID for failed decode' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input \
+            --restrict-uid=$(($(id -u) + 1)) >cred.$$ &&
+    test_must_fail "${UNMUNGE}" --socket="${MUNGE_SOCKET}" \
+            --request-id=job.43:dec <cred.$$ &&
+    retry 10 "grep -q \"Unauthorized credential.* req=job\.43:dec\$\" \
+            \"${MUNGE_LOGFILE}\""
+'
+
+# Check a request without a request ID is logged without one.
+#
+test_expect_success 'munged logs no request ID when unset' '
+    test_must_fail "${UNMUNGE}" --socket="${MUNGE_SOCKET}" <cred.$$ &&
+    retry 10 "grep -q \"Unauthorized credential.*[0-9]\$\" \
+            \"${MUNGE_LOGFILE}\"" &&
+    test "$(grep -c "req=" "${MUNGE_LOGFILE}")" -eq 1
+'
+
+# Stop the daemon.
+#
+test_expect_success 'stop munged' '
+    munged_stop
+'
+
+# Perform any housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
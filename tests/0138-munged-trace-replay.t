@@ -0,0 +1,130 @@
+#!/bin/sh
+
+test_description='Check munged request trace capture and remunge replay'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup &&
+    MUNGE_TRACEFILE="${MUNGE_SOCKET}.trace"
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Start the daemon with a request trace, or bail out.
+#
+test_expect_success 'start munged with --trace-file' '
+    rm -f "${MUNGE_TRACEFILE}" &&
+    munged_start t-bail-out-on-error --trace-file="${MUNGE_TRACEFILE}" &&
+    grep -q "Recording client requests in trace" "${MUNGE_LOGFILE}"
+'
+
+# Capture a mix of requests: encode/decode pairs, a restricted credential,
+#   and a failed decode.
+#
+test_expect_success 'capture requests' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --decode --num-creds=20 \
+            --length=100 &&
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input \
+            --restrict-uid=$(id -u) --ttl=60 |
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --no-output &&
+    echo garbage | test_must_fail "${UNMUNGE}" --socket="${MUNGE_SOCKET}" \
+            --no-output
+'
+
+# Stop the daemon, and check every request was written to the trace.
+#
+test_expect_success 'stop munged and check trace' '
+    munged_stop &&
+    grep -q "Request trace: 43 records written, 0 dropped" \
+            "${MUNGE_LOGFILE}" &&
+    test "$(head -c 8 "${MUNGE_TRACEFILE}")" = MUNGETRC &&
+    test "$(wc -c <"${MUNGE_TRACEFILE}")" -eq $((20 + (43 * 28)))
+'
+
+# Check the trace does not contain the payload.
+#
+test_expect_success 'trace is anonymized' '
+    ! grep -q ABCDEFGHIJ "${MUNGE_TRACEFILE}"
+'
+
+# Start the daemon without a request trace for replay.
+#
+test_expect_success 'start munged for replay' '
+    munged_start t-bail-out-on-error
+'
+
+# Check the trace replays as fast as possible, and the latencies are
+#   compared.
+#
+test_expect_success 'remunge --replay unpaced' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --replay="${MUNGE_TRACEFILE}" \
+            --replay-speed=0 --num-threads=2 >out.$$ &&
+    grep -q "Loaded 43 requests" out.$$ &&
+    grep -q "Recorded 1 error in trace" out.$$ &&
+    grep -q "Recorded service p50/p90/p99:" out.$$ &&
+    grep -q "Latency difference p50/p90/p99:" out.$$ &&
+    grep -q "Processed 43 credentials" out.$$ &&
+    ! grep -q "Replay lagged" out.$$
+'
+
+# Check the trace replays at the recorded (but accelerated) speed.
+#
+test_expect_success 'remunge --replay paced' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --replay="${MUNGE_TRACEFILE}" \
+            --replay-speed=10 >out.$$ &&
+    grep -q "Processed 43 credentials" out.$$ &&
+    grep -q "Replay lagged schedule by up to" out.$$
+'
+
+# Check the replay can be limited by the number of credentials.
+#
+test_expect_success 'remunge --replay with --num-creds' '
+    "${REMUNGE}" --socket="${MUNGE_SOCKET}" --replay="${MUNGE_TRACEFILE}" \
+            --replay-speed=0 --num-creds=5 >out.$$ &&
+    grep -q "Loaded 5 requests" out.$$ &&
+    grep -q "Processed 5 credentials" out.$$
+'
+
+# Check invalid replay arguments are rejected.
+#
+test_expect_success 'remunge --replay with invalid trace' '
+    echo garbage >bad.$$ &&
+    test_must_fail "${REMUNGE}" --socket="${MUNGE_SOCKET}" \
+            --replay=bad.$$ 2>err.$$ &&
+    grep -q "Invalid header" err.$$
+'
+
+test_expect_success 'remunge --replay-speed negative' '
+    test_must_fail "${REMUNGE}" --socket="${MUNGE_SOCKET}" \
+            --replay="${MUNGE_TRACEFILE}" --replay-speed=-1
+'
+
+test_expect_success 'remunge --replay with --sweep' '
+    test_must_fail "${REMUNGE}" --socket="${MUNGE_SOCKET}" \
+            --replay="${MUNGE_TRACEFILE}" --sweep=1-2
+'
+
+# Stop the daemon.
+#
+test_expect_success 'stop munged' '
+    munged_stop
+'
+
+# Perform any housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    rm -f "${MUNGE_TRACEFILE}" &&
+    munged_cleanup
+'
+
+test_done
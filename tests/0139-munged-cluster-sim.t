@@ -0,0 +1,109 @@
+#!/bin/sh
+
+test_description='Check the single-host munged cluster simulator'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment with a directory for the per-node files.
+#
+test_expect_success 'setup' '
+    munged_setup &&
+    CLUSTER_DIR="$(pwd)/cluster-$$" &&
+    mkdir -m 0755 -p "${CLUSTER_DIR}"
+'
+
+# Create a key shared by all nodes, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Run encode-on-one/decode-on-another traffic across 3 nodes.  Each cred is
+#   decoded once, so the replay hashes should hold one entry per cred.
+#
+test_expect_success 'pair pattern' '
+    "${CLUSTERSIM}" --munged="${MUNGED}" --key-file="${MUNGE_KEYFILE}" \
+            --dir="${CLUSTER_DIR}" --nodes=3 --pattern=pair --threads=2 \
+            --num-creds=60 --length=64 >out.pair &&
+    test_debug "cat out.pair" &&
+    grep -q "^encodes=60 decodes=60 " out.pair &&
+    grep -q "^encode_errs=0 decode_errs=0 replayed=0 " out.pair &&
+    test "$(grep -c "^node=[0-9]* replay_hash=" out.pair)" -eq 3 &&
+    grep -q "^replay_hash_total=60$" out.pair
+'
+
+# Check encodes were spread across the nodes, and each node exited cleanly.
+#
+test_expect_success 'pair pattern uses every node' '
+    ! grep -q "replay_hash=0$" out.pair &&
+    for i in 0 1 2; do
+        grep -q "Stopping" "${CLUSTER_DIR}/node.$i.log" || return 1
+    done
+'
+
+# Decode each cred on every node.
+#
+test_expect_success 'fanout pattern' '
+    "${CLUSTERSIM}" --munged="${MUNGED}" --key-file="${MUNGE_KEYFILE}" \
+            --dir="${CLUSTER_DIR}" --nodes=3 --pattern=fanout \
+            --num-creds=20 >out.fanout &&
+    test_debug "cat out.fanout" &&
+    grep -q "^encodes=20 decodes=60 " out.fanout &&
+    grep -q "^encode_errs=0 decode_errs=0 " out.fanout &&
+    grep -q "^node=0 replay_hash=20$" out.fanout &&
+    grep -q "^node=1 replay_hash=20$" out.fanout &&
+    grep -q "^node=2 replay_hash=20$" out.fanout &&
+    grep -q "^replay_hash_total=60$" out.fanout
+'
+
+# Decode each cred twice on the same node, and check every second decode is
+#   rejected as replayed.
+#
+test_expect_success 'replay pattern' '
+    "${CLUSTERSIM}" --munged="${MUNGED}" --key-file="${MUNGE_KEYFILE}" \
+            --dir="${CLUSTER_DIR}" --nodes=3 --pattern=replay --threads=3 \
+            --num-creds=30 >out.replay &&
+    test_debug "cat out.replay" &&
+    grep -q "^encodes=30 decodes=60 " out.replay &&
+    grep -q "^encode_errs=0 decode_errs=0 replayed=30 " out.replay &&
+    grep -q "^replay_hash_total=30$" out.replay
+'
+
+# Pass extra munged options after "--".
+#
+test_expect_success 'extra munged options' '
+    "${CLUSTERSIM}" --munged="${MUNGED}" --key-file="${MUNGE_KEYFILE}" \
+            --dir="${CLUSTER_DIR}" --nodes=2 --num-creds=10 \
+            -- --num-threads=1 >out.extra &&
+    grep -q "^encode_errs=0 decode_errs=0 " out.extra &&
+    grep -q "Created 1 work thread" "${CLUSTER_DIR}/node.0.log"
+'
+
+# Check a node that fails to start is reported.
+#
+test_expect_success 'node failure' '
+    test_must_fail "${CLUSTERSIM}" --munged="${MUNGED}" \
+            --key-file="${MUNGE_KEYFILE}.missing" --dir="${CLUSTER_DIR}" \
+            --nodes=2 --num-creds=10 2>err.fail &&
+    grep -q "Failed to start node" err.fail
+'
+
+# Check invalid options are rejected.
+#
+test_expect_success 'invalid options' '
+    test_must_fail "${CLUSTERSIM}" --munged="${MUNGED}" \
+            --key-file="${MUNGE_KEYFILE}" --pattern=bogus &&
+    test_must_fail "${CLUSTERSIM}" --munged="${MUNGED}" \
+            --key-file="${MUNGE_KEYFILE}" --nodes=0
+'
+
+# Clean up after a munged process that may not have terminated.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
@@ -0,0 +1,95 @@
+#!/bin/sh
+
+test_description='Check metadata-only decodes requested by unmunge --no-output'
+
+: "${SHARNESS_TEST_OUTDIR:=$(pwd)}"
+: "${SHARNESS_TEST_SRCDIR:=$(cd "$(dirname "$0")" && pwd)}"
+. "${SHARNESS_TEST_SRCDIR}/sharness.sh"
+
+# Set up the environment.
+#
+test_expect_success 'setup' '
+    munged_setup
+'
+
+# Create a key, or bail out.
+#
+test_expect_success 'create key' '
+    munged_create_key t-bail-out-on-error &&
+    test -f "${MUNGE_KEYFILE}"
+'
+
+# Start the daemon, or bail out.
+#
+test_expect_success 'start munged' '
+    munged_start t-bail-out-on-error
+'
+
+# Check a credential with a large payload decodes without its payload.
+#
+test_expect_success 'unmunge --no-output with large payload' '
+    dd if=/dev/zero of=payload.$$ bs=1024 count=512 2>/dev/null &&
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --input=payload.$$ \
+            --zip=none >cred.$$ &&
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --input=cred.$$ --no-output
+'
+
+# Check the payload length is still reported when the metadata is output.
+#
+test_expect_success 'unmunge --no-output --metadata reports payload length' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --string=xyzzy |
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --no-output --metadata=meta.$$ &&
+    test "$(awk "/LENGTH:/ { print \$2 }" meta.$$)" -eq 5
+'
+
+# Check the payload is still output when requested after --no-output.
+#
+test_expect_success 'unmunge --no-output --output writes payload' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --string=xyzzy |
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --no-output --output=out.$$ &&
+    test "$(cat out.$$)" = xyzzy
+'
+
+# Check a metadata-only decode is still subject to the replay check.
+#
+test_expect_success 'unmunge --no-output detects replay' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input >cred.$$ &&
+    "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --input=cred.$$ --no-output &&
+    test_must_fail "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --input=cred.$$ \
+            --no-output
+'
+
+# Check a metadata-only decode still rejects a corrupted credential.
+#
+test_expect_success 'unmunge --no-output rejects invalid credential' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --string=xyzzy |
+            sed "s/^\(MUNGE:.\{20\}\).\{4\}/\1/" >cred.$$ &&
+    test_must_fail "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --input=cred.$$ \
+            --no-output
+'
+
+# Check a metadata-only decode with a request ID still enforces a UID
+#   restriction, and that munged parses both the request ID and the flags.
+#
+test_expect_success 'unmunge --no-output --request-id enforces restriction' '
+    "${MUNGE}" --socket="${MUNGE_SOCKET}" --no-input \
+            --restrict-uid=$(( $(id -u) + 1 )) |
+    test_must_fail "${UNMUNGE}" --socket="${MUNGE_SOCKET}" --no-output \
+            --request-id=meta-42 &&
+    retry 10 "grep -q \"Unauthorized credential.* req=meta-42\$\" \
+            \"${MUNGE_LOGFILE}\""
+'
+
+# Stop the daemon.
+#
+test_expect_success 'stop munged' '
+    munged_stop
+'
+
+# Perform any housekeeping to clean up afterwards.
+#
+test_expect_success 'cleanup' '
+    munged_cleanup
+'
+
+test_done
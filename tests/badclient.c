@@ -0,0 +1,375 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+/*  Misbehaving munge client for testing munged's resilience.
+ *
+ *  Opens a number of connections to munged and misbehaves on each of them
+ *    according to the mode:
+ *  - idle:    connects but never sends anything
+ *  - trickle: sends a valid encode request one byte per interval
+ *  - stall:   sends an encode request with a large payload but never reads
+ *             the response
+ *  Waits for the daemon to close the connections (or for the duration to
+ *    elapse), then writes a summary line to stdout of the form
+ *    "conns=N closed=N max_msecs=N".
+ */
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <munge.h>
+#include "fd.h"
+#include "log.h"
+#include "m_msg.h"
+#include "munge_defs.h"
+
+
+#define MODE_IDLE       0
+#define MODE_TRICKLE    1
+#define MODE_STALL      2
+
+struct conn {
+    int             sd;                 /* socket, or -1 once closed         */
+    size_t          nsent;              /* num request bytes sent (trickle)  */
+    struct timeval  t0;                 /* time connected                    */
+};
+
+static const char *short_opts = "S:m:n:D:i:l:";
+
+static struct option long_opts[] = {
+    { "socket",    required_argument, NULL, 'S' },
+    { "mode",      required_argument, NULL, 'm' },
+    { "num-conns", required_argument, NULL, 'n' },
+    { "duration",  required_argument, NULL, 'D' },
+    { "interval",  required_argument, NULL, 'i' },
+    { "length",    required_argument, NULL, 'l' },
+    {  NULL,       0,                 NULL,  0  }
+};
+
+static long   get_num (const char *s, const char *name, long min, long max);
+static int    do_connect (const char *path);
+static void   pack_request (size_t len, unsigned char **bufp, size_t *lenp);
+static long   diff_msecs (const struct timeval *t0, const struct timeval *t1);
+
+
+int
+main (int argc, char *argv[])
+{
+    const char     *socket_name = NULL;
+    int             mode = MODE_IDLE;
+    int             n_conns = 1;
+    long            duration_msecs = 10000;
+    long            interval_msecs = 250;
+    size_t          length = 0;
+    unsigned char  *req = NULL;
+    size_t          req_len = 0;
+    struct conn    *conns;
+    struct pollfd  *pfds;
+    struct timeval  t_start;
+    struct timeval  t_now;
+    long            max_msecs = 0;
+    int             n_closed = 0;
+    char            c;
+    ssize_t         n;
+    int             i;
+    int             ch;
+
+    log_open_file (stderr, argv[0], LOG_INFO, LOG_OPT_PRIORITY);
+
+    for (;;) {
+        ch = getopt_long (argc, argv, short_opts, long_opts, NULL);
+        if (ch == -1) {
+            break;
+        }
+        switch (ch) {
+            case 'S':
+                socket_name = optarg;
+                break;
+            case 'm':
+                if (!strcmp (optarg, "idle"))
+                    mode = MODE_IDLE;
+                else if (!strcmp (optarg, "trickle"))
+                    mode = MODE_TRICKLE;
+                else if (!strcmp (optarg, "stall"))
+                    mode = MODE_STALL;
+                else
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid mode \"%s\"", optarg);
+                break;
+            case 'n':
+                n_conns = get_num (optarg, "num-conns", 1, 1024);
+                break;
+            case 'D':
+                duration_msecs = get_num (optarg, "duration", 1, 3600) * 1000;
+                break;
+            case 'i':
+                interval_msecs = get_num (optarg, "interval", 1, 60000);
+                break;
+            case 'l':
+                length = get_num (optarg, "length", 0,
+                        MUNGE_MAXIMUM_REQ_LEN / 2);
+                break;
+            default:
+                log_err (EMUNGE_SNAFU, LOG_ERR, "Invalid option \"%s\"",
+                    argv[optind - 1]);
+                break;
+        }
+    }
+    if (optind < argc) {
+        log_err (EMUNGE_SNAFU, LOG_ERR, "Unrecognized parameter \"%s\"",
+            argv[optind]);
+    }
+    if (socket_name == NULL) {
+        log_err (EMUNGE_SNAFU, LOG_ERR, "Socket not specified");
+    }
+    if ((mode == MODE_STALL) && (length == 0)) {
+        length = MUNGE_MAXIMUM_REQ_LEN / 2;
+    }
+    if (mode != MODE_IDLE) {
+        pack_request (length, &req, &req_len);
+    }
+    (void) signal (SIGPIPE, SIG_IGN);
+
+    conns = calloc (n_conns, sizeof (*conns));
+    pfds = calloc (n_conns, sizeof (*pfds));
+    if ((conns == NULL) || (pfds == NULL)) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR, "Failed to allocate %d conns",
+            n_conns);
+    }
+    for (i = 0; i < n_conns; i++) {
+        conns[i].sd = do_connect (socket_name);
+        (void) gettimeofday (&conns[i].t0, NULL);
+        if (mode == MODE_STALL) {
+            /*
+             *  The daemon reads the entire request before responding.
+             */
+            if (fd_write_n (conns[i].sd, req, req_len) != (ssize_t) req_len) {
+                log_errno (EMUNGE_SOCKET, LOG_ERR,
+                    "Failed to send request");
+            }
+            conns[i].nsent = req_len;
+        }
+    }
+    (void) gettimeofday (&t_start, NULL);
+
+    while (n_closed < n_conns) {
+        (void) gettimeofday (&t_now, NULL);
+        if (diff_msecs (&t_start, &t_now) >= duration_msecs) {
+            break;
+        }
+        /*  Check for connections closed by the daemon.  A stalled connection
+         *    polls for no events so as not to read its response.
+         */
+        for (i = 0; i < n_conns; i++) {
+            pfds[i].fd = conns[i].sd;
+            pfds[i].events = (mode == MODE_STALL) ? 0 : POLLIN;
+            pfds[i].revents = 0;
+        }
+        if (poll (pfds, n_conns, interval_msecs) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to poll connections");
+        }
+        (void) gettimeofday (&t_now, NULL);
+
+        for (i = 0; i < n_conns; i++) {
+            if (conns[i].sd < 0) {
+                continue;
+            }
+            if (pfds[i].revents & POLLIN) {
+                n = read (conns[i].sd, &c, 1);
+                if (n > 0) {
+                    continue;           /* unexpected response byte */
+                }
+            }
+            else if (pfds[i].revents & (POLLHUP | POLLERR)) {
+                ;                       /* closed */
+            }
+            else if ((mode == MODE_TRICKLE) && (conns[i].nsent < req_len)) {
+                n = write (conns[i].sd, req + conns[i].nsent, 1);
+                if (n > 0) {
+                    conns[i].nsent += n;
+                    continue;
+                }
+                if ((n < 0) && (errno != EPIPE) && (errno != ECONNRESET)) {
+                    continue;
+                }
+            }
+            else {
+                continue;
+            }
+            (void) close (conns[i].sd);
+            conns[i].sd = -1;
+            n_closed++;
+            if (diff_msecs (&conns[i].t0, &t_now) > max_msecs) {
+                max_msecs = diff_msecs (&conns[i].t0, &t_now);
+            }
+        }
+    }
+    printf ("conns=%d closed=%d max_msecs=%ld\n", n_conns, n_closed,
+            max_msecs);
+
+    for (i = 0; i < n_conns; i++) {
+        if (conns[i].sd >= 0) {
+            (void) close (conns[i].sd);
+        }
+    }
+    free (conns);
+    free (pfds);
+    free (req);
+    exit (EXIT_SUCCESS);
+}
+
+
+static long
+get_num (const char *s, const char *name, long min, long max)
+{
+    char *p;
+    long  l;
+
+    errno = 0;
+    l = strtol (s, &p, 10);
+    if ((errno != 0) || (s == p) || (*p != '\0') || (l < min) || (l > max)) {
+        log_err (EMUNGE_SNAFU, LOG_ERR, "Invalid value \"%s\" for %s",
+            s, name);
+    }
+    return (l);
+}
+
+
+static int
+do_connect (const char *path)
+{
+    struct sockaddr_un  addr;
+    int                 sd;
+
+    if ((sd = socket (PF_UNIX, SOCK_STREAM, 0)) < 0) {
+        log_errno (EMUNGE_SOCKET, LOG_ERR, "Failed to create socket");
+    }
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen (path) >= sizeof (addr.sun_path)) {
+        log_err (EMUNGE_SOCKET, LOG_ERR, "Socket name too long");
+    }
+    strcpy (addr.sun_path, path);
+    if (connect (sd, (struct sockaddr *) &addr, sizeof (addr)) < 0) {
+        log_errno (EMUNGE_SOCKET, LOG_ERR, "Failed to connect to \"%s\"",
+            path);
+    }
+    return (sd);
+}
+
+
+static void
+pack_request (size_t len, unsigned char **bufp, size_t *lenp)
+{
+/*  Packs an encode request with a [len]-byte payload into a new buffer
+ *    returned in [bufp] of length [lenp] by sending it over a socketpair.
+ */
+    int             sv[2];
+    m_msg_t         m;
+    unsigned char  *data;
+    unsigned char  *buf;
+    size_t          max;
+    ssize_t         n;
+    pid_t           pid;
+
+    if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to create socketpair");
+    }
+    if ((data = malloc (len + 1)) == NULL) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR, "Failed to allocate payload");
+    }
+    memset (data, 'x', len);
+    max = len + 4096;
+    if ((buf = malloc (max)) == NULL) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR, "Failed to allocate request");
+    }
+    if (m_msg_create (&m) != EMUNGE_SUCCESS) {
+        log_err (EMUNGE_NO_MEMORY, LOG_ERR, "Failed to create message");
+    }
+    (void) m_msg_bind (m, sv[0]);
+    m->cipher = MUNGE_CIPHER_DEFAULT;
+    m->mac = MUNGE_MAC_DEFAULT;
+    m->zip = MUNGE_ZIP_NONE;
+    m->ttl = MUNGE_TTL_DEFAULT;
+    m->auth_uid = MUNGE_UID_ANY;
+    m->auth_gid = MUNGE_GID_ANY;
+    m->data_len = len;
+    m->data = (len > 0) ? data : NULL;
+    m->data_is_copy = 1;
+
+    /*  The socketpair is drained by a child since the request may exceed the
+     *    socket buffer.
+     */
+    if ((pid = fork ()) < 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to fork");
+    }
+    else if (pid == 0) {
+        (void) close (sv[1]);
+        _exit ((m_msg_send (m, MUNGE_MSG_ENC_REQ, 0) == EMUNGE_SUCCESS)
+                ? 0 : 1);
+    }
+    (void) close (sv[0]);
+    m->sd = -1;
+    m_msg_destroy (m);
+
+    n = fd_read_n (sv[1], buf, max);
+    if (n <= 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to pack request");
+    }
+    (void) close (sv[1]);
+    (void) waitpid (pid, NULL, 0);
+    free (data);
+    *bufp = buf;
+    *lenp = n;
+    return;
+}
+
+
+static long
+diff_msecs (const struct timeval *t0, const struct timeval *t1)
+{
+    return (((t1->tv_sec - t0->tv_sec) * 1000)
+            + ((t1->tv_usec - t0->tv_usec) / 1000));
+}
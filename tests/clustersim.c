@@ -0,0 +1,598 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+/*  Single-host cluster simulator for scale testing munged.
+ *
+ *  Starts a number of munged "nodes" on this host, each with a private
+ *    socket, pidfile, logfile, and seedfile but sharing a single key, and
+ *    drives credential traffic across them from a number of threads
+ *    according to the pattern:
+ *  - pair:   encodes each credential on one node and decodes it on another
+ *  - fanout: encodes each credential on one node and decodes it on every
+ *            node
+ *  - replay: encodes each credential on one node and decodes it twice on
+ *            another, so every second decode should be rejected as replayed
+ *  Encodes are spread round-robin across the nodes.  Once the traffic is
+ *    done, the nodes are stopped and the size of each node's replay hash is
+ *    read from its logfile.  The results are written to stdout as lines of
+ *    the form "key=value ...".
+ *  Additional munged options can be specified after "--".
+ */
+
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <munge.h>
+#include "log.h"
+#include "munge_defs.h"
+#include "str.h"
+
+
+#define PATTERN_PAIR    0
+#define PATTERN_FANOUT  1
+#define PATTERN_REPLAY  2
+
+#define MAX_NODES       256
+#define MAX_THREADS     1024
+#define START_MSECS     10000
+
+struct node {
+    char           *socket;             /* munged socket name                */
+    char           *pidfile;            /* munged pidfile name               */
+    char           *logfile;            /* munged logfile name               */
+    char           *seedfile;           /* munged seedfile name              */
+    pid_t           pid;                /* munged pid, or 0 if not running   */
+    long            replay_count;       /* creds in replay hash at exit      */
+};
+
+struct sim {
+    int             pattern;            /* PATTERN_* traffic pattern         */
+    unsigned long   n_creds;            /* num creds to encode               */
+    char           *payload;            /* payload to encode into each cred  */
+    int             length;             /* length of payload                 */
+    pthread_mutex_t mutex;              /* mutex for the following           */
+    unsigned long   next;               /* num of next cred to encode        */
+    unsigned long   n_encodes;          /* num encode calls                  */
+    unsigned long   n_decodes;          /* num decode calls                  */
+    unsigned long   n_encode_errs;      /* num encode errors                 */
+    unsigned long   n_decode_errs;      /* num unexpected decode errors      */
+    unsigned long   n_replayed;         /* num decodes rejected as replayed  */
+};
+
+static const char *short_opts = "M:k:d:S:n:p:T:N:l:";
+
+static struct option long_opts[] = {
+    { "munged",     required_argument, NULL, 'M' },
+    { "key-file",   required_argument, NULL, 'k' },
+    { "dir",        required_argument, NULL, 'd' },
+    { "socket-dir", required_argument, NULL, 'S' },
+    { "nodes",      required_argument, NULL, 'n' },
+    { "pattern",    required_argument, NULL, 'p' },
+    { "threads",    required_argument, NULL, 'T' },
+    { "num-creds",  required_argument, NULL, 'N' },
+    { "length",     required_argument, NULL, 'l' },
+    {  NULL,        0,                 NULL,  0  }
+};
+
+static struct node *nodes = NULL;
+static int          n_nodes = 4;
+
+static long   get_num (const char *s, const char *name, long min, long max);
+static void   start_nodes (const char *munged, const char *keyfile,
+                  const char *dir, const char *socket_dir,
+                  char **extra_args, int n_extra_args);
+static void   wait_nodes (void);
+static void   stop_nodes (void);
+static void   read_replay_count (struct node *np);
+static void * sim_thread (struct sim *sp);
+static int    sim_decode (munge_ctx_t ctx, const char *cred);
+static double diff_secs (const struct timeval *t0, const struct timeval *t1);
+
+
+int
+main (int argc, char *argv[])
+{
+    const char     *munged = NULL;
+    const char     *keyfile = NULL;
+    const char     *dir = ".";
+    const char     *socket_dir;
+    const char     *pattern_str = "pair";
+    struct sim      sim;
+    int             n_threads = 1;
+    pthread_t      *tids;
+    struct timeval  t_start;
+    struct timeval  t_stop;
+    double          secs;
+    unsigned long   n_ops;
+    long            total;
+    int             i;
+    int             ch;
+
+    log_open_file (stderr, argv[0], LOG_INFO, LOG_OPT_PRIORITY);
+
+    memset (&sim, 0, sizeof (sim));
+    sim.pattern = PATTERN_PAIR;
+    sim.n_creds = 1000;
+
+    if (!(socket_dir = getenv ("TMPDIR"))) {
+        socket_dir = "/tmp";
+    }
+    for (;;) {
+        ch = getopt_long (argc, argv, short_opts, long_opts, NULL);
+        if (ch == -1) {
+            break;
+        }
+        switch (ch) {
+            case 'M':
+                munged = optarg;
+                break;
+            case 'k':
+                keyfile = optarg;
+                break;
+            case 'd':
+                dir = optarg;
+                break;
+            case 'S':
+                socket_dir = optarg;
+                break;
+            case 'n':
+                n_nodes = get_num (optarg, "nodes", 1, MAX_NODES);
+                break;
+            case 'p':
+                pattern_str = optarg;
+                if (!strcmp (optarg, "pair"))
+                    sim.pattern = PATTERN_PAIR;
+                else if (!strcmp (optarg, "fanout"))
+                    sim.pattern = PATTERN_FANOUT;
+                else if (!strcmp (optarg, "replay"))
+                    sim.pattern = PATTERN_REPLAY;
+                else
+                    log_err (EMUNGE_SNAFU, LOG_ERR,
+                        "Invalid pattern \"%s\"", optarg);
+                break;
+            case 'T':
+                n_threads = get_num (optarg, "threads", 1, MAX_THREADS);
+                break;
+            case 'N':
+                sim.n_creds = get_num (optarg, "num-creds", 1, LONG_MAX);
+                break;
+            case 'l':
+                sim.length = get_num (optarg, "length", 0,
+                        MUNGE_MAXIMUM_REQ_LEN / 2);
+                break;
+            default:
+                log_err (EMUNGE_SNAFU, LOG_ERR, "Invalid option \"%s\"",
+                    argv[optind - 1]);
+                break;
+        }
+    }
+    if (munged == NULL) {
+        log_err (EMUNGE_SNAFU, LOG_ERR, "Daemon not specified");
+    }
+    if (keyfile == NULL) {
+        log_err (EMUNGE_SNAFU, LOG_ERR, "Key file not specified");
+    }
+    if ((sim.length > 0) && !(sim.payload = malloc (sim.length))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR, "Failed to allocate payload");
+    }
+    if (sim.length > 0) {
+        memset (sim.payload, 'x', sim.length);
+    }
+    if ((errno = pthread_mutex_init (&sim.mutex, NULL)) != 0) {
+        log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to init mutex");
+    }
+    (void) signal (SIGPIPE, SIG_IGN);
+
+    /*  The nodes are stopped on exit (including on error) so none are left
+     *    behind.
+     */
+    if (atexit (stop_nodes) != 0) {
+        log_err (EMUNGE_SNAFU, LOG_ERR, "Failed to register exit handler");
+    }
+    start_nodes (munged, keyfile, dir, socket_dir,
+            argv + optind, argc - optind);
+    wait_nodes ();
+
+    if (!(tids = calloc (n_threads, sizeof (*tids)))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+            "Failed to allocate %d threads", n_threads);
+    }
+    (void) gettimeofday (&t_start, NULL);
+    for (i = 0; i < n_threads; i++) {
+        if ((errno = pthread_create (&tids[i], NULL,
+                (void * (*) (void *)) sim_thread, &sim)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to create thread #%d", i + 1);
+        }
+    }
+    for (i = 0; i < n_threads; i++) {
+        if ((errno = pthread_join (tids[i], NULL)) != 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to join thread #%d", i + 1);
+        }
+    }
+    (void) gettimeofday (&t_stop, NULL);
+    secs = diff_secs (&t_start, &t_stop);
+    if (secs <= 0.0) {
+        secs = 1e-6;
+    }
+    stop_nodes ();
+
+    n_ops = sim.n_encodes + sim.n_decodes;
+    printf ("nodes=%d pattern=%s threads=%d creds=%lu secs=%0.3f\n",
+            n_nodes, pattern_str, n_threads, sim.n_creds, secs);
+    printf ("encodes=%lu decodes=%lu encodes_per_sec=%0.0f "
+            "decodes_per_sec=%0.0f\n",
+            sim.n_encodes, sim.n_decodes, sim.n_encodes / secs,
+            sim.n_decodes / secs);
+    printf ("encode_errs=%lu decode_errs=%lu replayed=%lu err_rate=%0.4f\n",
+            sim.n_encode_errs, sim.n_decode_errs, sim.n_replayed,
+            (n_ops > 0)
+                ? (double) (sim.n_encode_errs + sim.n_decode_errs) / n_ops
+                : 0.0);
+    for (i = 0, total = 0; i < n_nodes; i++) {
+        printf ("node=%d replay_hash=%ld\n", i, nodes[i].replay_count);
+        if ((total >= 0) && (nodes[i].replay_count >= 0)) {
+            total += nodes[i].replay_count;
+        }
+        else {
+            total = -1;
+        }
+    }
+    printf ("replay_hash_total=%ld\n", total);
+
+    free (tids);
+    free (sim.payload);
+    (void) pthread_mutex_destroy (&sim.mutex);
+    exit (((sim.n_encode_errs + sim.n_decode_errs) == 0)
+            ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
+static long
+get_num (const char *s, const char *name, long min, long max)
+{
+    char *p;
+    long  l;
+
+    errno = 0;
+    l = strtol (s, &p, 10);
+    if ((errno != 0) || (s == p) || (*p != '\0') || (l < min) || (l > max)) {
+        log_err (EMUNGE_SNAFU, LOG_ERR, "Invalid value \"%s\" for %s",
+            s, name);
+    }
+    return (l);
+}
+
+
+static void
+start_nodes (const char *munged, const char *keyfile, const char *dir,
+             const char *socket_dir, char **extra_args, int n_extra_args)
+{
+/*  Starts [n_nodes] munged processes in the foreground, each with its own
+ *    socket in [socket_dir] and its own pidfile, logfile, and seedfile in
+ *    [dir], but all sharing the key in [keyfile].
+ *  Since munged logs to stderr in the foreground, each node's stderr is
+ *    redirected to its logfile.
+ *  The socket is kept apart from the other files since its pathname is
+ *    limited in length.
+ */
+    struct node  *np;
+    char        **av;
+    int           ac;
+    int           fd;
+    int           i;
+    int           j;
+
+    if (!(nodes = calloc (n_nodes, sizeof (*nodes)))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+            "Failed to allocate %d nodes", n_nodes);
+    }
+    if (!(av = calloc (n_extra_args + 8, sizeof (*av)))) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+            "Failed to allocate daemon args");
+    }
+    for (i = 0; i < n_nodes; i++) {
+        np = &nodes[i];
+        np->socket = strdupf ("%s/clustersim.%d.%d.sock",
+                socket_dir, (int) getpid (), i);
+        np->pidfile = strdupf ("%s/node.%d.pid", dir, i);
+        np->logfile = strdupf ("%s/node.%d.log", dir, i);
+        np->seedfile = strdupf ("%s/node.%d.seed", dir, i);
+        if (!np->socket || !np->pidfile || !np->logfile || !np->seedfile) {
+            log_errno (EMUNGE_NO_MEMORY, LOG_ERR,
+                "Failed to allocate node %d filenames", i);
+        }
+        np->replay_count = -1;
+        (void) unlink (np->pidfile);
+        (void) unlink (np->logfile);
+
+        ac = 0;
+        av[ac++] = (char *) munged;
+        av[ac++] = "--foreground";
+        av[ac++] = strdupf ("--socket=%s", np->socket);
+        av[ac++] = strdupf ("--key-file=%s", keyfile);
+        av[ac++] = strdupf ("--pid-file=%s", np->pidfile);
+        av[ac++] = strdupf ("--seed-file=%s", np->seedfile);
+        av[ac++] = "--group-update-time=-1";
+        for (j = 0; j < n_extra_args; j++) {
+            av[ac++] = extra_args[j];
+        }
+        av[ac] = NULL;
+
+        if ((np->pid = fork ()) < 0) {
+            log_errno (EMUNGE_SNAFU, LOG_ERR, "Failed to fork node %d", i);
+        }
+        else if (np->pid == 0) {
+            fd = open (np->logfile, O_WRONLY | O_CREAT | O_APPEND, 0640);
+            if ((fd < 0) || (dup2 (fd, STDERR_FILENO) < 0)) {
+                _exit (127);
+            }
+            (void) close (fd);
+            (void) execv (munged, av);
+            _exit (127);
+        }
+        for (j = 2; j < 6; j++) {
+            free (av[j]);
+        }
+    }
+    free (av);
+    return;
+}
+
+
+static void
+wait_nodes (void)
+{
+/*  Waits for each node to write its pidfile, which munged does once its
+ *    socket is ready.
+ */
+    struct node *np;
+    int          i;
+    int          msecs;
+
+    for (i = 0; i < n_nodes; i++) {
+        np = &nodes[i];
+        for (msecs = 0; access (np->pidfile, F_OK) < 0; msecs += 10) {
+            if (waitpid (np->pid, NULL, WNOHANG) != 0) {
+                np->pid = 0;
+                log_err (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to start node %d: See \"%s\"", i, np->logfile);
+            }
+            if (msecs >= START_MSECS) {
+                log_err (EMUNGE_SNAFU, LOG_ERR,
+                    "Failed to start node %d: Timed-out", i);
+            }
+            (void) usleep (10000);
+        }
+    }
+    return;
+}
+
+
+static void
+stop_nodes (void)
+{
+/*  Stops the nodes that are still running, and reads the size of each
+ *    node's replay hash from its logfile.
+ */
+    int i;
+
+    if (nodes == NULL) {
+        return;
+    }
+    for (i = 0; i < n_nodes; i++) {
+        if (nodes[i].pid > 0) {
+            (void) kill (nodes[i].pid, SIGTERM);
+        }
+    }
+    for (i = 0; i < n_nodes; i++) {
+        if (nodes[i].pid > 0) {
+            (void) waitpid (nodes[i].pid, NULL, 0);
+            nodes[i].pid = 0;
+            read_replay_count (&nodes[i]);
+        }
+    }
+    return;
+}
+
+
+static void
+read_replay_count (struct node *np)
+{
+/*  Sets the replay count of node [np] from the message logged by munged
+ *    at exit, or to -1 if not found.
+ */
+    FILE *fp;
+    char  buf[1024];
+    char *p;
+    long  l;
+
+    np->replay_count = -1;
+    if (!(fp = fopen (np->logfile, "r"))) {
+        return;
+    }
+    while (fgets (buf, sizeof (buf), fp) != NULL) {
+        if ((p = strstr (buf, "Replay hash: ")) != NULL
+                && (sscanf (p, "Replay hash: %ld", &l) == 1)) {
+            np->replay_count = l;
+        }
+    }
+    (void) fclose (fp);
+    return;
+}
+
+
+static void *
+sim_thread (struct sim *sp)
+{
+/*  Encodes and decodes credentials across the nodes according to the
+ *    traffic pattern of [sp] until the credential count is reached.
+ *  Each node gets separate encode and decode contexts since a decode error
+ *    could place the context in an invalid state for encoding.
+ */
+    munge_ctx_t    *ectx;
+    munge_ctx_t    *dctx;
+    unsigned long   k;
+    unsigned long   n_encodes = 0;
+    unsigned long   n_decodes = 0;
+    unsigned long   n_encode_errs = 0;
+    unsigned long   n_decode_errs = 0;
+    unsigned long   n_replayed = 0;
+    munge_err_t     e;
+    char           *cred;
+    int             src;
+    int             dst;
+    int             i;
+
+    ectx = calloc (n_nodes, sizeof (*ectx));
+    dctx = calloc (n_nodes, sizeof (*dctx));
+    if ((ectx == NULL) || (dctx == NULL)) {
+        log_errno (EMUNGE_NO_MEMORY, LOG_ERR, "Failed to allocate contexts");
+    }
+    for (i = 0; i < n_nodes; i++) {
+        if (!(ectx[i] = munge_ctx_create ())
+                || !(dctx[i] = munge_ctx_create ())
+                || (munge_ctx_set (ectx[i], MUNGE_OPT_SOCKET,
+                        nodes[i].socket) != EMUNGE_SUCCESS)
+                || (munge_ctx_set (dctx[i], MUNGE_OPT_SOCKET,
+                        nodes[i].socket) != EMUNGE_SUCCESS)) {
+            log_err (EMUNGE_SNAFU, LOG_ERR,
+                "Failed to create contexts for node %d", i);
+        }
+    }
+    for (;;) {
+        (void) pthread_mutex_lock (&sp->mutex);
+        k = sp->next;
+        if (k < sp->n_creds) {
+            sp->next++;
+        }
+        (void) pthread_mutex_unlock (&sp->mutex);
+        if (k >= sp->n_creds) {
+            break;
+        }
+        src = k % n_nodes;
+        dst = (n_nodes > 1)
+            ? (src + 1 + (int) ((k / n_nodes) % (n_nodes - 1))) % n_nodes
+            : src;
+
+        e = munge_encode (&cred, ectx[src], sp->payload, sp->length);
+        n_encodes++;
+        if (e != EMUNGE_SUCCESS) {
+            log_msg (LOG_WARNING, "Failed to encode on node %d: %s",
+                src, munge_ctx_strerror (ectx[src]));
+            n_encode_errs++;
+            continue;
+        }
+        switch (sp->pattern) {
+            case PATTERN_PAIR:
+                n_decodes++;
+                n_decode_errs += (sim_decode (dctx[dst], cred)
+                        != EMUNGE_SUCCESS);
+                break;
+            case PATTERN_FANOUT:
+                for (i = 0; i < n_nodes; i++) {
+                    n_decodes++;
+                    n_decode_errs += (sim_decode (dctx[i], cred)
+                            != EMUNGE_SUCCESS);
+                }
+                break;
+            case PATTERN_REPLAY:
+                n_decodes += 2;
+                n_decode_errs += (sim_decode (dctx[dst], cred)
+                        != EMUNGE_SUCCESS);
+                e = sim_decode (dctx[dst], cred);
+                if (e == EMUNGE_CRED_REPLAYED) {
+                    n_replayed++;
+                }
+                else {
+                    log_msg (LOG_WARNING,
+                        "Failed to detect replay on node %d", dst);
+                    n_decode_errs++;
+                }
+                break;
+        }
+        free (cred);
+    }
+    for (i = 0; i < n_nodes; i++) {
+        munge_ctx_destroy (ectx[i]);
+        munge_ctx_destroy (dctx[i]);
+    }
+    free (ectx);
+    free (dctx);
+
+    (void) pthread_mutex_lock (&sp->mutex);
+    sp->n_encodes += n_encodes;
+    sp->n_decodes += n_decodes;
+    sp->n_encode_errs += n_encode_errs;
+    sp->n_decode_errs += n_decode_errs;
+    sp->n_replayed += n_replayed;
+    (void) pthread_mutex_unlock (&sp->mutex);
+    return (NULL);
+}
+
+
+static int
+sim_decode (munge_ctx_t ctx, const char *cred)
+{
+/*  Decodes [cred] via the node of [ctx], discarding the payload.
+ *  Returns the munge error; errors other than a replay are logged.
+ */
+    munge_err_t  e;
+    void        *data = NULL;
+    int          len;
+
+    e = munge_decode (cred, ctx, &data, &len, NULL, NULL);
+    if ((e != EMUNGE_SUCCESS) && (e != EMUNGE_CRED_REPLAYED)) {
+        log_msg (LOG_WARNING, "Failed to decode: %s",
+            munge_ctx_strerror (ctx));
+    }
+    free (data);
+    return (e);
+}
+
+
+static double
+diff_secs (const struct timeval *t0, const struct timeval *t1)
+{
+    return ((t1->tv_sec - t0->tv_sec) + ((t1->tv_usec - t0->tv_usec) / 1e6));
+}
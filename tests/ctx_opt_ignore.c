@@ -90,6 +90,7 @@ main (int argc, char *argv[])
     plan (NO_PLAN);
     test_opt (MUNGE_OPT_IGNORE_TTL, "ignore-ttl");
     test_opt (MUNGE_OPT_IGNORE_REPLAY, "ignore-replay");
+    test_opt (MUNGE_OPT_METADATA_ONLY, "metadata-only");
     done_testing ();
     exit (EXIT_SUCCESS);
 }
@@ -0,0 +1,304 @@
+/*****************************************************************************
+ *  Copyright (C) 2007-2025 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2002-2007 The Regents of the University of California.
+ *  UCRL-CODE-155910.
+ *
+ *  This file is part of the MUNGE Uid 'N' Gid Emporium (MUNGE).
+ *  For details, see <https://github.com/dun/munge>.
+ *
+ *  MUNGE is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.  Additionally for the MUNGE library (libmunge), you
+ *  can redistribute it and/or modify it under the terms of the GNU Lesser
+ *  General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or (at your option) any later version.
+ *
+ *  MUNGE is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  and GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  and GNU Lesser General Public License along with MUNGE.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+/*  Malloc-counting preload shim for measuring munged's heap usage.
+ *
+ *  When preloaded (via LD_PRELOAD), this counts heap allocations and tracks
+ *    the current & peak number of bytes allocated.  At exit, these counters
+ *    are written to the file "${MEMSTAT_FILE}.PID" as a single line of the
+ *    form "allocs=N peak_bytes=N cur_bytes=N".
+ *
+ *  Each block is prefixed with a header recording its requested size and
+ *    the address returned by the underlying malloc(), so aligned allocations
+ *    are carved out of an ordinary one and realloc() always moves the block.
+ *    Requests made while the underlying allocator is being resolved are
+ *    served from a static arena and never freed.
+ */
+
+
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE                   /* for RTLD_NEXT */
+#endif /* !_GNU_SOURCE */
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define MEMSTAT_ALIGN           16
+#define MEMSTAT_ARENA_LEN       65536
+
+struct memstat_hdr {
+    size_t              size;           /* num bytes requested by caller     */
+    void               *base;           /* addr returned by real malloc()    */
+};
+
+static void * (*_real_malloc) (size_t) = NULL;
+static void   (*_real_free) (void *) = NULL;
+
+static pthread_mutex_t  _memstat_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long    _memstat_allocs = 0;
+static size_t           _memstat_cur_bytes = 0;
+static size_t           _memstat_peak_bytes = 0;
+
+static unsigned char    _memstat_arena [MEMSTAT_ARENA_LEN]
+                            __attribute__ ((aligned (MEMSTAT_ALIGN)));
+static size_t           _memstat_arena_used = 0;
+static int              _memstat_is_resolving = 0;
+
+
+static void
+_memstat_resolve (void)
+{
+    if (_real_malloc != NULL) {
+        return;
+    }
+    _memstat_is_resolving = 1;
+    _real_malloc = (void * (*) (size_t)) dlsym (RTLD_NEXT, "malloc");
+    _real_free = (void (*) (void *)) dlsym (RTLD_NEXT, "free");
+    _memstat_is_resolving = 0;
+    if ((_real_malloc == NULL) || (_real_free == NULL)) {
+        abort ();
+    }
+}
+
+
+static int
+_memstat_is_arena (const void *p)
+{
+    return (((const unsigned char *) p >= _memstat_arena)
+            && ((const unsigned char *) p
+                < _memstat_arena + MEMSTAT_ARENA_LEN));
+}
+
+
+static void
+_memstat_count (size_t size, int is_alloc)
+{
+    (void) pthread_mutex_lock (&_memstat_mutex);
+    if (is_alloc) {
+        _memstat_allocs++;
+        _memstat_cur_bytes += size;
+        if (_memstat_cur_bytes > _memstat_peak_bytes) {
+            _memstat_peak_bytes = _memstat_cur_bytes;
+        }
+    }
+    else {
+        _memstat_cur_bytes -= size;
+    }
+    (void) pthread_mutex_unlock (&_memstat_mutex);
+}
+
+
+static void *
+_memstat_alloc (size_t size, size_t align)
+{
+    struct memstat_hdr *hdr;
+    unsigned char      *base;
+    uintptr_t           p;
+    size_t              len;
+
+    if (align < MEMSTAT_ALIGN) {
+        align = MEMSTAT_ALIGN;
+    }
+    len = size + sizeof (*hdr) + align;
+    if (len < size) {
+        errno = ENOMEM;
+        return (NULL);
+    }
+    if (_real_malloc == NULL) {
+        if (_memstat_is_resolving) {
+            if (_memstat_arena_used + len > MEMSTAT_ARENA_LEN) {
+                errno = ENOMEM;
+                return (NULL);
+            }
+            base = _memstat_arena + _memstat_arena_used;
+            _memstat_arena_used += len;
+            p = ((uintptr_t) base + sizeof (*hdr) + align - 1) & ~(align - 1);
+            hdr = (struct memstat_hdr *) p - 1;
+            hdr->size = size;
+            hdr->base = base;
+            return ((void *) p);
+        }
+        _memstat_resolve ();
+    }
+    if ((base = _real_malloc (len)) == NULL) {
+        return (NULL);
+    }
+    p = ((uintptr_t) base + sizeof (*hdr) + align - 1) & ~(align - 1);
+    hdr = (struct memstat_hdr *) p - 1;
+    hdr->size = size;
+    hdr->base = base;
+    _memstat_count (size, 1);
+    return ((void *) p);
+}
+
+
+void *
+malloc (size_t size)
+{
+    return (_memstat_alloc (size, 0));
+}
+
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+    void *p;
+
+    if ((size != 0) && (nmemb > SIZE_MAX / size)) {
+        errno = ENOMEM;
+        return (NULL);
+    }
+    if ((p = _memstat_alloc (nmemb * size, 0)) != NULL) {
+        memset (p, 0, nmemb * size);
+    }
+    return (p);
+}
+
+
+void
+free (void *p)
+{
+    struct memstat_hdr *hdr;
+
+    if ((p == NULL) || _memstat_is_arena (p)) {
+        return;
+    }
+    hdr = (struct memstat_hdr *) p - 1;
+    _memstat_count (hdr->size, 0);
+    _real_free (hdr->base);
+}
+
+
+void *
+realloc (void *p, size_t size)
+{
+    struct memstat_hdr *hdr;
+    void               *q;
+
+    if (p == NULL) {
+        return (malloc (size));
+    }
+    if ((q = malloc (size)) == NULL) {
+        return (NULL);
+    }
+    hdr = (struct memstat_hdr *) p - 1;
+    memcpy (q, p, (hdr->size < size) ? hdr->size : size);
+    free (p);
+    return (q);
+}
+
+
+void *
+reallocarray (void *p, size_t nmemb, size_t size)
+{
+    if ((size != 0) && (nmemb > SIZE_MAX / size)) {
+        errno = ENOMEM;
+        return (NULL);
+    }
+    return (realloc (p, nmemb * size));
+}
+
+
+int
+posix_memalign (void **pp, size_t align, size_t size)
+{
+    void *p;
+
+    if ((align == 0) || ((align & (align - 1)) != 0)
+            || ((align % sizeof (void *)) != 0)) {
+        return (EINVAL);
+    }
+    if ((p = _memstat_alloc (size, align)) == NULL) {
+        return (ENOMEM);
+    }
+    *pp = p;
+    return (0);
+}
+
+
+void *
+aligned_alloc (size_t align, size_t size)
+{
+    return (_memstat_alloc (size, align));
+}
+
+
+void *
+memalign (size_t align, size_t size)
+{
+    return (_memstat_alloc (size, align));
+}
+
+
+void *
+valloc (size_t size)
+{
+    return (_memstat_alloc (size, sysconf (_SC_PAGESIZE)));
+}
+
+
+__attribute__ ((destructor))
+static void
+_memstat_report (void)
+{
+    const char *name;
+    char        path [4096];
+    char        buf [256];
+    int         fd;
+    int         n;
+
+    if ((name = getenv ("MEMSTAT_FILE")) == NULL) {
+        return;
+    }
+    n = snprintf (path, sizeof (path), "%s.%d", name, (int) getpid ());
+    if ((n < 0) || ((size_t) n >= sizeof (path))) {
+        return;
+    }
+    (void) pthread_mutex_lock (&_memstat_mutex);
+    n = snprintf (buf, sizeof (buf), "allocs=%lu peak_bytes=%lu "
+            "cur_bytes=%lu\n", _memstat_allocs,
+            (unsigned long) _memstat_peak_bytes,
+            (unsigned long) _memstat_cur_bytes);
+    (void) pthread_mutex_unlock (&_memstat_mutex);
+    if ((fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+        return;
+    }
+    (void) write (fd, buf, n);
+    (void) close (fd);
+}
@@ -5,14 +5,22 @@
 MUNGE="${MUNGE_BUILD_DIR}/src/munge/munge"
 UNMUNGE="${MUNGE_BUILD_DIR}/src/munge/unmunge"
 REMUNGE="${MUNGE_BUILD_DIR}/src/munge/remunge"
+MUNGEAUDIT="${MUNGE_BUILD_DIR}/src/munge/mungeaudit"
 MUNGED="${MUNGE_BUILD_DIR}/src/munged/munged"
 MUNGEKEY="${MUNGE_BUILD_DIR}/src/mungekey/mungekey"
 
+# Set paths to test helpers built by "make check".
+#
+BADCLIENT="${MUNGE_BUILD_DIR}/tests/badclient"
+CLUSTERSIM="${MUNGE_BUILD_DIR}/tests/clustersim"
+
 # Require executables to be built before tests can proceed.
 #
 set_executables()
 {
     local prog
+    local memstat_la="${MUNGE_BUILD_DIR}/tests/memstat.la"
+
     for prog in "${MUNGE}" "${UNMUNGE}" "${REMUNGE}" "${MUNGED}" "${MUNGEKEY}"
     do
         if test ! -x "${prog}"; then
@@ -20,6 +28,14 @@ set_executables()
             exit 1
         fi
     done
+
+    # Set path to the memstat preload shim built by "make check" (if any).
+    #   Its shared object name is taken from its libtool archive.
+    MEMSTAT=
+    if test -f "${memstat_la}"; then
+        MEMSTAT="${MUNGE_BUILD_DIR}/tests/.libs/$(sed -n \
+            "s/^dlname='\(.*\)'\$/\1/p" "${memstat_la}")"
+    fi
 }
 
 set_executables